@@ -4356,6 +4356,17 @@ class V8_EXPORT Isolate {
    */
   void RequestInterrupt(InterruptCallback callback, void* data);
 
+  /**
+   * RuntimeJs needs this to preempt isolates from timer interrupt
+   *
+   * Same as RequestInterrupt(callback, data), but doesn't take isolate
+   * execution access lock, interrupted code might hold it already.
+   * Request may be lost if it races with code which handles interrupts,
+   * caller should repeat it until |callback| runs. Request is dropped
+   * (asserts in debug builds) while a different callback is pending.
+   */
+  void RequestInterruptFromIrq(InterruptCallback callback, void* data);
+
   /**
    * Clear interrupt request created by |RequestInterrupt|.
    * Can be called from another thread without acquiring a |Locker|.
@@ -6562,6 +6562,22 @@ void Isolate::RequestInterrupt(InterruptCallback callback, void* data) {
 }
 
 
+void Isolate::RequestInterruptFromIrq(InterruptCallback callback, void* data) {
+  i::Isolate* i_isolate = reinterpret_cast<i::Isolate*>(this);
+  // Only one callback fits, don't replace the one installed by
+  // RequestInterrupt. Callback is cleared before it runs, caller
+  // repeats the request until it gets through
+  InterruptCallback current = i_isolate->api_interrupt_callback();
+  bool in_use = current != NULL && (current != callback ||
+      i_isolate->api_interrupt_callback_data() != data);
+  ASSERT(!in_use);
+  if (in_use) return;
+  i_isolate->set_api_interrupt_callback(callback);
+  i_isolate->set_api_interrupt_callback_data(data);
+  i_isolate->stack_guard()->RequestApiInterruptUnlocked();
+}
+
+
 void Isolate::ClearInterrupt() {
   i::Isolate* i_isolate = reinterpret_cast<i::Isolate*>(this);
   i_isolate->stack_guard()->ClearApiInterrupt();
@@ -350,6 +350,21 @@ void StackGuard::RequestInterrupt(int flagbit) {
 }
 
 
+void StackGuard::RequestApiInterruptUnlocked() {
+  ASSERT(isolate_ != NULL);
+  // Locked OR can't lose flags set by other CPUs. Interrupted code on
+  // this CPU may be between load and store of its own read-modify-write
+  // of flags or stack limits (under ExecutionAccess) and overwrite the
+  // request when it resumes. That is not detected here, RuntimeJs timer
+  // repeats the request on every tick until the callback runs.
+  __sync_fetch_and_or(&thread_local_.interrupt_flags_, 1 << API_INTERRUPT);
+  if (thread_local_.postpone_interrupts_nesting_ > 0) return;
+  thread_local_.jslimit_ = kInterruptLimit;
+  thread_local_.climit_ = kInterruptLimit;
+  isolate_->heap()->SetStackLimits();
+}
+
+
 void StackGuard::ClearInterrupt(int flagbit) {
   ExecutionAccess access(isolate_);
   thread_local_.interrupt_flags_ &= ~flagbit;
@@ -161,6 +161,11 @@ class StackGuard V8_FINAL {
   INTERRUPT_LIST(V)
 #undef V
 
+  // RuntimeJs: request API interrupt from interrupt handler, without
+  // execution access lock. Interrupted code may be in the middle of
+  // clearing interrupts and lose the request, caller repeats it.
+  void RequestApiInterruptUnlocked();
+
   // This provides an asynchronous read of the stack limits for the current
   // thread.  There are no locks protecting this, but it is assumed that you
   // have the global V8 lock if you are using multiple V8 threads.
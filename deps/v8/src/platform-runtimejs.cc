@@ -22,6 +22,9 @@
 #include <kernel/platform.h>
 #include <kernel/native-thread.h>
 #include <kernel/boot-services.h>
+#include <kernel/clock.h>
+#include <kernel/mem-manager.h>
+#include <kernel/thread.h>
 
 #include "v8.h"
 
@@ -30,8 +33,6 @@
 #include "vm-state-inl.h"
 #include "codegen.h"
 
-extern "C" int sched_yield(void);
-
 namespace v8 {
 namespace internal {
 
@@ -82,8 +83,10 @@ int OS::GetCurrentProcessId() {
 
 
 int OS::GetUserTime(uint32_t* secs,  uint32_t* usecs) {
-  *secs = static_cast<uint32_t>(1);
-  *usecs = static_cast<uint32_t>(1);
+  // No per-thread CPU time accounting, use time since boot
+  uint64_t us = GLOBAL_clock()->MonotonicNanos() / 1000;
+  *secs = static_cast<uint32_t>(us / 1000000);
+  *usecs = static_cast<uint32_t>(us % 1000000);
   return 0;
 }
 
@@ -200,7 +203,7 @@ void OS::StrNCpy(char* dest, int length, const char* src, size_t n) {
 
 
 void Thread::YieldCPU() {
-  sched_yield();
+  GLOBAL_native_threads()->Yield();
 }
 
 
@@ -326,6 +329,17 @@ void OS::SignalCodeMovingGC() {
 }
 
 
+// Reservations are charged to the kernel thread which owns
+// current isolate (isolate data slot 0)
+static rt::VmAccount* CurrentVmAccount() {
+  Isolate* isolate = Isolate::UncheckedCurrent();
+  if (isolate == NULL) return NULL;
+  rt::Thread* thread = reinterpret_cast<rt::Thread*>(isolate->GetData(0));
+  if (thread == NULL) return NULL;
+  return &thread->vm_account();
+}
+
+
 VirtualMemory::VirtualMemory() : address_(NULL), size_(0) { }
 
 
@@ -336,13 +350,15 @@ VirtualMemory::VirtualMemory(size_t size)
 VirtualMemory::VirtualMemory(size_t size, size_t alignment)
     : address_(NULL), size_(0) {
   ASSERT(IsAligned(alignment, static_cast<intptr_t>(OS::AllocateAlignment())));
-  size_t request_size = RoundUp(size + alignment,
+  size_t request_size = RoundUp(size,
                                 static_cast<intptr_t>(OS::AllocateAlignment()));
 
-  void* reservation = memalign(alignment, request_size);
-  Address base = static_cast<Address>(reservation);
-  Address aligned_base = RoundUp(base, alignment);
-  ASSERT_EQ(base, aligned_base);
+  // Kernel reservations are aligned, no need to over-reserve
+  void* reservation = GLOBAL_mem_manager()->ReserveRegion(request_size,
+      alignment, CurrentVmAccount());
+  if (reservation == NULL) return;
+  ASSERT_EQ(static_cast<Address>(reservation),
+            RoundUp(static_cast<Address>(reservation), alignment));
 
   address_ = reservation;
   size_ = request_size;
@@ -370,12 +386,12 @@ void VirtualMemory::Reset() {
 
 
 bool VirtualMemory::Commit(void* address, size_t size, bool is_executable) {
-  return true;
+  return CommitRegion(address, size, is_executable);
 }
 
 
 bool VirtualMemory::Uncommit(void* address, size_t size) {
-  return true;
+  return UncommitRegion(address, size);
 }
 
 
@@ -386,29 +402,28 @@ bool VirtualMemory::Guard(void* address) {
 
 
 void* VirtualMemory::ReserveRegion(size_t size) {
-  void* addr = memalign(0x200000, size);
-  return addr;
+  return GLOBAL_mem_manager()->ReserveRegion(size, 0, CurrentVmAccount());
 }
 
 
 bool VirtualMemory::CommitRegion(void* base, size_t size, bool is_executable) {
-  return true;
+  return GLOBAL_mem_manager()->CommitRegion(base, size);
 }
 
 
 bool VirtualMemory::UncommitRegion(void* base, size_t size) {
-  return true;
+  return GLOBAL_mem_manager()->UncommitRegion(base, size);
 }
 
 
 bool VirtualMemory::ReleaseRegion(void* base, size_t size) {
-  free(base);
-  return true;
+  return GLOBAL_mem_manager()->ReleaseRegion(base, size);
 }
 
 
 bool VirtualMemory::HasLazyCommits() {
-  return false;
+  // Committed pages are mapped on first access
+  return true;
 }
 
 
@@ -432,10 +447,9 @@ Thread::~Thread() {
 }
 
 
-static void* ThreadEntry(void* arg) {
+static void ThreadEntry(void* arg) {
   Thread* thread = reinterpret_cast<Thread*>(arg);
   thread->NotifyStartedAndRun();
-  return NULL;
 }
 
 
@@ -446,12 +460,16 @@ void Thread::set_name(const char* name) {
 
 
 void Thread::Start() {
-  ASSERT(!"Thread::Start");
+  ASSERT(data_->thread_.empty());
+  data_->thread_ = GLOBAL_native_threads()->Create(name_,
+      static_cast<uint32_t>(stack_size_), ThreadEntry, this);
+  ASSERT(!data_->thread_.empty());
 }
 
 
 void Thread::Join() {
-  ASSERT(!"Thread::Join");
+  GLOBAL_native_threads()->Join(data_->thread_);
+  data_->thread_ = rt::NativeThreadHandle();
 }
 
 
@@ -9,6 +9,10 @@
 
 #include "src/platform/time.h"
 
+#if V8_OS_RUNTIMEJS
+#include <kernel/clock.h>
+#endif
+
 namespace v8 {
 namespace internal {
 
@@ -317,6 +321,40 @@ bool ConditionVariable::WaitFor(Mutex* mutex, const TimeDelta& rel_time) {
   return result;
 }
 
+#elif V8_OS_RUNTIMEJS
+
+ConditionVariable::ConditionVariable() {}
+
+
+ConditionVariable::~ConditionVariable() {}
+
+
+void ConditionVariable::NotifyOne() {
+  native_handle_.NotifyOne();
+}
+
+
+void ConditionVariable::NotifyAll() {
+  native_handle_.NotifyAll();
+}
+
+
+void ConditionVariable::Wait(Mutex* mutex) {
+  mutex->AssertHeldAndUnmark();
+  native_handle_.WaitUntil(&mutex->native_handle(), 0);
+  mutex->AssertUnheldAndMark();
+}
+
+
+bool ConditionVariable::WaitFor(Mutex* mutex, const TimeDelta& rel_time) {
+  int64_t ns = rel_time.InMicroseconds() * 1000;
+  uint64_t deadline = GLOBAL_clock()->MonotonicNanos() + (ns > 0 ? ns : 0);
+  mutex->AssertHeldAndUnmark();
+  bool result = native_handle_.WaitUntil(&mutex->native_handle(), deadline);
+  mutex->AssertUnheldAndMark();
+  return result;
+}
+
 #endif  // V8_OS_POSIX
 
 } }  // namespace v8::internal
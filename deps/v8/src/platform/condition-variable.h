@@ -81,6 +81,8 @@ class ConditionVariable V8_FINAL {
 
     DISALLOW_COPY_AND_ASSIGN(NativeHandle);
   };
+#elif V8_OS_RUNTIMEJS
+  typedef rt::NativeConditionVariable NativeHandle;
 #endif
 
   NativeHandle& native_handle() {
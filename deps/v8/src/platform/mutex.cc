@@ -78,36 +78,31 @@ static V8_INLINE bool TryLockNativeHandle(pthread_mutex_t* mutex) {
 
 #elif V8_OS_RUNTIMEJS
 
-static V8_INLINE void InitializeNativeHandle(rt::Locker* cs) {
-
+static V8_INLINE void InitializeNativeHandle(rt::NativeMutex* mutex) {
 }
 
 
-static V8_INLINE void InitializeRecursiveNativeHandle(rt::Locker* cs) {
-
+static V8_INLINE void InitializeRecursiveNativeHandle(rt::NativeMutex* mutex) {
+  mutex->SetRecursive();
 }
 
 
-static V8_INLINE void DestroyNativeHandle(rt::Locker* cs) {
-  
+static V8_INLINE void DestroyNativeHandle(rt::NativeMutex* mutex) {
 }
 
 
-static V8_INLINE void LockNativeHandle(rt::Locker* cs) {
-    rt::Spinlock lock(cs);
-    lock.lock();
+static V8_INLINE void LockNativeHandle(rt::NativeMutex* mutex) {
+  mutex->Lock();
 }
 
 
-static V8_INLINE void UnlockNativeHandle(rt::Locker* cs) {
-    rt::Spinlock lock(cs);
-    lock.unlock();
+static V8_INLINE void UnlockNativeHandle(rt::NativeMutex* mutex) {
+  mutex->Unlock();
 }
 
 
-static V8_INLINE bool TryLockNativeHandle(rt::Locker* cs) {
-    rt::Spinlock lock(cs);
-    return lock.tryLock();
+static V8_INLINE bool TryLockNativeHandle(rt::NativeMutex* mutex) {
+  return mutex->TryLock();
 }
 
 #elif V8_OS_WIN
@@ -16,7 +16,7 @@
 #endif
 
 #if V8_OS_RUNTIMEJS
-#include <kernel/spinlock.h>
+#include <kernel/native-sync.h>
 #endif
 
 namespace v8 {
@@ -62,7 +62,7 @@ class Mutex V8_FINAL {
 #elif V8_OS_WIN
   typedef CRITICAL_SECTION NativeHandle;
 #elif V8_OS_RUNTIMEJS
-  typedef rt::Locker NativeHandle;
+  typedef rt::NativeMutex NativeHandle;
 #endif
 
   NativeHandle& native_handle() {
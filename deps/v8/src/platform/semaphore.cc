@@ -10,7 +10,7 @@
 #endif
 
 #if V8_OS_RUNTIMEJS
-#include <kernel/cpu.h>
+#include <kernel/clock.h>
 #endif
 
 #include <errno.h>
@@ -192,10 +192,8 @@ bool Semaphore::WaitFor(const TimeDelta& rel_time) {
 
 #elif V8_OS_RUNTIMEJS
 
-// TODO: implement
-
-Semaphore::Semaphore(int count) {
-    native_handle_.Set(count);
+Semaphore::Semaphore(int count) : native_handle_(count) {
+  ASSERT(count >= 0);
 }
 
 
@@ -204,20 +202,19 @@ Semaphore::~Semaphore() {
 
 
 void Semaphore::Signal() {
-    native_handle_.AddFetch(1);
+  native_handle_.Signal();
 }
 
 
 void Semaphore::Wait() {
-    RT_ASSERT(0 == rt::Cpu::id() && "Only service process native thread can wait");
-    native_handle_.SubFetch(1);
-    RT_ASSERT(!"Need semapthore: wait");
+  native_handle_.Wait();
 }
 
 
 bool Semaphore::WaitFor(const TimeDelta& rel_time) {
-    RT_ASSERT(!"Need semapthore: waitfor");
-  return true;
+  int64_t ns = rel_time.InMicroseconds() * 1000;
+  uint64_t deadline = GLOBAL_clock()->MonotonicNanos() + (ns > 0 ? ns : 0);
+  return native_handle_.WaitUntil(deadline);
 }
 
 #endif  // V8_OS_MACOSX
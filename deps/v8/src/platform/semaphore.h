@@ -15,7 +15,7 @@
 #elif V8_OS_POSIX
 #include <semaphore.h>  // NOLINT
 #elif V8_OS_RUNTIMEJS
-#include <kernel/atomic.h>
+#include <kernel/native-sync.h>
 #endif
 
 namespace v8 {
@@ -58,7 +58,7 @@ class Semaphore V8_FINAL {
 #elif V8_OS_WIN
   typedef HANDLE NativeHandle;
 #elif V8_OS_RUNTIMEJS
-  typedef rt::Atomic<int32_t> NativeHandle;
+  typedef rt::NativeSemaphore NativeHandle;
 #endif
 
   NativeHandle& native_handle() {
@@ -14,6 +14,7 @@
 #include <kernel/kernel.h>
 #include <kernel/engines.h>
 #include <kernel/thread-manager.h>
+#include <kernel/clock.h>
 #endif
 
 #include <string.h>
@@ -337,14 +338,10 @@ Time Time::Now() {
   // Uncomment for snapshot generation
   // return Time(1);
 
-  // RT_ASSERT(::GLOBAL_engines()->cpu_engine());
-  // RT_ASSERT(::GLOBAL_engines()->cpu_engine()->thread_manager());
-  // int64_t ticks = ::GLOBAL_engines()->cpu_engine()->thread_manager()->ticks_count();
-  // int64_t per_tick = ::GLOBAL_engines()->MsPerTick();
-
-  // Supported 10ms precision at the moment, need to return
-  // time in microseconds
-  return Time(1000);
+  // RTC epoch read at boot plus TSC time since then,
+  // microseconds since Unix epoch
+  int64_t us = static_cast<int64_t>(::GLOBAL_clock()->WallClockMicros());
+  return Time(us > 0 ? us : 1);
 }
 
 
@@ -574,14 +571,8 @@ TimeTicks TimeTicks::HighResolutionNow() {
   USE(result);
   ticks = (tv.tv_sec * Time::kMicrosecondsPerSecond + tv.tv_usec);
 #elif V8_OS_RUNTIMEJS
-  // RT_ASSERT(::GLOBAL_engines()->cpu_engine());
-  // RT_ASSERT(::GLOBAL_engines()->cpu_engine()->thread_manager());
-  // int64_t platform_ticks = ::GLOBAL_engines()->cpu_engine()->thread_manager()->ticks_count();
-  // int64_t per_tick = ::GLOBAL_engines()->MsPerTick();
-
-  // Supported 10ms precision at the moment, need to return
-  // time in microseconds
-  ticks = 1000;
+  ticks = static_cast<int64_t>(::GLOBAL_clock()->MonotonicNanos() /
+                               Time::kNanosecondsPerMicrosecond);
 #elif V8_OS_POSIX
   struct timespec ts;
   int result = clock_gettime(CLOCK_MONOTONIC, &ts);
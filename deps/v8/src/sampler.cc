@@ -40,6 +40,11 @@
 
 #include "src/base/win32-headers.h"
 
+#elif V8_OS_RUNTIMEJS
+
+#include <kernel/kernel.h>
+#include <kernel/profiler.h>
+
 #endif
 
 #include "src/v8.h"
@@ -190,15 +195,38 @@ class Sampler::PlatformData : public PlatformDataCommon {
 
 #elif V8_OS_RUNTIMEJS
 
+// Samples are taken by kernel profiler from the local APIC timer
+// interrupt, there is no sampler thread and no signal delivery.
 class Sampler::PlatformData : public PlatformDataCommon {
  public:
-  PlatformData() : vm_tid_(1) {}
-  int vm_tid() const { return vm_tid_; }
+  PlatformData() {}
 
- private:
-  int vm_tid_;
+  static void HandleTimerSample(void* data, const rt::ProfilerRegisters& regs);
 };
 
+
+void Sampler::PlatformData::HandleTimerSample(
+    void* data, const rt::ProfilerRegisters& regs) {
+  Sampler* sampler = reinterpret_cast<Sampler*>(data);
+  Isolate* isolate = Isolate::UncheckedCurrent();
+  if (isolate == NULL || isolate != sampler->isolate() ||
+      !isolate->IsInitialized() || !isolate->IsInUse()) {
+    // Interrupted code does not belong to sampled isolate.
+    return;
+  }
+  if (v8::Locker::IsActive() &&
+      !isolate->thread_manager()->IsLockedByCurrentThread()) {
+    return;
+  }
+  if (!sampler->IsActive()) return;
+
+  RegisterState state;
+  state.pc = reinterpret_cast<Address>(regs.rip);
+  state.sp = reinterpret_cast<Address>(regs.rsp);
+  state.fp = reinterpret_cast<Address>(regs.rbp);
+  sampler->SampleStack(state);
+}
+
 #elif V8_OS_WIN || V8_OS_CYGWIN
 
 // ----------------------------------------------------------------------------
@@ -653,13 +681,22 @@ Sampler::~Sampler() {
 void Sampler::Start() {
   ASSERT(!IsActive());
   SetActive(true);
+#if V8_OS_RUNTIMEJS
+  int hz = interval_ > 0 ? 1000 / interval_ : 1000;
+  GLOBAL_profiler()->AddHook(&PlatformData::HandleTimerSample, this, hz);
+#else
   SamplerThread::AddActiveSampler(this);
+#endif
 }
 
 
 void Sampler::Stop() {
   ASSERT(IsActive());
+#if V8_OS_RUNTIMEJS
+  GLOBAL_profiler()->RemoveHook(&PlatformData::HandleTimerSample, this);
+#else
   SamplerThread::RemoveActiveSampler(this);
+#endif
   SetActive(false);
 }
 
@@ -707,7 +744,10 @@ void Sampler::DoSample() {
 #elif V8_OS_RUNTIMEJS
 
 void Sampler::DoSample() {
-  assert(false);
+  // Timer interrupt takes the samples. Profiler events processor
+  // calls this between sampling periods, give the CPU to the VM
+  // thread in case both run on the same CPU.
+  Thread::YieldCPU();
 }
 
 #elif V8_OS_WIN || V8_OS_CYGWIN
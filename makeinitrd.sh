@@ -1,3 +1,3 @@
 #!/bin/bash
 
-./mkinitrd -c disk/boot/initrd initrd
+./mkinitrd -c disk/boot/initrd initrd disk/initrd-gen
@@ -0,0 +1,114 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <runtimejs.h>
+
+namespace common {
+
+/**
+ * CPUID based feature detection, shared by kernel and host tools
+ */
+class CpuFeatures {
+public:
+    struct Registers {
+        uint32_t eax;
+        uint32_t ebx;
+        uint32_t ecx;
+        uint32_t edx;
+    };
+
+    inline static Registers Cpuid(uint32_t leaf, uint32_t subleaf = 0) {
+        Registers r;
+        asm volatile("cpuid"
+                     : "=a"(r.eax), "=b"(r.ebx), "=c"(r.ecx), "=d"(r.edx)
+                     : "a"(leaf), "c"(subleaf));
+        return r;
+    }
+
+    inline static uint32_t MaxLeaf() {
+        return Cpuid(0).eax;
+    }
+
+    /**
+     * Carry-less multiplication (PCLMULQDQ)
+     */
+    inline static bool HasPclmul() {
+        return 0 != (Cpuid(1).ecx & (1 << 1));
+    }
+
+    /**
+     * XSAVE/XRSTOR and XSETBV/XGETBV instructions
+     */
+    inline static bool HasXsave() {
+        return 0 != (Cpuid(1).ecx & (1 << 26));
+    }
+
+    /**
+     * XSAVEOPT instruction (skips unmodified state components)
+     */
+    inline static bool HasXsaveopt() {
+        if (MaxLeaf() < 0xd) {
+            return false;
+        }
+        return 0 != (Cpuid(0xd, 1).eax & 1);
+    }
+
+    /**
+     * 256-bit AVX registers
+     */
+    inline static bool HasAvx() {
+        return 0 != (Cpuid(1).ecx & (1 << 28));
+    }
+
+    /**
+     * 256-bit integer AVX2 instructions, usable only when OS
+     * enabled AVX state in XCR0
+     */
+    inline static bool HasAvx2() {
+        if (MaxLeaf() < 7 || 0 == (Cpuid(1).ecx & (1 << 27))) {
+            return false;
+        }
+        uint32_t xcr0_lo, xcr0_hi;
+        asm volatile("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+        if (0x6 != (xcr0_lo & 0x6)) {
+            return false;
+        }
+        return 0 != (Cpuid(7).ebx & (1 << 5));
+    }
+
+    /**
+     * Enhanced REP MOVSB/STOSB, string instructions are fast
+     * for large copies and fills
+     */
+    inline static bool HasErms() {
+        if (MaxLeaf() < 7) {
+            return false;
+        }
+        return 0 != (Cpuid(7).ebx & (1 << 9));
+    }
+
+    /**
+     * Time stamp counter runs at constant rate in all ACPI states
+     */
+    inline static bool HasInvariantTsc() {
+        if (Cpuid(0x80000000).eax < 0x80000007) {
+            return false;
+        }
+        return 0 != (Cpuid(0x80000007).edx & (1 << 8));
+    }
+};
+
+} // namespace common
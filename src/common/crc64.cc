@@ -38,6 +38,8 @@
  * POSSIBILITY OF SUCH DAMAGE. */
 
 #include <common/crc64.h>
+#include <common/cpu-features.h>
+#include <string.h>
 
 static const uint64_t crc64_tab[256] = {
     UINT64_C(0x0000000000000000), UINT64_C(0x7ad870c830358979),
@@ -170,7 +172,87 @@ static const uint64_t crc64_tab[256] = {
     UINT64_C(0x536fa08fdfd90e51), UINT64_C(0x29b7d047efec8728),
 };
 
+// Jones polynomial, normal (MSB first) form without x^64 term
+static const uint64_t kPoly = UINT64_C(0xad93d23594c935a9);
+
+// Shorter inputs are not worth folding setup
+static const uint64_t kPclmulMinLength = 128;
+
+typedef long long v2di __attribute__((vector_size(16)));
+
+static inline uint64_t Read64(const unsigned char* s) {
+    uint64_t value;
+    memcpy(&value, s, sizeof(uint64_t));
+    return value;
+}
+
+static uint64_t Reflect64(uint64_t value) {
+    uint64_t result = 0;
+    for (uint32_t i = 0; i < 64; ++i) {
+        result = (result << 1) | ((value >> i) & 1);
+    }
+    return result;
+}
+
+// x^n mod P, result is reflected to match register bit order
+static uint64_t XPowModReflected(uint32_t n) {
+    uint64_t r = 1;
+    for (uint32_t i = 0; i < n; ++i) {
+        bool carry = 0 != (r >> 63);
+        r <<= 1;
+        if (carry) {
+            r ^= kPoly;
+        }
+    }
+    return Reflect64(r);
+}
+
+/**
+ * Slicing tables and folding constants, built once
+ * during static initialization
+ */
+class CRC64Tables {
+public:
+    CRC64Tables() {
+        for (uint32_t n = 0; n < 256; ++n) {
+            slice[0][n] = crc64_tab[n];
+        }
+
+        for (uint32_t k = 1; k < 16; ++k) {
+            for (uint32_t n = 0; n < 256; ++n) {
+                uint64_t crc = slice[k - 1][n];
+                slice[k][n] = crc64_tab[crc & 0xff] ^ (crc >> 8);
+            }
+        }
+
+        // Folding 128-bit accumulator A forward by D bits:
+        // A * x^D = A_hi * x^(D+64) + A_lo * x^D. Product of two
+        // reflected values is shifted by one bit, so constants
+        // are x^(D+63) and x^(D-1). A_hi is in low qword.
+        static const uint32_t distances[] = { 128, 256, 384, 512 };
+        for (uint32_t i = 0; i < 4; ++i) {
+            fold[i][0] = XPowModReflected(distances[i] + 63);
+            fold[i][1] = XPowModReflected(distances[i] - 1);
+        }
+
+        use_pclmul = common::CpuFeatures::HasPclmul();
+    }
+
+    uint64_t slice[16][256];
+    uint64_t fold[4][2];
+    bool use_pclmul;
+};
+
+static CRC64Tables tables;
+
 uint64_t CRC64::Compute(uint64_t crc, const unsigned char* s, uint64_t l) {
+    if (tables.use_pclmul && l >= kPclmulMinLength) {
+        return ComputePclmul(crc, s, l);
+    }
+    return ComputeSlicing16(crc, s, l);
+}
+
+uint64_t CRC64::ComputeTable(uint64_t crc, const unsigned char* s, uint64_t l) {
     uint64_t j;
 
     for (j = 0; j < l; j++) {
@@ -179,3 +261,116 @@ uint64_t CRC64::Compute(uint64_t crc, const unsigned char* s, uint64_t l) {
     }
     return crc;
 }
+
+uint64_t CRC64::ComputeSlicing8(uint64_t crc, const unsigned char* s, uint64_t l) {
+    const uint64_t (*t)[256] = tables.slice;
+
+    while (l >= 8) {
+        crc ^= Read64(s);
+        crc = t[7][crc & 0xff] ^
+              t[6][(crc >> 8) & 0xff] ^
+              t[5][(crc >> 16) & 0xff] ^
+              t[4][(crc >> 24) & 0xff] ^
+              t[3][(crc >> 32) & 0xff] ^
+              t[2][(crc >> 40) & 0xff] ^
+              t[1][(crc >> 48) & 0xff] ^
+              t[0][crc >> 56];
+        s += 8;
+        l -= 8;
+    }
+
+    return ComputeTable(crc, s, l);
+}
+
+uint64_t CRC64::ComputeSlicing16(uint64_t crc, const unsigned char* s, uint64_t l) {
+    const uint64_t (*t)[256] = tables.slice;
+
+    while (l >= 16) {
+        uint64_t a = Read64(s) ^ crc;
+        uint64_t b = Read64(s + 8);
+        crc = t[15][a & 0xff] ^
+              t[14][(a >> 8) & 0xff] ^
+              t[13][(a >> 16) & 0xff] ^
+              t[12][(a >> 24) & 0xff] ^
+              t[11][(a >> 32) & 0xff] ^
+              t[10][(a >> 40) & 0xff] ^
+              t[9][(a >> 48) & 0xff] ^
+              t[8][a >> 56] ^
+              t[7][b & 0xff] ^
+              t[6][(b >> 8) & 0xff] ^
+              t[5][(b >> 16) & 0xff] ^
+              t[4][(b >> 24) & 0xff] ^
+              t[3][(b >> 32) & 0xff] ^
+              t[2][(b >> 40) & 0xff] ^
+              t[1][(b >> 48) & 0xff] ^
+              t[0][b >> 56];
+        s += 16;
+        l -= 16;
+    }
+
+    return ComputeSlicing8(crc, s, l);
+}
+
+__attribute__((target("pclmul,sse2")))
+static inline v2di Load128(const unsigned char* s) {
+    v2di value;
+    memcpy(&value, s, sizeof(v2di));
+    return value;
+}
+
+__attribute__((target("pclmul,sse2")))
+static inline v2di Fold(v2di a, v2di k) {
+    return __builtin_ia32_pclmulqdq128(a, k, 0x00) ^
+           __builtin_ia32_pclmulqdq128(a, k, 0x11);
+}
+
+__attribute__((target("pclmul,sse2")))
+uint64_t CRC64::ComputePclmul(uint64_t crc, const unsigned char* s, uint64_t l) {
+    if (l < kPclmulMinLength) {
+        return ComputeSlicing16(crc, s, l);
+    }
+
+    v2di k128 = { static_cast<long long>(tables.fold[0][0]),
+                  static_cast<long long>(tables.fold[0][1]) };
+    v2di k256 = { static_cast<long long>(tables.fold[1][0]),
+                  static_cast<long long>(tables.fold[1][1]) };
+    v2di k384 = { static_cast<long long>(tables.fold[2][0]),
+                  static_cast<long long>(tables.fold[2][1]) };
+    v2di k512 = { static_cast<long long>(tables.fold[3][0]),
+                  static_cast<long long>(tables.fold[3][1]) };
+
+    // Four independent accumulators, register is xored
+    // into the first 64 bits of the message
+    v2di x0 = Load128(s);
+    v2di x1 = Load128(s + 16);
+    v2di x2 = Load128(s + 32);
+    v2di x3 = Load128(s + 48);
+    v2di init = { static_cast<long long>(crc), 0 };
+    x0 ^= init;
+    s += 64;
+    l -= 64;
+
+    while (l >= 64) {
+        x0 = Fold(x0, k512) ^ Load128(s);
+        x1 = Fold(x1, k512) ^ Load128(s + 16);
+        x2 = Fold(x2, k512) ^ Load128(s + 32);
+        x3 = Fold(x3, k512) ^ Load128(s + 48);
+        s += 64;
+        l -= 64;
+    }
+
+    v2di a = Fold(x0, k384) ^ Fold(x1, k256) ^ Fold(x2, k128) ^ x3;
+
+    while (l >= 16) {
+        a = Fold(a, k128) ^ Load128(s);
+        s += 16;
+        l -= 16;
+    }
+
+    // Remainder of 128-bit accumulator is its CRC with zero
+    // initial value, tail is handled by table lookup
+    unsigned char buf[16];
+    memcpy(buf, &a, sizeof(buf));
+    crc = ComputeSlicing16(0, buf, sizeof(buf));
+    return ComputeSlicing16(crc, s, l);
+}
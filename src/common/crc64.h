@@ -18,5 +18,25 @@
 
 class CRC64 {
 public:
+    /**
+     * Compute CRC64 using the fastest implementation supported
+     * by current CPU, all variants produce identical results
+     */
     static uint64_t Compute(uint64_t crc, const unsigned char* s, uint64_t l);
+
+    /**
+     * Byte at a time table lookup
+     */
+    static uint64_t ComputeTable(uint64_t crc, const unsigned char* s, uint64_t l);
+
+    /**
+     * Table lookup processing 8 and 16 bytes per iteration
+     */
+    static uint64_t ComputeSlicing8(uint64_t crc, const unsigned char* s, uint64_t l);
+    static uint64_t ComputeSlicing16(uint64_t crc, const unsigned char* s, uint64_t l);
+
+    /**
+     * Carry-less multiplication folding, requires PCLMULQDQ
+     */
+    static uint64_t ComputePclmul(uint64_t crc, const unsigned char* s, uint64_t l);
 };
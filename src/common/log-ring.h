@@ -0,0 +1,107 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <runtimejs.h>
+#include <string.h>
+
+namespace common {
+
+/**
+ * Single producer, single consumer ring of variable length
+ * records. Producer and consumer do not share any lock, record
+ * becomes visible to consumer only after it is fully written.
+ */
+template<size_t Size>
+class LogRing {
+    static_assert(0 == (Size & (Size - 1)), "Ring size must be a power of two");
+public:
+    static const size_t kHeaderSize = 4;
+    static const size_t kMaxRecord = 0xffff;
+
+    LogRing()
+        :	head_(0),
+            tail_(0) { }
+
+    /**
+     * Append record, returns false if there is not enough space
+     */
+    bool Push(uint8_t tag, const char* data, size_t len) {
+        if (len > kMaxRecord) {
+            len = kMaxRecord;
+        }
+
+        uint64_t head = __atomic_load_n(&head_, __ATOMIC_RELAXED);
+        uint64_t tail = __atomic_load_n(&tail_, __ATOMIC_ACQUIRE);
+        if (kHeaderSize + len > Size - (head - tail)) {
+            return false;
+        }
+
+        uint8_t header[kHeaderSize] = {
+            static_cast<uint8_t>(len), static_cast<uint8_t>(len >> 8), tag, 0
+        };
+        CopyIn(head, header, kHeaderSize);
+        CopyIn(head + kHeaderSize, reinterpret_cast<const uint8_t*>(data), len);
+        __atomic_store_n(&head_, head + kHeaderSize + len, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    /**
+     * Take next record, data longer than buf_len is truncated.
+     * Returns false if ring is empty
+     */
+    bool Pop(uint8_t* tag, char* buf, size_t buf_len, size_t* len) {
+        uint64_t tail = __atomic_load_n(&tail_, __ATOMIC_RELAXED);
+        uint64_t head = __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            return false;
+        }
+
+        uint8_t header[kHeaderSize];
+        CopyOut(tail, header, kHeaderSize);
+        size_t record_len = header[0] | (static_cast<size_t>(header[1]) << 8);
+        *tag = header[2];
+        *len = record_len < buf_len ? record_len : buf_len;
+        CopyOut(tail + kHeaderSize, reinterpret_cast<uint8_t*>(buf), *len);
+
+        __atomic_store_n(&tail_, tail + kHeaderSize + record_len, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    bool empty() const {
+        return __atomic_load_n(&head_, __ATOMIC_ACQUIRE) ==
+               __atomic_load_n(&tail_, __ATOMIC_ACQUIRE);
+    }
+private:
+    void CopyIn(uint64_t pos, const uint8_t* data, size_t len) {
+        size_t offset = pos & (Size - 1);
+        size_t first = len < Size - offset ? len : Size - offset;
+        memcpy(&buf_[offset], data, first);
+        memcpy(&buf_[0], data + first, len - first);
+    }
+
+    void CopyOut(uint64_t pos, uint8_t* data, size_t len) const {
+        size_t offset = pos & (Size - 1);
+        size_t first = len < Size - offset ? len : Size - offset;
+        memcpy(data, &buf_[offset], first);
+        memcpy(data + first, &buf_[0], len - first);
+    }
+
+    uint64_t head_;
+    uint64_t tail_;
+    uint8_t buf_[Size];
+};
+
+} // namespace common
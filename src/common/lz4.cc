@@ -0,0 +1,209 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lz4.h"
+#include <string.h>
+
+static const size_t kMinMatch = 4;
+static const size_t kLastLiterals = 5;
+static const size_t kMatchFindLimit = 12;
+static const size_t kMaxDistance = 65535;
+static const uint32_t kHashLog = 12;
+
+static inline uint32_t Read32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(uint32_t));
+    return value;
+}
+
+static inline uint32_t Hash(uint32_t value) {
+    return (value * 2654435761U) >> (32 - kHashLog);
+}
+
+static inline uint8_t* WriteLength(uint8_t* op, size_t len) {
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = static_cast<uint8_t>(len);
+    return op;
+}
+
+static inline bool ReadLength(const uint8_t** ip, const uint8_t* iend, size_t* len) {
+    uint8_t b;
+    do {
+        if (*ip >= iend) {
+            return false;
+        }
+        b = *(*ip)++;
+        *len += b;
+    } while (255 == b);
+    return true;
+}
+
+// Writes literals followed by optional match (match_len == 0 for
+// the last sequence), returns nullptr if it does not fit
+static uint8_t* WriteSequence(uint8_t* op, uint8_t* oend,
+                              const uint8_t* literals, size_t lit_len,
+                              size_t offset, size_t match_len) {
+    size_t need = 1 + lit_len + lit_len / 255 + 1;
+    if (match_len) {
+        need += 2 + (match_len - kMinMatch) / 255 + 1;
+    }
+    if (need > static_cast<size_t>(oend - op)) {
+        return nullptr;
+    }
+
+    uint8_t* token = op++;
+    if (lit_len >= 15) {
+        *token = 15 << 4;
+        op = WriteLength(op, lit_len - 15);
+    } else {
+        *token = static_cast<uint8_t>(lit_len << 4);
+    }
+
+    memcpy(op, literals, lit_len);
+    op += lit_len;
+
+    if (0 == match_len) {
+        return op;
+    }
+
+    *op++ = static_cast<uint8_t>(offset);
+    *op++ = static_cast<uint8_t>(offset >> 8);
+
+    size_t ml = match_len - kMinMatch;
+    if (ml >= 15) {
+        *token |= 15;
+        op = WriteLength(op, ml - 15);
+    } else {
+        *token |= static_cast<uint8_t>(ml);
+    }
+
+    return op;
+}
+
+size_t LZ4::Compress(const uint8_t* src, size_t len,
+                     uint8_t* dst, size_t dst_len) {
+    uint32_t table[1 << kHashLog];
+    memset(table, 0, sizeof(table));
+
+    const uint8_t* ip = src;
+    const uint8_t* anchor = src;
+    const uint8_t* iend = src + len;
+    uint8_t* op = dst;
+    uint8_t* oend = dst + dst_len;
+
+    if (len >= kMatchFindLimit) {
+        const uint8_t* mflimit = iend - kMatchFindLimit;
+        const uint8_t* matchlimit = iend - kLastLiterals;
+
+        while (ip <= mflimit) {
+            uint32_t seq = Read32(ip);
+            uint32_t h = Hash(seq);
+            const uint8_t* ref = src + table[h];
+            table[h] = static_cast<uint32_t>(ip - src);
+
+            if (ref >= ip || static_cast<size_t>(ip - ref) > kMaxDistance ||
+                Read32(ref) != seq) {
+                ++ip;
+                continue;
+            }
+
+            size_t match_len = kMinMatch;
+            while (ip + match_len < matchlimit && ip[match_len] == ref[match_len]) {
+                ++match_len;
+            }
+
+            op = WriteSequence(op, oend, anchor, ip - anchor, ip - ref, match_len);
+            if (nullptr == op) {
+                return 0;
+            }
+
+            ip += match_len;
+            anchor = ip;
+        }
+    }
+
+    op = WriteSequence(op, oend, anchor, iend - anchor, 0, 0);
+    if (nullptr == op) {
+        return 0;
+    }
+
+    return op - dst;
+}
+
+bool LZ4::Decompress(const uint8_t* src, size_t len,
+                     uint8_t* dst, size_t dst_len) {
+    const uint8_t* ip = src;
+    const uint8_t* iend = src + len;
+    uint8_t* op = dst;
+    uint8_t* oend = dst + dst_len;
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+
+        size_t lit_len = token >> 4;
+        if (15 == lit_len && !ReadLength(&ip, iend, &lit_len)) {
+            return false;
+        }
+
+        if (lit_len > static_cast<size_t>(iend - ip) ||
+            lit_len > static_cast<size_t>(oend - op)) {
+            return false;
+        }
+
+        memcpy(op, ip, lit_len);
+        op += lit_len;
+        ip += lit_len;
+
+        // Last sequence has no match
+        if (ip == iend) {
+            break;
+        }
+
+        if (iend - ip < 2) {
+            return false;
+        }
+
+        size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        if (0 == offset || offset > static_cast<size_t>(op - dst)) {
+            return false;
+        }
+
+        size_t match_len = token & 15;
+        if (15 == match_len && !ReadLength(&ip, iend, &match_len)) {
+            return false;
+        }
+        match_len += kMinMatch;
+
+        if (match_len > static_cast<size_t>(oend - op)) {
+            return false;
+        }
+
+        const uint8_t* ref = op - offset;
+        if (offset >= match_len) {
+            memcpy(op, ref, match_len);
+            op += match_len;
+        } else {
+            // Overlapping copy repeats the pattern
+            while (match_len--) {
+                *op++ = *ref++;
+            }
+        }
+    }
+
+    return op == oend;
+}
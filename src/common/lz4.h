@@ -0,0 +1,46 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <runtimejs.h>
+
+/**
+ * LZ4 block format codec. Compressor is a simple greedy single-pass
+ * one, decompressor validates the stream and never writes out of
+ * destination buffer bounds.
+ */
+class LZ4 {
+public:
+    /**
+     * Max compressed size for the input of provided length
+     */
+    static size_t CompressBound(size_t len) {
+        return len + len / 255 + 16;
+    }
+
+    /**
+     * Compress buffer, returns compressed size or 0 if
+     * destination buffer is too small
+     */
+    static size_t Compress(const uint8_t* src, size_t len,
+                           uint8_t* dst, size_t dst_len);
+
+    /**
+     * Decompress buffer, returns false on malformed input or if
+     * decompressed size is not equal to dst_len
+     */
+    static bool Decompress(const uint8_t* src, size_t len,
+                           uint8_t* dst, size_t dst_len);
+};
@@ -0,0 +1,375 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mem-ops.h"
+#include <common/cpu-features.h>
+
+// These functions implement memcpy and memset in the kernel, compiler
+// must not turn their loops back into memcpy and memset calls
+#pragma GCC optimize ("no-tree-loop-distribute-patterns")
+
+namespace common {
+
+bool MemOps::avx2_ = false;
+bool MemOps::erms_ = false;
+
+namespace {
+
+// Unaligned accesses without memcpy, which is not a builtin
+// in freestanding build
+typedef uint64_t u64_u __attribute__((aligned(1), may_alias));
+typedef uint32_t u32_u __attribute__((aligned(1), may_alias));
+typedef uint16_t u16_u __attribute__((aligned(1), may_alias));
+typedef long long v2di __attribute__((vector_size(16), may_alias));
+typedef long long v2di_u __attribute__((vector_size(16), aligned(1), may_alias));
+typedef long long v4di __attribute__((vector_size(32), may_alias));
+typedef long long v4di_u __attribute__((vector_size(32), aligned(1), may_alias));
+
+const uint64_t kByteMask = 0x0101010101010101ULL;
+
+inline uint64_t Pattern(int c) {
+    return static_cast<uint8_t>(c) * kByteMask;
+}
+
+// All loads are done before stores, so these are
+// safe for overlapping buffers (memmove)
+
+inline void CopySmall(uint8_t* d, const uint8_t* s, size_t n) {
+    if (n >= 8) {
+        uint64_t a = *reinterpret_cast<const u64_u*>(s);
+        uint64_t b = *reinterpret_cast<const u64_u*>(s + n - 8);
+        *reinterpret_cast<u64_u*>(d) = a;
+        *reinterpret_cast<u64_u*>(d + n - 8) = b;
+    } else if (n >= 4) {
+        uint32_t a = *reinterpret_cast<const u32_u*>(s);
+        uint32_t b = *reinterpret_cast<const u32_u*>(s + n - 4);
+        *reinterpret_cast<u32_u*>(d) = a;
+        *reinterpret_cast<u32_u*>(d + n - 4) = b;
+    } else if (n >= 2) {
+        uint16_t a = *reinterpret_cast<const u16_u*>(s);
+        uint16_t b = *reinterpret_cast<const u16_u*>(s + n - 2);
+        *reinterpret_cast<u16_u*>(d) = a;
+        *reinterpret_cast<u16_u*>(d + n - 2) = b;
+    } else if (1 == n) {
+        *d = *s;
+    }
+}
+
+inline void Copy16To32(uint8_t* d, const uint8_t* s, size_t n) {
+    v2di a = *reinterpret_cast<const v2di_u*>(s);
+    v2di b = *reinterpret_cast<const v2di_u*>(s + n - 16);
+    *reinterpret_cast<v2di_u*>(d) = a;
+    *reinterpret_cast<v2di_u*>(d + n - 16) = b;
+}
+
+inline void FillSmall(uint8_t* d, uint64_t v, size_t n) {
+    if (n >= 8) {
+        *reinterpret_cast<u64_u*>(d) = v;
+        *reinterpret_cast<u64_u*>(d + n - 8) = v;
+    } else if (n >= 4) {
+        *reinterpret_cast<u32_u*>(d) = static_cast<uint32_t>(v);
+        *reinterpret_cast<u32_u*>(d + n - 4) = static_cast<uint32_t>(v);
+    } else if (n >= 2) {
+        *reinterpret_cast<u16_u*>(d) = static_cast<uint16_t>(v);
+        *reinterpret_cast<u16_u*>(d + n - 2) = static_cast<uint16_t>(v);
+    } else if (1 == n) {
+        *d = static_cast<uint8_t>(v);
+    }
+}
+
+// Head and tail are copied with unaligned moves, the rest
+// with aligned stores. Sizes above 32 bytes only
+inline void CopyLoopSse2(uint8_t* d, const uint8_t* s, size_t n) {
+    v2di head = *reinterpret_cast<const v2di_u*>(s);
+    v2di tail = *reinterpret_cast<const v2di_u*>(s + n - 16);
+    uint8_t* end = d + n - 16;
+
+    size_t skip = 16 - (reinterpret_cast<uintptr_t>(d) & 15);
+    *reinterpret_cast<v2di_u*>(d) = head;
+    d += skip;
+    s += skip;
+
+    while (end - d >= 64) {
+        v2di a = *reinterpret_cast<const v2di_u*>(s);
+        v2di b = *reinterpret_cast<const v2di_u*>(s + 16);
+        v2di c = *reinterpret_cast<const v2di_u*>(s + 32);
+        v2di e = *reinterpret_cast<const v2di_u*>(s + 48);
+        *reinterpret_cast<v2di*>(d) = a;
+        *reinterpret_cast<v2di*>(d + 16) = b;
+        *reinterpret_cast<v2di*>(d + 32) = c;
+        *reinterpret_cast<v2di*>(d + 48) = e;
+        d += 64;
+        s += 64;
+    }
+    while (end - d > 0) {
+        *reinterpret_cast<v2di*>(d) = *reinterpret_cast<const v2di_u*>(s);
+        d += 16;
+        s += 16;
+    }
+    *reinterpret_cast<v2di_u*>(end) = tail;
+}
+
+inline void FillLoopSse2(uint8_t* d, uint64_t v, size_t n) {
+    v2di value = { static_cast<long long>(v), static_cast<long long>(v) };
+    uint8_t* end = d + n - 16;
+
+    *reinterpret_cast<v2di_u*>(d) = value;
+    d += 16 - (reinterpret_cast<uintptr_t>(d) & 15);
+
+    while (end - d >= 64) {
+        *reinterpret_cast<v2di*>(d) = value;
+        *reinterpret_cast<v2di*>(d + 16) = value;
+        *reinterpret_cast<v2di*>(d + 32) = value;
+        *reinterpret_cast<v2di*>(d + 48) = value;
+        d += 64;
+    }
+    while (end - d > 0) {
+        *reinterpret_cast<v2di*>(d) = value;
+        d += 16;
+    }
+    *reinterpret_cast<v2di_u*>(end) = value;
+}
+
+__attribute__((target("avx2")))
+void CopyLoopAvx2(uint8_t* d, const uint8_t* s, size_t n) {
+    v4di head = *reinterpret_cast<const v4di_u*>(s);
+    v4di tail = *reinterpret_cast<const v4di_u*>(s + n - 32);
+    uint8_t* end = d + n - 32;
+
+    size_t skip = 32 - (reinterpret_cast<uintptr_t>(d) & 31);
+    *reinterpret_cast<v4di_u*>(d) = head;
+    d += skip;
+    s += skip;
+
+    while (end - d >= 128) {
+        v4di a = *reinterpret_cast<const v4di_u*>(s);
+        v4di b = *reinterpret_cast<const v4di_u*>(s + 32);
+        v4di c = *reinterpret_cast<const v4di_u*>(s + 64);
+        v4di e = *reinterpret_cast<const v4di_u*>(s + 96);
+        *reinterpret_cast<v4di*>(d) = a;
+        *reinterpret_cast<v4di*>(d + 32) = b;
+        *reinterpret_cast<v4di*>(d + 64) = c;
+        *reinterpret_cast<v4di*>(d + 96) = e;
+        d += 128;
+        s += 128;
+    }
+    while (end - d > 0) {
+        *reinterpret_cast<v4di*>(d) = *reinterpret_cast<const v4di_u*>(s);
+        d += 32;
+        s += 32;
+    }
+    *reinterpret_cast<v4di_u*>(end) = tail;
+}
+
+__attribute__((target("avx2")))
+void FillLoopAvx2(uint8_t* d, uint64_t v, size_t n) {
+    long long x = static_cast<long long>(v);
+    v4di value = { x, x, x, x };
+    uint8_t* end = d + n - 32;
+
+    *reinterpret_cast<v4di_u*>(d) = value;
+    d += 32 - (reinterpret_cast<uintptr_t>(d) & 31);
+
+    while (end - d >= 128) {
+        *reinterpret_cast<v4di*>(d) = value;
+        *reinterpret_cast<v4di*>(d + 32) = value;
+        *reinterpret_cast<v4di*>(d + 64) = value;
+        *reinterpret_cast<v4di*>(d + 96) = value;
+        d += 128;
+    }
+    while (end - d > 0) {
+        *reinterpret_cast<v4di*>(d) = value;
+        d += 32;
+    }
+    *reinterpret_cast<v4di_u*>(end) = value;
+}
+
+inline void RepMovsb(uint8_t* d, const uint8_t* s, size_t n) {
+    asm volatile("rep movsb" : "+D"(d), "+S"(s), "+c"(n) : : "memory");
+}
+
+inline void RepStosb(uint8_t* d, int c, size_t n) {
+    asm volatile("rep stosb" : "+D"(d), "+c"(n) : "a"(c) : "memory");
+}
+
+} // namespace
+
+void MemOps::Init() {
+    avx2_ = CpuFeatures::HasAvx2();
+    erms_ = CpuFeatures::HasErms();
+}
+
+void* MemOps::Copy(void* dst, const void* src, size_t n) {
+    uint8_t* d = static_cast<uint8_t*>(dst);
+    const uint8_t* s = static_cast<const uint8_t*>(src);
+    if (n <= 16) {
+        CopySmall(d, s, n);
+    } else if (n <= 32) {
+        Copy16To32(d, s, n);
+    } else if (erms_ && n >= kErmsCopyMinSize) {
+        RepMovsb(d, s, n);
+    } else if (avx2_) {
+        CopyLoopAvx2(d, s, n);
+    } else {
+        CopyLoopSse2(d, s, n);
+    }
+    return dst;
+}
+
+void* MemOps::Move(void* dst, const void* src, size_t n) {
+    uint8_t* d = static_cast<uint8_t*>(dst);
+    const uint8_t* s = static_cast<const uint8_t*>(src);
+    if (d == s) {
+        return dst;
+    }
+
+    if (d + n <= s || s + n <= d) {
+        return Copy(dst, src, n);
+    }
+
+    if (n <= 16) {
+        CopySmall(d, s, n);
+        return dst;
+    }
+    if (n <= 32) {
+        Copy16To32(d, s, n);
+        return dst;
+    }
+
+    // Every block is loaded before it's stored, remaining
+    // bytes are moved at once
+    if (d < s) {
+        while (n >= 16) {
+            v2di a = *reinterpret_cast<const v2di_u*>(s);
+            *reinterpret_cast<v2di_u*>(d) = a;
+            d += 16;
+            s += 16;
+            n -= 16;
+        }
+        CopySmall(d, s, n);
+    } else {
+        while (n >= 16) {
+            n -= 16;
+            v2di a = *reinterpret_cast<const v2di_u*>(s + n);
+            *reinterpret_cast<v2di_u*>(d + n) = a;
+        }
+        CopySmall(d, s, n);
+    }
+    return dst;
+}
+
+void* MemOps::Fill(void* dst, int c, size_t n) {
+    uint8_t* d = static_cast<uint8_t*>(dst);
+    if (n <= 16) {
+        FillSmall(d, Pattern(c), n);
+    } else if (erms_ && n >= kErmsFillMinSize) {
+        RepStosb(d, c, n);
+    } else if (avx2_ && n > 32) {
+        FillLoopAvx2(d, Pattern(c), n);
+    } else {
+        FillLoopSse2(d, Pattern(c), n);
+    }
+    return dst;
+}
+
+void* MemOps::CopyScalar(void* dst, const void* src, size_t n) {
+    uint8_t* d = static_cast<uint8_t*>(dst);
+    const uint8_t* s = static_cast<const uint8_t*>(src);
+    while (n >= 8) {
+        *reinterpret_cast<u64_u*>(d) = *reinterpret_cast<const u64_u*>(s);
+        d += 8;
+        s += 8;
+        n -= 8;
+    }
+    while (n > 0) {
+        *d++ = *s++;
+        --n;
+    }
+    return dst;
+}
+
+void* MemOps::CopySse2(void* dst, const void* src, size_t n) {
+    uint8_t* d = static_cast<uint8_t*>(dst);
+    const uint8_t* s = static_cast<const uint8_t*>(src);
+    if (n <= 16) {
+        CopySmall(d, s, n);
+    } else if (n <= 32) {
+        Copy16To32(d, s, n);
+    } else {
+        CopyLoopSse2(d, s, n);
+    }
+    return dst;
+}
+
+void* MemOps::CopyAvx2(void* dst, const void* src, size_t n) {
+    uint8_t* d = static_cast<uint8_t*>(dst);
+    const uint8_t* s = static_cast<const uint8_t*>(src);
+    if (n <= 16) {
+        CopySmall(d, s, n);
+    } else if (n <= 32) {
+        Copy16To32(d, s, n);
+    } else {
+        CopyLoopAvx2(d, s, n);
+    }
+    return dst;
+}
+
+void* MemOps::CopyErms(void* dst, const void* src, size_t n) {
+    RepMovsb(static_cast<uint8_t*>(dst), static_cast<const uint8_t*>(src), n);
+    return dst;
+}
+
+void* MemOps::FillScalar(void* dst, int c, size_t n) {
+    uint8_t* d = static_cast<uint8_t*>(dst);
+    uint64_t v = Pattern(c);
+    while (n >= 8) {
+        *reinterpret_cast<u64_u*>(d) = v;
+        d += 8;
+        n -= 8;
+    }
+    while (n > 0) {
+        *d++ = static_cast<uint8_t>(c);
+        --n;
+    }
+    return dst;
+}
+
+void* MemOps::FillSse2(void* dst, int c, size_t n) {
+    uint8_t* d = static_cast<uint8_t*>(dst);
+    if (n <= 16) {
+        FillSmall(d, Pattern(c), n);
+    } else {
+        FillLoopSse2(d, Pattern(c), n);
+    }
+    return dst;
+}
+
+void* MemOps::FillAvx2(void* dst, int c, size_t n) {
+    uint8_t* d = static_cast<uint8_t*>(dst);
+    if (n <= 16) {
+        FillSmall(d, Pattern(c), n);
+    } else if (n <= 32) {
+        FillLoopSse2(d, Pattern(c), n);
+    } else {
+        FillLoopAvx2(d, Pattern(c), n);
+    }
+    return dst;
+}
+
+void* MemOps::FillErms(void* dst, int c, size_t n) {
+    RepStosb(static_cast<uint8_t*>(dst), c, n);
+    return dst;
+}
+
+} // namespace common
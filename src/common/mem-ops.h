@@ -0,0 +1,65 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <runtimejs.h>
+
+namespace common {
+
+/**
+ * Bulk memory copy and fill, kernel memcpy, memmove and memset.
+ * Size dispatched: up to 32 bytes are done with overlapping
+ * scalar or SSE2 moves, medium sizes with SSE2 or AVX2 loops and
+ * large sizes with REP MOVSB/STOSB on CPUs with ERMS. SSE2 is
+ * always available on x86_64 and used until Init() runs.
+ */
+class MemOps {
+public:
+    /**
+     * Sizes from which REP MOVSB/STOSB beats vector loops
+     */
+    static const size_t kErmsCopyMinSize = 2048;
+    static const size_t kErmsFillMinSize = 2048;
+
+    /**
+     * Select implementations supported by current CPU. AVX2 is
+     * only used if OS enabled AVX state already (XCR0)
+     */
+    static void Init();
+
+    static void* Copy(void* dst, const void* src, size_t n);
+    static void* Move(void* dst, const void* src, size_t n);
+    static void* Fill(void* dst, int c, size_t n);
+
+    /**
+     * Fixed implementations, for tests and benchmarks
+     */
+    static void* CopyScalar(void* dst, const void* src, size_t n);
+    static void* CopySse2(void* dst, const void* src, size_t n);
+    static void* CopyAvx2(void* dst, const void* src, size_t n);
+    static void* CopyErms(void* dst, const void* src, size_t n);
+    static void* FillScalar(void* dst, int c, size_t n);
+    static void* FillSse2(void* dst, int c, size_t n);
+    static void* FillAvx2(void* dst, int c, size_t n);
+    static void* FillErms(void* dst, int c, size_t n);
+
+    static bool uses_avx2() { return avx2_; }
+    static bool uses_erms() { return erms_; }
+private:
+    static bool avx2_;
+    static bool erms_;
+};
+
+} // namespace common
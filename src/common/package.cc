@@ -14,11 +14,16 @@
 
 #include "package.h"
 #include <common/crc64.h>
+#include <common/lz4.h>
+#include <algorithm>
 
 #define PACKAGE_MAGIC 0xCAFECAFE
 
 namespace package {
 
+static const size_t kHeaderLength = 2 * sizeof(uint32_t) + 2 * sizeof(uint64_t);
+static const size_t kDataAlignment = 16;
+
 void PackageWriter::WriteString(const char* str) {
     size_t len = strlen(str);
     WriteData(reinterpret_cast<const void*>(str), len + 1);
@@ -36,31 +41,127 @@ void PackageWriter::WriteUint32(uint32_t value) {
     WriteData(reinterpret_cast<const void*>(&value), sizeof(uint32_t));
 }
 
+void PackageWriter::WritePadding(size_t len) {
+    static const uint8_t zeros[kDataAlignment] = { 0 };
+    RT_ASSERT(len <= kDataAlignment);
+    WriteData(reinterpret_cast<const void*>(zeros), len);
+}
+
 void PackageWriter::Write() {
+    size_t file_count = files_.size();
+
+    // Directory is sorted by name, lookups go through hash table
+    std::vector<size_t> order(file_count);
+    for (size_t i = 0; i < file_count; ++i) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        return strcmp(files_[a].name(), files_[b].name()) < 0;
+    });
+
+    // Load factor is at most 0.5
+    size_t buckets_count = 1;
+    while (buckets_count < file_count * 2) {
+        buckets_count <<= 1;
+    }
+
+    size_t entries_offset = kHeaderLength;
+    size_t buckets_offset = entries_offset + file_count * sizeof(PackageIndexEntry);
+    size_t names_offset = buckets_offset + buckets_count * sizeof(uint32_t);
+
+    // Keep compressed copy only if it is smaller
+    std::vector<std::vector<uint8_t>> packed(file_count);
+    for (size_t i = 0; i < file_count; ++i) {
+        const PackageFileData& file = files_[order[i]];
+        if (PackageFileType::LZ4 != file.type() || 0 == file.len()) {
+            continue;
+        }
+
+        std::vector<uint8_t>& buf = packed[i];
+        buf.resize(LZ4::CompressBound(file.len()));
+        size_t len = LZ4::Compress(file.buf(), file.len(), &buf[0], buf.size());
+        if (0 == len || len >= file.len()) {
+            buf.clear();
+            continue;
+        }
+        buf.resize(len);
+    }
+
+    std::vector<PackageIndexEntry> entries(file_count);
+    size_t pos = names_offset;
+    for (size_t i = 0; i < file_count; ++i) {
+        const PackageFileData& file = files_[order[i]];
+        PackageIndexEntry& entry = entries[i];
+        entry.name_hash = PackageNameHash(file.name());
+        entry.name_len = strlen(file.name());
+        entry.name_offset = pos;
+        entry.type = static_cast<uint32_t>(packed[i].empty() ?
+            PackageFileType::DEFAULT : PackageFileType::LZ4);
+        entry.reserved = 0;
+        pos += entry.name_len + 1;
+    }
+
+    for (size_t i = 0; i < file_count; ++i) {
+        const PackageFileData& file = files_[order[i]];
+        PackageIndexEntry& entry = entries[i];
+        pos = common::Utils::Align(pos, kDataAlignment);
+        entry.data_offset = pos;
+        entry.data_len = packed[i].empty() ? file.len() : packed[i].size();
+        entry.raw_len = file.len();
+        entry.crc64 = CRC64::Compute(0, file.buf(), file.len());
+        pos += entry.data_len;
+    }
+
+    std::vector<uint32_t> buckets(buckets_count, 0);
+    for (size_t i = 0; i < file_count; ++i) {
+        size_t bucket = entries[i].name_hash & (buckets_count - 1);
+        while (0 != buckets[bucket]) {
+            bucket = (bucket + 1) & (buckets_count - 1);
+        }
+        buckets[bucket] = static_cast<uint32_t>(i + 1);
+    }
+
     WriteUint32(PACKAGE_MAGIC);
 
-    const char* hdr = "PCKG";
+    const char* hdr = "PCKI";
     WriteBuf(reinterpret_cast<const uint8_t*>(hdr), 4);
 
-    size_t file_count = files_.size();
     WriteUint64(file_count);
+    WriteUint64(buckets_count);
+
+    for (const PackageIndexEntry& entry : entries) {
+        WriteData(reinterpret_cast<const void*>(&entry), sizeof(PackageIndexEntry));
+    }
 
-    for (const PackageFileData& file : files_) {
-        const char* name = file.name();
-        size_t len = file.len();
-        size_t name_len = strlen(name);
-        WriteUint32(static_cast<uint32_t>(PackageFileType::DEFAULT));
-        WriteUint64(name_len);
-        WriteString(name);
-        WriteUint64(CRC64::Compute(0, file.buf(), len));
-        WriteUint64(len);
-        WriteBuf(file.buf(), len);
+    for (uint32_t bucket : buckets) {
+        WriteUint32(bucket);
+    }
+
+    pos = names_offset;
+    for (size_t i = 0; i < file_count; ++i) {
+        WriteString(files_[order[i]].name());
+        pos += entries[i].name_len + 1;
+    }
+
+    for (size_t i = 0; i < file_count; ++i) {
+        const PackageFileData& file = files_[order[i]];
+        WritePadding(entries[i].data_offset - pos);
+        if (packed[i].empty()) {
+            WriteBuf(file.buf(), file.len());
+        } else {
+            WriteBuf(&packed[i][0], packed[i].size());
+        }
+        pos = entries[i].data_offset + entries[i].data_len;
     }
 }
 
 PackageReader::PackageReader(const void* start, size_t len)
-    :	next_(nullptr),
-        files_left_(0) {
+    :	base_(nullptr),
+        len_(0),
+        entries_(nullptr),
+        buckets_(nullptr),
+        files_count_(0),
+        buckets_count_(0) {
 
     RT_ASSERT(start);
     RT_ASSERT(len > 0);
@@ -71,76 +172,113 @@ PackageReader::PackageReader(const void* start, size_t len)
     pos = common::Utils::AlignPtr<const uint8_t>(pos, sizeof(uint32_t));
 
     // Search for archive header
-    while (pos < end) {
-        const uint32_t* value = reinterpret_cast<const uint32_t*>(pos);
+    while (pos + kHeaderLength <= end) {
+        const uint8_t* hdr = pos;
+        uint32_t value = common::Utils::ReadUnaligned<uint32_t>(pos);
         pos += sizeof(uint32_t);
 
-        if (PACKAGE_MAGIC != *value) {
+        if (PACKAGE_MAGIC != value) {
             continue;
         }
 
-        if ('P' != pos[0] || 'C' != pos[1] || 'K' != pos[2] || 'G' != pos[3]) {
+        if ('P' != pos[0] || 'C' != pos[1] || 'K' != pos[2] || 'I' != pos[3]) {
             continue;
         }
 
-        files_left_ = common::Utils::ReadUnaligned<size_t>(reinterpret_cast<const void*>(pos + 4));
-        next_ = pos + 4 + sizeof(uint64_t);
+        size_t files_count = common::Utils::ReadUnaligned<uint64_t>(pos + 4);
+        size_t buckets_count = common::Utils::ReadUnaligned<uint64_t>(pos + 12);
+        size_t avail = end - hdr;
+
+        // Directory should fit into buffer, hash table size
+        // is a power of two with at least one empty bucket
+        if (0 == buckets_count || 0 != (buckets_count & (buckets_count - 1)) ||
+            files_count >= buckets_count ||
+            buckets_count > avail / sizeof(uint32_t) ||
+            files_count > avail / sizeof(PackageIndexEntry) ||
+            kHeaderLength + files_count * sizeof(PackageIndexEntry) +
+            buckets_count * sizeof(uint32_t) > avail) {
+            break;
+        }
+
+        base_ = hdr;
+        len_ = avail;
+        files_count_ = files_count;
+        buckets_count_ = buckets_count;
+        entries_ = hdr + kHeaderLength;
+        buckets_ = entries_ + files_count * sizeof(PackageIndexEntry);
         break;
     }
 }
 
-PackageFile PackageReader::Next() {
-    if (0 == files_left_ || nullptr == next_) {
-        return Finish();
+PackageIndexEntry PackageReader::Entry(size_t index) const {
+    RT_ASSERT(index < files_count_);
+    return common::Utils::ReadUnaligned<PackageIndexEntry>(
+        entries_ + index * sizeof(PackageIndexEntry));
+}
+
+size_t PackageReader::IndexOf(const char* name) const {
+    RT_ASSERT(name);
+    if (0 == files_count_) {
+        return kNotFound;
     }
 
-    // File type
-    uint32_t type = common::Utils
-            ::ReadUnaligned<uint32_t>(reinterpret_cast<const void*>(next_));
-    next_ += sizeof(uint32_t);
+    uint64_t hash = PackageNameHash(name);
+    size_t bucket = hash & (buckets_count_ - 1);
 
-    // Check type
-    if (static_cast<uint32_t>(PackageFileType::DEFAULT) != type) {
-        return Finish();
-    }
+    // Table without empty buckets (corrupted image) must not make
+    // lookup of missing name spin forever
+    for (size_t probes = 0; probes < buckets_count_; ++probes) {
+        uint32_t value = common::Utils::ReadUnaligned<uint32_t>(
+            buckets_ + bucket * sizeof(uint32_t));
+        if (0 == value || value > files_count_) {
+            return kNotFound;
+        }
 
-    // Name length
-    size_t name_len = common::Utils
-            ::ReadUnaligned<size_t>(reinterpret_cast<const void*>(next_));
-    next_ += sizeof(uint64_t);
+        size_t index = value - 1;
+        PackageIndexEntry entry = Entry(index);
+        if (hash == entry.name_hash) {
+            PackageFile file = Get(index);
+            if (!file.empty() && 0 == strcmp(name, file.name())) {
+                return index;
+            }
+        }
 
-    // Filename
-    const char* name = reinterpret_cast<const char*>(next_);
-    next_ += name_len;
+        bucket = (bucket + 1) & (buckets_count_ - 1);
+    }
 
-    // Null-terminator of string
-    if (*next_ != 0) {
-        return Finish();
+    return kNotFound;
+}
+
+PackageFile PackageReader::Get(size_t index) const {
+    if (index >= files_count_) {
+        return PackageFile();
     }
-    ++next_;
 
-    // File CRC64
-    uint64_t crc64 = common::Utils
-            ::ReadUnaligned<size_t>(reinterpret_cast<const void*>(next_));
-    next_ += sizeof(uint64_t);
+    PackageIndexEntry entry = Entry(index);
 
-    // File length
-    size_t len = common::Utils
-            ::ReadUnaligned<size_t>(reinterpret_cast<const void*>(next_));
-    next_ += sizeof(uint64_t);
+    // Check type
+    PackageFileType type = static_cast<PackageFileType>(entry.type);
+    if (PackageFileType::DEFAULT != type && PackageFileType::LZ4 != type) {
+        return PackageFile();
+    }
 
-    // File buffer
-    const uint8_t* buf = next_;
+    if (PackageFileType::DEFAULT == type && entry.raw_len != entry.data_len) {
+        return PackageFile();
+    }
 
-    --files_left_;
-    next_ += len;
-    return PackageFile(name, buf, len, crc64);
-}
+    if (entry.name_offset >= len_ || entry.name_len >= len_ - entry.name_offset ||
+        entry.data_offset > len_ || entry.data_len > len_ - entry.data_offset) {
+        return PackageFile();
+    }
+
+    // Null-terminator of string
+    const char* name = reinterpret_cast<const char*>(base_ + entry.name_offset);
+    if (0 != name[entry.name_len]) {
+        return PackageFile();
+    }
 
-PackageFile PackageReader::Finish() {
-    next_ = nullptr;
-    files_left_ = 0;
-    return PackageFile();
+    return PackageFile(name, base_ + entry.data_offset, entry.data_len,
+                       entry.raw_len, entry.crc64, type);
 }
 
 } // namespace package
@@ -23,20 +23,62 @@ namespace package {
 
 enum class PackageFileType {
     EMPTY = 0x00,
-    DEFAULT = 0xAA
+    DEFAULT = 0xAA,     // Stored as is
+    LZ4 = 0xAB          // LZ4 block compressed
 };
 
+/**
+ * Package layout (offsets are relative to the magic value):
+ *
+ *   header   magic, "PCKI", files count, buckets count
+ *   entries  one PackageIndexEntry per file, sorted by name
+ *   buckets  open addressing hash table, entry index + 1 (0 is empty)
+ *   names    null-terminated file names
+ *   data     file contents, every file is 16 byte aligned
+ *
+ * Directory is at the front so reader only needs to map it,
+ * file contents are not touched until requested. CRC64 is computed
+ * over uncompressed file contents.
+ */
+struct PackageIndexEntry {
+    uint64_t name_hash;
+    uint64_t name_offset;
+    uint64_t name_len;
+    uint64_t data_offset;
+    uint64_t data_len;
+    uint64_t raw_len;
+    uint64_t crc64;
+    uint32_t type;
+    uint32_t reserved;
+};
+
+/**
+ * FNV-1a hash of the file name used by directory table
+ */
+inline uint64_t PackageNameHash(const char* name) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    while (*name) {
+        hash ^= static_cast<uint8_t>(*name++);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
 class PackageFileData {
 public:
-    PackageFileData(std::string name, std::vector<uint8_t> buf)
+    PackageFileData(std::string name, std::vector<uint8_t> buf,
+                    PackageFileType type = PackageFileType::DEFAULT)
         :	name_(name),
-            buf_(buf) {}
+            buf_(buf),
+            type_(type) {}
     const char* name() const { return name_.c_str(); }
     const uint8_t* buf() const { return &buf_[0]; }
     size_t len() const { return buf_.size(); }
+    PackageFileType type() const { return type_; }
 private:
     std::string name_;
     std::vector<uint8_t> buf_;
+    PackageFileType type_;
 };
 
 class PackageWriter {
@@ -51,6 +93,7 @@ private:
     void WriteBuf(const uint8_t* buf, size_t len);
     void WriteUint64(uint64_t value);
     void WriteUint32(uint32_t value);
+    void WritePadding(size_t len);
     std::vector<PackageFileData> files_;
 };
 
@@ -60,35 +103,93 @@ public:
         :	name_(nullptr),
             buf_(nullptr),
             len_(0),
-            crc64_(0) { }
+            raw_len_(0),
+            crc64_(0),
+            type_(PackageFileType::EMPTY) { }
 
-    PackageFile(const char* name, const uint8_t* buf,
-                size_t len, uint64_t crc64)
+    PackageFile(const char* name, const uint8_t* buf, size_t len,
+                size_t raw_len, uint64_t crc64, PackageFileType type)
         :	name_(name),
             buf_(buf),
             len_(len),
-            crc64_(crc64) { }
+            raw_len_(raw_len),
+            crc64_(crc64),
+            type_(type) { }
 
     const char* name() const { return name_; }
+
+    /**
+     * Stored (possibly compressed) file contents
+     */
     const uint8_t* buf() const { return buf_; }
     size_t len() const { return len_; }
+
+    /**
+     * Uncompressed file size
+     */
+    size_t raw_len() const { return raw_len_; }
     uint64_t crc64() const { return crc64_; }
+    PackageFileType type() const { return type_; }
+    bool compressed() const { return PackageFileType::LZ4 == type_; }
     bool empty() const { return nullptr == buf_; }
 private:
     const char* name_;
     const uint8_t* buf_;
     size_t len_;
+    size_t raw_len_;
     uint64_t crc64_;
+    PackageFileType type_;
 };
 
+/**
+ * Read-only view of the package directory. Does not copy or
+ * validate file contents, CRC64 check is up to the caller.
+ */
 class PackageReader {
 public:
+    static const size_t kNotFound = static_cast<size_t>(-1);
+
+    PackageReader()
+        :	base_(nullptr),
+            len_(0),
+            entries_(nullptr),
+            buckets_(nullptr),
+            files_count_(0),
+            buckets_count_(0) { }
+
     PackageReader(const void* start, size_t len);
-    PackageFile Next();
-    PackageFile Finish();
+
+    /**
+     * Find file index by name in O(1), returns kNotFound if
+     * there is no such file
+     */
+    size_t IndexOf(const char* name) const;
+
+    /**
+     * Get file by index (in name order)
+     */
+    PackageFile Get(size_t index) const;
+
+    /**
+     * Get file by name
+     */
+    PackageFile Find(const char* name) const {
+        size_t index = IndexOf(name);
+        if (kNotFound == index) {
+            return PackageFile();
+        }
+        return Get(index);
+    }
+
+    size_t files_count() const { return files_count_; }
 private:
-    const uint8_t* next_;
-    size_t files_left_;
+    PackageIndexEntry Entry(size_t index) const;
+    const uint8_t* base_;
+    size_t len_;
+    const uint8_t* entries_;
+    const uint8_t* buckets_;
+    size_t files_count_;
+    size_t buckets_count_;
 };
 
 } // namespace package
@@ -36,6 +36,11 @@ public:
         return __atomic_sub_fetch(&_value, count, __ATOMIC_SEQ_CST);
     }
 
+    bool CompareExchange(T expected, T desired) {
+        return __atomic_compare_exchange_n(&_value, &expected, desired,
+            false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    }
+
     T Get() const {
         T value;
         __atomic_load(&_value, &value, __ATOMIC_SEQ_CST);
@@ -0,0 +1,492 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <kernel/kernel.h>
+#include <kernel/atomic.h>
+#include <kernel/spinlock.h>
+#include <kernel/cpu.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+namespace rt {
+
+class BufferPool;
+
+/**
+ * Reference counted memory behind ArrayBuffers. Pooled and page
+ * backed stores are placed next to their data, store is found
+ * from data pointer and length V8 passes to allocator. Device
+ * stores describe memory kernel does not free (DMA pages, MMIO)
+ * and are allocated separately. ArrayBuffer which owns data,
+ * transport data in transit and external buffer mappings hold
+ * a reference each, last one returns memory to the pool.
+ */
+class BackingStore {
+public:
+    enum class Kind : uint32_t {
+        POOLED,
+        PAGES,
+        DEVICE
+    };
+
+    /**
+     * Store of pooled or page backed buffer contents
+     */
+    static BackingStore* FromData(void* data, size_t length);
+
+    /**
+     * Describe memory owned by device, store is deleted with
+     * the last reference
+     */
+    static BackingStore* NewDevice(void* data, size_t length) {
+        RT_ASSERT(data);
+        return new BackingStore(Kind::DEVICE, nullptr, 0, data, length);
+    }
+
+    void AddRef() {
+        refs_.AddFetch(1);
+    }
+
+    inline void Release();
+
+    Kind kind() const { return kind_; }
+    void* data() const { return data_; }
+    size_t length() const { return length_; }
+    uint32_t refs() const { return refs_.Get(); }
+private:
+    friend class BufferPool;
+
+    /**
+     * Device stores are the only ones allocated with new, kept out
+     * of line so pooled and page backed paths never reach delete
+     */
+    __attribute__((noinline)) static void DeleteDevice(BackingStore* store) {
+        RT_ASSERT(store);
+        RT_ASSERT(Kind::DEVICE == store->kind_);
+        delete store;
+    }
+
+    BackingStore(Kind kind, BufferPool* pool, uint32_t size_class,
+                 void* data, size_t length)
+        :	kind_(kind),
+            size_class_(size_class),
+            pool_(pool),
+            data_(static_cast<uint8_t*>(data)),
+            length_(length),
+            next_(nullptr) {
+        refs_.Set(1);
+    }
+
+    Atomic<uint32_t> refs_;
+    Kind kind_;
+    uint32_t size_class_;
+    BufferPool* pool_;
+    uint8_t* data_;
+    size_t length_;
+    BackingStore* next_;
+    DELETE_COPY_AND_ASSIGN(BackingStore);
+};
+
+/**
+ * Size class allocator of ArrayBuffer backing stores. Buffers up
+ * to kMaxPooledSize are rounded up to a power of two. Released
+ * blocks go to a small per-CPU cache of their class first (no
+ * locks or atomics, interrupts are disabled for a moment), which
+ * overflows to a shared free list (up to kMaxCachedBytes per
+ * class), so steady packet-sized traffic does not touch malloc.
+ * Shared lists are emptied by Trim when system is low on memory.
+ * Larger buffers get page aligned regions from page allocator,
+ * store header is placed after the data.
+ */
+class BufferPool {
+public:
+    typedef void* (*AllocPagesFn)(size_t size);
+    typedef void (*FreePagesFn)(void* base, size_t size);
+
+    static const size_t kHeaderSize = 64;
+    static const uint32_t kMinClassShift = 6;
+    static const uint32_t kMaxClassShift = 20;
+    static const uint32_t kClassCount = kMaxClassShift - kMinClassShift + 1;
+    static const size_t kMaxPooledSize = 1 << kMaxClassShift;
+    static const size_t kMaxCachedBytes = 8 << 20;
+    static const uint32_t kMaxCpus = 32;
+    static const uint32_t kCpuCacheSize = 32;
+    static const size_t kCpuCacheBytes = 256 << 10;
+
+    /**
+     * Pages are allocated in page_size units, page allocator
+     * should return zeroed memory
+     */
+    BufferPool(AllocPagesFn alloc_pages, FreePagesFn free_pages,
+               size_t page_size)
+        :	alloc_pages_(alloc_pages),
+            free_pages_(free_pages),
+            page_size_(page_size),
+            classes_(),
+            cpus_() {
+        RT_ASSERT(alloc_pages_);
+        RT_ASSERT(free_pages_);
+        RT_ASSERT(page_size_ >= kHeaderSize);
+        RT_ASSERT(0 == (page_size_ & (page_size_ - 1)));
+    }
+
+    ~BufferPool() {
+        for (uint32_t i = 0; i < kClassCount; ++i) {
+            for (uint32_t cpu = 0; cpu < kMaxCpus; ++cpu) {
+                CpuCache& cache { cpus_[cpu] };
+                while (cache.counts[i] > 0) {
+                    free(cache.stores[i][--cache.counts[i]]);
+                }
+            }
+
+            while (nullptr != classes_[i].head) {
+                BackingStore* store { classes_[i].head };
+                classes_[i].head = store->next_;
+                free(store);
+            }
+        }
+    }
+
+    /**
+     * Allocate store for length bytes with one reference. Returns
+     * null when out of memory
+     */
+    BackingStore* Alloc(size_t length, bool zeroed) {
+        if (length > kMaxPooledSize) {
+            return AllocPages(length);
+        }
+
+        uint32_t index { ClassIndex(length) };
+        BackingStore* store { nullptr };
+        {	CpuScope scope(this);
+            CpuCache& cache { scope.cache() };
+            if (0 == cache.counts[index]) {
+                Refill(cache, index);
+            }
+
+            if (cache.counts[index] > 0) {
+                store = cache.stores[index][--cache.counts[index]];
+                ++cache.reused;
+                ++cache.allocated;
+            }
+        }
+
+        if (nullptr != store) {
+            store->refs_.Set(1);
+            store->length_ = length;
+            store->next_ = nullptr;
+        } else {
+            void* block { memalign(kHeaderSize, kHeaderSize + ClassSize(index)) };
+            if (nullptr == block) {
+                return nullptr;
+            }
+
+            store = new (block) BackingStore(BackingStore::Kind::POOLED, this,
+                index, static_cast<uint8_t*>(block) + kHeaderSize, length);
+            CountAllocated(1);
+        }
+
+        // Only length bytes are visible to V8
+        if (zeroed) {
+            memset(store->data_, 0, length);
+        }
+        return store;
+    }
+
+    static uint32_t ClassIndex(size_t length) {
+        RT_ASSERT(length <= kMaxPooledSize);
+        uint32_t shift = kMinClassShift;
+        while ((static_cast<size_t>(1) << shift) < length) {
+            ++shift;
+        }
+        return shift - kMinClassShift;
+    }
+
+    static size_t ClassSize(uint32_t index) {
+        RT_ASSERT(index < kClassCount);
+        return static_cast<size_t>(1) << (index + kMinClassShift);
+    }
+
+    /**
+     * Stores a CPU cache of the class can hold, largest classes
+     * only use shared free list
+     */
+    static uint32_t CpuCacheLimit(uint32_t index) {
+        size_t limit { kCpuCacheBytes / ClassSize(index) };
+        return limit < kCpuCacheSize ? static_cast<uint32_t>(limit) : kCpuCacheSize;
+    }
+
+    /**
+     * Stores currently referenced, allocations served from free
+     * lists and bytes kept on free lists. Per-CPU counters are
+     * read without synchronization, values are approximate
+     */
+    uint64_t allocated() const {
+        int64_t count = 0;
+        for (uint32_t cpu = 0; cpu < kMaxCpus; ++cpu) {
+            count += cpus_[cpu].allocated;
+        }
+        return count > 0 ? static_cast<uint64_t>(count) : 0;
+    }
+
+    uint64_t reused() const {
+        uint64_t count = 0;
+        for (uint32_t cpu = 0; cpu < kMaxCpus; ++cpu) {
+            count += cpus_[cpu].reused;
+        }
+        return count;
+    }
+
+    /**
+     * Free stores on shared lists and in the cache of current
+     * CPU, other CPU caches are left alone. Returns number
+     * of bytes freed
+     */
+    size_t Trim() {
+        size_t freed = 0;
+        for (uint32_t i = 0; i < kClassCount; ++i) {
+            BackingStore* head { nullptr };
+            {	CpuScope scope(this);
+                CpuCache& cache { scope.cache() };
+                SizeClass& size_class { classes_[i] };
+                ScopedLock lock(size_class.locker);
+                head = size_class.head;
+                freed += size_class.cached;
+                size_class.head = nullptr;
+                size_class.cached = 0;
+
+                while (cache.counts[i] > 0) {
+                    BackingStore* store { cache.stores[i][--cache.counts[i]] };
+                    store->next_ = head;
+                    head = store;
+                    freed += ClassSize(i);
+                }
+            }
+
+            // Interrupts are enabled again
+            while (nullptr != head) {
+                BackingStore* next { head->next_ };
+                free(head);
+                head = next;
+            }
+        }
+        return freed;
+    }
+
+    uint64_t cached_bytes() {
+        uint64_t bytes = 0;
+        for (uint32_t i = 0; i < kClassCount; ++i) {
+            {	ScopedLock lock(classes_[i].locker);
+                bytes += classes_[i].cached;
+            }
+            for (uint32_t cpu = 0; cpu < kMaxCpus; ++cpu) {
+                bytes += cpus_[cpu].counts[i] * ClassSize(i);
+            }
+        }
+        return bytes;
+    }
+private:
+    friend class BackingStore;
+
+    struct SizeClass {
+        Locker locker;
+        BackingStore* head;
+        size_t cached;
+    };
+
+    struct CpuCache {
+        BackingStore* stores[kClassCount][kCpuCacheSize];
+        uint32_t counts[kClassCount];
+        int64_t allocated;
+        uint64_t reused;
+    };
+
+    /**
+     * Current CPU cache, interrupt handler or another thread can't
+     * run on this CPU until scope ends
+     */
+    class CpuScope {
+    public:
+        explicit CpuScope(BufferPool* pool)
+            :	interrupts_(Cpu::InterruptsEnabled()) {
+            Cpu::DisableInterrupts();
+            uint32_t cpu { Cpu::id() };
+            RT_ASSERT(cpu < kMaxCpus);
+            cache_ = &pool->cpus_[cpu];
+        }
+
+        ~CpuScope() {
+            if (interrupts_) {
+                Cpu::EnableInterrupts();
+            }
+        }
+
+        CpuCache& cache() { return *cache_; }
+    private:
+        bool interrupts_;
+        CpuCache* cache_;
+        DELETE_COPY_AND_ASSIGN(CpuScope);
+    };
+
+    static size_t RoundUp(size_t value, size_t alignment) {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    size_t PagesSize(size_t length) const {
+        return RoundUp(RoundUp(length, kHeaderSize) + kHeaderSize, page_size_);
+    }
+
+    void CountAllocated(int64_t count) {
+        CpuScope scope(this);
+        scope.cache().allocated += count;
+    }
+
+    /**
+     * Move up to half of CPU cache worth of stores from shared
+     * list, at least one if there is any
+     */
+    void Refill(CpuCache& cache, uint32_t index) {
+        uint32_t want { CpuCacheLimit(index) / 2 };
+        if (0 == want) {
+            want = 1;
+        }
+
+        SizeClass& size_class { classes_[index] };
+        ScopedLock lock(size_class.locker);
+        while (cache.counts[index] < want && nullptr != size_class.head) {
+            BackingStore* store { size_class.head };
+            size_class.head = store->next_;
+            size_class.cached -= ClassSize(index);
+            cache.stores[index][cache.counts[index]++] = store;
+        }
+    }
+
+    /**
+     * Move half of CPU cache to shared list, stores over shared
+     * list limit are returned to be freed
+     */
+    BackingStore* Flush(CpuCache& cache, uint32_t index, BackingStore* store) {
+        uint32_t keep { CpuCacheLimit(index) / 2 };
+        BackingStore* overflow { nullptr };
+        SizeClass& size_class { classes_[index] };
+        ScopedLock lock(size_class.locker);
+        for (;;) {
+            if (size_class.cached + ClassSize(index) <= kMaxCachedBytes) {
+                store->next_ = size_class.head;
+                size_class.head = store;
+                size_class.cached += ClassSize(index);
+            } else {
+                store->next_ = overflow;
+                overflow = store;
+            }
+
+            if (cache.counts[index] <= keep) {
+                break;
+            }
+            store = cache.stores[index][--cache.counts[index]];
+        }
+        return overflow;
+    }
+
+    BackingStore* AllocPages(size_t length) {
+        void* base { alloc_pages_(PagesSize(length)) };
+        if (nullptr == base) {
+            return nullptr;
+        }
+
+        void* header { static_cast<uint8_t*>(base) + RoundUp(length, kHeaderSize) };
+        CountAllocated(1);
+        return new (header) BackingStore(BackingStore::Kind::PAGES, this,
+            0, base, length);
+    }
+
+    void Recycle(BackingStore* store) {
+        RT_ASSERT(store);
+
+        if (BackingStore::Kind::PAGES == store->kind_) {
+            CountAllocated(-1);
+            free_pages_(store->data_, PagesSize(store->length_));
+            return;
+        }
+
+        RT_ASSERT(BackingStore::Kind::POOLED == store->kind_);
+        uint32_t index { store->size_class_ };
+        BackingStore* overflow { nullptr };
+        {	CpuScope scope(this);
+            CpuCache& cache { scope.cache() };
+            --cache.allocated;
+            if (cache.counts[index] < CpuCacheLimit(index)) {
+                cache.stores[index][cache.counts[index]++] = store;
+                return;
+            }
+            overflow = Flush(cache, index, store);
+        }
+
+        // Interrupts are enabled again
+        while (nullptr != overflow) {
+            BackingStore* next { overflow->next_ };
+            free(overflow);
+            overflow = next;
+        }
+    }
+
+    AllocPagesFn alloc_pages_;
+    FreePagesFn free_pages_;
+    size_t page_size_;
+    SizeClass classes_[kClassCount];
+    CpuCache cpus_[kMaxCpus];
+    DELETE_COPY_AND_ASSIGN(BufferPool);
+};
+
+static_assert(sizeof(BackingStore) <= BufferPool::kHeaderSize,
+              "store header does not fit");
+
+inline BackingStore* BackingStore::FromData(void* data, size_t length) {
+    RT_ASSERT(data);
+    uint8_t* p { static_cast<uint8_t*>(data) };
+    BackingStore* store { nullptr };
+    if (length > BufferPool::kMaxPooledSize) {
+        store = reinterpret_cast<BackingStore*>(p +
+            BufferPool::RoundUp(length, BufferPool::kHeaderSize));
+    } else {
+        store = reinterpret_cast<BackingStore*>(p - BufferPool::kHeaderSize);
+    }
+
+    RT_ASSERT(store->data_ == p);
+    RT_ASSERT(Kind::DEVICE != store->kind_);
+    return store;
+}
+
+inline void BackingStore::Release() {
+    // Nobody else can take a reference when caller holds the
+    // only one, common case needs no locked instruction
+    if (1 != refs_.Get() && 0 != refs_.SubFetch(1)) {
+        return;
+    }
+
+    if (Kind::DEVICE == kind_) {
+        DeleteDevice(this);
+        return;
+    }
+
+    RT_ASSERT(pool_);
+    pool_->Recycle(this);
+}
+
+} // namespace rt
@@ -0,0 +1,107 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <kernel/kernel.h>
+#include <kernel/vector.h>
+#include <string.h>
+
+namespace rt {
+
+/**
+ * Dynamic size contiguous byte array for mixed data
+ */
+class ByteStream {
+    friend class ByteStreamReader;
+public:
+    ByteStream() {}
+
+    ByteStream(ByteStream&& other)
+        :	data_(std::move(other.data_)) {}
+
+    /**
+     * Memcpy value into stream
+     */
+    template<typename T>
+    void AppendValue(T value) {
+        size_t size = data_.size();
+        size_t valsize = sizeof(T);
+        data_.resize(size + valsize);
+        T* p = reinterpret_cast<T*>(data_.data() + size);
+        memcpy(p, &value, valsize);
+    }
+
+    /**
+     * Clear stream
+     */
+    void Clear() {
+        data_.clear();
+    }
+
+    /**
+     * Allocate uninitialized space on the stream. Returns pointer
+     * to first element.
+     */
+    void* AppendBuffer(uint32_t len) {
+        size_t size = data_.size();
+        data_.resize(size + len);
+        return data_.data() + size;
+    }
+
+private:
+    SharedSTLVector<uint8_t> data_;
+    DELETE_COPY_AND_ASSIGN(ByteStream);
+};
+
+/**
+ * Provides read functionality for ByteStream object
+ */
+class ByteStreamReader {
+public:
+    ByteStreamReader(const ByteStream& stream)
+        :	stream_(stream), pos_(0) {}
+
+    /**
+     * Copy value from stream. Moves read position sizeof(T)
+     * elements forward.
+     */
+    template<typename T>
+    T ReadValue() {
+        size_t valsize = sizeof(T);
+        RT_ASSERT(pos_ + valsize <= stream_.data_.size());
+        const void* p = stream_.data_.data() + pos_;
+        T ret;
+        memcpy(&ret, p, valsize);
+        pos_ += valsize;
+        return ret;
+    }
+
+    /**
+     * Returns pointer to current stream position. Moves
+     * read position "len" elements forward.
+     */
+    const void* ReadBuffer(uint32_t len) {
+        RT_ASSERT(pos_ + len <= stream_.data_.size());
+        const void* p = stream_.data_.data() + pos_;
+        pos_ += len;
+        return p;
+    }
+
+private:
+    const ByteStream& stream_;
+    size_t pos_;
+};
+
+} // namespace rt
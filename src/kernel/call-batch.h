@@ -0,0 +1,107 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <kernel/kernel.h>
+#include <kernel/vector.h>
+#include <kernel/resource.h>
+#include <kernel/transport.h>
+#include <kernel/native-fn.h>
+
+namespace rt {
+
+/**
+ * Function calls made from one isolate to another during one
+ * event loop turn. Delivered as a single FUNCTION_CALL_BATCH
+ * message, callee answers all of them with a single
+ * FUNCTION_RETURN_BATCH message, one entry per promise
+ */
+class CallBatch {
+public:
+    struct Entry {
+        Entry(ExternalFunction* efn_, TransportData data_,
+              uint32_t promise_index_, bool ok_)
+            :	efn(efn_),
+                data(std::move(data_)),
+                promise_index(promise_index_),
+                ok(ok_) {
+            if (nullptr != efn) {
+                efn->AddRef();
+            }
+        }
+
+        Entry(Entry&& other)
+            :	efn(other.efn),
+                data(std::move(other.data)),
+                promise_index(other.promise_index),
+                ok(other.ok) {
+            other.efn = nullptr;
+        }
+
+        ~Entry() {
+            if (nullptr != efn) {
+                efn->Release();
+            }
+        }
+
+        /**
+         * Called function, null in replies. Referenced until
+         * batch is destroyed
+         */
+        ExternalFunction* efn;
+
+        /**
+         * Array of argument arrays, or array of results (or the
+         * exception thrown) in replies
+         */
+        TransportData data;
+        uint32_t promise_index;
+        bool ok;
+        DELETE_COPY_AND_ASSIGN(Entry);
+    };
+
+    explicit CallBatch(ResourceHandle<EngineThread> recv)
+        :	recv_(recv),
+            calls_count_(0) {}
+
+    void Add(ExternalFunction* efn, TransportData data,
+             uint32_t promise_index, size_t calls) {
+        entries_.push_back(Entry(efn, std::move(data), promise_index, true));
+        calls_count_ += calls;
+    }
+
+    void AddResult(TransportData data, uint32_t promise_index, bool ok) {
+        entries_.push_back(Entry(nullptr, std::move(data), promise_index, ok));
+    }
+
+    /**
+     * Thread batch is delivered to
+     */
+    ResourceHandle<EngineThread> recv() const { return recv_; }
+
+    SharedSTLVector<Entry>& entries() { return entries_; }
+
+    /**
+     * Total number of function calls in all entries
+     */
+    size_t calls_count() const { return calls_count_; }
+private:
+    ResourceHandle<EngineThread> recv_;
+    SharedSTLVector<Entry> entries_;
+    size_t calls_count_;
+    DELETE_COPY_AND_ASSIGN(CallBatch);
+};
+
+} // namespace rt
@@ -0,0 +1,93 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <kernel/kernel.h>
+#include <kernel/atomic.h>
+
+namespace rt {
+
+/**
+ * Flow control of calls made to one mailbox. Sender takes a
+ * credit per call before it pushes a call message, receiver
+ * returns them when the calls are done. Calls which don't get
+ * credits wait in the sender. Mailbox with no calls in it always
+ * admits the next message, so a batch larger than the capacity
+ * is not stuck forever.
+ */
+class CallCredits {
+public:
+    static const uint32_t kDefaultCapacity = 1024;
+
+    CallCredits() {
+        capacity_.Set(kDefaultCapacity);
+    }
+
+    /**
+     * Take credits for a message of count calls, returns false
+     * if receiver is over budget
+     */
+    bool Take(uint32_t count) {
+        for (;;) {
+            uint32_t used = used_.Get();
+            if (0 != used && used + count > capacity_.Get()) {
+                denied_.AddFetch(1);
+                return false;
+            }
+
+            if (used_.CompareExchange(used, used + count)) {
+                UpdatePeak(used + count);
+                return true;
+            }
+        }
+    }
+
+    void Return(uint32_t count) {
+        RT_ASSERT(used_.Get() >= count);
+        used_.SubFetch(count);
+    }
+
+    void SetCapacity(uint32_t capacity) {
+        RT_ASSERT(capacity > 0);
+        capacity_.Set(capacity);
+    }
+
+    uint32_t used() const { return used_.Get(); }
+    uint32_t capacity() const { return capacity_.Get(); }
+    uint32_t peak() const { return peak_.Get(); }
+
+    /**
+     * Number of times a sender had to wait
+     */
+    uint64_t denied() const { return denied_.Get(); }
+private:
+    void UpdatePeak(uint32_t used) {
+        for (;;) {
+            uint32_t peak = peak_.Get();
+            if (used <= peak || peak_.CompareExchange(peak, used)) {
+                return;
+            }
+        }
+    }
+
+    Atomic<uint32_t> used_;
+    Atomic<uint32_t> capacity_;
+    Atomic<uint32_t> peak_;
+    Atomic<uint64_t> denied_;
+    DELETE_COPY_AND_ASSIGN(CallCredits);
+};
+
+} // namespace rt
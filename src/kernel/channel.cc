@@ -0,0 +1,101 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "channel.h"
+#include <kernel/engine.h>
+#include <stdlib.h>
+
+namespace rt {
+
+Channel::Channel(void* memory, uint32_t size)
+    :	ring_(memory, size) {
+    refs_.Set(0);
+}
+
+Channel::~Channel() {
+    free(ring_.memory());
+}
+
+Channel* Channel::Create(uint32_t size) {
+    if (!SpscRing::IsValidSize(size)) {
+        return nullptr;
+    }
+
+    // Cache line aligned, head and tail don't share lines
+    void* memory = memalign(64, SpscRing::MemorySize(size));
+    if (nullptr == memory) {
+        return nullptr;
+    }
+
+    return new Channel(memory, size);
+}
+
+void Channel::Commit(uint32_t bytes) {
+    if (ring_.Commit(bytes)) {
+        Ring(consumer_);
+    }
+}
+
+void Channel::Consume(uint32_t bytes) {
+    if (ring_.Consume(bytes)) {
+        Ring(producer_);
+    }
+}
+
+Channel::WaitStatus Channel::Wait(Side side, ResourceHandle<EngineThread> thread,
+                                  uint32_t index) {
+    RT_ASSERT(!thread.empty());
+    NoInterrupsScope no_interrupts;
+    ScopedLock lock(waiters_locker_);
+    Waiter& waiter { Side::PRODUCER == side ? producer_ : consumer_ };
+
+    // Previous doorbell is armed or on its way
+    if (!waiter.thread.empty()) {
+        return WaitStatus::BUSY;
+    }
+
+    // Other side takes waiter under the lock after it disarms the flag
+    waiter.thread = thread;
+    waiter.index = index;
+    bool armed { Side::PRODUCER == side ? ring_.WaitWritable() : ring_.WaitReadable() };
+    if (!armed) {
+        waiter = Waiter();
+        return WaitStatus::READY;
+    }
+
+    return WaitStatus::ARMED;
+}
+
+void Channel::Ring(Waiter& waiter) {
+    Waiter taken;
+    {	NoInterrupsScope no_interrupts;
+        ScopedLock lock(waiters_locker_);
+
+        // Flag is in script writable memory and could be set
+        // without wait call
+        if (waiter.thread.empty()) {
+            return;
+        }
+
+        taken = waiter;
+        waiter = Waiter();
+    }
+
+    std::unique_ptr<ThreadMessage> msg(new ThreadMessage(
+        ThreadMessage::Type::CHANNEL_DOORBELL,
+        ResourceHandle<EngineThread>(), TransportData(), nullptr, taken.index));
+    taken.thread.get()->PushMessage(std::move(msg));
+}
+
+} // namespace rt
@@ -0,0 +1,124 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <kernel/kernel.h>
+#include <kernel/atomic.h>
+#include <kernel/resource.h>
+#include <kernel/spsc-ring.h>
+#include <v8.h>
+
+namespace rt {
+
+/**
+ * Shared memory channel between two isolates. Producer and
+ * consumer endpoints map the same kernel allocated memory (ring
+ * header and data, see SpscRing) as ArrayBuffers and move bytes
+ * without messages or allocations. Only doorbell message is sent
+ * when the other side waits. Reference counted by endpoint
+ * objects, buffers and data in transit.
+ */
+class Channel {
+public:
+    enum class Side {
+        PRODUCER,
+        CONSUMER
+    };
+
+    /**
+     * Returns null if size is not a power of two or memory is
+     * not available
+     */
+    static Channel* Create(uint32_t size);
+
+    void AddRef() {
+        refs_.AddFetch(1);
+    }
+
+    void Release() {
+        if (0 == refs_.SubFetch(1)) {
+            delete this;
+        }
+    }
+
+    SpscRing& ring() { return ring_; }
+
+    /**
+     * Data was written or read, wake other side if it waits
+     */
+    void Commit(uint32_t bytes);
+    void Consume(uint32_t bytes);
+
+    enum class WaitStatus {
+        READY,
+        ARMED,
+        BUSY
+    };
+
+    /**
+     * Ask for doorbell (thread callback index) when side can
+     * make progress. Returns READY if it can already, and BUSY
+     * if side waits for the previous doorbell still
+     */
+    WaitStatus Wait(Side side, ResourceHandle<EngineThread> thread, uint32_t index);
+private:
+    struct Waiter {
+        Waiter()
+            :	index(0) {}
+        ResourceHandle<EngineThread> thread;
+        uint32_t index;
+    };
+
+    Channel(void* memory, uint32_t size);
+    ~Channel();
+
+    void Ring(Waiter& waiter);
+
+    SpscRing ring_;
+    Atomic<uint32_t> refs_;
+    Locker waiters_locker_;
+    Waiter producer_;
+    Waiter consumer_;
+    DELETE_COPY_AND_ASSIGN(Channel);
+};
+
+/**
+ * Weak handle of ArrayBuffer which maps channel memory, keeps
+ * channel alive until buffer is collected
+ */
+class ChannelBufferRef {
+public:
+    ChannelBufferRef(v8::Isolate* iv8, v8::Local<v8::ArrayBuffer> buffer,
+                     Channel* channel)
+        :	buffer_(iv8, buffer),
+            channel_(channel) {
+        RT_ASSERT(channel_);
+        channel_->AddRef();
+        buffer_.SetWeak(this, WeakCallback);
+    }
+private:
+    static void WeakCallback(const v8::WeakCallbackData<v8::ArrayBuffer,
+                             ChannelBufferRef>& data) {
+        ChannelBufferRef* ref { data.GetParameter() };
+        ref->channel_->Release();
+        delete ref;
+    }
+
+    v8::UniquePersistent<v8::ArrayBuffer> buffer_;
+    Channel* channel_;
+    DELETE_COPY_AND_ASSIGN(ChannelBufferRef);
+};
+
+} // namespace rt
@@ -0,0 +1,37 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "clock.h"
+#include <common/cpu-features.h>
+
+// TODO: remove arch header
+#include <kernel/x64/rtc-x64.h>
+
+namespace rt {
+
+Clock::Clock()
+    :	boot_epoch_us_(RtcX64::ReadUnixTime() * 1000000),
+        tsc_base_(Cpu::ReadTimestampCounter()),
+        tsc_hz_(0),
+        ns_mult_(0),
+        tsc_invariant_(common::CpuFeatures::HasInvariantTsc()) { }
+
+void Clock::CalibrateTsc(uint64_t tsc_hz) {
+    RT_ASSERT(tsc_hz);
+    RT_ASSERT(0 == tsc_hz_);
+    tsc_hz_ = tsc_hz;
+    ns_mult_ = (UINT64_C(1000000000) << 32) / tsc_hz;
+}
+
+} // namespace rt
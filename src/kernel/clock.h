@@ -0,0 +1,73 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <kernel/kernel.h>
+#include <kernel/cpu.h>
+
+namespace rt {
+
+/**
+ * Monotonic and wall clock based on time stamp counter. TSC
+ * frequency is calibrated against PIT during local APIC timer
+ * setup, wall clock epoch comes from RTC read once at boot.
+ */
+class Clock {
+public:
+    Clock();
+
+    /**
+     * Set TSC frequency, called once by boot CPU
+     */
+    void CalibrateTsc(uint64_t tsc_hz);
+
+    /**
+     * Nanoseconds since boot, 0 until TSC is calibrated
+     */
+    uint64_t MonotonicNanos() const {
+        return NanosFromTsc(Cpu::ReadTimestampCounter());
+    }
+
+    /**
+     * Convert time stamp counter value to nanoseconds since boot
+     */
+    uint64_t NanosFromTsc(uint64_t tsc) const {
+        if (0 == ns_mult_ || tsc < tsc_base_) {
+            return 0;
+        }
+        uint64_t delta = tsc - tsc_base_;
+        return static_cast<uint64_t>(
+            (static_cast<unsigned __int128>(delta) * ns_mult_) >> 32);
+    }
+
+    /**
+     * Microseconds since Unix epoch
+     */
+    uint64_t WallClockMicros() const {
+        return boot_epoch_us_ + MonotonicNanos() / 1000;
+    }
+
+    uint64_t tsc_hz() const { return tsc_hz_; }
+    bool tsc_invariant() const { return tsc_invariant_; }
+private:
+    uint64_t boot_epoch_us_;
+    uint64_t tsc_base_;
+    uint64_t tsc_hz_;
+    uint64_t ns_mult_;      // Nanoseconds per tick, 32.32 fixed point
+    bool tsc_invariant_;
+    DELETE_COPY_AND_ASSIGN(Clock);
+};
+
+} // namespace rt
@@ -16,6 +16,8 @@
 
 #ifdef RUNTIMEJS_PLATFORM_X64
 #include <kernel/x64/cpu-x64.h>
+#elif defined(RUNTIMEJS_PLATFORM_HOST)
+#include <kernel/host/cpu-host.h>
 #else
 #error Platform is not supported
 #endif
@@ -58,6 +60,20 @@ public:
     static void DisableInterrupts() {
         CpuPlatform::DisableInterrupts();
     }
+
+    /**
+     * Read CPU cycle counter
+     */
+    static uint64_t ReadTimestampCounter() {
+        return CpuPlatform::ReadTimestampCounter();
+    }
+
+    /**
+     * Check if interrupts are enabled on current CPU
+     */
+    static bool InterruptsEnabled() {
+        return CpuPlatform::InterruptsEnabled();
+    }
 };
 
 } // namespace rt
@@ -21,6 +21,9 @@
 #include <kernel/thread.h>
 #include <kernel/system-context.h>
 #include <kernel/resource.h>
+#include <kernel/trace.h>
+#include <kernel/call-batch.h>
+#include <kernel/call-credits.h>
 
 namespace rt {
 
@@ -37,6 +40,10 @@ public:
         FUNCTION_CALL,
         FUNCTION_RETURN_RESOLVE,
         FUNCTION_RETURN_REJECT,
+        FUNCTION_CALL_BATCH,
+        FUNCTION_RETURN_BATCH,
+        FUNCTION_RELEASE,
+        CHANNEL_DOORBELL,
     };
 
     ThreadMessage(Type type, ResourceHandle<EngineThread> sender,
@@ -50,6 +57,20 @@ public:
             recv_index_(recv_index),
             reusable_(false) {}
 
+    /**
+     * Batch of calls or results, see CallBatch
+     */
+    ThreadMessage(Type type, ResourceHandle<EngineThread> sender,
+        std::unique_ptr<CallBatch> batch)
+        :	type_(type),
+            sender_(sender),
+            efn_(nullptr),
+            recv_index_(0),
+            reusable_(false),
+            batch_(std::move(batch)) {
+        RT_ASSERT(batch_);
+    }
+
     Type type() const { return type_; }
     const TransportData& data() { return data_; }
 
@@ -67,6 +88,25 @@ public:
         reusable_ = true;
     }
 
+    CallBatch* batch() {
+        RT_ASSERT(batch_);
+        return batch_.get();
+    }
+
+    /**
+     * Mailbox credits taken by this message, see CallCredits
+     */
+    uint32_t call_credits() const {
+        if (Type::FUNCTION_CALL == type_) {
+            return 1;
+        }
+        if (Type::FUNCTION_CALL_BATCH == type_) {
+            return batch_->calls_count() > 0 ?
+                static_cast<uint32_t>(batch_->calls_count()) : 1;
+        }
+        return 0;
+    }
+
     size_t recv_index() const { return recv_index_; }
     bool reusable() const { return reusable_; }
     DELETE_COPY_AND_ASSIGN(ThreadMessage);
@@ -77,6 +117,7 @@ private:
     ExternalFunction* efn_;
     size_t recv_index_;
     bool reusable_;
+    std::unique_ptr<CallBatch> batch_;
 };
 
 class EngineThread : public Resource {
@@ -92,10 +133,25 @@ public:
 
     v8::Local<v8::Object> NewInstance(Thread* thread);
 
+    /**
+     * Mailbox counters, depth is the number of messages
+     * waiting right now
+     */
+    struct MailboxStats {
+        size_t depth;
+        size_t high_watermark;
+        uint64_t pushed;
+        uint64_t irq_dropped;
+    };
+
     EngineThread(Engine* engine)
         :	engine_(engine),
             status_(Status::EMPTY),
-            thread_(nullptr) {
+            thread_(nullptr),
+            high_watermark_(0),
+            pushed_(0),
+            irq_dropped_(0),
+            time_slice_nanos_(0) {
         RT_ASSERT(engine_);
     }
 
@@ -119,7 +175,29 @@ public:
         NoInterrupsScope no_interrups;
         ScopedLock lock(c_locker_);
         RT_ASSERT(message);
+        RT_TRACE_INSTANT(Trace::kCategoryMessage, "push",
+                         static_cast<uint64_t>(message->type()));
         messages_.push_back(message.release());
+        ++pushed_;
+        UpdateWatermark();
+        if (nullptr != thread_) {
+            thread_->NotifyMessage(false);
+        }
+    }
+
+    /**
+     * Put messages starting from index back in front of the
+     * queue, they are taken first next time
+     */
+    void RequeueMessages(const ThreadMessagesVector& messages, size_t from) {
+        NoInterrupsScope no_interrups;
+        ScopedLock lock(c_locker_);
+        RT_ASSERT(from <= messages.size());
+        messages_.insert(messages_.begin(), messages.begin() + from, messages.end());
+        UpdateWatermark();
+        if (nullptr != thread_) {
+            thread_->NotifyMessage(false);
+        }
     }
 
     /**
@@ -132,18 +210,112 @@ public:
 
         // We don't want to allocate memory in IRQ handler
         if (messages_.size() < messages_.capacity()) {
+            RT_TRACE_INSTANT(Trace::kCategoryMessage, "push irq",
+                             static_cast<uint64_t>(message->type()));
             messages_.push_back(message);
+            ++pushed_;
+            UpdateWatermark();
+            if (nullptr != thread_) {
+                thread_->NotifyMessage(true);
+            }
+        } else {
+            ++irq_dropped_;
+        }
+    }
+
+    MailboxStats stats() {
+        NoInterrupsScope no_interrups;
+        ScopedLock lock(c_locker_);
+        MailboxStats s;
+        s.depth = messages_.size();
+        s.high_watermark = high_watermark_;
+        s.pushed = pushed_;
+        s.irq_dropped = irq_dropped_;
+        return s;
+    }
+
+    /**
+     * Memory budget of the thread isolate, set by process creator
+     * before thread starts
+     */
+    void SetMemoryLimits(const MemoryLimits& limits) { memory_limits_ = limits; }
+    const MemoryLimits& memory_limits() const { return memory_limits_; }
+
+    /**
+     * Time slice of the thread, set by process creator before
+     * thread starts. Zero means default
+     */
+    void SetTimeSlice(uint64_t nanos) { time_slice_nanos_ = nanos; }
+    uint64_t time_slice_nanos() const { return time_slice_nanos_; }
+
+    /**
+     * Credits for calls made to this mailbox
+     */
+    CallCredits& credits() { return credits_; }
+
+    /**
+     * Sender is out of credits for this mailbox, it is notified
+     * once when the next calls return theirs
+     */
+    void AddCreditWaiter(ResourceHandle<EngineThread> sender) {
+        NoInterrupsScope no_interrups;
+        ScopedLock lock(c_locker_);
+        for (const ResourceHandle<EngineThread>& waiter : credit_waiters_) {
+            if (waiter == sender) {
+                return;
+            }
+        }
+        credit_waiters_.push_back(sender);
+    }
+
+    /**
+     * Credits were returned, waiting senders retry their calls
+     */
+    void WakeCreditWaiters() {
+        SharedVector<ResourceHandle<EngineThread>> waiters;
+        {	NoInterrupsScope no_interrups;
+            ScopedLock lock(c_locker_);
+            if (0 == credit_waiters_.size()) return;
+            credit_waiters_.swap(waiters);
+        }
+
+        for (const ResourceHandle<EngineThread>& waiter : waiters) {
+            waiter.get()->Notify();
+        }
+    }
+
+    /**
+     * Make thread run even if it has no messages
+     */
+    void Notify() {
+        NoInterrupsScope no_interrups;
+        ScopedLock lock(c_locker_);
+        if (nullptr != thread_) {
+            thread_->NotifyMessage(false);
         }
     }
 
     Thread* thread() const;
 
 private:
+    void UpdateWatermark() {
+        if (messages_.size() > high_watermark_) {
+            high_watermark_ = messages_.size();
+        }
+    }
+
     Engine* engine_;
     Status status_;
     Thread* thread_;
     Locker c_locker_;
     ThreadMessagesVector messages_;
+    CallCredits credits_;
+    SharedVector<ResourceHandle<EngineThread>> credit_waiters_;
+    size_t high_watermark_;
+    uint64_t pushed_;
+    uint64_t irq_dropped_;
+    uint64_t time_slice_nanos_;
+    MemoryLimits memory_limits_;
     DELETE_COPY_AND_ASSIGN(EngineThread);
 };
 
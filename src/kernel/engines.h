@@ -23,17 +23,11 @@
 #include <kernel/engine.h>
 #include <kernel/system-context.h>
 #include <kernel/initrd.h>
+#include <kernel/isolate-memory.h>
 #include <EASTL/vector.h>
 
 namespace rt {
 
-class MallocArrayBufferAllocator : public v8::ArrayBuffer::Allocator {
-public:
-    virtual void* Allocate(size_t length) { return calloc(1, length); }
-    virtual void* AllocateUninitialized(size_t length) { return malloc(length); }
-    virtual void Free(void* data, size_t length) { free(data); }
-};
-
 class AcpiManager;
 
 class Engines {
@@ -41,7 +35,8 @@ public:
     Engines(uint32_t cpu_count)
         :	cpu_count_(cpu_count),
             _non_isolate_ticks(0),
-            proc_mgr_(this) {
+            proc_mgr_(this),
+            array_buffer_allocator_(nullptr) {
         RT_ASSERT(nullptr == GLOBAL_engines());
         RT_ASSERT(this);
         RT_ASSERT(cpu_count >= 1);
@@ -68,7 +63,8 @@ public:
         RT_ASSERT(engines_execution_.size() > 0);
 
         v8::V8::InitializeICU();
-        v8::V8::SetArrayBufferAllocator(new MallocArrayBufferAllocator());
+        array_buffer_allocator_ = new AccountingArrayBufferAllocator();
+        v8::V8::SetArrayBufferAllocator(array_buffer_allocator_);
 
         const char flags[] = "--harmony_collections";
         v8::V8::SetFlagsFromString(flags, sizeof(flags));
@@ -228,6 +224,10 @@ public:
     AcpiManager* acpi_manager();
     ProcessManager& process_manager() { return proc_mgr_; }
 
+    AccountingArrayBufferAllocator* array_buffer_allocator() const {
+        return array_buffer_allocator_;
+    }
+
     ~Engines() = delete;
     DELETE_COPY_AND_ASSIGN(Engines);
 private:
@@ -237,6 +237,7 @@ private:
     AcpiManager* _acpi_manager;
     volatile uint64_t _non_isolate_ticks;
     ProcessManager proc_mgr_;
+    AccountingArrayBufferAllocator* array_buffer_allocator_;
 
     Atomic<uint64_t> global_ticks_counter_;
 
@@ -0,0 +1,70 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <kernel/kernel.h>
+#include <stdlib.h>
+
+namespace rt {
+
+/**
+ * CPU shim for kernel code built as a Linux program (unit tests
+ * and benchmarks). Every host thread is a separate CPU, there
+ * are no interrupts to disable
+ */
+class CpuPlatform {
+public:
+    /**
+     * Pause operation for busy-wait loops
+     */
+    static void WaitPause() {
+        asm volatile("rep;nop" : : : "memory");
+    }
+
+    /**
+     * Stop execution
+     */
+    __attribute__((__noreturn__)) static void HangSystem() {
+        abort();
+    }
+
+    /**
+     * Get current CPU index, assigned to host threads in order
+     * of first call
+     */
+    static uint32_t id() {
+        static uint32_t next = 0;
+        static thread_local uint32_t cpu = __sync_fetch_and_add(&next, 1);
+        return cpu;
+    }
+
+    inline static void DisableInterrupts() { }
+    inline static void EnableInterrupts() { }
+
+    /**
+     * Read time stamp counter
+     */
+    inline static uint64_t ReadTimestampCounter() {
+        uint32_t lo, hi;
+        asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+        return (static_cast<uint64_t>(hi) << 32) | lo;
+    }
+
+    inline static bool InterruptsEnabled() {
+        return true;
+    }
+};
+
+} // namespace rt
@@ -0,0 +1,151 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <kernel/kernel.h>
+#include <kernel/vector.h>
+
+namespace rt {
+
+/**
+ * Values addressed by 32 bit index which holds slot number and
+ * slot generation. Generation changes every time value is taken,
+ * so index of a slot taken and reused since (late reply, fired
+ * timer) is stale and finds nothing. Free slots are linked into
+ * intrusive free list, Push and Take are O(1)
+ */
+template<typename V>
+class IndexedPool {
+public:
+    static const uint32_t kSlotBits = 22;
+    static const uint32_t kMaxSlots = 1 << kSlotBits;
+    static const uint32_t kSlotMask = kMaxSlots - 1;
+
+    // Generation has 10 bits and wraps, index of a slot which was
+    // taken 1024 times since (or a multiple of it) is valid again
+    static const uint32_t kGenerationMask = (1 << (32 - kSlotBits)) - 1;
+
+    IndexedPool()
+        :	free_head_(kNoSlot),
+            count_(0) {}
+
+    uint32_t Push(V value) {
+        uint32_t slot;
+        if (kNoSlot != free_head_) {
+            slot = free_head_;
+            free_head_ = slots_[slot].next_free;
+        } else {
+            slot = slots_.size();
+            RT_ASSERT(slot < kMaxSlots);
+            slots_.push_back(Slot());
+        }
+
+        Slot& s = slots_[slot];
+        RT_ASSERT(!s.used);
+        s.value = std::move(value);
+        s.used = true;
+        s.next_free = kNoSlot;
+        ++count_;
+        return (s.generation << kSlotBits) | slot;
+    }
+
+    /**
+     * Take value out of the pool, default value if index
+     * is stale
+     */
+    V Take(uint32_t index) {
+        Slot* s = Find(index);
+        if (nullptr == s) {
+            return V();
+        }
+
+        s->used = false;
+        s->generation = (s->generation + 1) & kGenerationMask;
+        s->next_free = free_head_;
+        free_head_ = index & kSlotMask;
+        --count_;
+
+        // Free slot keeps moved-from value until it is reused
+        return std::move(s->value);
+    }
+
+    /**
+     * Value in the pool, null if index is stale
+     */
+    V* Get(uint32_t index) {
+        Slot* s = Find(index);
+        return nullptr == s ? nullptr : &s->value;
+    }
+
+    const V* Get(uint32_t index) const {
+        return const_cast<IndexedPool*>(this)->Get(index);
+    }
+
+    bool Contains(uint32_t index) const {
+        return nullptr != Get(index);
+    }
+
+    /**
+     * Number of values in the pool
+     */
+    uint32_t count() const { return count_; }
+
+    /**
+     * Number of allocated slots
+     */
+    uint32_t capacity() const { return slots_.size(); }
+private:
+    static const uint32_t kNoSlot = 0xffffffff;
+
+    struct Slot {
+        Slot()
+            :	value(),
+                generation(0),
+                used(false),
+                next_free(kNoSlot) {}
+
+        Slot(Slot&& other)
+            :	value(std::move(other.value)),
+                generation(other.generation),
+                used(other.used),
+                next_free(other.next_free) {}
+
+        V value;
+        uint32_t generation;
+        bool used;
+        uint32_t next_free;
+    };
+
+    Slot* Find(uint32_t index) {
+        uint32_t slot = index & kSlotMask;
+        if (slot >= slots_.size()) {
+            return nullptr;
+        }
+
+        Slot& s = slots_[slot];
+        if (!s.used || s.generation != (index >> kSlotBits)) {
+            return nullptr;
+        }
+
+        return &s;
+    }
+
+    SharedSTLVector<Slot> slots_;
+    uint32_t free_head_;
+    uint32_t count_;
+    DELETE_COPY_AND_ASSIGN(IndexedPool);
+};
+
+} // namespace rt
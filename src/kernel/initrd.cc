@@ -15,6 +15,8 @@
 #include "initrd.h"
 #include <common/package.h>
 #include <common/crc64.h>
+#include <common/lz4.h>
+#include <stdlib.h>
 
 namespace rt {
 
@@ -22,32 +24,75 @@ void Initrd::Init(const void* buf, size_t len) {
     RT_ASSERT(buf);
     RT_ASSERT(len > 0);
 
-    package::PackageReader reader(buf, len);
-    package::PackageFile file = reader.Next();
+    reader_ = package::PackageReader(buf, len);
+    state_.assign(reader_.files_count(), FileState::UNCHECKED);
+    data_.assign(reader_.files_count(), nullptr);
+}
+
+const uint8_t* Initrd::Load(const package::PackageFile& file) {
+    const uint8_t* data = file.buf();
+    uint8_t* cache = nullptr;
 
-    while (!file.empty()) {
-        uint64_t crc64 = CRC64::Compute(0, file.buf(), file.len());
-        if (file.crc64() != crc64) {
-           // printf("Initrd file %s invalid CRC64, loc %p, len %ul.\n", file.name(), file.buf(), file.len());
-            break;
+    if (file.compressed()) {
+        cache = reinterpret_cast<uint8_t*>(memalign(kCacheAlignment,
+            common::Utils::Align(file.raw_len(), kCacheAlignment)));
+        if (nullptr == cache) {
+            return nullptr;
         }
-        files_.push_back(InitrdFile(file.name(), file.len(), file.buf()));
-        file = reader.Next();
+
+        if (!LZ4::Decompress(file.buf(), file.len(), cache, file.raw_len())) {
+            free(cache);
+            return nullptr;
+        }
+
+        data = cache;
     }
+
+    uint64_t crc64 = CRC64::Compute(0, data, file.raw_len());
+    if (file.crc64() != crc64) {
+        free(cache);
+        return nullptr;
+    }
+
+    if (nullptr != cache) {
+        cache_size_ += common::Utils::Align(file.raw_len(), kCacheAlignment);
+    }
+
+    return data;
 }
 
 const InitrdFile Initrd::GetByIndex(size_t index) {
-    RT_ASSERT(index < files_.size());
-    return files_[index];
+    RT_ASSERT(index < state_.size());
+
+    package::PackageFile file = reader_.Get(index);
+    if (file.empty()) {
+        return InitrdFile();
+    }
+
+    const uint8_t* data = nullptr;
+
+    {   ScopedLock lock(locker_);
+        if (FileState::UNCHECKED == state_[index]) {
+            data_[index] = Load(file);
+            state_[index] = nullptr != data_[index] ? FileState::VALID : FileState::INVALID;
+        }
+        data = data_[index];
+    }
+
+    if (nullptr == data) {
+        // printf("Initrd file %s invalid CRC64, loc %p, len %ul.\n", file.name(), file.buf(), file.len());
+        return InitrdFile();
+    }
+
+    return InitrdFile(file.name(), file.raw_len(), data);
 }
 
 const InitrdFile Initrd::Get(const char* filename) {
-    for (const InitrdFile& file : files_) {
-        if (strcmp(filename, file.Name()) == 0) {
-            return file;
-        }
+    size_t index = reader_.IndexOf(filename);
+    if (package::PackageReader::kNotFound == index) {
+        return InitrdFile();
     }
-    return InitrdFile();
+    return GetByIndex(index);
 }
 
 } // namespace rt
@@ -19,6 +19,8 @@
 #include <vector>
 #include <cstdlib>
 #include <kernel/string.h>
+#include <common/package.h>
+#include <kernel/spinlock.h>
 
 namespace rt {
 
@@ -59,13 +61,15 @@ private:
 };
 
 /**
- * Manages initrd files storage
+ * Manages initrd files storage. Directory is mapped in place,
+ * file CRC64 is verified on first access. Compressed files are
+ * unpacked on first access into page aligned cache buffer which
+ * stays alive while system is running.
  */
 class Initrd {
 public:
-    Initrd() {
-        files_.reserve(20);
-    }
+    Initrd()
+        :	cache_size_(0) { }
 
     /**
      * Initialize using preloaded initrd data buffer
@@ -85,9 +89,28 @@ public:
     /**
      * Initrd files count
      */
-    size_t files_count() const { return files_.size(); }
+    size_t files_count() const { return reader_.files_count(); }
+
+    /**
+     * Memory used by decompressed files cache
+     */
+    size_t cache_size() const { return cache_size_; }
 private:
-    std::vector<InitrdFile> files_;
+    static const size_t kCacheAlignment = 4096;
+
+    enum class FileState : uint8_t {
+        UNCHECKED,
+        VALID,
+        INVALID
+    };
+
+    const uint8_t* Load(const package::PackageFile& file);
+
+    Locker locker_;
+    package::PackageReader reader_;
+    std::vector<FileState> state_;
+    std::vector<const uint8_t*> data_;
+    size_t cache_size_;
 };
 
 } // namespace rt
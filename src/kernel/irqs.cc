@@ -15,9 +15,11 @@
 #include <kernel/kernel.h>
 #include <kernel/irqs.h>
 #include <kernel/cpu.h>
+#include <kernel/fpu.h>
 #include <kernel/mem-manager.h>
 #include <kernel/platform.h>
 #include <kernel/engines.h>
+#include <kernel/trace.h>
 
 using namespace rt;
 
@@ -60,8 +62,8 @@ EXPORT_EVENT void exception_UD_event(uint64_t rip, uint64_t cs) {
 }
 
 EXPORT_EVENT void exception_NM_event() {
-    RT_ASSERT(!"!Ex_x86_64_NM");
-    Cpu::HangSystem();
+    // FPU used for the first time since context switch
+    Fpu::LazyRestore();
 }
 
 EXPORT_EVENT void exception_DF_event() {
@@ -90,7 +92,10 @@ EXPORT_EVENT void exception_GP_event(uint64_t rip, uint64_t cs, uint64_t errcode
 }
 
 EXPORT_EVENT void exception_PF_event(void* fault_address, uint64_t error_code) {
+    uint64_t address = reinterpret_cast<uint64_t>(fault_address);
+    RT_TRACE_BEGIN(Trace::kCategoryPageFault, "page fault", address);
     GLOBAL_mem_manager()->PageFault(fault_address, error_code);
+    RT_TRACE_END(Trace::kCategoryPageFault, "page fault", address);
 }
 
 EXPORT_EVENT void exception_MF_event() {
@@ -0,0 +1,387 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "isolate-memory.h"
+#include <kernel/thread-manager.h>
+#include <kernel/boot-services.h>
+#include <kernel/trace.h>
+#include <kernel/clock.h>
+#include <kernel/mem-manager.h>
+#include <kernel/engines.h>
+#include <stdlib.h>
+
+namespace rt {
+
+namespace {
+
+uint64_t GCClockNanos() {
+    if (nullptr == GLOBAL_clock()) {
+        return 0;
+    }
+    return GLOBAL_clock()->MonotonicNanos();
+}
+
+void MemoryGCPrologue(v8::Isolate* iv8, v8::GCType type,
+                      v8::GCCallbackFlags flags) {
+    IsolateMemory* memory = IsolateMemory::FromIsolate(iv8);
+    if (nullptr != memory) {
+        memory->GCStarted();
+    }
+}
+
+void MemoryGCEpilogue(v8::Isolate* iv8, v8::GCType type,
+                      v8::GCCallbackFlags flags) {
+    IsolateMemory* memory = IsolateMemory::FromIsolate(iv8);
+    if (nullptr != memory) {
+        memory->UpdateHeapUsage(v8::kGCTypeMarkSweepCompact == type);
+    }
+}
+
+void MemoryFatalError(const char* location, const char* message) {
+    RT_LOG_ERROR("isolate fatal error in %s: %s\n", location, message);
+
+    v8::Isolate* iv8 = v8::Isolate::GetCurrent();
+    if (nullptr == iv8) {
+        return;
+    }
+
+    Thread* thread = reinterpret_cast<Thread*>(iv8->GetData(0));
+    IsolateMemory* memory = IsolateMemory::FromIsolate(iv8);
+    if (nullptr == thread || nullptr == memory) {
+        // Boot isolate, V8 aborts the system after we return
+        return;
+    }
+
+    // Stop JavaScript and drop remaining messages of this isolate
+    memory->Terminate();
+
+    // V8 state is unusable after OOM and this stack can't be unwound.
+    // Isolate is unlocked so nobody waits for it forever, Park never
+    // returns and takes the thread out of the scheduler, so neither
+    // this Unlocker nor the Locker on this stack is destroyed.
+    // Isolate memory and thread stack are leaked, other threads
+    // keep running
+    RT_ASSERT(v8::Locker::IsLocked(iv8));
+    v8::Unlocker unlocker(iv8);
+    thread->Park();
+}
+
+// Large buffers, region pages are mapped and zeroed on first access
+void* AllocBufferPages(size_t size) {
+    MemManager* mem = GLOBAL_mem_manager();
+    void* base = mem->ReserveRegion(size, mem->page_size(), nullptr);
+    if (nullptr == base) {
+        return nullptr;
+    }
+
+    if (!mem->CommitRegion(base, size)) {
+        mem->ReleaseRegion(base, size);
+        return nullptr;
+    }
+    return base;
+}
+
+void FreeBufferPages(void* base, size_t size) {
+    GLOBAL_mem_manager()->ReleaseRegion(base, size);
+}
+
+} // namespace
+
+IsolateMemory::IsolateMemory()
+    :	iv8_(nullptr),
+        pressure_(MemoryPressure::NONE),
+        heap_used_(0),
+        heap_limit_(0),
+        notifications_(0),
+        idle_(false),
+        idle_done_(false),
+        system_low_memory_(false),
+        gc_start_(0),
+        gc_count_(0),
+        gc_nanos_(0),
+        idle_gc_count_(0),
+        idle_gc_nanos_(0) {}
+
+IsolateMemory::IsolateMemory(const MemoryLimits& limits)
+    :	limits_(limits),
+        iv8_(nullptr),
+        pressure_(MemoryPressure::NONE),
+        heap_used_(0),
+        heap_limit_(0),
+        notifications_(0),
+        idle_(false),
+        idle_done_(false),
+        system_low_memory_(false),
+        gc_start_(0),
+        gc_count_(0),
+        gc_nanos_(0),
+        idle_gc_count_(0),
+        idle_gc_nanos_(0) {}
+
+void IsolateMemory::SetLimits(const MemoryLimits& limits) {
+    limits_ = limits;
+}
+
+bool IsolateMemory::Attach(v8::Isolate* iv8) {
+    RT_ASSERT(iv8);
+    RT_ASSERT(nullptr == iv8_);
+    iv8_ = iv8;
+
+    v8::ResourceConstraints constraints;
+    constraints.set_max_semi_space_size(limits_.max_semi_space_mb);
+    constraints.set_max_old_space_size(limits_.max_old_space_mb);
+    constraints.set_max_executable_size(limits_.max_executable_mb);
+    bool ok = v8::SetResourceConstraints(iv8, &constraints);
+
+    heap_limit_ = static_cast<uint64_t>(limits_.max_old_space_mb) << 20;
+    iv8->SetData(kDataSlot, this);
+    iv8->AddGCPrologueCallback(MemoryGCPrologue);
+    iv8->AddGCEpilogueCallback(MemoryGCEpilogue);
+    return ok;
+}
+
+void IsolateMemory::InstallFatalErrorHandler() {
+    RT_ASSERT(iv8_);
+    RT_ASSERT(iv8_ == v8::Isolate::GetCurrent());
+    v8::V8::SetFatalErrorHandler(MemoryFatalError);
+}
+
+IsolateMemory* IsolateMemory::Current() {
+    v8::Isolate* iv8 = v8::Isolate::GetCurrent();
+    if (nullptr == iv8) {
+        return nullptr;
+    }
+    return FromIsolate(iv8);
+}
+
+bool IsolateMemory::ChargeArrayBuffer(size_t bytes) {
+    uint64_t total = array_buffer_bytes_.AddFetch(bytes);
+    if (total > limits_.max_array_buffer_bytes) {
+        array_buffer_bytes_.SubFetch(bytes);
+        array_buffer_failures_.AddFetch(1);
+
+        // Unreachable buffers are only released by full GC
+        notification_pending_.Set(1);
+        return false;
+    }
+
+    uint64_t peak = array_buffer_peak_.Get();
+    while (total > peak && !array_buffer_peak_.CompareExchange(peak, total)) {
+        peak = array_buffer_peak_.Get();
+    }
+    return true;
+}
+
+void IsolateMemory::ReleaseArrayBuffer(size_t bytes) {
+    array_buffer_bytes_.SubFetch(bytes);
+}
+
+void IsolateMemory::AdoptArrayBuffer(size_t bytes) {
+    uint64_t total = array_buffer_bytes_.AddFetch(bytes);
+    uint64_t peak = array_buffer_peak_.Get();
+    while (total > peak && !array_buffer_peak_.CompareExchange(peak, total)) {
+        peak = array_buffer_peak_.Get();
+    }
+
+    // Over budget, GC should free something
+    if (total > limits_.max_array_buffer_bytes) {
+        notification_pending_.Set(1);
+    }
+}
+
+void IsolateMemory::HandlePressure() {
+    RT_ASSERT(iv8_);
+    if (!notification_pending_.CompareExchange(1, 0)) {
+        return;
+    }
+
+    ++notifications_;
+    RT_TRACE_INSTANT(Trace::kCategoryGC, "low memory", notifications_);
+    v8::V8::LowMemoryNotification();
+}
+
+bool IsolateMemory::SystemMemoryPressure() {
+    MemManager* mem = GLOBAL_mem_manager();
+    if (nullptr == mem || 0 == mem->physical_memory_total()) {
+        return false;
+    }
+    return mem->vm_resident_total() * 100 / mem->physical_memory_total()
+        >= kPressurePercent;
+}
+
+bool IsolateMemory::NotifyIdle(uint32_t idle_ms) {
+    RT_ASSERT(iv8_);
+    RT_ASSERT(iv8_ == v8::Isolate::GetCurrent());
+    if (idle_done_ || terminated() || 0 == idle_ms) {
+        return idle_done_;
+    }
+
+    if (idle_ms > kMaxIdleMs) {
+        idle_ms = kMaxIdleMs;
+    }
+
+    idle_ = true;
+    RT_TRACE_BEGIN(Trace::kCategoryGC, "idle", idle_ms);
+    if (SystemMemoryPressure()) {
+        // Once per pressure episode, full GC is not cheap
+        if (!system_low_memory_) {
+            system_low_memory_ = true;
+            ++notifications_;
+            v8::V8::LowMemoryNotification();
+
+            // Free buffers kept for reuse, GC might have added some
+            size_t trimmed = GLOBAL_engines()->array_buffer_allocator()->pool().Trim();
+            RT_TRACE_INSTANT(Trace::kCategoryGC, "buffer pool trim", trimmed);
+        }
+        idle_done_ = true;
+    } else {
+        system_low_memory_ = false;
+        idle_done_ = v8::V8::IdleNotification(idle_ms);
+    }
+    RT_TRACE_END(Trace::kCategoryGC, "idle", idle_done_);
+    idle_ = false;
+    return idle_done_;
+}
+
+void IsolateMemory::GCStarted() {
+    gc_start_ = GCClockNanos();
+}
+
+void IsolateMemory::UpdateHeapUsage(bool full_gc) {
+    RT_ASSERT(iv8_);
+    uint64_t elapsed = GCClockNanos() - gc_start_;
+    if (idle_) {
+        ++idle_gc_count_;
+        idle_gc_nanos_ += elapsed;
+    } else {
+        ++gc_count_;
+        gc_nanos_ += elapsed;
+    }
+
+    v8::HeapStatistics stats;
+    iv8_->GetHeapStatistics(&stats);
+    heap_used_ = stats.used_heap_size();
+    if (0 != stats.heap_size_limit()) {
+        heap_limit_ = stats.heap_size_limit();
+    }
+
+    uint64_t percent = 0;
+    if (0 != heap_limit_) {
+        percent = heap_used_ * 100 / heap_limit_;
+    }
+    if (0 != limits_.max_array_buffer_bytes) {
+        uint64_t buffers = array_buffer_bytes_.Get() * 100 /
+            limits_.max_array_buffer_bytes;
+        if (buffers > percent) {
+            percent = buffers;
+        }
+    }
+
+    if (percent >= kTerminatePercent && full_gc) {
+        SetPressure(MemoryPressure::CRITICAL);
+        Terminate();
+    } else if (percent >= kPressurePercent) {
+        SetPressure(MemoryPressure::MODERATE);
+    } else {
+        SetPressure(MemoryPressure::NONE);
+    }
+}
+
+void IsolateMemory::SetPressure(MemoryPressure pressure) {
+    // Notify once every time pressure goes up
+    if (pressure > pressure_) {
+        notification_pending_.Set(1);
+        RT_TRACE_INSTANT(Trace::kCategoryGC, "memory pressure",
+                         static_cast<uint64_t>(pressure));
+    }
+    pressure_ = pressure;
+}
+
+void IsolateMemory::Terminate() {
+    if (!terminated_.CompareExchange(0, 1)) {
+        return;
+    }
+
+    RT_LOG_ERROR("isolate %p terminated: heap %lu of %lu bytes, "
+                 "array buffers %lu bytes\n", iv8_, heap_used_, heap_limit_,
+                 array_buffer_bytes_.Get());
+    v8::V8::TerminateExecution(iv8_);
+}
+
+AccountingArrayBufferAllocator::AccountingArrayBufferAllocator()
+    :	pool_(AllocBufferPages, FreeBufferPages,
+              GLOBAL_mem_manager()->page_size()) {}
+
+void* AccountingArrayBufferAllocator::Allocate(size_t length) {
+    return AllocateStore(length, true);
+}
+
+void* AccountingArrayBufferAllocator::AllocateUninitialized(size_t length) {
+    return AllocateStore(length, false);
+}
+
+void* AccountingArrayBufferAllocator::AllocateStore(size_t length, bool zeroed) {
+    IsolateMemory* memory = IsolateMemory::Current();
+    if (nullptr != memory && !memory->ChargeArrayBuffer(length)) {
+        return nullptr;
+    }
+
+    BackingStore* store = pool_.Alloc(length, zeroed);
+    if (nullptr == store) {
+        if (nullptr != memory) {
+            memory->ReleaseArrayBuffer(length);
+        }
+        return nullptr;
+    }
+    return store->data();
+}
+
+void AccountingArrayBufferAllocator::Free(void* data, size_t length) {
+    if (nullptr == data) {
+        return;
+    }
+
+    // Store can outlive this buffer if it was also unpacked elsewhere
+    BackingStore::FromData(data, length)->Release();
+
+    // Backing stores are freed by GC of the isolate which owns them
+    IsolateMemory* memory = IsolateMemory::Current();
+    if (nullptr != memory) {
+        memory->ReleaseArrayBuffer(length);
+    }
+}
+
+v8::Local<v8::ArrayBuffer> ExternalBufferRef::NewBuffer(v8::Isolate* iv8,
+                                                       BackingStore* store) {
+    RT_ASSERT(iv8);
+    RT_ASSERT(store);
+    RT_ASSERT(BackingStore::Kind::DEVICE == store->kind());
+    v8::EscapableHandleScope scope(iv8);
+    v8::Local<v8::ArrayBuffer> buffer { v8::ArrayBuffer::New(iv8,
+        store->data(), store->length()) };
+    buffer->SetAlignedPointerInInternalField(kStoreField, store);
+
+    // Deletes itself when buffer is collected
+    new ExternalBufferRef(iv8, buffer, store);
+    return scope.Escape(buffer);
+}
+
+void ExternalBufferRef::WeakCallback(const v8::WeakCallbackData<v8::ArrayBuffer,
+                                     ExternalBufferRef>& data) {
+    ExternalBufferRef* ref { data.GetParameter() };
+    ref->store_->Release();
+    delete ref;
+}
+
+} // namespace rt
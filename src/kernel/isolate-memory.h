@@ -0,0 +1,272 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <v8.h>
+#include <kernel/kernel.h>
+#include <kernel/atomic.h>
+#include <kernel/buffer-pool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+namespace rt {
+
+/**
+ * Memory budget of a single process (isolate). V8 heap sizes
+ * are in megabytes, same as v8::ResourceConstraints
+ */
+struct MemoryLimits {
+    MemoryLimits()
+        :	max_semi_space_mb(kDefaultSemiSpaceMb),
+            max_old_space_mb(kDefaultOldSpaceMb),
+            max_executable_mb(kDefaultExecutableMb),
+            max_array_buffer_bytes(kDefaultArrayBufferBytes) {}
+
+    static const int kDefaultSemiSpaceMb = 4;
+    static const int kDefaultOldSpaceMb = 256;
+    static const int kDefaultExecutableMb = 64;
+    static const uint64_t kDefaultArrayBufferBytes = 128ULL << 20;
+    static const uint64_t kMaxBytes = 1ULL << 40;
+
+    /**
+     * Processes get limits in bytes, rounded up to megabytes
+     * for V8 heap sizes
+     */
+    static int MegabytesFromBytes(uint64_t bytes) {
+        RT_ASSERT(bytes <= kMaxBytes);
+        return static_cast<int>((bytes + (1ULL << 20) - 1) >> 20);
+    }
+
+    int max_semi_space_mb;
+    int max_old_space_mb;
+    int max_executable_mb;
+    uint64_t max_array_buffer_bytes;
+};
+
+enum class MemoryPressure {
+    NONE,
+    MODERATE,
+    CRITICAL
+};
+
+/**
+ * Per-isolate memory accounting. Applies heap limits to a new
+ * isolate, charges ArrayBuffer backing stores to the isolate
+ * which allocates them and watches heap usage after every GC.
+ * Isolate above kPressurePercent of its budget gets low memory
+ * notification at the next safe point, isolate still above
+ * kTerminatePercent after full GC is terminated. Fatal V8 OOM
+ * is confined to the isolate which caused it. GC time is counted
+ * separately for GC done while isolate was idle.
+ */
+class IsolateMemory {
+public:
+    static const int kDataSlot = 1;
+    static const uint32_t kPressurePercent = 80;
+    static const uint32_t kTerminatePercent = 95;
+    static const uint32_t kMaxIdleMs = 50;
+
+    IsolateMemory();
+    explicit IsolateMemory(const MemoryLimits& limits);
+
+    /**
+     * Change limits, heap limits only apply to isolates which
+     * are not attached yet
+     */
+    void SetLimits(const MemoryLimits& limits);
+
+    /**
+     * Configure heap limits and attach accounting to a new
+     * (not yet entered) isolate
+     */
+    bool Attach(v8::Isolate* iv8);
+
+    /**
+     * Install fatal OOM handler, isolate must be entered
+     */
+    void InstallFatalErrorHandler();
+
+    /**
+     * Accounting of the isolate which runs on current CPU
+     */
+    static IsolateMemory* Current();
+
+    static IsolateMemory* FromIsolate(v8::Isolate* iv8) {
+        RT_ASSERT(iv8);
+        return reinterpret_cast<IsolateMemory*>(iv8->GetData(kDataSlot));
+    }
+
+    /**
+     * Charge ArrayBuffer backing store, fails when budget
+     * is exhausted
+     */
+    bool ChargeArrayBuffer(size_t bytes);
+    void ReleaseArrayBuffer(size_t bytes);
+
+    /**
+     * Charge buffer transferred from another isolate, it exists
+     * already and can't be refused
+     */
+    void AdoptArrayBuffer(size_t bytes);
+
+    /**
+     * Deliver pending pressure notification, must be called
+     * outside of GC with isolate entered
+     */
+    void HandlePressure();
+
+    /**
+     * Tell V8 isolate is going to be idle for about idle_ms,
+     * isolate must be entered. Does full GC instead when system
+     * is low on memory. Returns true when V8 has nothing left
+     * to clean up, then notifications are skipped until the
+     * isolate does some work
+     */
+    bool NotifyIdle(uint32_t idle_ms);
+
+    /**
+     * Isolate processed a request, idle notifications resume
+     */
+    void RequestDone() {
+        idle_done_ = false;
+    }
+
+    bool idle_done() const { return idle_done_; }
+
+    /**
+     * Physical memory used by all isolate heaps is above
+     * kPressurePercent of total
+     */
+    static bool SystemMemoryPressure();
+
+    /**
+     * GC started, called before every GC
+     */
+    void GCStarted();
+
+    /**
+     * Check heap usage, called after every GC. Isolate can
+     * only be terminated after full GC
+     */
+    void UpdateHeapUsage(bool full_gc);
+
+    /**
+     * Stop the isolate, it never runs JavaScript again
+     */
+    void Terminate();
+
+    const MemoryLimits& limits() const { return limits_; }
+    v8::Isolate* isolate() const { return iv8_; }
+    MemoryPressure pressure() const { return pressure_; }
+    bool terminated() const { return 0 != terminated_.Get(); }
+
+    uint64_t array_buffer_bytes() const { return array_buffer_bytes_.Get(); }
+    uint64_t array_buffer_peak() const { return array_buffer_peak_.Get(); }
+    uint64_t array_buffer_failures() const { return array_buffer_failures_.Get(); }
+    uint64_t heap_used() const { return heap_used_; }
+    uint64_t heap_limit() const { return heap_limit_; }
+    uint64_t pressure_notifications() const { return notifications_; }
+    uint64_t gc_count() const { return gc_count_; }
+    uint64_t gc_nanos() const { return gc_nanos_; }
+    uint64_t idle_gc_count() const { return idle_gc_count_; }
+    uint64_t idle_gc_nanos() const { return idle_gc_nanos_; }
+private:
+    void SetPressure(MemoryPressure pressure);
+
+    MemoryLimits limits_;
+    v8::Isolate* iv8_;
+    Atomic<uint64_t> array_buffer_bytes_;
+    Atomic<uint64_t> array_buffer_peak_;
+    Atomic<uint64_t> array_buffer_failures_;
+    Atomic<uint32_t> notification_pending_;
+    Atomic<uint32_t> terminated_;
+    MemoryPressure pressure_;
+    uint64_t heap_used_;
+    uint64_t heap_limit_;
+    uint64_t notifications_;
+    bool idle_;
+    bool idle_done_;
+    bool system_low_memory_;
+    uint64_t gc_start_;
+    uint64_t gc_count_;
+    uint64_t gc_nanos_;
+    uint64_t idle_gc_count_;
+    uint64_t idle_gc_nanos_;
+    DELETE_COPY_AND_ASSIGN(IsolateMemory);
+};
+
+/**
+ * ArrayBuffer allocator which charges backing stores to the
+ * current isolate budget. Memory comes from buffer pool, large
+ * buffers are backed by heap regions (lazily mapped and zeroed)
+ */
+class AccountingArrayBufferAllocator : public v8::ArrayBuffer::Allocator {
+public:
+    AccountingArrayBufferAllocator();
+
+    virtual void* Allocate(size_t length);
+    virtual void* AllocateUninitialized(size_t length);
+    virtual void Free(void* data, size_t length);
+
+    BufferPool& pool() { return pool_; }
+private:
+    void* AllocateStore(size_t length, bool zeroed);
+
+    BufferPool pool_;
+    DELETE_COPY_AND_ASSIGN(AccountingArrayBufferAllocator);
+};
+
+/**
+ * External ArrayBuffer over device memory store. Store is kept
+ * in buffer internal field, so buffer can be transferred, and
+ * is referenced until buffer is collected
+ */
+class ExternalBufferRef {
+public:
+    static const int kStoreField = 0;
+
+    /**
+     * Map store memory, buffer takes over one reference
+     * of the caller
+     */
+    static v8::Local<v8::ArrayBuffer> NewBuffer(v8::Isolate* iv8,
+                                                BackingStore* store);
+
+    /**
+     * Store of external buffer, null if buffer is not backed
+     * by a device store
+     */
+    static BackingStore* GetStore(v8::Local<v8::ArrayBuffer> buffer) {
+        RT_ASSERT(buffer->IsExternal());
+        return static_cast<BackingStore*>(
+            buffer->GetAlignedPointerFromInternalField(kStoreField));
+    }
+private:
+    ExternalBufferRef(v8::Isolate* iv8, v8::Local<v8::ArrayBuffer> buffer,
+                      BackingStore* store)
+        :	buffer_(iv8, buffer),
+            store_(store) {
+        buffer_.SetWeak(this, WeakCallback);
+    }
+
+    static void WeakCallback(const v8::WeakCallbackData<v8::ArrayBuffer,
+                             ExternalBufferRef>& data);
+
+    v8::UniquePersistent<v8::ArrayBuffer> buffer_;
+    BackingStore* store_;
+    DELETE_COPY_AND_ASSIGN(ExternalBufferRef);
+};
+
+} // namespace rt
@@ -28,6 +28,11 @@
 #include <kernel/logger.h>
 #include <kernel/platform.h>
 #include <kernel/irqs.h>
+#include <kernel/clock.h>
+#include <kernel/native-thread.h>
+#include <kernel/fpu.h>
+#include <common/mem-ops.h>
+#include <kernel/profiler.h>
 
 // #include <test-framework.h>
 #include <kernel/runtimeos.h>
@@ -43,8 +48,11 @@ DEFINE_GLOBAL_OBJECT(GLOBAL_mem_manager, rt::MemManager);
 DEFINE_GLOBAL_OBJECT(GLOBAL_irqs, rt::Irqs);
 DEFINE_GLOBAL_OBJECT(GLOBAL_keystorage, rt::KeyStorage);
 DEFINE_GLOBAL_OBJECT(GLOBAL_initrd, rt::Initrd);
+DEFINE_GLOBAL_OBJECT(GLOBAL_clock, rt::Clock);
+DEFINE_GLOBAL_OBJECT(GLOBAL_native_threads, rt::NativeThreads);
 DEFINE_GLOBAL_OBJECT(GLOBAL_engines, rt::Engines);
 DEFINE_GLOBAL_OBJECT(GLOBAL_trace, rt::Trace);
+DEFINE_GLOBAL_OBJECT(GLOBAL_profiler, rt::Profiler);
 
 #undef DEFINE_GLOBAL_OBJECT
 
@@ -66,6 +74,7 @@ namespace rt {
 void KernelMain::Initialize(void* mbt) {
     CONSTRUCT_GLOBAL_OBJECT(GLOBAL_boot_services, BootServices, );      // NOLINT
     CONSTRUCT_GLOBAL_OBJECT(GLOBAL_multiboot, Multiboot, mbt);			// NOLINT
+    CONSTRUCT_GLOBAL_OBJECT(GLOBAL_clock, Clock, );                     // NOLINT
     CONSTRUCT_GLOBAL_OBJECT(GLOBAL_mem_manager, MemManager, );          // NOLINT
 
     Cpu::DisableInterrupts();
@@ -74,10 +83,16 @@ void KernelMain::Initialize(void* mbt) {
     // Initialize memory manager for this CPU
     // After this line we can use malloc / free to allocate memory
     GLOBAL_mem_manager()->InitSubsystems();
+    Fpu::InitCpu();
+    common::MemOps::Init();
+
+    CONSTRUCT_GLOBAL_OBJECT(GLOBAL_native_threads, NativeThreads, );   // NOLINT
+    GLOBAL_native_threads()->CpuEnter(false);
 
     CONSTRUCT_GLOBAL_OBJECT(GLOBAL_keystorage, KeyStorage, );           // NOLINT
     CONSTRUCT_GLOBAL_OBJECT(GLOBAL_initrd, Initrd, );                   // NOLINT
     CONSTRUCT_GLOBAL_OBJECT(GLOBAL_trace, Trace, );                     // NOLINT
+    CONSTRUCT_GLOBAL_OBJECT(GLOBAL_profiler, Profiler, );               // NOLINT
 
     // This will run V8 static constructors
     uint64_t ctor_count = (end_ctors - start_ctors);
@@ -134,54 +149,58 @@ void KernelMain::InitSystemBSP(void* mbt) {
     libc.threads_minus_1 = 0;
 
     Initialize(mbt);
-    // MultibootParseResult parsed = ParseMultiboot(mbt);
+    // Initializes initrd, command line is not used yet
+    ParseMultiboot(mbt);
 
     CONSTRUCT_GLOBAL_OBJECT(GLOBAL_platform, Platform, );		        // NOLINT
 
     // uint32_t cpus_found = GLOBAL_platform()->cpu_count();
     GLOBAL_platform()->InitCurrentCPU();
 
-    // const char* cmdline = parsed.cmdline();
-
     // GLOBAL_boot_services()->logger()->EnableConsole();
     CONSTRUCT_GLOBAL_OBJECT(GLOBAL_engines, Engines, 1 /*cpus_found*/ );
     Cpu::EnableInterrupts();
     // GLOBAL_engines()->Startup();
 
-    // Uncomment to enable SMP
+    // Uncomment to enable SMP. Heap uncommit and release unmap
+    // pages without TLB shootdown, AddressSpaceX64::UnmapPage
+    // asserts address space is installed on one CPU only. IPI
+    // invalidation is required before this can be enabled
     // GLOBAL_platform()->StartCPUs();
 }
 
 void KernelMain::InitSystemAP() {
     GLOBAL_mem_manager()->InitSubsystems();
+    Fpu::InitCpu();
     GLOBAL_platform()->InitCurrentCPU();
+
+    // Application processors are reserved for V8 background
+    // threads (sweeping, optimizing compiler)
+    GLOBAL_native_threads()->CpuEnter(true);
+    GLOBAL_native_threads()->RunBackground();
 }
 
 
 KernelMain::KernelMain(void* mbt) {
-    uint32_t cpuid = Cpu::id();
-
     InitSystemBSP(mbt);
 
-    // rt::InitrdFile startup_file = GLOBAL_initrd()->Get("/init.js");
-    MultibootStruct* s = reinterpret_cast<MultibootStruct*>(mbt);
-    uint32_t mod_addr = s->module_addr;
-    MultibootModuleEntry* m = reinterpret_cast<MultibootModuleEntry*>(mod_addr);
-    uint32_t rd_start = m->start;
-    uint32_t rd_end = m->end;
-    size_t len = rd_end - rd_start;
+    InitrdFile startup_file = GLOBAL_initrd()->Get("/init.js");
+
+    if (startup_file.IsEmpty() && 0 == GLOBAL_initrd()->files_count()) {
+        // Boot module is not a package, run it as a single script
+        MultibootStruct* s = reinterpret_cast<MultibootStruct*>(mbt);
+        MultibootModuleEntry* m = reinterpret_cast<MultibootModuleEntry*>(s->module_addr);
+        startup_file = InitrdFile("system.js", m->end - m->start,
+            reinterpret_cast<const uint8_t*>(m->start));
+    }
+
+    if (startup_file.IsEmpty()) {
+       // printf("Unable to load /init.js from initrd.\n");
+        abort();
+    }
 
-    // size_t size = startup_file.Size();
-    const void* data = reinterpret_cast<void*>(rd_start);
-    //
-    // uint8_t place[size + 1];
-    // place[size] = '\0';
-    // memcpy(place, data, size);
-    char x[len + 1];
-    memcpy(x, data, len);
-    x[len] = '\0';
-
-    RuntimeOS::Main(x);
+    RuntimeOS::Main(startup_file.Name(),
+        reinterpret_cast<const char*>(startup_file.Data()), startup_file.Size());
 }
 
 } // namespace rt
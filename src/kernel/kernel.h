@@ -33,6 +33,9 @@ namespace rt {
     class Engines;
     class Trace;
     class Irqs;
+    class Clock;
+    class NativeThreads;
+    class Profiler;
 
     class DefaultEASTLAlloc;
 
@@ -47,10 +50,15 @@ namespace rt {
         TraceScope(const char* func, const char* file, int line);
         ~TraceScope();
     private:
+        const char* func_;
+        const char* file_;
+        int line_;
         DELETE_COPY_AND_ASSIGN(TraceScope);
     };
 }
 
+// Host tests and benchmarks link without kernel globals
+#ifndef RUNTIMEJS_PLATFORM_HOST
 #define EXTERNAL_ACCESSOR(TypeName, AccessorName)   \
 static TypeName* AccessorName()                     \
 {                                                   \
@@ -67,7 +75,10 @@ EXTERNAL_ACCESSOR(rt::KeyStorage, GLOBAL_keystorage)
 EXTERNAL_ACCESSOR(rt::Initrd, GLOBAL_initrd)
 EXTERNAL_ACCESSOR(rt::Engines, GLOBAL_engines)
 EXTERNAL_ACCESSOR(rt::Trace, GLOBAL_trace)
+EXTERNAL_ACCESSOR(rt::Clock, GLOBAL_clock)
+EXTERNAL_ACCESSOR(rt::NativeThreads, GLOBAL_native_threads)
+EXTERNAL_ACCESSOR(rt::Profiler, GLOBAL_profiler)
+#undef EXTERNAL_ACCESSOR
+#endif
 
 #define RT_TRACESCOPE rt::TraceScope scope(__PRETTY_FUNCTION__, __FILE__, __LINE__)
-
-#undef EXTERNAL_ACCESSOR
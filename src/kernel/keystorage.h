@@ -17,6 +17,7 @@
 #include <kernel/kernel.h>
 #include <kernel/engines.h>
 #include <kernel/local-storage.h>
+#include <kernel/native-thread.h>
 
 namespace rt {
 
@@ -39,6 +40,12 @@ public:
 
     inline void Set(uint64_t index, void* value) {
         RT_ASSERT(index > 0);
+        NativeThread* worker = CurrentWorker();
+        if (nullptr != worker) {
+            worker->GetLocalStorage().Set(index - 1, value);
+            return;
+        }
+
         if (!GLOBAL_engines()) {
             no_platform_storage_.Set(index - 1, value);
             return;
@@ -49,6 +56,11 @@ public:
 
     inline void* Get(uint64_t index) {
         RT_ASSERT(index > 0);
+        NativeThread* worker = CurrentWorker();
+        if (nullptr != worker) {
+            return worker->GetLocalStorage().Get(index - 1);
+        }
+
         if (!GLOBAL_engines()) {
             return no_platform_storage_.Get(index - 1);
         }
@@ -56,6 +68,13 @@ public:
         return GLOBAL_engines()->cpu_engine()->ThreadLocalGet(index - 1);
     }
 private:
+    static NativeThread* CurrentWorker() {
+        if (nullptr == GLOBAL_native_threads()) {
+            return nullptr;
+        }
+        return GLOBAL_native_threads()->current_worker();
+    }
+
     uint64_t next_index_;
     LocalStorage no_platform_storage_;
     DELETE_COPY_AND_ASSIGN(KeyStorage);
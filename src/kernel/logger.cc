@@ -28,6 +28,10 @@ void LogWriterSerial::WriteChar(LogDataType type, char c) {
     SerialPortX64::WriteByte(c);
 }
 
+void LogWriterSerial::WriteLine(LogDataType type, const char* data, size_t len) {
+    SerialPortX64::WriteBuffer(data, len);
+}
+
 LogWriterVideo::LogWriterVideo()
     :	attribute_(0x0F),
         cursor_x_(0),
@@ -96,11 +100,81 @@ void LogWriterVideo::PutChar(char c, uint8_t color, uint32_t x, uint32_t y) {
     *(video + (y * kWidth + x) * 2 + 1) = color;
 }
 
-void putp_printer(void* p, char c, size_t offset) {
-    RT_ASSERT(p);
-    Logger* prt = reinterpret_cast<Logger*>(p);
-    prt->PutChar(c);
+int Logger::PrintFormat(LogDataType type, const char* fmt, va_list va) {
+    char line[kLineLength];
+    int count = tfp_vsnprintf(line, sizeof(line), fmt, va);
+    if (count <= 0) {
+        return count;
+    }
+
+    size_t len = static_cast<size_t>(count) < sizeof(line) ?
+        static_cast<size_t>(count) : sizeof(line) - 1;
+
+    uint32_t cpu = Cpu::id();
+    if (cpu >= kMaxCpus) {
+        LockWriters();
+        WriteLine(type, line, len);
+        UnlockWriters();
+        return count;
+    }
+
+    // Interrupt handler on this CPU could log too, ring
+    // has a single producer
+    bool interrupts = Cpu::InterruptsEnabled();
+    Cpu::DisableInterrupts();
+
+    uint8_t tag = static_cast<uint8_t>(type);
+    bool pushed = rings_[cpu].Push(tag, line, len);
+    if (!pushed) {
+        Drain();
+        pushed = rings_[cpu].Push(tag, line, len);
+    }
+
+    if (interrupts) {
+        Cpu::EnableInterrupts();
+    }
+
+    if (!pushed) {
+        __atomic_add_fetch(&dropped_, 1, __ATOMIC_RELAXED);
+    }
+
+    Drain();
+    return count;
+}
+
+void Logger::Drain() {
+    // Records pushed while other CPU was releasing writers
+    // would be left behind, check again after unlock
+    do {
+        if (!TryLockWriters()) {
+            return;
+        }
+
+        char line[kLineLength];
+        for (uint32_t cpu = 0; cpu < kMaxCpus; ++cpu) {
+            uint8_t tag;
+            size_t len;
+            while (rings_[cpu].Pop(&tag, line, sizeof(line), &len)) {
+                WriteLine(static_cast<LogDataType>(tag), line, len);
+            }
+        }
+
+        UnlockWriters();
+    } while (!RingsEmpty());
+}
+
+bool Logger::RingsEmpty() const {
+    for (uint32_t cpu = 0; cpu < kMaxCpus; ++cpu) {
+        if (!rings_[cpu].empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Logger::WriteLine(LogDataType type, const char* data, size_t len) {
+    if (video_enabled_) video_writer_.WriteLine(type, data, len);
+    if (console_enabled_) serial_writer_.WriteLine(type, data, len);
 }
 
 } // namespace rt
-
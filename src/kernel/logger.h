@@ -17,6 +17,7 @@
 // #include <kernel/kernel.h>
 #include <printf.h>
 #include <kernel/spinlock.h>
+#include <common/log-ring.h>
 #include <stdarg.h>
 #include <memory>
 #include <array>
@@ -24,6 +25,37 @@
 // No memory allocation allowed in this file. This is part of boot
 // services, runs before memory manager initialization.
 
+#define RT_LOG_LEVEL_NONE   0
+#define RT_LOG_LEVEL_ERROR  1
+#define RT_LOG_LEVEL_INFO   2
+#define RT_LOG_LEVEL_DEBUG  3
+
+// Messages above this level are removed at compile time
+#ifndef RT_LOG_LEVEL
+#define RT_LOG_LEVEL RT_LOG_LEVEL_INFO
+#endif
+
+#if RT_LOG_LEVEL >= RT_LOG_LEVEL_ERROR
+#define RT_LOG_ERROR(...)                                                       \
+    GLOBAL_boot_services()->logger()->printf(rt::LogDataType::ERR, __VA_ARGS__)
+#else
+#define RT_LOG_ERROR(...) ((void)0)
+#endif
+
+#if RT_LOG_LEVEL >= RT_LOG_LEVEL_INFO
+#define RT_LOG_INFO(...)                                                        \
+    GLOBAL_boot_services()->logger()->printf(rt::LogDataType::DEFAULT, __VA_ARGS__)
+#else
+#define RT_LOG_INFO(...) ((void)0)
+#endif
+
+#if RT_LOG_LEVEL >= RT_LOG_LEVEL_DEBUG
+#define RT_LOG_DEBUG(...)                                                       \
+    GLOBAL_boot_services()->logger()->printf(rt::LogDataType::DBG, __VA_ARGS__)
+#else
+#define RT_LOG_DEBUG(...) ((void)0)
+#endif
+
 namespace rt {
 
 enum class LogDataType {
@@ -45,16 +77,18 @@ enum class LoggerMode {
 class LogWriter {
 public:
     virtual void WriteChar(LogDataType type, char c) = 0;
-    void Lock() { Spinlock(lock_).lock(); }
-    void Unlock() { Spinlock(lock_).unlock(); }
-private:
-    Locker lock_;
+    virtual void WriteLine(LogDataType type, const char* data, size_t len) {
+        for (size_t i = 0; i < len; ++i) {
+            WriteChar(type, data[i]);
+        }
+    }
 };
 
 class LogWriterSerial : public LogWriter {
 public:
     LogWriterSerial();
     void WriteChar(LogDataType type, char c);
+    void WriteLine(LogDataType type, const char* data, size_t len);
 };
 
 class LogWriterVideo : public LogWriter {
@@ -76,13 +110,19 @@ private:
     void PutChar(char c, uint8_t color, uint32_t x, uint32_t y);
 };
 
-void putp_printer(void* p, char c, size_t offset);
-
+/**
+ * Every printf call is formatted in one pass into a stack buffer
+ * and appended to current CPU ring without taking any lock. Whoever
+ * gets the writers first drains all rings and writes whole records
+ * to the devices, other CPUs do not wait for it.
+ */
 class Logger {
     friend class BootServices;
-    friend class LoggerPrinter;
-    friend void putp_printer(void* p, char c, size_t offset);
 public:
+    static const size_t kLineLength = 256;
+    static const uint32_t kMaxCpus = 32;
+    static const size_t kRingSize = 4096;
+
     int printf(LogDataType type, const char* fmt, ...) {
         va_list va;
         va_start(va, fmt);
@@ -101,21 +141,33 @@ public:
 
     void PutCharSnapshot(char c) {
         RT_ASSERT(!console_enabled_);
-        serial_writer_.Lock();
+        LockWriters();
         serial_writer_.WriteChar(LogDataType::SNAPSHOT, c);
-        serial_writer_.Unlock();
+        UnlockWriters();
     }
 
     void __tmp_Lock() {
-        video_writer_.Lock();
+        Drain();
+        LockWriters();
     }
     void __tmp_Unlock() {
-        video_writer_.Unlock();
+        UnlockWriters();
     }
     void __tmp_Putch(char c) {
         video_writer_.WriteChar(LogDataType::ERR, c);
     }
 
+    /**
+     * Write raw data to serial port regardless of logger mode,
+     * used to export profiles
+     */
+    void WriteSerial(const char* data, size_t len) {
+        Drain();
+        LockWriters();
+        serial_writer_.WriteLine(LogDataType::DEFAULT, data, len);
+        UnlockWriters();
+    }
+
     void EnableConsole() {
         console_enabled_ = true;
     }
@@ -123,36 +175,39 @@ public:
     void DisableVideo() {
         video_enabled_ = false;
     }
+
+    /**
+     * Records lost because CPU ring was full
+     */
+    uint64_t dropped() const {
+        return __atomic_load_n(&dropped_, __ATOMIC_RELAXED);
+    }
 private:
     Logger()
         :	mode_(LoggerMode::VIDEO),
             console_enabled_(false), //false
             video_enabled_(true),
-            type_(LogDataType::DEFAULT) { }
+            writers_busy_(0),
+            dropped_(0) { }
     ~Logger() {}
 
-    int PrintFormat(LogDataType type, const char* fmt, va_list va) {
-        bool video = video_enabled_;
-        bool console = console_enabled_;
-
-        if (video) video_writer_.Lock();
-        if (console) serial_writer_.Lock();
-
-        type_ = type;
-        int count = tfp_format(this, putp_printer, fmt, va);
+    int PrintFormat(LogDataType type, const char* fmt, va_list va);
+    void Drain();
+    void WriteLine(LogDataType type, const char* data, size_t len);
+    bool RingsEmpty() const;
 
-        if (console) serial_writer_.Unlock();
-        if (video) video_writer_.Unlock();
-
-        return count;
+    bool TryLockWriters() {
+        return 0 == __sync_lock_test_and_set(&writers_busy_, 1);
     }
 
-    void PutChar(char c) {
-        bool video = video_enabled_;
-        bool console = console_enabled_;
+    void LockWriters() {
+        while (!TryLockWriters()) {
+            Cpu::WaitPause();
+        }
+    }
 
-        if (video) video_writer_.WriteChar(type_, c);
-        if (console) serial_writer_.WriteChar(type_, c);
+    void UnlockWriters() {
+        __sync_lock_release(&writers_busy_);
     }
 
     LoggerMode mode_;
@@ -160,7 +215,9 @@ private:
     bool video_enabled_;
     LogWriterVideo video_writer_;
     LogWriterSerial serial_writer_;
-    LogDataType type_;
+    volatile uint32_t writers_busy_;
+    uint64_t dropped_;
+    common::LogRing<kRingSize> rings_[kMaxCpus];
 };
 
 } // namespace rt
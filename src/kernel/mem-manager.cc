@@ -55,6 +55,22 @@ void MemManager::PageFault(void* fault_address, uint64_t error_code) {
         // Lazy-identity mapping for 4 GB virtual address space
         phys_mem = fault_address;
         writethrough = true;
+    } else if (VirtualAllocator::IsHeapAddress(fa)) {
+        // Memory which was never committed, uncommitted or
+        // released must not silently come back as zeros
+        if (!IsCommitted(fault_address)) {
+            GLOBAL_boot_services()
+                ->FatalError("Access to uncommitted heap memory = %p,"
+                             " error code = %d, cpu %d\n",
+                             fault_address, error_code, Cpu::id());
+        }
+
+        // Lazy commit of reserved heap region, heap
+        // memory is expected to be zero-filled
+        phys_mem = pmm_.alloc();
+        vm_resident_.AddFetch(pmm_.chunk_size());
+        clean = true;
+        writethrough = false;
     } else if (fa < 512 * 256 * common::Constants::GiB) {
         // Automatic mapping normal space
         phys_mem = pmm_.alloc();
@@ -71,12 +87,287 @@ void MemManager::PageFault(void* fault_address, uint64_t error_code) {
     addr_space_.MapPage(fault_address, phys_mem, true, writethrough);
 
     if (clean) {
-        // Clean memory
+        // Clean memory, faulting code is going to use it right
+        // away, cached stores are faster here
         void* s = pmm_.PageAligned(fault_address);
         memset(s, 0, pmm_.chunk_size());
     }
 }
 
+void* MemManager::ReserveRegion(size_t size, size_t alignment, VmAccount* account) {
+    if (0 == size) {
+        return nullptr;
+    }
+
+    VirtualRange range = vmm_.AllocHeapRange(size, alignment);
+    if (0 == range.base()) {
+        return nullptr;
+    }
+
+    {   ScopedLock lock(vm_locker_);
+        vm_regions_.insert(vm_regions_.begin() + RegionsAfter(range.base()),
+                           VmRegion(range, account));
+    }
+
+    vm_total_.AddReserved(range.size());
+    if (nullptr != account) {
+        account->AddReserved(range.size());
+    }
+
+    return reinterpret_cast<void*>(range.base());
+}
+
+bool MemManager::CommitRegion(void* base, size_t size) {
+    uintptr_t start = reinterpret_cast<uintptr_t>(base);
+
+    ScopedLock lock(vm_locker_);
+    VmRegion* region = FindRegion(start);
+    if (nullptr == region || start + size > region->range.end()) {
+        return false;
+    }
+
+    size_t committed = SetCommitted(region, start, start + size, true);
+    region->committed += committed;
+    vm_total_.AddCommitted(committed);
+    if (nullptr != region->account) {
+        region->account->AddCommitted(committed);
+    }
+
+    return true;
+}
+
+bool MemManager::UncommitRegion(void* base, size_t size) {
+    uintptr_t start = reinterpret_cast<uintptr_t>(base);
+
+    ScopedLock lock(vm_locker_);
+    VmRegion* region = FindRegion(start);
+    if (nullptr == region || start + size > region->range.end()) {
+        return false;
+    }
+
+    size_t uncommitted = SetCommitted(region, start, start + size, false);
+
+    // Pages with other committed blocks stay mapped
+    uintptr_t page_size = pmm_.chunk_size();
+    for (uintptr_t page = start & ~(page_size - 1); page < start + size;
+         page += page_size) {
+        if (!IsPageCommitted(*region, page)) {
+            UnmapRange(page, page + page_size);
+        }
+    }
+
+    RT_ASSERT(uncommitted <= region->committed);
+    region->committed -= uncommitted;
+    vm_total_.AddCommitted(-static_cast<int64_t>(uncommitted));
+    if (nullptr != region->account) {
+        region->account->AddCommitted(-static_cast<int64_t>(uncommitted));
+    }
+
+    return true;
+}
+
+bool MemManager::ReleaseRegion(void* base, size_t size) {
+    uintptr_t start = reinterpret_cast<uintptr_t>(base);
+    VirtualRange range(0, 0);
+    VmAccount* account = nullptr;
+    size_t committed = 0;
+
+    {   ScopedLock lock(vm_locker_);
+        VmRegion* region = FindRegion(start);
+        if (nullptr == region || start != region->range.base()) {
+            return false;
+        }
+
+        RT_ASSERT(size <= region->range.size());
+        range = region->range;
+        account = region->account;
+        committed = region->committed;
+
+        UnmapRange(range.base(), range.end());
+        vm_regions_.erase(vm_regions_.begin() + (region - vm_regions_.data()));
+    }
+
+    vmm_.FreeHeapRange(range);
+
+    vm_total_.AddReserved(-static_cast<int64_t>(range.size()));
+    vm_total_.AddCommitted(-static_cast<int64_t>(committed));
+    if (nullptr != account) {
+        account->AddReserved(-static_cast<int64_t>(range.size()));
+        account->AddCommitted(-static_cast<int64_t>(committed));
+    }
+
+    return true;
+}
+
+bool MemManager::IsCommitted(void* address) {
+    uintptr_t addr = reinterpret_cast<uintptr_t>(address);
+
+    ScopedLock lock(vm_locker_);
+    VmRegion* region = FindRegion(addr);
+    if (nullptr == region) {
+        return false;
+    }
+
+    return IsBlockCommitted(*region, addr);
+}
+
+size_t MemManager::SetCommitted(VmRegion* region, uintptr_t start,
+                                uintptr_t end, bool committed) {
+    RT_ASSERT(region);
+    RT_ASSERT(start >= region->range.base());
+    RT_ASSERT(end <= region->range.end());
+
+    // Commit covers partial blocks at both ends, uncommit
+    // leaves them committed
+    uintptr_t offset = start - region->range.base();
+    uintptr_t offset_end = end - region->range.base();
+    size_t first = committed ? offset / kCommitBlockSize :
+        (offset + kCommitBlockSize - 1) / kCommitBlockSize;
+    size_t last = committed ? (offset_end + kCommitBlockSize - 1) / kCommitBlockSize :
+        offset_end / kCommitBlockSize;
+
+    size_t changed = 0;
+    for (size_t i = first; i < last; ++i) {
+        uint64_t& word = region->commit_bits[i / 64];
+        uint64_t bit = static_cast<uint64_t>(1) << (i % 64);
+        if (committed != (0 != (word & bit))) {
+            word ^= bit;
+            ++changed;
+        }
+    }
+
+    return changed * kCommitBlockSize;
+}
+
+bool MemManager::IsBlockCommitted(const VmRegion& region, uintptr_t addr) const {
+    size_t block = (addr - region.range.base()) / kCommitBlockSize;
+    RT_ASSERT(block / 64 < region.commit_bits.size());
+    return 0 != (region.commit_bits[block / 64] & (static_cast<uint64_t>(1) << (block % 64)));
+}
+
+bool MemManager::IsPageCommitted(const VmRegion& region, uintptr_t page) const {
+    size_t page_size = pmm_.chunk_size();
+    RT_ASSERT(0 == page_size % (64 * kCommitBlockSize));
+    RT_ASSERT(0 == (page - region.range.base()) % page_size);
+
+    size_t first = (page - region.range.base()) / kCommitBlockSize / 64;
+    size_t count = page_size / kCommitBlockSize / 64;
+    for (size_t i = first; i < first + count; ++i) {
+        if (0 != region.commit_bits[i]) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+size_t MemManager::RegionsAfter(uintptr_t addr) const {
+    size_t low = 0;
+    size_t high = vm_regions_.size();
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (vm_regions_[middle].range.base() <= addr) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+MemManager::VmRegion* MemManager::FindRegion(uintptr_t addr) {
+    // Regions don't overlap, only the last one which starts
+    // at or below address can contain it
+    size_t index = RegionsAfter(addr);
+    if (0 == index) {
+        return nullptr;
+    }
+
+    VmRegion& region = vm_regions_[index - 1];
+    return region.range.Contains(addr) ? &region : nullptr;
+}
+
+void MemManager::UnmapRange(uintptr_t start, uintptr_t end) {
+    uintptr_t page_size = pmm_.chunk_size();
+    RT_ASSERT(0 == start % page_size);
+    RT_ASSERT(0 == end % page_size);
+
+    for (uintptr_t p = start; p < end; p += page_size) {
+        void* phys = addr_space_.UnmapPage(reinterpret_cast<void*>(p));
+        if (nullptr == phys) {
+            continue;
+        }
+
+        {   ScopedLock lock(page_alloc_locker_);
+            pmm_.free(phys);
+        }
+
+        vm_resident_.SubFetch(page_size);
+    }
+}
+
+VirtualRange VirtualAllocator::AllocHeapRange(size_t size, size_t alignment) {
+    uint64_t page_size = PhysicalAllocator::chunk_size();
+    if (alignment < page_size) {
+        alignment = page_size;
+    }
+    RT_ASSERT(0 == (alignment & (alignment - 1)));
+    size = (size + page_size - 1) & ~(page_size - 1);
+
+    ScopedLock lock(heap_alloc_locker_);
+
+    // First fit in previously released ranges, remainders
+    // before and after allocated range stay free
+    for (size_t i = 0; i < heap_free_ranges_.size(); ++i) {
+        VirtualRange free_range = heap_free_ranges_[i];
+        uintptr_t base = (free_range.base() + alignment - 1) & ~(alignment - 1);
+        if (base + size > free_range.end()) {
+            continue;
+        }
+
+        heap_free_ranges_[i] = heap_free_ranges_.back();
+        heap_free_ranges_.pop_back();
+
+        if (base > free_range.base()) {
+            heap_free_ranges_.push_back(VirtualRange(free_range.base(),
+                base - free_range.base()));
+        }
+
+        if (base + size < free_range.end()) {
+            heap_free_ranges_.push_back(VirtualRange(base + size,
+                free_range.end() - base - size));
+        }
+
+        return VirtualRange(base, size);
+    }
+
+    uintptr_t base = (heap_alloc_next_ + alignment - 1) & ~(alignment - 1);
+    if (base + size > kHeapsBase + kHeapsSize) {
+        return VirtualRange(0, 0);
+    }
+
+    if (base > heap_alloc_next_) {
+        heap_free_ranges_.push_back(VirtualRange(heap_alloc_next_,
+            base - heap_alloc_next_));
+    }
+
+    heap_alloc_next_ = base + size;
+    return VirtualRange(base, size);
+}
+
+void VirtualAllocator::FreeHeapRange(VirtualRange range) {
+    RT_ASSERT(IsHeapAddress(range.base()));
+
+    ScopedLock lock(heap_alloc_locker_);
+    if (range.end() == heap_alloc_next_) {
+        heap_alloc_next_ = range.base();
+        return;
+    }
+
+    heap_free_ranges_.push_back(range);
+}
+
 MallocAllocator::MallocAllocator()
     :	default_mspace_(nullptr) {}
 
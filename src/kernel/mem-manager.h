@@ -14,7 +14,9 @@
 
 #pragma once
 
+#include <vector>
 #include <kernel/kernel.h>
+#include <kernel/atomic.h>
 #include <kernel/spinlock.h>
 #include <kernel/multiboot.h>
 #include <kernel/boot-services.h>
@@ -287,13 +289,36 @@ private:
     size_t len_;
 };
 
+/**
+ * Range of virtual address space
+ */
+class VirtualRange {
+public:
+    VirtualRange(uintptr_t base, size_t size) :
+        base_(base),
+        size_(size) { }
+
+    uintptr_t base() const { return base_; }
+    size_t size() const { return size_; }
+    uintptr_t end() const { return base_ + size_; }
+
+    bool Contains(uintptr_t addr) const {
+        return addr >= base_ && addr < end();
+    }
+
+private:
+    uintptr_t base_;
+    size_t size_;
+};
+
 /**
  * Manages virtual memory
  */
 class VirtualAllocator {
 public:
     VirtualAllocator() :
-        stack_alloc_next_(kStacks) {}
+        stack_alloc_next_(kStacks),
+        heap_alloc_next_(kHeapsBase) {}
 
     VirtualStack AllocStack() {
         ScopedLock lock(stack_alloc_locker_);
@@ -325,12 +350,34 @@ public:
         return kSpaceSize;
     }
 
+    /**
+     * Reserve range of heap address space. Size is rounded up to
+     * physical page size, alignment is at least page size. Nothing
+     * is mapped until the range is touched
+     */
+    VirtualRange AllocHeapRange(size_t size, size_t alignment);
+
+    /**
+     * Return range to heap address space, all pages in the range
+     * should be already unmapped
+     */
+    void FreeHeapRange(VirtualRange range);
+
+    static bool IsHeapAddress(uintptr_t addr) {
+        return addr >= kHeapsBase && addr < kHeapsBase + kHeapsSize;
+    }
+
     static const uint64_t kSpacesBase = 256 * common::Constants::GiB;
     static const uint64_t kSpaceSize = 256 * common::Constants::GiB;
     static const uint64_t kStacks = 128 * common::Constants::GiB;
+    static const uint64_t kHeapsBase = 64 * 1024 * common::Constants::GiB;
+    static const uint64_t kHeapsSize = 32 * 1024 * common::Constants::GiB;
 private:
     Locker stack_alloc_locker_;
     uint64_t stack_alloc_next_;
+    Locker heap_alloc_locker_;
+    uint64_t heap_alloc_next_;
+    std::vector<VirtualRange> heap_free_ranges_;
     DELETE_COPY_AND_ASSIGN(VirtualAllocator);
 };
 
@@ -417,6 +464,25 @@ private:
     DELETE_COPY_AND_ASSIGN(MallocAllocator);
 };
 
+/**
+ * Reserved and committed virtual memory counters of a single
+ * owner (isolate)
+ */
+class VmAccount {
+public:
+    VmAccount() {}
+
+    uint64_t reserved() const { return reserved_.Get(); }
+    uint64_t committed() const { return committed_.Get(); }
+
+    void AddReserved(int64_t bytes) { reserved_.AddFetch(bytes); }
+    void AddCommitted(int64_t bytes) { committed_.AddFetch(bytes); }
+private:
+    Atomic<uint64_t> reserved_;
+    Atomic<uint64_t> committed_;
+    DELETE_COPY_AND_ASSIGN(VmAccount);
+};
+
 /**
  * Controls memory and address space
  */
@@ -453,6 +519,56 @@ public:
         return pmm_.alloc32();
     }
 
+    /**
+     * Commit state is tracked in blocks of this size (V8 commit
+     * page size), physical pages are larger
+     */
+    static const size_t kCommitBlockSize = 4096;
+
+    /**
+     * Reserve virtual memory region in heap address space. Region
+     * is charged to account (can be null)
+     */
+    void* ReserveRegion(size_t size, size_t alignment, VmAccount* account);
+
+    /**
+     * Commit part of reserved region. Commits are lazy, pages are
+     * mapped and zeroed on first access
+     */
+    bool CommitRegion(void* base, size_t size);
+
+    /**
+     * Decommit part of reserved region. Physical pages with no
+     * committed blocks left are unmapped and returned to allocator
+     */
+    bool UncommitRegion(void* base, size_t size);
+
+    /**
+     * Release whole reserved region and all its physical pages
+     */
+    bool ReleaseRegion(void* base, size_t size);
+
+    /**
+     * Check if address belongs to committed part of a region,
+     * other heap addresses must never be accessed
+     */
+    bool IsCommitted(void* address);
+
+    /**
+     * Total virtual memory reserved in heap address space
+     */
+    uint64_t vm_reserved_total() const { return vm_total_.reserved(); }
+
+    /**
+     * Total virtual memory committed in heap address space
+     */
+    uint64_t vm_committed_total() const { return vm_total_.committed(); }
+
+    /**
+     * Physical memory mapped into heap address space
+     */
+    uint64_t vm_resident_total() const { return vm_resident_.Get(); }
+
     /**
      * Get physical page size
      */
@@ -479,6 +595,45 @@ private:
     AddressSpaceX64 addr_space_;
     bool malloc_available_;
     Locker page_alloc_locker_;
+
+    class VmRegion {
+    public:
+        VmRegion(VirtualRange range, VmAccount* account) :
+            range(range),
+            account(account),
+            committed(0),
+            commit_bits((range.size() / kCommitBlockSize + 63) / 64, 0) { }
+
+        VirtualRange range;
+        VmAccount* account;
+        size_t committed;
+
+        // One bit per commit block
+        std::vector<uint64_t> commit_bits;
+    };
+
+    Locker vm_locker_;
+
+    // Sorted by base address, page fault path does binary search
+    std::vector<VmRegion> vm_regions_;
+    VmAccount vm_total_;
+    Atomic<uint64_t> vm_resident_;
+
+    VmRegion* FindRegion(uintptr_t addr);
+
+    /**
+     * Index of the first region which starts above address
+     */
+    size_t RegionsAfter(uintptr_t addr) const;
+    void UnmapRange(uintptr_t start, uintptr_t end);
+
+    /**
+     * Set commit state of blocks in [start, end), returns number
+     * of bytes which changed state
+     */
+    size_t SetCommitted(VmRegion* region, uintptr_t start, uintptr_t end, bool committed);
+    bool IsBlockCommitted(const VmRegion& region, uintptr_t addr) const;
+    bool IsPageCommitted(const VmRegion& region, uintptr_t page) const;
     DELETE_COPY_AND_ASSIGN(MemManager);
 };
 
@@ -15,6 +15,7 @@
 #pragma once
 #include <kernel/kernel.h>
 #include <kernel/object-wrapper.h>
+#include <kernel/atomic.h>
 
 namespace rt {
 
@@ -22,7 +23,12 @@ namespace rt {
  * Represents external function, exported from other context
  * or isolate. Containts all data required to make RPC
  * function call. Inherits native object wrapper, so its
- * possible to wrap this into v8 object instance
+ * possible to wrap this into v8 object instance.
+ *
+ * Owned by exporter function table. Reference counted by v8
+ * wrapper objects and serialized data which carries it. Last
+ * reference sends release message to the exporter, which frees
+ * the export unless it was exported again meanwhile.
  */
 class ExternalFunction : public NativeObjectWrapper {
 public:
@@ -34,6 +40,33 @@ public:
         RT_ASSERT(thread_);
     }
 
+    void AddRef() {
+        state_.AddFetch(kRefOne);
+    }
+
+    /**
+     * Drop reference, last one sends release message to the
+     * exporter thread
+     */
+    void Release();
+
+    /**
+     * Exporter thread got release message. Returns true if
+     * function is not referenced and should be freed
+     */
+    bool TryFree() {
+        for (;;) {
+            uint64_t state = state_.Get();
+            if (kReleasePending == state) {
+                // Only exporter can add references now
+                return true;
+            }
+            if (state_.CompareExchange(state, state & ~kReleasePending)) {
+                return false;
+            }
+        }
+    }
+
     /**
      * ID allocated by function impementor
      */
@@ -54,10 +87,43 @@ public:
      */
     ResourceHandle<EngineThread> recv() const { return recv_; }
 private:
+    // Reference count and release message flag share one word,
+    // last reference sends at most one message
+    static const uint64_t kReleasePending = 1;
+    static const uint64_t kRefOne = 2;
+
     uint32_t index_;
     size_t export_id_;
     Thread* thread_;
     ResourceHandle<EngineThread> recv_;
+    Atomic<uint64_t> state_;
+};
+
+/**
+ * Weak handle of v8 object which wraps external function,
+ * holds function reference until the object is collected
+ */
+class ExternalFunctionWrapper {
+public:
+    ExternalFunctionWrapper(v8::Isolate* iv8, v8::Local<v8::Object> obj,
+                            ExternalFunction* efn)
+        :	object_(iv8, obj),
+            efn_(efn) {
+        RT_ASSERT(efn_);
+        efn_->AddRef();
+        object_.SetWeak(this, WeakCallback);
+    }
+private:
+    static void WeakCallback(const v8::WeakCallbackData<v8::Object,
+                             ExternalFunctionWrapper>& data) {
+        ExternalFunctionWrapper* w { data.GetParameter() };
+        w->efn_->Release();
+        delete w;
+    }
+
+    v8::UniquePersistent<v8::Object> object_;
+    ExternalFunction* efn_;
+    DELETE_COPY_AND_ASSIGN(ExternalFunctionWrapper);
 };
 
 } // namespace rt
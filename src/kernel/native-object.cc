@@ -32,6 +32,44 @@ using ::common::Nullable;
 template<typename T>
 using SharedSTLVector = std::vector<T, DefaultSTLAlloc<T>>;
 
+namespace {
+
+/**
+ * Promise of a call which was not sent, receiver is over
+ * budget and caller has too many calls waiting
+ */
+v8::Local<v8::Promise::Resolver> RejectedCall(v8::Isolate* iv8, Thread* th) {
+    v8::EscapableHandleScope scope(iv8);
+    th->AddRejectedCall();
+    v8::Local<v8::Promise::Resolver> promise_resolver {
+        v8::Promise::Resolver::New(iv8) };
+    promise_resolver->Reject(v8::Exception::Error(
+        v8::String::NewFromUtf8(iv8, "Receiver mailbox is full")));
+    return scope.Escape(promise_resolver);
+}
+
+/**
+ * Read optional numeric option, returns false when it is
+ * present and not in [1, max]
+ */
+bool ReadOption(v8::Isolate* iv8, v8::Local<v8::Object> options,
+                const char* name, double max, double* value) {
+    v8::Local<v8::Value> v { options->Get(v8::String::NewFromUtf8(iv8, name)) };
+    if (v->IsUndefined()) {
+        return true;
+    }
+
+    double number { v->NumberValue() };
+    if (!v->IsNumber() || !(number >= 1 && number <= max)) {
+        return false;
+    }
+
+    *value = number;
+    return true;
+}
+
+} // namespace
+
 NATIVE_FUNCTION(NativesObject, CallHandler) {
     PROLOGUE_NOTHIS;
 
@@ -54,6 +92,33 @@ NATIVE_FUNCTION(NativesObject, CallHandler) {
     Thread* recv { efn->recv().get()->thread() };
     RT_ASSERT(recv);
 
+    // Function exported by this isolate. Call it from a microtask
+    // with original arguments, no serialization and no message
+    if (recv == th) {
+        v8::Local<v8::Value> fnval { th->GetExport(efn) };
+        if (!fnval.IsEmpty() && fnval->IsFunction()) {
+            v8::Local<v8::Promise::Resolver> promise_resolver {
+                v8::Promise::Resolver::New(iv8) };
+
+            int argc = args.Length();
+            v8::Local<v8::Array> data { v8::Array::New(iv8, argc + 2) };
+            data->Set(0, fnval);
+            data->Set(1, promise_resolver);
+            for (int i = 0; i < argc; ++i) {
+                data->Set(i + 2, args[i]);
+            }
+
+            iv8->EnqueueMicrotask(v8::Function::New(iv8, LocalCall, data));
+            args.GetReturnValue().Set(promise_resolver);
+            return;
+        }
+    }
+
+    if (th->CallsOverLimit()) {
+        args.GetReturnValue().Set(RejectedCall(iv8, th));
+        return;
+    }
+
     TransportData data;
     {	TransportData::SerializeError err { data.MoveArgs(th, recv, args) };
         if (TransportData::ThrowError(iv8, err)) return;
@@ -68,12 +133,72 @@ NATIVE_FUNCTION(NativesObject, CallHandler) {
             ThreadMessage::Type::FUNCTION_CALL,
             th->handle(),
             std::move(data), efn, promise_index));
-        efn->recv().get()->PushMessage(std::move(msg));
+        th->SendCall(efn->recv(), std::move(msg));
     }
 
     args.GetReturnValue().Set(promise_resolver);
 }
 
+NATIVE_FUNCTION(NativesObject, LocalCall) {
+    PROLOGUE_NOTHIS;
+    RT_ASSERT(args.Data()->IsArray());
+    v8::Local<v8::Array> data { v8::Local<v8::Array>::Cast(args.Data()) };
+    RT_ASSERT(data->Length() >= 2);
+
+    v8::Local<v8::Value> fnval { data->Get(0) };
+    RT_ASSERT(fnval->IsFunction());
+    v8::Local<v8::Function> fn { v8::Local<v8::Function>::Cast(fnval) };
+    v8::Local<v8::Promise::Resolver> resolver {
+        v8::Local<v8::Promise::Resolver>::Cast(data->Get(1)) };
+
+    uint32_t argc = data->Length() - 2;
+    std::vector<v8::Local<v8::Value>> argv;
+    argv.reserve(argc);
+    for (uint32_t i = 0; i < argc; ++i) {
+        argv.push_back(data->Get(i + 2));
+    }
+
+    v8::TryCatch trycatch;
+    v8::Local<v8::Value> result { fn->Call(iv8->GetCurrentContext()->Global(),
+                                           argc, argv.data()) };
+    if (trycatch.HasCaught()) {
+        resolver->Reject(trycatch.Exception());
+        return;
+    }
+
+    // Settle with the value promise returned by function resolves
+    // to, same as calls through the mailbox do
+    if (result->IsPromise()) {
+        v8::Local<v8::Promise> promise { v8::Local<v8::Promise>::Cast(result) };
+        v8::Local<v8::Array> on_resolve { v8::Array::New(iv8, 2) };
+        on_resolve->Set(0, resolver);
+        on_resolve->Set(1, v8::True(iv8));
+        v8::Local<v8::Array> on_reject { v8::Array::New(iv8, 2) };
+        on_reject->Set(0, resolver);
+        on_reject->Set(1, v8::False(iv8));
+        promise->Then(v8::Function::New(iv8, LocalCallSettle, on_resolve));
+        promise->Catch(v8::Function::New(iv8, LocalCallSettle, on_reject));
+        return;
+    }
+
+    resolver->Resolve(result);
+}
+
+NATIVE_FUNCTION(NativesObject, LocalCallSettle) {
+    PROLOGUE_NOTHIS;
+    USEARG(0);
+    RT_ASSERT(args.Data()->IsArray());
+    v8::Local<v8::Array> data { v8::Local<v8::Array>::Cast(args.Data()) };
+    v8::Local<v8::Promise::Resolver> resolver {
+        v8::Local<v8::Promise::Resolver>::Cast(data->Get(0)) };
+
+    if (data->Get(1)->BooleanValue()) {
+        resolver->Resolve(arg0);
+    } else {
+        resolver->Reject(arg0);
+    }
+}
+
 NATIVE_FUNCTION(NativesObject, CallResult) {
     PROLOGUE_NOTHIS;
     RT_ASSERT(4 == args.Length());
@@ -109,6 +234,237 @@ NATIVE_FUNCTION(NativesObject, CallResult) {
     }
 }
 
+NATIVE_FUNCTION(NativesObject, CallBatch) {
+    PROLOGUE_NOTHIS;
+    USEARG(0);
+    USEARG(1);
+    VALIDATEARG(1, ARRAY, "callBatch: argument 1 should be an array");
+
+    ExternalFunction* efn { nullptr };
+    if (arg0->IsObject()) {
+        v8::Local<v8::Object> obj { arg0->ToObject() };
+        if (obj->InternalFieldCount() == 1) {
+            void* ptr = obj->GetAlignedPointerFromInternalField(0);
+            NativeObjectWrapper* wrapper { static_cast<NativeObjectWrapper*>(ptr) };
+            if (nullptr != wrapper &&
+                NativeTypeId::TYPEID_FUNCTION == wrapper->type_id()) {
+                efn = static_cast<ExternalFunction*>(wrapper);
+            }
+        }
+    }
+
+    if (nullptr == efn) {
+        THROW_TYPE_ERROR("callBatch: argument 0 should be an external function");
+    }
+
+    Thread* recv { efn->recv().get()->thread() };
+    RT_ASSERT(recv);
+
+    if (th->CallsOverLimit()) {
+        args.GetReturnValue().Set(RejectedCall(iv8, th));
+        return;
+    }
+
+    // Whole list is serialized at once, single buffer per entry
+    TransportData data;
+    {	TransportData::SerializeError err { data.MoveValue(th, recv, arg1) };
+        if (TransportData::ThrowError(iv8, err)) return;
+    }
+
+    v8::Local<v8::Promise::Resolver> promise_resolver {
+        v8::Promise::Resolver::New(iv8) };
+    uint32_t promise_index = th->AddPromise(
+        v8::UniquePersistent<v8::Promise::Resolver>(iv8, promise_resolver));
+
+    th->QueueCall(efn, std::move(data), promise_index,
+                  v8::Local<v8::Array>::Cast(arg1)->Length());
+    args.GetReturnValue().Set(promise_resolver);
+}
+
+NATIVE_FUNCTION(NativesObject, SetExceptionHandler) {
+    PROLOGUE_NOTHIS;
+    USEARG(0);
+    VALIDATEARG(0, FUNCTION, "setExceptionHandler: argument 0 should be a function");
+    th->SetExceptionHandler(v8::Local<v8::Function>::Cast(arg0));
+    args.GetReturnValue().SetUndefined();
+}
+
+NATIVE_FUNCTION(NativesObject, SetDrainLimits) {
+    PROLOGUE_NOTHIS;
+    USEARG(0);
+    USEARG(1);
+    VALIDATEARG(0, NUMBER, "setDrainLimits: argument 0 should be a number");
+    VALIDATEARG(1, UINT32, "setDrainLimits: argument 1 should be an unsigned integer");
+
+    double slice_ms { arg0->NumberValue() };
+    uint32_t budget { arg1->Uint32Value() };
+    if (slice_ms <= 0 || 0 == budget) {
+        THROW_RANGE_ERROR("setDrainLimits: limits should be positive");
+    }
+
+    th->SetDrainLimits(static_cast<uint64_t>(slice_ms * 1e6), budget);
+    args.GetReturnValue().SetUndefined();
+}
+
+NATIVE_FUNCTION(NativesObject, SetMailboxLimits) {
+    PROLOGUE_NOTHIS;
+    USEARG(0);
+    USEARG(1);
+    VALIDATEARG(0, UINT32, "setMailboxLimits: argument 0 should be an unsigned integer");
+    VALIDATEARG(1, UINT32, "setMailboxLimits: argument 1 should be an unsigned integer");
+
+    uint32_t capacity { arg0->Uint32Value() };
+    uint32_t pending { arg1->Uint32Value() };
+    if (0 == capacity || 0 == pending) {
+        THROW_RANGE_ERROR("setMailboxLimits: limits should be positive");
+    }
+
+    th->SetMailboxLimits(capacity, pending);
+    args.GetReturnValue().SetUndefined();
+}
+
+NATIVE_FUNCTION(NativesObject, MailboxInfo) {
+    PROLOGUE_NOTHIS;
+    EngineThread::MailboxStats stats { th->handle().get()->stats() };
+    CallCredits& credits { th->handle().get()->credits() };
+
+    LOCAL_V8STRING(s_depth, "depth");
+    LOCAL_V8STRING(s_high_watermark, "highWatermark");
+    LOCAL_V8STRING(s_pushed, "pushed");
+    LOCAL_V8STRING(s_irq_dropped, "irqDropped");
+    LOCAL_V8STRING(s_credits_used, "creditsUsed");
+    LOCAL_V8STRING(s_credits_peak, "creditsPeak");
+    LOCAL_V8STRING(s_capacity, "capacity");
+    LOCAL_V8STRING(s_denied, "denied");
+    LOCAL_V8STRING(s_deferred, "deferred");
+    LOCAL_V8STRING(s_pending_limit, "pendingLimit");
+    LOCAL_V8STRING(s_rejected, "rejected");
+
+    v8::Local<v8::Object> obj { v8::Object::New(iv8) };
+    obj->Set(s_depth, v8::Number::New(iv8, static_cast<double>(stats.depth)));
+    obj->Set(s_high_watermark, v8::Number::New(iv8,
+        static_cast<double>(stats.high_watermark)));
+    obj->Set(s_pushed, v8::Number::New(iv8, static_cast<double>(stats.pushed)));
+    obj->Set(s_irq_dropped, v8::Number::New(iv8,
+        static_cast<double>(stats.irq_dropped)));
+    obj->Set(s_credits_used, v8::Uint32::NewFromUnsigned(iv8, credits.used()));
+    obj->Set(s_credits_peak, v8::Uint32::NewFromUnsigned(iv8, credits.peak()));
+    obj->Set(s_capacity, v8::Uint32::NewFromUnsigned(iv8, credits.capacity()));
+    obj->Set(s_denied, v8::Number::New(iv8, static_cast<double>(credits.denied())));
+    obj->Set(s_deferred, v8::Number::New(iv8,
+        static_cast<double>(th->deferred_calls())));
+    obj->Set(s_pending_limit, v8::Number::New(iv8,
+        static_cast<double>(th->max_pending_calls())));
+    obj->Set(s_rejected, v8::Number::New(iv8,
+        static_cast<double>(th->rejected_calls())));
+    args.GetReturnValue().Set(obj);
+}
+
+NATIVE_FUNCTION(NativesObject, SetTimeSlice) {
+    PROLOGUE_NOTHIS;
+    USEARG(0);
+    VALIDATEARG(0, UINT32, "setTimeSlice: argument 0 should be an unsigned integer");
+
+    uint32_t ms { arg0->Uint32Value() };
+    if (0 == ms) {
+        THROW_RANGE_ERROR("setTimeSlice: time slice should be positive");
+    }
+
+    th->SetTimeSlice(static_cast<uint64_t>(ms) * 1000 * 1000);
+    args.GetReturnValue().SetUndefined();
+}
+
+NATIVE_FUNCTION(NativesObject, SchedulerInfo) {
+    PROLOGUE_NOTHIS;
+    const SchedEntity& sched { th->sched() };
+
+    LOCAL_V8STRING(s_level, "level");
+    LOCAL_V8STRING(s_run_time, "runTime");
+    LOCAL_V8STRING(s_wait_time, "waitTime");
+    LOCAL_V8STRING(s_max_wait, "maxWait");
+    LOCAL_V8STRING(s_last_slice, "lastSlice");
+    LOCAL_V8STRING(s_dispatches, "dispatches");
+    LOCAL_V8STRING(s_irq_wakeups, "irqWakeups");
+    LOCAL_V8STRING(s_irq_count, "irqCount");
+    LOCAL_V8STRING(s_irq_latency, "irqLatency");
+    LOCAL_V8STRING(s_irq_latency_max, "irqLatencyMax");
+    LOCAL_V8STRING(s_preemptions, "preemptions");
+    LOCAL_V8STRING(s_time_slice, "timeSlice");
+
+    // Times in milliseconds, IRQ latency is the average
+    double irq_latency = 0 == sched.irq_count() ? 0 :
+        static_cast<double>(sched.irq_latency_nanos()) / sched.irq_count() / 1e6;
+
+    v8::Local<v8::Object> obj { v8::Object::New(iv8) };
+    obj->Set(s_level, v8::Uint32::NewFromUnsigned(iv8, sched.level()));
+    obj->Set(s_run_time, v8::Number::New(iv8,
+        static_cast<double>(sched.run_nanos()) / 1e6));
+    obj->Set(s_wait_time, v8::Number::New(iv8,
+        static_cast<double>(sched.wait_nanos()) / 1e6));
+    obj->Set(s_max_wait, v8::Number::New(iv8,
+        static_cast<double>(sched.max_wait_nanos()) / 1e6));
+    obj->Set(s_last_slice, v8::Number::New(iv8,
+        static_cast<double>(sched.last_slice_nanos()) / 1e6));
+    obj->Set(s_dispatches, v8::Number::New(iv8,
+        static_cast<double>(sched.dispatches())));
+    obj->Set(s_irq_wakeups, v8::Number::New(iv8,
+        static_cast<double>(sched.irq_wakeups())));
+    obj->Set(s_irq_count, v8::Number::New(iv8,
+        static_cast<double>(sched.irq_count())));
+    obj->Set(s_irq_latency, v8::Number::New(iv8, irq_latency));
+    obj->Set(s_irq_latency_max, v8::Number::New(iv8,
+        static_cast<double>(sched.irq_latency_max_nanos()) / 1e6));
+    obj->Set(s_preemptions, v8::Number::New(iv8,
+        static_cast<double>(th->preemptions())));
+    obj->Set(s_time_slice, v8::Number::New(iv8,
+        static_cast<double>(th->time_slice_nanos()) / 1e6));
+    args.GetReturnValue().Set(obj);
+}
+
+NATIVE_FUNCTION(NativesObject, CreateChannel) {
+    PROLOGUE_NOTHIS;
+    USEARG(0);
+    VALIDATEARG(0, UINT32, "createChannel: argument 0 should be an unsigned integer");
+
+    Channel* channel { Channel::Create(arg0->Uint32Value()) };
+    if (nullptr == channel) {
+        THROW_RANGE_ERROR("createChannel: size should be a power of two up to 1 GiB");
+    }
+
+    v8::Local<v8::Array> endpoints { v8::Array::New(iv8, 2) };
+    endpoints->Set(0, (new ChannelObject(th->template_cache(), channel,
+        Channel::Side::PRODUCER))->GetInstance());
+    endpoints->Set(1, (new ChannelObject(th->template_cache(), channel,
+        Channel::Side::CONSUMER))->GetInstance());
+    args.GetReturnValue().Set(endpoints);
+}
+
+NATIVE_FUNCTION(NativesObject, RecycleBuffer) {
+    PROLOGUE_NOTHIS;
+    USEARG(0);
+    VALIDATEARG(0, ARRAYBUFFER, "recycleBuffer: argument 0 should be an ArrayBuffer");
+
+    // Return memory to the pool now instead of on GC, buffer
+    // becomes empty
+    v8::Local<v8::ArrayBuffer> buffer { v8::Local<v8::ArrayBuffer>::Cast(arg0) };
+    if (buffer->IsExternal()) {
+        if (nullptr == ExternalBufferRef::GetStore(buffer)) {
+            THROW_ERROR("recycleBuffer: buffer is not owned by allocator");
+        }
+        buffer->Neuter();
+        args.GetReturnValue().SetUndefined();
+        return;
+    }
+
+    v8::ArrayBuffer::Contents c { buffer->Externalize() };
+    buffer->Neuter();
+    if (nullptr != c.Data()) {
+        BackingStore::FromData(c.Data(), c.ByteLength())->Release();
+        th->memory().ReleaseArrayBuffer(c.ByteLength());
+    }
+    args.GetReturnValue().SetUndefined();
+}
+
 NATIVE_FUNCTION(NativesObject, SetTimeout) {
     PROLOGUE_NOTHIS;
     USEARG(0);
@@ -161,9 +517,8 @@ NATIVE_FUNCTION(NativesObject, InitrdText) {
         return;
     }
 
-    v8::Local<v8::String> text { v8::String::NewFromUtf8(iv8,
-        reinterpret_cast<const char*>(file.Data()),
-        v8::String::kNormalString, file.Size()) };
+    v8::Local<v8::String> text { V8Utils::StaticString(iv8,
+        reinterpret_cast<const char*>(file.Data()), file.Size()) };
 
     args.GetReturnValue().Set(text);
 }
@@ -194,6 +549,89 @@ NATIVE_FUNCTION(NativesObject, InitrdList) {
     args.GetReturnValue().Set(arr);
 }
 
+NATIVE_FUNCTION(NativesObject, MemoryInfo) {
+    PROLOGUE_NOTHIS;
+    MemManager* mem { GLOBAL_mem_manager() };
+
+    LOCAL_V8STRING(s_reserved, "reserved");
+    LOCAL_V8STRING(s_committed, "committed");
+    LOCAL_V8STRING(s_total_reserved, "totalReserved");
+    LOCAL_V8STRING(s_total_committed, "totalCommitted");
+    LOCAL_V8STRING(s_resident, "resident");
+    LOCAL_V8STRING(s_heap_used, "heapUsed");
+    LOCAL_V8STRING(s_heap_limit, "heapLimit");
+    LOCAL_V8STRING(s_array_buffers, "arrayBuffers");
+    LOCAL_V8STRING(s_array_buffers_peak, "arrayBuffersPeak");
+    LOCAL_V8STRING(s_array_buffers_limit, "arrayBuffersLimit");
+    LOCAL_V8STRING(s_array_buffers_failed, "arrayBuffersFailed");
+    LOCAL_V8STRING(s_pressure, "pressure");
+    LOCAL_V8STRING(s_notifications, "lowMemoryNotifications");
+    LOCAL_V8STRING(s_gc_count, "gcCount");
+    LOCAL_V8STRING(s_gc_time, "gcTime");
+    LOCAL_V8STRING(s_idle_gc_count, "idleGcCount");
+    LOCAL_V8STRING(s_idle_gc_time, "idleGcTime");
+    LOCAL_V8STRING(s_exports, "exports");
+    LOCAL_V8STRING(s_export_slots, "exportSlots");
+    LOCAL_V8STRING(s_buffer_stores, "bufferStores");
+    LOCAL_V8STRING(s_buffer_reused, "bufferStoresReused");
+    LOCAL_V8STRING(s_buffer_cached, "bufferPoolCached");
+
+    v8::Local<v8::Object> obj { v8::Object::New(iv8) };
+    obj->Set(s_reserved, v8::Number::New(iv8,
+        static_cast<double>(th->vm_account().reserved())));
+    obj->Set(s_committed, v8::Number::New(iv8,
+        static_cast<double>(th->vm_account().committed())));
+    obj->Set(s_total_reserved, v8::Number::New(iv8,
+        static_cast<double>(mem->vm_reserved_total())));
+    obj->Set(s_total_committed, v8::Number::New(iv8,
+        static_cast<double>(mem->vm_committed_total())));
+    obj->Set(s_resident, v8::Number::New(iv8,
+        static_cast<double>(mem->vm_resident_total())));
+
+    IsolateMemory& memory { th->memory() };
+    obj->Set(s_heap_used, v8::Number::New(iv8,
+        static_cast<double>(memory.heap_used())));
+    obj->Set(s_heap_limit, v8::Number::New(iv8,
+        static_cast<double>(memory.heap_limit())));
+    obj->Set(s_array_buffers, v8::Number::New(iv8,
+        static_cast<double>(memory.array_buffer_bytes())));
+    obj->Set(s_array_buffers_peak, v8::Number::New(iv8,
+        static_cast<double>(memory.array_buffer_peak())));
+    obj->Set(s_array_buffers_limit, v8::Number::New(iv8,
+        static_cast<double>(memory.limits().max_array_buffer_bytes)));
+    obj->Set(s_array_buffers_failed, v8::Number::New(iv8,
+        static_cast<double>(memory.array_buffer_failures())));
+    obj->Set(s_pressure, v8::Uint32::NewFromUnsigned(iv8,
+        static_cast<uint32_t>(memory.pressure())));
+    obj->Set(s_notifications, v8::Number::New(iv8,
+        static_cast<double>(memory.pressure_notifications())));
+    obj->Set(s_gc_count, v8::Number::New(iv8,
+        static_cast<double>(memory.gc_count())));
+    obj->Set(s_gc_time, v8::Number::New(iv8,
+        static_cast<double>(memory.gc_nanos()) / 1e6));
+    obj->Set(s_idle_gc_count, v8::Number::New(iv8,
+        static_cast<double>(memory.idle_gc_count())));
+    obj->Set(s_idle_gc_time, v8::Number::New(iv8,
+        static_cast<double>(memory.idle_gc_nanos()) / 1e6));
+    obj->Set(s_exports, v8::Number::New(iv8,
+        static_cast<double>(th->exports().count())));
+    obj->Set(s_export_slots, v8::Number::New(iv8,
+        static_cast<double>(th->exports().capacity())));
+
+    AccountingArrayBufferAllocator* allocator { GLOBAL_engines()->array_buffer_allocator() };
+    if (nullptr != allocator) {
+        BufferPool& pool { allocator->pool() };
+        obj->Set(s_buffer_stores, v8::Number::New(iv8,
+            static_cast<double>(pool.allocated())));
+        obj->Set(s_buffer_reused, v8::Number::New(iv8,
+            static_cast<double>(pool.reused())));
+        obj->Set(s_buffer_cached, v8::Number::New(iv8,
+            static_cast<double>(pool.cached_bytes())));
+    }
+
+    args.GetReturnValue().Set(obj);
+}
+
 NATIVE_FUNCTION(NativesObject, KernelLoaderCallback) {
     PROLOGUE_NOTHIS;
     USEARG(0);
@@ -208,9 +646,8 @@ NATIVE_FUNCTION(NativesObject, KernelLoaderCallback) {
         return;
     }
 
-    v8::Local<v8::String> text { v8::String::NewFromUtf8(iv8,
-        reinterpret_cast<const char*>(file.Data()),
-        v8::String::kNormalString, file.Size()) };
+    v8::Local<v8::String> text { V8Utils::StaticString(iv8,
+        reinterpret_cast<const char*>(file.Data()), file.Size()) };
 
     args.GetReturnValue().Set(text);
 }
@@ -821,7 +1258,8 @@ NATIVE_FUNCTION(ResourceMemoryBlockObject, Buffer) {
     RT_ASSERT(ptr);
     RT_ASSERT(length > 0);
 
-    args.GetReturnValue().Set(v8::ArrayBuffer::New(iv8, ptr, length));
+    args.GetReturnValue().Set(ExternalBufferRef::NewBuffer(iv8,
+        BackingStore::NewDevice(ptr, length)));
 }
 
 NATIVE_FUNCTION(ResourceMemoryBlockObject, Length) {
@@ -839,6 +1277,45 @@ NATIVE_FUNCTION(ProcessManagerHandleObject, Create) {
     RT_ASSERT(arg0->IsString());
     RT_ASSERT(arg1->IsObject());
 
+    // Optional options object, time slice in milliseconds and
+    // memory budget in bytes:
+    // { timeSlice, heapLimit, semiSpaceLimit, codeLimit, arrayBuffersLimit }
+    uint64_t time_slice_nanos = 0;
+    MemoryLimits limits;
+    if (args.Length() > 2 && args[2]->IsObject()) {
+        v8::Local<v8::Object> options { args[2].As<v8::Object>() };
+        const double max_bytes = static_cast<double>(MemoryLimits::kMaxBytes);
+        double time_slice = 0;
+        double heap = 0;
+        double semi_space = 0;
+        double code = 0;
+        double array_buffers = 0;
+
+        if (!ReadOption(iv8, options, "timeSlice", UINT32_MAX, &time_slice)) {
+            THROW_RANGE_ERROR("create: timeSlice should be a positive number of milliseconds");
+        }
+        if (!ReadOption(iv8, options, "heapLimit", max_bytes, &heap) ||
+            !ReadOption(iv8, options, "semiSpaceLimit", max_bytes, &semi_space) ||
+            !ReadOption(iv8, options, "codeLimit", max_bytes, &code) ||
+            !ReadOption(iv8, options, "arrayBuffersLimit", max_bytes, &array_buffers)) {
+            THROW_RANGE_ERROR("create: memory limits should be positive sizes in bytes up to 1 TiB");
+        }
+
+        time_slice_nanos = static_cast<uint64_t>(time_slice * 1000 * 1000);
+        if (0 != heap) {
+            limits.max_old_space_mb = MemoryLimits::MegabytesFromBytes(heap);
+        }
+        if (0 != semi_space) {
+            limits.max_semi_space_mb = MemoryLimits::MegabytesFromBytes(semi_space);
+        }
+        if (0 != code) {
+            limits.max_executable_mb = MemoryLimits::MegabytesFromBytes(code);
+        }
+        if (0 != array_buffers) {
+            limits.max_array_buffer_bytes = static_cast<uint64_t>(array_buffers);
+        }
+    }
+
     RT_ASSERT(GLOBAL_engines()->execution_engines_count() > 0);
     Engine* first_engine = GLOBAL_engines()->execution_engine(0);
     RT_ASSERT(first_engine);
@@ -857,6 +1334,8 @@ NATIVE_FUNCTION(ProcessManagerHandleObject, Create) {
     ResourceHandle<EngineThread> st = first_engine->threads().Create();
 
     {	LockingPtr<EngineThread> thread { st.get() };
+        thread->SetTimeSlice(time_slice_nanos);
+        thread->SetMemoryLimits(limits);
 
         {	std::unique_ptr<ThreadMessage> msg(new ThreadMessage(
                 ThreadMessage::Type::SET_ARGUMENTS,
@@ -878,6 +1357,94 @@ NATIVE_FUNCTION(ProcessManagerHandleObject, Create) {
     args.GetReturnValue().Set(proc->NewInstance(th));
 }
 
+NATIVE_FUNCTION(ChannelObject, Buffer) {
+    PROLOGUE;
+    SpscRing& ring { that->channel_->ring() };
+    v8::Local<v8::ArrayBuffer> buffer { v8::ArrayBuffer::New(iv8, ring.memory(),
+        SpscRing::MemorySize(ring.size())) };
+
+    // Deletes itself when buffer is collected
+    new ChannelBufferRef(iv8, buffer, that->channel_);
+    args.GetReturnValue().Set(buffer);
+}
+
+NATIVE_FUNCTION(ChannelObject, Size) {
+    PROLOGUE;
+    args.GetReturnValue().Set(v8::Uint32::NewFromUnsigned(iv8,
+        that->channel_->ring().size()));
+}
+
+NATIVE_FUNCTION(ChannelObject, IsProducer) {
+    PROLOGUE;
+    args.GetReturnValue().Set(v8::Boolean::New(iv8,
+        Channel::Side::PRODUCER == that->side_));
+}
+
+NATIVE_FUNCTION(ChannelObject, Commit) {
+    PROLOGUE;
+    USEARG(0);
+    VALIDATEARG(0, UINT32, "commit: argument 0 should be an unsigned integer");
+    if (that->detached_ || Channel::Side::PRODUCER != that->side_) {
+        THROW_ERROR("commit: not a producer endpoint");
+    }
+
+    if (!that->channel_->ring().IsValid()) {
+        THROW_RANGE_ERROR("commit: ring indices are corrupted");
+    }
+
+    uint32_t bytes { arg0->Uint32Value() };
+    if (bytes > that->channel_->ring().Writable()) {
+        THROW_RANGE_ERROR("commit: more bytes than free space");
+    }
+
+    that->channel_->Commit(bytes);
+    args.GetReturnValue().SetUndefined();
+}
+
+NATIVE_FUNCTION(ChannelObject, Consume) {
+    PROLOGUE;
+    USEARG(0);
+    VALIDATEARG(0, UINT32, "consume: argument 0 should be an unsigned integer");
+    if (that->detached_ || Channel::Side::CONSUMER != that->side_) {
+        THROW_ERROR("consume: not a consumer endpoint");
+    }
+
+    if (!that->channel_->ring().IsValid()) {
+        THROW_RANGE_ERROR("consume: ring indices are corrupted");
+    }
+
+    uint32_t bytes { arg0->Uint32Value() };
+    if (bytes > that->channel_->ring().Readable()) {
+        THROW_RANGE_ERROR("consume: more bytes than available");
+    }
+
+    that->channel_->Consume(bytes);
+    args.GetReturnValue().SetUndefined();
+}
+
+NATIVE_FUNCTION(ChannelObject, Wait) {
+    PROLOGUE;
+    USEARG(0);
+    VALIDATEARG(0, FUNCTION, "wait: argument 0 should be a function");
+    if (that->detached_) {
+        THROW_ERROR("wait: endpoint is detached");
+    }
+
+    uint32_t index { th->AddDoorbellData(v8::UniquePersistent<v8::Value>(iv8, arg0)) };
+    Channel::WaitStatus status { that->channel_->Wait(that->side_, th->handle(), index) };
+    if (Channel::WaitStatus::ARMED != status) {
+        // No doorbell is coming for this index
+        th->TakeDoorbellData(index);
+    }
+
+    if (Channel::WaitStatus::BUSY == status) {
+        THROW_ERROR("wait: endpoint is waiting already");
+    }
+
+    args.GetReturnValue().Set(v8::Boolean::New(iv8,
+        Channel::WaitStatus::ARMED == status));
+}
+
 NATIVE_FUNCTION(AllocatorObject, AllocDMA) {
     PROLOGUE;
 
@@ -901,7 +1468,8 @@ NATIVE_FUNCTION(AllocatorObject, AllocDMA) {
     v8::Local<v8::Object> ret { v8::Object::New(iv8) };
     ret->Set(s_address, v8::Uint32::New(iv8, static_cast<uint32_t>(ptrvalue)));
     ret->Set(s_size, v8::Uint32::New(iv8, static_cast<uint32_t>(size)));
-    ret->Set(s_buffer, v8::ArrayBuffer::New(iv8, ptr, size));
+    ret->Set(s_buffer, ExternalBufferRef::NewBuffer(iv8,
+        BackingStore::NewDevice(ptr, size)));
 
     args.GetReturnValue().Set(ret);
 }
@@ -18,6 +18,7 @@
 #include <kernel/string.h>
 #include <kernel/v8utils.h>
 #include <kernel/template-cache.h>
+#include <kernel/channel.h>
 #include <acpi.h>
 
 namespace rt {
@@ -40,6 +41,58 @@ public:
     DECLARE_NATIVE(Args);
     DECLARE_NATIVE(InstallInternals);
     DECLARE_NATIVE(CallResult);
+
+    /**
+     * Call external function once for every arguments array
+     * in the list. Calls to the same isolate during current turn
+     * share one message. Returns promise of results array
+     */
+    DECLARE_NATIVE(CallBatch);
+
+    /**
+     * Set function called with exceptions not caught by
+     * message handlers of this isolate
+     */
+    DECLARE_NATIVE(SetExceptionHandler);
+
+    /**
+     * Set mailbox drain time slice (ms) and number of settled
+     * promises which forces microtask checkpoint
+     */
+    DECLARE_NATIVE(SetDrainLimits);
+
+    /**
+     * Set number of calls this isolate mailbox accepts and number
+     * of calls it keeps waiting for busy receivers
+     */
+    DECLARE_NATIVE(SetMailboxLimits);
+
+    /**
+     * Get mailbox depth, high watermark and call credit counters
+     * of current isolate
+     */
+    DECLARE_NATIVE(MailboxInfo);
+
+    /**
+     * Get scheduler level, run and wait time and IRQ latency
+     * of current isolate
+     */
+    DECLARE_NATIVE(SetTimeSlice);
+    DECLARE_NATIVE(SchedulerInfo);
+
+    /**
+     * Create shared memory channel with ring of given size
+     * (power of two). Returns [producer, consumer] endpoints
+     */
+    DECLARE_NATIVE(CreateChannel);
+    DECLARE_NATIVE(RecycleBuffer);
+
+    /**
+     * Microtask which runs same-isolate call, and promise
+     * handlers which settle its result
+     */
+    DECLARE_NATIVE(LocalCall);
+    DECLARE_NATIVE(LocalCallSettle);
     DECLARE_NATIVE(Debug);
     DECLARE_NATIVE(StopVideoLog);
 
@@ -48,6 +101,12 @@ public:
      */
     DECLARE_NATIVE(InitrdList);
 
+    /**
+     * Get virtual memory counters of current isolate heap,
+     * function exports and system totals
+     */
+    DECLARE_NATIVE(MemoryInfo);
+
     void ObjectInit(ExportBuilder obj) {
         obj.SetCallback("timeout", SetTimeout);
         obj.SetCallback("kernelLog", KernelLog);
@@ -55,10 +114,20 @@ public:
         obj.SetCallback("args", Args);
         obj.SetCallback("installInternals", InstallInternals);
         obj.SetCallback("callResult", CallResult);
+        obj.SetCallback("callBatch", CallBatch);
+        obj.SetCallback("setExceptionHandler", SetExceptionHandler);
+        obj.SetCallback("setDrainLimits", SetDrainLimits);
+        obj.SetCallback("setMailboxLimits", SetMailboxLimits);
+        obj.SetCallback("mailboxInfo", MailboxInfo);
+        obj.SetCallback("setTimeSlice", SetTimeSlice);
+        obj.SetCallback("schedulerInfo", SchedulerInfo);
+        obj.SetCallback("createChannel", CreateChannel);
+        obj.SetCallback("recycleBuffer", RecycleBuffer);
         obj.SetCallback("initrdText", InitrdText);
         obj.SetCallback("debug", Debug);
         obj.SetCallback("stopVideoLog", StopVideoLog);
         obj.SetCallback("initrdList", InitrdList);
+        obj.SetCallback("memoryInfo", MemoryInfo);
     }
 };
 
@@ -291,6 +360,60 @@ private:
     ResourceHandle<ProcessManager> proc_mgr_;
 };
 
+/**
+ * Endpoint of shared memory channel. Buffer maps ring header
+ * and data, scripts read and write data in place and publish
+ * progress with commit (producer) or consume (consumer).
+ * Transferring endpoint to another isolate detaches it here
+ */
+class ChannelObject : public JsObjectWrapper<ChannelObject,
+    NativeTypeId::TYPEID_CHANNEL> {
+public:
+    ChannelObject(TemplateCache* tpl_cache, Channel* channel, Channel::Side side)
+        :	JsObjectWrapper(tpl_cache),
+            channel_(channel),
+            side_(side),
+            detached_(false) {
+        RT_ASSERT(channel_);
+        channel_->AddRef();
+    }
+
+    ~ChannelObject() {
+        channel_->Release();
+    }
+
+    DECLARE_NATIVE(Buffer);
+    DECLARE_NATIVE(Size);
+    DECLARE_NATIVE(IsProducer);
+    DECLARE_NATIVE(Commit);
+    DECLARE_NATIVE(Consume);
+    DECLARE_NATIVE(Wait);
+
+    void ObjectInit(ExportBuilder obj) {
+        obj.SetCallback("buffer", Buffer);
+        obj.SetCallback("size", Size);
+        obj.SetCallback("isProducer", IsProducer);
+        obj.SetCallback("commit", Commit);
+        obj.SetCallback("consume", Consume);
+        obj.SetCallback("wait", Wait);
+    }
+
+    Channel* channel() const { return channel_; }
+    Channel::Side side() const { return side_; }
+    bool detached() const { return detached_; }
+
+    /**
+     * Endpoint moved to another isolate
+     */
+    void Detach() {
+        detached_ = true;
+    }
+private:
+    Channel* channel_;
+    Channel::Side side_;
+    bool detached_;
+};
+
 class AllocatorObject : public JsObjectWrapper<AllocatorObject,
     NativeTypeId::TYPEID_ALLOCATOR> {
 public:
@@ -0,0 +1,100 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <kernel/kernel.h>
+#include <kernel/atomic.h>
+
+namespace rt {
+
+class NativeThread;
+
+/**
+ * Non-recursive (unless configured) mutex owned by native
+ * thread. Contended lock yields current CPU
+ */
+class NativeMutex {
+public:
+    NativeMutex()
+        :	owner_(nullptr),
+            flag_(0),
+            level_(0),
+            recursive_(false) {}
+
+    void SetRecursive() { recursive_ = true; }
+
+    void Lock();
+    void Unlock();
+    bool TryLock();
+    DELETE_COPY_AND_ASSIGN(NativeMutex);
+private:
+    NativeThread* volatile owner_;
+    volatile uint32_t flag_;
+    uint32_t level_;
+    bool recursive_;
+};
+
+/**
+ * Counting semaphore. Waiters yield until count is positive
+ * or deadline passes
+ */
+class NativeSemaphore {
+public:
+    explicit NativeSemaphore(int32_t count) {
+        count_.Set(count);
+    }
+
+    void Signal() {
+        count_.AddFetch(1);
+    }
+
+    void Wait() {
+        WaitUntil(0);
+    }
+
+    /**
+     * Wait until count is positive, deadline is monotonic clock
+     * value in nanoseconds (0 means no deadline). Returns false
+     * on timeout
+     */
+    bool WaitUntil(uint64_t deadline_ns);
+    DELETE_COPY_AND_ASSIGN(NativeSemaphore);
+private:
+    bool TryDecrement();
+    Atomic<int32_t> count_;
+};
+
+/**
+ * Condition variable based on notification generation counter.
+ * NotifyOne wakes all waiters, spurious wakeups are allowed
+ */
+class NativeConditionVariable {
+public:
+    NativeConditionVariable() {}
+
+    void NotifyOne() { generation_.AddFetch(1); }
+    void NotifyAll() { generation_.AddFetch(1); }
+
+    /**
+     * Release mutex and wait for notification or deadline
+     * (0 means no deadline), returns false on timeout
+     */
+    bool WaitUntil(NativeMutex* mutex, uint64_t deadline_ns);
+    DELETE_COPY_AND_ASSIGN(NativeConditionVariable);
+private:
+    Atomic<uint64_t> generation_;
+};
+
+} // namespace rt
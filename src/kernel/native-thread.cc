@@ -13,28 +13,332 @@
 // limitations under the License.
 
 #include "native-thread.h"
+#include <kernel/clock.h>
+#include <kernel/trace.h>
+#include <kernel/fpu.h>
 
 namespace rt {
 
+extern "C" void preemptStart(void* current_state, void* new_state);
+extern "C" void threadStructInit(void* thread_state,
+    void (*entry_point)(NativeThread* t), uintptr_t sp, NativeThread* t);
+
+// CPU boot stacks grow down from here, one per CPU id
+// (see startup_init.inc)
+const uintptr_t kBootStackTop = 0x1600000;
+const uintptr_t kBootStackSize = 64 * 1024;
+
+static void NativeThreadEntryPoint(NativeThread* t) {
+    RT_ASSERT(t);
+    GLOBAL_native_threads()->FinishSwitch();
+    Cpu::EnableInterrupts();
+    t->entry()(t->arg());
+    GLOBAL_native_threads()->Exit();
+}
+
 NativeThread::NativeThread(uint32_t id, String name, uint32_t stacksize,
-                           void* entry, void* arg)
+                           NativeThreadEntry entry, void* arg)
     :	id_(id),
+        cpu_(0),
         name_(name),
         status_(NativeThreadStatus::IDLE),
-        state_(malloc(1024)),
+        state_(Fpu::AllocState()),
         vstack_(GLOBAL_mem_manager()->virtual_allocator().AllocStack()),
+        stack_low_(reinterpret_cast<uintptr_t>(vstack_.top())),
+        stack_high_(stack_low_ + vstack_.len()),
         entry_(entry),
         arg_(arg) {
 
     RT_ASSERT(entry);
     RT_ASSERT(vstack_.top());
     RT_ASSERT(state_);
+    RT_ASSERT(stacksize <= vstack_.len());
+    threadStructInit(state_, NativeThreadEntryPoint, GetStackBottom(), this);
+}
+
+NativeThread::NativeThread(uint32_t id, String name)
+    :	id_(id),
+        cpu_(Cpu::id()),
+        name_(name),
+        status_(NativeThreadStatus::RUNNING),
+        state_(Fpu::AllocState()),
+        vstack_(nullptr, 0),
+        stack_low_(kBootStackTop - (cpu_ + 1) * kBootStackSize),
+        stack_high_(kBootStackTop - cpu_ * kBootStackSize),
+        entry_(nullptr),
+        arg_(nullptr) {
+    RT_ASSERT(state_);
 }
 
 NativeThread::~NativeThread() {
-    free(state_);
+    RT_ASSERT(NativeThreadStatus::RUNNING != status_ || is_adopted());
+    Fpu::FreeState(state_);
     state_ = nullptr;
     //TODO: free vstack
 }
 
+NativeThreads::NativeThreads() {
+    next_thread_id_.Set(1);
+}
+
+void NativeThreads::CpuEnter(bool background) {
+    uint32_t cpuid = Cpu::id();
+    RT_ASSERT(cpuid < kMaxCpus);
+    CpuData& data = cpus_[cpuid];
+    RT_ASSERT(nullptr == data.current);
+
+    data.current = new NativeThread(next_thread_id_.AddFetch(1) - 1,
+        background ? "background" : "main");
+    Fpu::Adopt(data.current->state());
+    data.background = background;
+    cpus_online_.AddFetch(1);
+
+    if (background) {
+        background_cpus_.AddFetch(1);
+    }
+}
+
+uint32_t NativeThreads::PickCpu() {
+    uint32_t background = background_cpus_.Get();
+    if (0 == background) {
+        return Cpu::id();
+    }
+
+    // Round robin over background CPUs
+    uint32_t n = next_cpu_.AddFetch(1) % background;
+    for (uint32_t i = 0; i < kMaxCpus; ++i) {
+        if (!cpus_[i].background) {
+            continue;
+        }
+
+        if (0 == n) {
+            return i;
+        }
+        --n;
+    }
+
+    return Cpu::id();
+}
+
+NativeThreadHandle NativeThreads::Create(String name, uint32_t stacksize,
+                                         NativeThreadEntry entry, void* arg) {
+    NativeThread* t = new NativeThread(next_thread_id_.AddFetch(1) - 1,
+        name, stacksize, entry, arg);
+    uint32_t cpuid = PickCpu();
+    t->cpu_ = cpuid;
+
+    CpuData& data = cpus_[cpuid];
+    bool irq = Cpu::InterruptsEnabled();
+    Cpu::DisableInterrupts();
+    {   ScopedLock lock(data.ready_locker);
+        data.ready.push_back(t);
+    }
+    if (irq) {
+        Cpu::EnableInterrupts();
+    }
+
+    return NativeThreadHandle(t);
+}
+
+void NativeThreads::Join(NativeThreadHandle handle) {
+    NativeThread* t = handle.get();
+    RT_ASSERT(t);
+    RT_ASSERT(t != current());
+
+    while (NativeThreadStatus::FINISHED != t->status()) {
+        Yield();
+        Cpu::WaitPause();
+    }
+
+    delete t;
+}
+
+void NativeThreads::Yield() {
+    uint32_t cpuid = Cpu::id();
+    CpuData& data = cpus_[cpuid];
+    NativeThread* prev = data.current;
+    if (nullptr == prev) {
+        return;
+    }
+
+    bool irq = Cpu::InterruptsEnabled();
+    Cpu::DisableInterrupts();
+
+    NativeThread* next = nullptr;
+    {   ScopedLock lock(data.ready_locker);
+        if (!data.ready.empty()) {
+            next = data.ready.front();
+            data.ready.pop_front();
+
+            // Thread stays in the queue while it waits, blocking
+            // primitives poll their condition after each switch.
+            // Only this CPU takes threads out of the queue, so prev
+            // can't be resumed before its state is saved
+            if (prev != data.exiting) {
+                data.ready.push_back(prev);
+            }
+        }
+    }
+
+    if (nullptr == next) {
+        if (irq) {
+            Cpu::EnableInterrupts();
+        }
+        return;
+    }
+
+    data.current = next;
+    if (NativeThreadStatus::IDLE == next->status()) {
+        next->SetStatus(NativeThreadStatus::RUNNING);
+    }
+
+    RT_TRACE_INSTANT(Trace::kCategorySched, "switch", next->id());
+    preemptStart(prev->state(), next->state());
+    FinishSwitch();
+
+    // Resumed, interrupts were enabled by context switch
+    if (!irq) {
+        Cpu::DisableInterrupts();
+    }
+}
+
+void NativeThreads::Exit() {
+    NativeThread* t = current();
+    RT_ASSERT(t);
+    RT_ASSERT(!t->is_adopted());
+
+    // CPU main thread always stays in the ready queue,
+    // so there is someone to switch to. Thread is marked as
+    // finished by the next one, after its state is saved
+    cpus_[Cpu::id()].exiting = t;
+    Yield();
+    RT_ASSERT(!"Finished thread resumed");
+}
+
+void NativeThreads::FinishSwitch() {
+    CpuData& data = cpus_[Cpu::id()];
+    if (nullptr != data.exiting) {
+        data.exiting->SetStatus(NativeThreadStatus::FINISHED);
+        data.exiting = nullptr;
+    }
+}
+
+void NativeThreads::RunBackground() {
+    RT_ASSERT(cpus_[Cpu::id()].background);
+    for (;;) {
+        Yield();
+        Cpu::WaitPause();
+    }
+}
+
+void NativeMutex::Lock() {
+    NativeThread* self = nullptr;
+    if (nullptr != GLOBAL_native_threads()) {
+        self = GLOBAL_native_threads()->current();
+    }
+
+    if (recursive_ && nullptr != self && self == owner_) {
+        ++level_;
+        return;
+    }
+
+    while (__sync_lock_test_and_set(&flag_, 1)) {
+        if (nullptr != self) {
+            GLOBAL_native_threads()->Yield();
+        }
+        Cpu::WaitPause();
+    }
+
+    owner_ = self;
+    level_ = 1;
+}
+
+void NativeMutex::Unlock() {
+    RT_ASSERT(level_ > 0);
+    if (--level_ > 0) {
+        return;
+    }
+
+    owner_ = nullptr;
+    __sync_lock_release(&flag_);
+}
+
+bool NativeMutex::TryLock() {
+    NativeThread* self = nullptr;
+    if (nullptr != GLOBAL_native_threads()) {
+        self = GLOBAL_native_threads()->current();
+    }
+
+    if (recursive_ && nullptr != self && self == owner_) {
+        ++level_;
+        return true;
+    }
+
+    if (__sync_lock_test_and_set(&flag_, 1)) {
+        return false;
+    }
+
+    owner_ = self;
+    level_ = 1;
+    return true;
+}
+
+bool NativeSemaphore::TryDecrement() {
+    int32_t count = count_.Get();
+    while (count > 0) {
+        if (count_.CompareExchange(count, count - 1)) {
+            return true;
+        }
+        count = count_.Get();
+    }
+    return false;
+}
+
+static bool DeadlinePassed(uint64_t deadline_ns) {
+    return 0 != deadline_ns && GLOBAL_clock()->MonotonicNanos() >= deadline_ns;
+}
+
+bool NativeSemaphore::WaitUntil(uint64_t deadline_ns) {
+    NativeThread* self = GLOBAL_native_threads()->current();
+    while (!TryDecrement()) {
+        if (DeadlinePassed(deadline_ns)) {
+            return false;
+        }
+
+        if (nullptr != self) {
+            self->SetStatus(NativeThreadStatus::WAITING);
+            GLOBAL_native_threads()->Yield();
+            self->SetStatus(NativeThreadStatus::RUNNING);
+        }
+        Cpu::WaitPause();
+    }
+
+    return true;
+}
+
+bool NativeConditionVariable::WaitUntil(NativeMutex* mutex, uint64_t deadline_ns) {
+    RT_ASSERT(mutex);
+    uint64_t generation = generation_.Get();
+    NativeThread* self = GLOBAL_native_threads()->current();
+    bool notified = true;
+
+    mutex->Unlock();
+    while (generation == generation_.Get()) {
+        if (DeadlinePassed(deadline_ns)) {
+            notified = false;
+            break;
+        }
+
+        if (nullptr != self) {
+            self->SetStatus(NativeThreadStatus::WAITING);
+            GLOBAL_native_threads()->Yield();
+            self->SetStatus(NativeThreadStatus::RUNNING);
+        }
+        Cpu::WaitPause();
+    }
+    mutex->Lock();
+
+    return notified;
+}
+
 } // namespace rt
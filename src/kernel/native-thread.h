@@ -15,52 +15,202 @@
 #pragma once
 
 #include <string>
+#include <deque>
 #include <kernel/kernel.h>
+#include <kernel/atomic.h>
+#include <kernel/spinlock.h>
 #include <kernel/mem-manager.h>
+#include <kernel/local-storage.h>
 #include <kernel/string.h>
+#include <kernel/native-sync.h>
 
 namespace rt {
 
 enum class NativeThreadStatus {
     IDLE,
     RUNNING,
-    WAITING
+    WAITING,
+    FINISHED
 };
 
+typedef void (*NativeThreadEntry)(void* arg);
+
+/**
+ * Kernel thread without isolate. Native threads are scheduled
+ * cooperatively on the CPU they were created for, blocking
+ * primitives yield to other threads of the same CPU
+ */
 class NativeThread {
 public:
-    NativeThread(uint32_t id, String name, uint32_t stacksize, void* entry, void* arg);
+    NativeThread(uint32_t id, String name, uint32_t stacksize,
+                 NativeThreadEntry entry, void* arg);
+
+    /**
+     * Adopt currently executing context (CPU boot or idle loop)
+     */
+    NativeThread(uint32_t id, String name);
     ~NativeThread();
 
     String name() const { return name_; }
     uint32_t id() const { return id_; }
+    uint32_t cpu() const { return cpu_; }
     NativeThreadStatus status() const { return status_; }
-    void* entry() const { return entry_; }
+    NativeThreadEntry entry() const { return entry_; }
     void* arg() const { return arg_; }
 
+    /**
+     * Adopted contexts don't own the stack they run on
+     */
+    bool is_adopted() const { return nullptr == entry_; }
+
     void SetStatus(NativeThreadStatus status) {
         status_ = status;
     }
 
+    LocalStorage& GetLocalStorage() {
+        return local_storage_;
+    }
+
+    void* state() const { return state_; }
+
+    /**
+     * Addresses [stack_low, stack_high) of the stack thread runs
+     * on. Adopted contexts run on boot stack of their CPU
+     */
+    uintptr_t stack_low() const { return stack_low_; }
+    uintptr_t stack_high() const { return stack_high_; }
+
+    uintptr_t GetStackBottom() const {
+        RT_ASSERT(vstack_.top());
+        return reinterpret_cast<uintptr_t>(vstack_.top()) + vstack_.len() - 256;
+    }
+
     DELETE_COPY_AND_ASSIGN(NativeThread);
 private:
+    friend class NativeThreads;
     uint32_t id_;
+    uint32_t cpu_;
     String name_;
-    NativeThreadStatus status_;
+    volatile NativeThreadStatus status_;
     void* state_;
     VirtualStack vstack_;
-    void* entry_;
+    uintptr_t stack_low_;
+    uintptr_t stack_high_;
+    NativeThreadEntry entry_;
     void* arg_;
+    LocalStorage local_storage_;
 };
 
 class NativeThreadHandle {
 public:
     NativeThreadHandle()
-        :	index_(0) { }
-    NativeThreadHandle(size_t index)
-        :	index_(index) { }
+        :	thread_(nullptr) { }
+    NativeThreadHandle(NativeThread* thread)
+        :	thread_(thread) { }
+
+    NativeThread* get() const { return thread_; }
+    bool empty() const { return nullptr == thread_; }
+private:
+    NativeThread* thread_;
+};
+
+/**
+ * Per-CPU native thread schedulers. CPU 0 runs isolates, other
+ * CPUs entered as background CPUs only run native threads
+ */
+class NativeThreads {
+public:
+    NativeThreads();
+
+    /**
+     * Adopt current execution context as CPU main thread
+     */
+    void CpuEnter(bool background);
+
+    /**
+     * Create and start thread. Threads are placed on background
+     * CPUs if there are any, or on current CPU otherwise
+     */
+    NativeThreadHandle Create(String name, uint32_t stacksize,
+                              NativeThreadEntry entry, void* arg);
+
+    /**
+     * Wait for thread to finish and delete it
+     */
+    void Join(NativeThreadHandle handle);
+
+    /**
+     * Switch to the next ready thread of current CPU, returns
+     * immediately if there is none
+     */
+    void Yield();
+
+    /**
+     * Terminate current thread, never returns
+     */
+    void Exit();
+
+    /**
+     * Background CPU loop, never returns
+     */
+    void RunBackground();
+
+    /**
+     * Complete context switch on the resumed side
+     */
+    void FinishSwitch();
+
+    /**
+     * Thread running on current CPU
+     */
+    NativeThread* current() const {
+        const CpuData& data = cpus_[Cpu::id()];
+        return data.current;
+    }
+
+    /**
+     * Current thread if it's not a CPU main thread
+     */
+    NativeThread* current_worker() const {
+        NativeThread* t = current();
+        if (nullptr == t || t->is_adopted()) {
+            return nullptr;
+        }
+        return t;
+    }
+
+    /**
+     * Number of CPUs running native threads
+     */
+    uint32_t cpus_online() const { return cpus_online_.Get(); }
+
+    /**
+     * Number of CPUs reserved for native threads
+     */
+    uint32_t background_cpus() const { return background_cpus_.Get(); }
+
+    static const uint32_t kMaxCpus = 32;
 private:
-    size_t index_;
+    struct CpuData {
+        CpuData()
+            :	current(nullptr),
+                exiting(nullptr),
+                background(false) {}
+        NativeThread* current;
+        NativeThread* exiting;
+        bool background;
+        Locker ready_locker;
+        std::deque<NativeThread*> ready;
+    };
+
+    uint32_t PickCpu();
+
+    CpuData cpus_[kMaxCpus];
+    Atomic<uint32_t> next_thread_id_;
+    Atomic<uint32_t> next_cpu_;
+    Atomic<uint32_t> cpus_online_;
+    Atomic<uint32_t> background_cpus_;
+    DELETE_COPY_AND_ASSIGN(NativeThreads);
 };
 
 } // namespace rt
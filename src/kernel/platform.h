@@ -59,6 +59,20 @@ public:
         return platform_arch_.bus_frequency();
     }
 
+    /**
+     * Returns default timer interrupt rate in Hz
+     */
+    uint32_t timer_frequency() const {
+        return platform_arch_.timer_frequency();
+    }
+
+    /**
+     * Change timer interrupt rate on current CPU
+     */
+    void SetTimerFrequency(uint32_t hz) {
+        platform_arch_.SetTimerFrequency(hz);
+    }
+
     /**
      * Returns IRQ dispatcher for current platform
      */
@@ -0,0 +1,437 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "profiler.h"
+#include <kernel/platform.h>
+#include <kernel/initrd.h>
+#include <kernel/boot-services.h>
+#include <kernel/mem-manager.h>
+#include <kernel/spinlock.h>
+#include <kernel/native-thread.h>
+#include <printf.h>
+#include <algorithm>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+
+namespace rt {
+
+namespace {
+
+// Offsets of interrupted context registers in the state
+// saved by interrupt gate (see irq-vectors-x64.asm)
+const size_t kStateRbp = 14;
+const size_t kStateRip = 32;
+const size_t kStateRsp = 35;
+
+struct KernelSymbol {
+    uintptr_t addr;
+    const char* name;
+    size_t len;
+};
+
+bool operator<(const KernelSymbol& a, const KernelSymbol& b) {
+    return a.addr < b.addr;
+}
+
+/**
+ * Kernel symbol table, parsed from "nm -n -C" output packed
+ * into initrd as /kernel.sym. Names point into initrd data
+ */
+class KernelSymbols {
+public:
+    KernelSymbols() {
+        InitrdFile file = GLOBAL_initrd()->Get("/kernel.sym");
+        if (file.IsEmpty()) {
+            return;
+        }
+
+        const char* p = reinterpret_cast<const char*>(file.Data());
+        const char* end = p + file.Size();
+        while (p < end) {
+            const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+            if (nullptr == eol) {
+                eol = end;
+            }
+            ParseLine(p, eol);
+            p = eol + 1;
+        }
+
+        std::sort(symbols_.begin(), symbols_.end());
+    }
+
+    const KernelSymbol* Find(uintptr_t addr) const {
+        if (symbols_.empty() || addr < symbols_.front().addr) {
+            return nullptr;
+        }
+
+        KernelSymbol key { addr + 1, nullptr, 0 };
+        auto it = std::lower_bound(symbols_.begin(), symbols_.end(), key);
+        return &*(it - 1);
+    }
+
+    bool empty() const { return symbols_.empty(); }
+private:
+    void ParseLine(const char* p, const char* eol) {
+        uintptr_t addr = 0;
+        const char* s = p;
+        for (; s < eol && ' ' != *s; ++s) {
+            char c = *s;
+            uint32_t digit;
+            if (c >= '0' && c <= '9') digit = c - '0';
+            else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+            else return;
+            addr = (addr << 4) | digit;
+        }
+
+        // "<addr> <type> <name>", code symbols only
+        if (eol - s < 4 || ' ' != s[2]) {
+            return;
+        }
+
+        char type = s[1];
+        if ('t' != type && 'T' != type && 'w' != type && 'W' != type) {
+            return;
+        }
+
+        const char* name = s + 3;
+        symbols_.push_back(KernelSymbol { addr, name, static_cast<size_t>(eol - name) });
+    }
+
+    std::vector<KernelSymbol> symbols_;
+};
+
+/**
+ * Line buffer flushed to serial port
+ */
+class CollapsedWriter {
+public:
+    CollapsedWriter()
+        :	len_(0) { }
+
+    ~CollapsedWriter() {
+        Flush();
+    }
+
+    void Append(const char* data, size_t len) {
+        if (len_ + len > sizeof(buf_)) {
+            Flush();
+        }
+        if (len > sizeof(buf_)) {
+            len = sizeof(buf_);
+        }
+        memcpy(buf_ + len_, data, len);
+        len_ += len;
+    }
+
+    void AppendFrame(const KernelSymbols& symbols, uintptr_t addr,
+                     bool return_address) {
+        // Return address might be the first byte of the next function
+        // if call was the last instruction
+        const KernelSymbol* sym = symbols.Find(return_address ? addr - 1 : addr);
+        if (nullptr != sym) {
+            Append(sym->name, sym->len);
+            return;
+        }
+
+        // Code generated by V8 lives in isolate heaps, JS stacks
+        // are resolved by V8 CPU profiler instead
+        if (VirtualAllocator::IsHeapAddress(addr)) {
+            Append("[jit]", 5);
+            return;
+        }
+
+        char hex[24];
+        int len = tfp_snprintf(hex, sizeof(hex), "0x%lx", addr);
+        Append(hex, len);
+    }
+
+    void Flush() {
+        if (0 == len_) {
+            return;
+        }
+        GLOBAL_boot_services()->logger()->WriteSerial(buf_, len_);
+        len_ = 0;
+    }
+private:
+    char buf_[4096];
+    size_t len_;
+};
+
+} // namespace
+
+Profiler::Profiler()
+    :	samples_(nullptr),
+        sampling_hz_(0),
+        hz_(0),
+        cpu_(0),
+        ticks_per_tick_(1),
+        tick_counter_(0) {
+    memset(hooks_, 0, sizeof(hooks_));
+}
+
+Profiler::~Profiler() {
+    RT_ASSERT(!running());
+    free(samples_);
+}
+
+bool Profiler::Start(uint32_t hz) {
+    if (0 == hz) {
+        return false;
+    }
+
+    if (nullptr == samples_) {
+        samples_ = static_cast<Sample*>(malloc(sizeof(Sample) * kMaxSamples));
+        if (nullptr == samples_) {
+            return false;
+        }
+    }
+
+    NoInterrupsScope no_interrupts;
+    sampling_hz_ = hz;
+    SetRate(std::max(hz, HookFrequency()));
+    return true;
+}
+
+void Profiler::Stop() {
+    NoInterrupsScope no_interrupts;
+    sampling_hz_ = 0;
+    SetRate(HookFrequency());
+}
+
+void Profiler::Reset() {
+    NoInterrupsScope no_interrupts;
+    count_.Set(0);
+    dropped_.Set(0);
+}
+
+bool Profiler::AddHook(ProfilerSampleHook hook, void* data, uint32_t hz) {
+    RT_ASSERT(hook);
+    NoInterrupsScope no_interrupts;
+    for (uint32_t i = 0; i < kMaxHooks; ++i) {
+        if (nullptr != hooks_[i].fn) {
+            continue;
+        }
+
+        hooks_[i].data = data;
+        hooks_[i].hz = hz;
+        __atomic_store_n(&hooks_[i].fn, hook, __ATOMIC_RELEASE);
+        SetRate(std::max(sampling_hz_, HookFrequency()));
+        return true;
+    }
+    return false;
+}
+
+void Profiler::RemoveHook(ProfilerSampleHook hook, void* data) {
+    {   NoInterrupsScope no_interrupts;
+        for (uint32_t i = 0; i < kMaxHooks; ++i) {
+            if (hook == hooks_[i].fn && data == hooks_[i].data) {
+                __atomic_store_n(&hooks_[i].fn, nullptr, __ATOMIC_RELEASE);
+                hooks_[i].data = nullptr;
+                hooks_[i].hz = 0;
+            }
+        }
+        SetRate(std::max(sampling_hz_, HookFrequency()));
+    }
+
+    // Sampled CPU could be in the middle of the hook call
+    while (0 != hooks_busy_.Get()) {
+        Cpu::WaitPause();
+    }
+}
+
+uint32_t Profiler::HookFrequency() const {
+    uint32_t hz = 0;
+    for (uint32_t i = 0; i < kMaxHooks; ++i) {
+        if (nullptr != hooks_[i].fn) {
+            hz = std::max(hz, hooks_[i].hz);
+        }
+    }
+    return hz;
+}
+
+void Profiler::SetRate(uint32_t hz) {
+    RT_ASSERT(GLOBAL_platform());
+    uint32_t base = GLOBAL_platform()->timer_frequency();
+
+    if (0 == hz || hz <= base) {
+        // Profiling at or below scheduler rate does not need
+        // timer to be reprogrammed
+        if (0 != hz_ && hz_ > base) {
+            GLOBAL_platform()->SetTimerFrequency(base);
+        }
+        hz_ = hz;
+        cpu_ = Cpu::id();
+        ticks_per_tick_ = 1;
+        tick_counter_ = 0;
+        return;
+    }
+
+    if (hz == hz_ && cpu_ == Cpu::id()) {
+        return;
+    }
+
+    cpu_ = Cpu::id();
+    ticks_per_tick_ = hz / base;
+    tick_counter_ = 0;
+    hz_ = hz;
+    GLOBAL_platform()->SetTimerFrequency(hz);
+}
+
+bool Profiler::Tick(const uint64_t* state) {
+    if (0 == hz_ || Cpu::id() != cpu_) {
+        return true;
+    }
+
+    RT_ASSERT(state);
+    ProfilerRegisters regs;
+    regs.rip = state[kStateRip];
+    regs.rsp = state[kStateRsp];
+    regs.rbp = state[kStateRbp];
+    regs.stack_low = 0;
+    regs.stack_high = 0;
+
+    // Engine threads run on their own stacks, those samples
+    // fall outside of CPU thread stack and are not walked
+    NativeThread* thread = nullptr == GLOBAL_native_threads() ? nullptr :
+                           GLOBAL_native_threads()->current();
+    if (nullptr != thread) {
+        regs.stack_low = thread->stack_low();
+        regs.stack_high = thread->stack_high();
+    }
+
+    if (0 != sampling_hz_) {
+        Record(regs);
+    }
+
+    hooks_busy_.AddFetch(1);
+    for (uint32_t i = 0; i < kMaxHooks; ++i) {
+        ProfilerSampleHook fn = __atomic_load_n(&hooks_[i].fn, __ATOMIC_ACQUIRE);
+        if (nullptr != fn) {
+            fn(hooks_[i].data, regs);
+        }
+    }
+    hooks_busy_.SubFetch(1);
+
+    if (++tick_counter_ < ticks_per_tick_) {
+        return false;
+    }
+
+    tick_counter_ = 0;
+    return true;
+}
+
+void Profiler::Record(const ProfilerRegisters& regs) {
+    uint64_t index = count_.Get();
+    if (index >= kMaxSamples) {
+        dropped_.AddFetch(1);
+        return;
+    }
+
+    Sample& sample = samples_[index];
+    uint32_t depth = 0;
+    sample.frames[depth++] = regs.rip;
+
+    // Follow saved frame pointers within interrupted thread stack
+    // only, anything else may be unmapped. Each frame must be
+    // aligned and above the previous one
+    uintptr_t low = regs.rsp;
+    uintptr_t high = regs.stack_high;
+    uintptr_t fp = regs.rbp;
+    if (regs.rsp < regs.stack_low || regs.rsp >= high) {
+        fp = 0;
+    }
+
+    while (depth < kMaxDepth) {
+        if (0 == fp || fp < low || 0 != (fp & 7) ||
+            fp > high - 2 * sizeof(uintptr_t)) {
+            break;
+        }
+
+        const uintptr_t* frame = reinterpret_cast<const uintptr_t*>(fp);
+        uintptr_t next = frame[0];
+        uintptr_t ret = frame[1];
+        if (0 == ret) {
+            break;
+        }
+
+        sample.frames[depth++] = ret;
+        low = fp + 2 * sizeof(uintptr_t);
+        fp = next;
+    }
+
+    sample.depth = depth;
+    count_.Set(index + 1);
+}
+
+size_t Profiler::DumpCollapsed() {
+    size_t count = std::min<uint64_t>(count_.Get(), kMaxSamples);
+    if (0 == count) {
+        return 0;
+    }
+
+    // Group identical stacks
+    std::vector<uint32_t> order(count);
+    for (size_t i = 0; i < count; ++i) {
+        order[i] = i;
+    }
+
+    const Sample* samples = samples_;
+    std::sort(order.begin(), order.end(), [samples](uint32_t a, uint32_t b) {
+        const Sample& x = samples[a];
+        const Sample& y = samples[b];
+        if (x.depth != y.depth) {
+            return x.depth < y.depth;
+        }
+        return memcmp(x.frames, y.frames, x.depth * sizeof(uintptr_t)) < 0;
+    });
+
+    KernelSymbols symbols;
+    CollapsedWriter writer;
+    size_t unique = 0;
+
+    size_t i = 0;
+    while (i < count) {
+        const Sample& sample = samples[order[i]];
+        size_t j = i + 1;
+        while (j < count) {
+            const Sample& other = samples[order[j]];
+            if (other.depth != sample.depth || 0 != memcmp(other.frames,
+                sample.frames, sample.depth * sizeof(uintptr_t))) {
+                break;
+            }
+            ++j;
+        }
+
+        // Root frame goes first
+        for (uint32_t d = sample.depth; d > 0; --d) {
+            writer.AppendFrame(symbols, sample.frames[d - 1], d > 1);
+            if (d > 1) {
+                writer.Append(";", 1);
+            }
+        }
+
+        char tail[24];
+        int len = tfp_snprintf(tail, sizeof(tail), " %lu\n", j - i);
+        writer.Append(tail, len);
+
+        ++unique;
+        i = j;
+    }
+
+    return unique;
+}
+
+} // namespace rt
@@ -0,0 +1,141 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <kernel/kernel.h>
+#include <kernel/atomic.h>
+#include <stdint.h>
+#include <stddef.h>
+
+namespace rt {
+
+/**
+ * Registers of interrupted context
+ */
+struct ProfilerRegisters {
+    uintptr_t rip;
+    uintptr_t rsp;
+    uintptr_t rbp;
+
+    // Stack of interrupted thread, empty if unknown
+    uintptr_t stack_low;
+    uintptr_t stack_high;
+};
+
+/**
+ * Sample hook, called in IRQ context on the sampled CPU
+ */
+typedef void (*ProfilerSampleHook)(void* data, const ProfilerRegisters& regs);
+
+/**
+ * Sampling profiler driven by local APIC timer. While profiling
+ * timer runs at sampling rate on the CPU which started it, every
+ * interrupt records interrupted RIP and frame pointer chain into
+ * preallocated buffer and calls registered hooks (V8 sampler).
+ * Scheduler tick is still reported at base timer rate.
+ */
+class Profiler {
+public:
+    static const uint32_t kMaxDepth = 16;
+    static const size_t kMaxSamples = 8192;
+    static const uint32_t kMaxHooks = 4;
+    static const uint32_t kDefaultFrequency = 1000;
+
+    Profiler();
+    ~Profiler();
+
+    /**
+     * Start kernel sampling on current CPU, frequency in Hz
+     */
+    bool Start(uint32_t hz);
+
+    /**
+     * Stop kernel sampling, recorded samples are kept
+     */
+    void Stop();
+
+    /**
+     * Drop recorded samples
+     */
+    void Reset();
+
+    /**
+     * Register hook for every timer sample. Timer is switched
+     * to requested frequency if it's not running faster already
+     */
+    bool AddHook(ProfilerSampleHook hook, void* data, uint32_t hz);
+
+    /**
+     * Remove hook, returns after hook can no longer be running
+     */
+    void RemoveHook(ProfilerSampleHook hook, void* data);
+
+    /**
+     * Timer interrupt handler (requires IRQ context). State points
+     * to registers saved by interrupt gate. Returns true when
+     * scheduler tick is due
+     */
+    bool Tick(const uint64_t* state);
+
+    /**
+     * Write recorded samples in collapsed stack format (one
+     * "frame;frame;frame count" line per unique stack) to serial
+     * port. Addresses are resolved using /kernel.sym from initrd
+     * if present. Returns number of unique stacks
+     */
+    size_t DumpCollapsed();
+
+    bool running() const { return 0 != hz_; }
+    uint32_t frequency() const { return hz_; }
+    uint64_t samples() const { return count_.Get(); }
+    uint64_t dropped() const { return dropped_.Get(); }
+
+    /**
+     * Number of frames in recorded sample
+     */
+    uint32_t sample_depth(size_t index) const {
+        RT_ASSERT(index < samples());
+        return samples_[index].depth;
+    }
+private:
+    struct Sample {
+        uint32_t depth;
+        uintptr_t frames[kMaxDepth];
+    };
+
+    struct Hook {
+        ProfilerSampleHook fn;
+        void* data;
+        uint32_t hz;
+    };
+
+    void Record(const ProfilerRegisters& regs);
+    void SetRate(uint32_t hz);
+    uint32_t HookFrequency() const;
+
+    Sample* samples_;
+    Atomic<uint64_t> count_;
+    Atomic<uint64_t> dropped_;
+    Atomic<uint32_t> hooks_busy_;
+    Hook hooks_[kMaxHooks];
+    uint32_t sampling_hz_;
+    uint32_t hz_;
+    uint32_t cpu_;
+    uint32_t ticks_per_tick_;
+    uint32_t tick_counter_;
+    DELETE_COPY_AND_ASSIGN(Profiler);
+};
+
+} // namespace rt
@@ -52,7 +52,7 @@ public:
     }
 
     bool operator!=(const ResourceHandle<R>& that) const {
-        return !(this == that);
+        return !(*this == that);
     }
 
     LockingPtr<R> get() const {
@@ -1,4 +1,18 @@
 #include <v8.h>
+#include <kernel/v8utils.h>
+#include <kernel/clock.h>
+#include <kernel/profiler.h>
+#include <kernel/trace.h>
+#include <kernel/isolate-memory.h>
+#include <kernel/boot-services.h>
+#include <kernel/platform.h>
+#include <kernel/fpu.h>
+#include <kernel/native-thread.h>
+#include <kernel/engines.h>
+#include <kernel/system-context.h>
+#include <v8-profiler.h>
+#include <printf.h>
+#include <string>
 
 namespace RuntimeOS {
 
@@ -15,22 +29,46 @@ namespace RuntimeOS {
   // IRQ events
   vector<uint64_t> queue;
 
+  // memory budget of the boot isolate
+  rt::IsolateMemory memory;
+
+  // tick of the last idle notification
+  uint64_t idle_tick = 0;
+
   //--------------------//
   // INTERRUPT HANDLERS //
   //--------------------//
 
   extern "C" void irq_handler_any(uint64_t number) {
+      RT_TRACE_BEGIN(rt::Trace::kCategoryIrq, "irq", number);
       queue.push_back(number);
 
       // https://github.com/runtimejs/runtime/blob/master/initrd/system/driver/ps2kbd.js#L155
       *(volatile uint32_t*)(0xfee00000 + 0x00b0) = 0;
+      RT_TRACE_END(rt::Trace::kCategoryIrq, "irq", number);
   };
 
-  // run this interrupt every time a cpu tick occurs
-  extern "C" void irq_timer_event() {
-      ticks++;
+  // run this interrupt every time a cpu tick occurs, state
+  // points to registers of interrupted code
+  extern "C" void irq_timer_event(uint64_t* state) {
+      RT_TRACE_BEGIN(rt::Trace::kCategoryIrq, "timer", 32);
+
+      // timer runs faster while profiling, only some
+      // interrupts are scheduler ticks
+      if (GLOBAL_profiler()->Tick(state)) {
+        ticks++;
+
+        // lets engines preempt isolates which ran out of time slice,
+        // this boot isolate is not an engine thread and is never
+        // preempted, nothing else runs on this CPU until it returns
+        if (nullptr != GLOBAL_engines()) {
+          rt::SystemContextTimerIRQ irq_context {};
+          GLOBAL_engines()->TimerTick(irq_context);
+        }
+      }
 
       *(volatile uint32_t*)(0xfee00000 + 0x00b0) = 0;
+      RT_TRACE_END(rt::Trace::kCategoryIrq, "timer", 32);
   };
 
   Handle<ObjectTemplate> MakeGlobal(Isolate *isolate);
@@ -82,15 +120,26 @@ namespace RuntimeOS {
     args.GetReturnValue().Set(Number::New(args.GetIsolate(), 0));
   };
 
-  // poll for queued interrupts
+  // poll for queued interrupts, event loop calls this all
+  // the time so it's also where memory pressure is handled
   void Poll(const FunctionCallbackInfo<Value>& args) {
+    memory.HandlePressure();
+
     if (queue.size() > 0) {
       // there is an event in the queue
+      memory.RequestDone();
       uint64_t e = queue.back();
       args.GetReturnValue().Set(Number::New(args.GetIsolate(), e));
       queue.pop_back();
     } else {
-      // the event queue is empty
+      // the event queue is empty, nothing is going to happen
+      // until the next interrupt, give V8 one tick for GC
+      if (idle_tick != ticks) {
+        idle_tick = ticks;
+        // V8 takes whole milliseconds, ticks above 1 kHz are shorter
+        uint32_t tick_ms = 1000 / GLOBAL_platform()->timer_frequency();
+        memory.NotifyIdle(tick_ms > 0 ? tick_ms : 1);
+      }
       args.GetReturnValue().SetUndefined();
     }
   };
@@ -103,6 +152,277 @@ namespace RuntimeOS {
       .Set(Number::New(args.GetIsolate(), ticks));
   };
 
+  // high resolution time since boot in milliseconds,
+  // same as performance.now() in browsers
+  void PerformanceNow(const FunctionCallbackInfo<Value>& args) {
+    uint64_t ns = GLOBAL_clock()->MonotonicNanos();
+    args
+      .GetReturnValue()
+      .Set(Number::New(args.GetIsolate(), static_cast<double>(ns) / 1e6));
+  };
+
+  // nanoseconds since boot
+  void HrTime(const FunctionCallbackInfo<Value>& args) {
+    uint64_t ns = GLOBAL_clock()->MonotonicNanos();
+    args
+      .GetReturnValue()
+      .Set(Number::New(args.GetIsolate(), static_cast<double>(ns)));
+  };
+
+  // start sampling kernel stacks, optional rate in Hz
+  void ProfilerStart(const FunctionCallbackInfo<Value>& args) {
+    uint32_t hz = rt::Profiler::kDefaultFrequency;
+    if (args.Length() > 0 && args[0]->IsNumber()) {
+      hz = args[0]->Uint32Value();
+    }
+
+    bool ok = GLOBAL_profiler()->Start(hz);
+    args.GetReturnValue().Set(Boolean::New(args.GetIsolate(), ok));
+  };
+
+  void ProfilerStop(const FunctionCallbackInfo<Value>& args) {
+    GLOBAL_profiler()->Stop();
+  };
+
+  void ProfilerReset(const FunctionCallbackInfo<Value>& args) {
+    GLOBAL_profiler()->Reset();
+  };
+
+  // write kernel samples to serial port as collapsed stacks,
+  // returns number of unique stacks
+  void ProfilerDump(const FunctionCallbackInfo<Value>& args) {
+    size_t stacks = GLOBAL_profiler()->DumpCollapsed();
+    args
+      .GetReturnValue()
+      .Set(Number::New(args.GetIsolate(), stacks));
+  };
+
+  void ProfilerInfo(const FunctionCallbackInfo<Value>& args) {
+    Isolate* isolate = args.GetIsolate();
+    Handle<Object> info = Object::New(isolate);
+    info->Set(String::NewFromUtf8(isolate, "samples"),
+              Number::New(isolate, GLOBAL_profiler()->samples()));
+    info->Set(String::NewFromUtf8(isolate, "dropped"),
+              Number::New(isolate, GLOBAL_profiler()->dropped()));
+    info->Set(String::NewFromUtf8(isolate, "frequency"),
+              Number::New(isolate, GLOBAL_profiler()->frequency()));
+    args.GetReturnValue().Set(info);
+  };
+
+  // one collapsed stack line per V8 profile node with self samples
+  size_t WriteCollapsed(const CpuProfileNode* node, std::string& path) {
+    size_t mark = path.size();
+    String::Utf8Value name(node->GetFunctionName());
+    String::Utf8Value file(node->GetScriptResourceName());
+
+    if (!path.empty()) {
+      path += ';';
+    }
+    path += name.length() > 0 ? *name : "(anonymous)";
+    if (file.length() > 0) {
+      char line[16];
+      tfp_snprintf(line, sizeof(line), ":%d", node->GetLineNumber());
+      path += " (";
+      path += *file;
+      path += line;
+      path += ')';
+    }
+
+    size_t lines = 0;
+    if (node->GetHitCount() > 0) {
+      char count[24];
+      tfp_snprintf(count, sizeof(count), " %u\n", node->GetHitCount());
+      std::string out = path + count;
+      GLOBAL_boot_services()->logger()->WriteSerial(out.data(), out.size());
+      ++lines;
+    }
+
+    for (int i = 0; i < node->GetChildrenCount(); ++i) {
+      lines += WriteCollapsed(node->GetChild(i), path);
+    }
+
+    path.resize(mark);
+    return lines;
+  };
+
+  // start V8 CPU profiler, samples come from the timer interrupt
+  void ProfileStart(const FunctionCallbackInfo<Value>& args) {
+    Isolate* isolate = args.GetIsolate();
+    Handle<String> title = args.Length() > 0 ? args[0]->ToString()
+                                             : String::NewFromUtf8(isolate, "");
+    isolate->GetCpuProfiler()->StartProfiling(title, false);
+  };
+
+  // stop V8 CPU profiler and write JS stacks to serial port
+  // as collapsed stacks, returns number of lines written
+  void ProfileStop(const FunctionCallbackInfo<Value>& args) {
+    Isolate* isolate = args.GetIsolate();
+    Handle<String> title = args.Length() > 0 ? args[0]->ToString()
+                                             : String::NewFromUtf8(isolate, "");
+    CpuProfile* profile = isolate->GetCpuProfiler()->StopProfiling(title);
+    if (NULL == profile) {
+      args.GetReturnValue().SetUndefined();
+      return;
+    }
+
+    std::string path;
+    size_t lines = WriteCollapsed(profile->GetTopDownRoot(), path);
+    profile->Delete();
+
+    args
+      .GetReturnValue()
+      .Set(Number::New(isolate, lines));
+  };
+
+  // start kernel tracing, optional category mask (all by default)
+  void TraceStart(const FunctionCallbackInfo<Value>& args) {
+    uint32_t categories = rt::Trace::kCategoryAll;
+    if (args.Length() > 0 && args[0]->IsNumber()) {
+      categories = args[0]->Uint32Value();
+    }
+
+    bool ok = GLOBAL_trace()->Start(categories);
+    args.GetReturnValue().Set(Boolean::New(args.GetIsolate(), ok));
+  };
+
+  void TraceStop(const FunctionCallbackInfo<Value>& args) {
+    GLOBAL_trace()->Stop();
+  };
+
+  // write Chrome trace event JSON to serial port,
+  // returns number of events
+  void TraceDump(const FunctionCallbackInfo<Value>& args) {
+    size_t events = GLOBAL_trace()->DumpChromeJson();
+    args
+      .GetReturnValue()
+      .Set(Number::New(args.GetIsolate(), events));
+  };
+
+  void AppendTrace(void* data, const char* buf, size_t len) {
+    reinterpret_cast<std::string*>(data)->append(buf, len);
+  };
+
+  // get Chrome trace event JSON as a string
+  void TraceFetch(const FunctionCallbackInfo<Value>& args) {
+    std::string json;
+    GLOBAL_trace()->ExportChromeJson(AppendTrace, &json);
+    args
+      .GetReturnValue()
+      .Set(String::NewFromUtf8(args.GetIsolate(), json.data(),
+                               String::kNormalString, json.size()));
+  };
+
+  // memory usage and budget of this isolate in bytes,
+  // GC time in milliseconds
+  void MemoryStats(const FunctionCallbackInfo<Value>& args) {
+    Isolate* isolate = args.GetIsolate();
+    Handle<Object> stats = Object::New(isolate);
+    stats->Set(String::NewFromUtf8(isolate, "heapUsed"),
+               Number::New(isolate, memory.heap_used()));
+    stats->Set(String::NewFromUtf8(isolate, "heapLimit"),
+               Number::New(isolate, memory.heap_limit()));
+    stats->Set(String::NewFromUtf8(isolate, "arrayBuffers"),
+               Number::New(isolate, memory.array_buffer_bytes()));
+    stats->Set(String::NewFromUtf8(isolate, "arrayBuffersPeak"),
+               Number::New(isolate, memory.array_buffer_peak()));
+    stats->Set(String::NewFromUtf8(isolate, "arrayBuffersLimit"),
+               Number::New(isolate, memory.limits().max_array_buffer_bytes));
+    stats->Set(String::NewFromUtf8(isolate, "arrayBuffersFailed"),
+               Number::New(isolate, memory.array_buffer_failures()));
+    stats->Set(String::NewFromUtf8(isolate, "pressure"),
+               Number::New(isolate, static_cast<uint32_t>(memory.pressure())));
+    stats->Set(String::NewFromUtf8(isolate, "lowMemoryNotifications"),
+               Number::New(isolate, memory.pressure_notifications()));
+    stats->Set(String::NewFromUtf8(isolate, "gcCount"),
+               Number::New(isolate, memory.gc_count()));
+    stats->Set(String::NewFromUtf8(isolate, "gcTime"),
+               Number::New(isolate, memory.gc_nanos() / 1e6));
+    stats->Set(String::NewFromUtf8(isolate, "idleGcCount"),
+               Number::New(isolate, memory.idle_gc_count()));
+    stats->Set(String::NewFromUtf8(isolate, "idleGcTime"),
+               Number::New(isolate, memory.idle_gc_nanos() / 1e6));
+    args.GetReturnValue().Set(stats);
+  };
+
+  // FPU context switching mode and counters
+  void FpuInfo(const FunctionCallbackInfo<Value>& args) {
+    Isolate* isolate = args.GetIsolate();
+    Handle<Object> info = Object::New(isolate);
+    info->Set(String::NewFromUtf8(isolate, "xsave"),
+              Boolean::New(isolate, rt::Fpu::uses_xsave()));
+    info->Set(String::NewFromUtf8(isolate, "avx"),
+              Boolean::New(isolate, 0 != (rt::Fpu::features() & rt::Fpu::kFeatureAVX)));
+    info->Set(String::NewFromUtf8(isolate, "stateSize"),
+              Number::New(isolate, rt::Fpu::area_size()));
+    info->Set(String::NewFromUtf8(isolate, "switches"),
+              Number::New(isolate, rt::Fpu::switches()));
+    info->Set(String::NewFromUtf8(isolate, "restores"),
+              Number::New(isolate, rt::Fpu::restores()));
+    args.GetReturnValue().Set(info);
+  };
+
+  struct SwitchBench {
+    volatile uint64_t remaining;
+    bool simd;
+  };
+
+  // xmm15 is not used by generated kernel code in practice
+  inline void SwitchBenchTouch(bool simd) {
+    if (simd) {
+      asm volatile("pxor %%xmm15, %%xmm15" : : : "xmm15");
+    }
+  };
+
+  void SwitchBenchWorker(void* arg) {
+    SwitchBench* bench = reinterpret_cast<SwitchBench*>(arg);
+    while (bench->remaining > 0) {
+      SwitchBenchTouch(bench->simd);
+      GLOBAL_native_threads()->Yield();
+    }
+  };
+
+  // context switch cost in TSC cycles, this thread and a native
+  // thread yield to each other. When simd is true both threads
+  // touch SIMD registers and every switch swaps FPU state
+  void FpuBenchSwitch(const FunctionCallbackInfo<Value>& args) {
+    Isolate* isolate = args.GetIsolate();
+    uint64_t iterations = 100000;
+    if (args.Length() > 0 && args[0]->IsNumber()) {
+      iterations = args[0]->Uint32Value();
+    }
+    bool simd = args.Length() > 1 && args[1]->BooleanValue();
+
+    // worker must run on this CPU
+    if (0 == iterations || GLOBAL_native_threads()->background_cpus() > 0) {
+      args.GetReturnValue().SetUndefined();
+      return;
+    }
+
+    SwitchBench bench;
+    bench.remaining = iterations;
+    bench.simd = simd;
+    rt::NativeThreadHandle worker = GLOBAL_native_threads()->Create(
+      "bench-switch", 0, SwitchBenchWorker, &bench);
+    GLOBAL_native_threads()->Yield();
+
+    uint64_t restores = rt::Fpu::restores();
+    uint64_t start = rt::Cpu::ReadTimestampCounter();
+    while (bench.remaining > 0) {
+      SwitchBenchTouch(simd);
+      --bench.remaining;
+      GLOBAL_native_threads()->Yield();
+    }
+    uint64_t cycles = rt::Cpu::ReadTimestampCounter() - start;
+    GLOBAL_native_threads()->Join(worker);
+
+    Handle<Object> result = Object::New(isolate);
+    result->Set(String::NewFromUtf8(isolate, "cycles"),
+                Number::New(isolate, static_cast<double>(cycles) / (2 * iterations)));
+    result->Set(String::NewFromUtf8(isolate, "restores"),
+                Number::New(isolate, rt::Fpu::restores() - restores));
+    args.GetReturnValue().Set(result);
+  };
+
   // this is the public kernel API
   Handle<ObjectTemplate> MakeGlobal(Isolate *isolate) {
     Handle<ObjectTemplate> global = ObjectTemplate::New(isolate);
@@ -125,16 +445,78 @@ namespace RuntimeOS {
     global->Set(String::NewFromUtf8(isolate, "buff"),
                 FunctionTemplate::New(isolate, Buffer));
 
+    global->Set(String::NewFromUtf8(isolate, "hrtime"),
+                FunctionTemplate::New(isolate, HrTime));
+
+    Handle<ObjectTemplate> performance = ObjectTemplate::New(isolate);
+    performance->Set(String::NewFromUtf8(isolate, "now"),
+                     FunctionTemplate::New(isolate, PerformanceNow));
+    global->Set(String::NewFromUtf8(isolate, "performance"), performance);
+
+    Handle<ObjectTemplate> profiler = ObjectTemplate::New(isolate);
+    profiler->Set(String::NewFromUtf8(isolate, "start"),
+                  FunctionTemplate::New(isolate, ProfilerStart));
+    profiler->Set(String::NewFromUtf8(isolate, "stop"),
+                  FunctionTemplate::New(isolate, ProfilerStop));
+    profiler->Set(String::NewFromUtf8(isolate, "reset"),
+                  FunctionTemplate::New(isolate, ProfilerReset));
+    profiler->Set(String::NewFromUtf8(isolate, "dump"),
+                  FunctionTemplate::New(isolate, ProfilerDump));
+    profiler->Set(String::NewFromUtf8(isolate, "info"),
+                  FunctionTemplate::New(isolate, ProfilerInfo));
+    profiler->Set(String::NewFromUtf8(isolate, "startJS"),
+                  FunctionTemplate::New(isolate, ProfileStart));
+    profiler->Set(String::NewFromUtf8(isolate, "stopJS"),
+                  FunctionTemplate::New(isolate, ProfileStop));
+    global->Set(String::NewFromUtf8(isolate, "profiler"), profiler);
+
+    Handle<ObjectTemplate> trace = ObjectTemplate::New(isolate);
+    trace->Set(String::NewFromUtf8(isolate, "start"),
+               FunctionTemplate::New(isolate, TraceStart));
+    trace->Set(String::NewFromUtf8(isolate, "stop"),
+               FunctionTemplate::New(isolate, TraceStop));
+    trace->Set(String::NewFromUtf8(isolate, "dump"),
+               FunctionTemplate::New(isolate, TraceDump));
+    trace->Set(String::NewFromUtf8(isolate, "fetch"),
+               FunctionTemplate::New(isolate, TraceFetch));
+
+    const uint32_t categories[] = {
+      rt::Trace::kCategoryScope, rt::Trace::kCategorySched,
+      rt::Trace::kCategoryIrq, rt::Trace::kCategoryPageFault,
+      rt::Trace::kCategoryMessage, rt::Trace::kCategoryGC
+    };
+    for (uint32_t category : categories) {
+      trace->Set(String::NewFromUtf8(isolate, rt::Trace::CategoryName(category)),
+                 Number::New(isolate, category));
+    }
+    global->Set(String::NewFromUtf8(isolate, "trace"), trace);
+
+    Handle<ObjectTemplate> mem = ObjectTemplate::New(isolate);
+    mem->Set(String::NewFromUtf8(isolate, "stats"),
+             FunctionTemplate::New(isolate, MemoryStats));
+    global->Set(String::NewFromUtf8(isolate, "memory"), mem);
+
+    Handle<ObjectTemplate> fpu = ObjectTemplate::New(isolate);
+    fpu->Set(String::NewFromUtf8(isolate, "info"),
+             FunctionTemplate::New(isolate, FpuInfo));
+    fpu->Set(String::NewFromUtf8(isolate, "benchSwitch"),
+             FunctionTemplate::New(isolate, FpuBenchSwitch));
+    global->Set(String::NewFromUtf8(isolate, "fpu"), fpu);
+
     return global;
   };
 
-  void Main(char* str) {
+  void Main(const char* name, const char* str, size_t len) {
     Isolate* isolate = Isolate::New();
+    memory.Attach(isolate);
+    GLOBAL_trace()->SetIsolate(isolate);
+    rt::V8Utils::AddTraceGCCallbacks(isolate);
 
     // v8 boilerplate
     Locker locker(isolate);
     Isolate::Scope isolateScope(isolate);
     HandleScope handleScope(isolate);
+    memory.InstallFatalErrorHandler();
 
     // populate global object with C++ wrapped functions
     Handle<ObjectTemplate> global = MakeGlobal(isolate);
@@ -142,11 +524,10 @@ namespace RuntimeOS {
 
     Context::Scope contextScope(context);
 
-    // compile the script from the initrd file
-    Handle<String> file = String::NewFromUtf8(isolate, "system.js");
-    Handle<String> code = String::NewFromUtf8(isolate, str);
+    // compile the script straight from initrd memory, no copies
+    Handle<String> file = String::NewFromUtf8(isolate, name);
+    Handle<String> code = rt::V8Utils::StaticString(isolate, str, len);
 
-    // Handle<String> code = String::
     Handle<Script> script = Script::Compile(code, file);
 
     // run script
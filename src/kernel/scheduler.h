@@ -0,0 +1,279 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <kernel/kernel.h>
+#include <stdint.h>
+#include <stddef.h>
+
+namespace rt {
+
+class MlfqScheduler;
+
+/**
+ * Scheduling state of one thread, and time it spent running and
+ * waiting to run. Owned by thread, updated by its thread manager
+ * on the CPU thread runs on
+ */
+class SchedEntity {
+    friend class MlfqScheduler;
+public:
+    /**
+     * Level 0 is latency class of driver isolates woken by IRQs.
+     * Threads start at level 1, CPU-bound ones sink to the last
+     */
+    static const uint32_t kLevels = 4;
+    static const uint32_t kDriverLevel = 0;
+    static const uint32_t kStartLevel = 1;
+
+    SchedEntity()
+        :	level_(kStartLevel),
+            runnable_(false),
+            irq_(false),
+            ready_nanos_(0),
+            run_start_nanos_(0),
+            last_stop_nanos_(0),
+            last_slice_nanos_(0),
+            run_nanos_(0),
+            wait_nanos_(0),
+            max_wait_nanos_(0),
+            dispatches_(0),
+            irq_wakeups_(0),
+            irq_count_(0),
+            irq_latency_nanos_(0),
+            irq_latency_max_nanos_(0) {}
+
+    /**
+     * Work state refreshed before every scheduling decision.
+     * Runnable threads have messages, irq is set if one of them
+     * is an IRQ, ready_nanos is the time first one arrived
+     */
+    void SetReady(bool runnable, bool irq, uint64_t ready_nanos) {
+        runnable_ = runnable || irq;
+        irq_ = irq;
+        ready_nanos_ = ready_nanos;
+    }
+
+    /**
+     * Time from IRQ to the start of its handler
+     */
+    void AddIrqLatency(uint64_t nanos) {
+        ++irq_count_;
+        irq_latency_nanos_ += nanos;
+        if (nanos > irq_latency_max_nanos_) {
+            irq_latency_max_nanos_ = nanos;
+        }
+    }
+
+    uint32_t level() const { return level_; }
+    uint64_t last_slice_nanos() const { return last_slice_nanos_; }
+    uint64_t run_nanos() const { return run_nanos_; }
+    uint64_t wait_nanos() const { return wait_nanos_; }
+    uint64_t max_wait_nanos() const { return max_wait_nanos_; }
+    uint64_t dispatches() const { return dispatches_; }
+    uint64_t irq_wakeups() const { return irq_wakeups_; }
+    uint64_t irq_count() const { return irq_count_; }
+    uint64_t irq_latency_nanos() const { return irq_latency_nanos_; }
+    uint64_t irq_latency_max_nanos() const { return irq_latency_max_nanos_; }
+private:
+    uint32_t level_;
+    bool runnable_;
+    bool irq_;
+    uint64_t ready_nanos_;
+    uint64_t run_start_nanos_;
+    uint64_t last_stop_nanos_;
+    uint64_t last_slice_nanos_;
+    uint64_t run_nanos_;
+    uint64_t wait_nanos_;
+    uint64_t max_wait_nanos_;
+    uint64_t dispatches_;
+    uint64_t irq_wakeups_;
+    uint64_t irq_count_;
+    uint64_t irq_latency_nanos_;
+    uint64_t irq_latency_max_nanos_;
+    DELETE_COPY_AND_ASSIGN(SchedEntity);
+};
+
+/**
+ * Time a thread may run JS before timer interrupt preempts it.
+ * Checked on every timer tick, it stays expired until thread
+ * starts the next slice, so a lost interrupt request is repeated
+ */
+class TimeSlice {
+public:
+    explicit TimeSlice(uint64_t length_nanos)
+        :	length_nanos_(length_nanos),
+            start_nanos_(0) {
+        RT_ASSERT(length_nanos_ > 0);
+    }
+
+    void SetLength(uint64_t nanos) {
+        RT_ASSERT(nanos > 0);
+        length_nanos_ = nanos;
+    }
+
+    void Start(uint64_t now) {
+        start_nanos_ = now;
+    }
+
+    /**
+     * Safe in IRQ context
+     */
+    bool Expired(uint64_t now) const {
+        return now - start_nanos_ >= length_nanos_;
+    }
+
+    uint64_t length_nanos() const { return length_nanos_; }
+private:
+    uint64_t length_nanos_;
+    volatile uint64_t start_nanos_;
+    DELETE_COPY_AND_ASSIGN(TimeSlice);
+};
+
+/**
+ * Multi-level feedback queue. Runnable thread on the lowest level
+ * runs next, round-robin within a level. Thread which used up the
+ * quantum of its level drops one level, thread which gave CPU up
+ * early rises back. Threads woken by IRQ run on driver level
+ * until they give CPU up, then continue from the start level.
+ * All levels are boosted periodically and idle threads still run
+ * now and then (timeouts, GC), so nobody starves.
+ */
+class MlfqScheduler {
+public:
+    static const uint64_t kBaseQuantumNanos = 2 * 1000 * 1000;
+    static const uint64_t kBoostPeriodNanos = 200 * 1000 * 1000;
+    static const uint64_t kStarvationNanos = 50 * 1000 * 1000;
+
+    MlfqScheduler()
+        :	last_boost_nanos_(0) {}
+
+    /**
+     * Quantum doubles with every level
+     */
+    static uint64_t Quantum(uint32_t level) {
+        RT_ASSERT(level < SchedEntity::kLevels);
+        return kBaseQuantumNanos << level;
+    }
+
+    /**
+     * Running thread used up the quantum of its level and should
+     * be preempted. Safe in IRQ context
+     */
+    static bool Expired(const SchedEntity* e, uint64_t now) {
+        RT_ASSERT(e);
+        return now - e->run_start_nanos_ >= Quantum(e->level_);
+    }
+
+    /**
+     * Index of the thread to run after current one
+     */
+    size_t Pick(SchedEntity* const* entities, size_t count,
+                size_t current, uint64_t now) {
+        RT_ASSERT(count > 0);
+        if (now - last_boost_nanos_ >= kBoostPeriodNanos) {
+            last_boost_nanos_ = now;
+            for (size_t i = 0; i < count; ++i) {
+                if (entities[i]->level_ > SchedEntity::kStartLevel) {
+                    entities[i]->level_ = SchedEntity::kStartLevel;
+                }
+            }
+        }
+
+        size_t best = count;
+        uint32_t best_level = SchedEntity::kLevels;
+
+        // Start after current thread, it runs again only if
+        // nobody else on its level has work
+        for (size_t k = 1; k <= count; ++k) {
+            size_t index = (current + k) % count;
+            SchedEntity* e = entities[index];
+            uint32_t level;
+            if (e->irq_) {
+                level = SchedEntity::kDriverLevel;
+            } else if (e->runnable_) {
+                level = e->level_;
+            } else if (now - e->last_stop_nanos_ >= kStarvationNanos) {
+                level = SchedEntity::kStartLevel;
+            } else {
+                continue;
+            }
+
+            if (level < best_level) {
+                best = index;
+                best_level = level;
+            }
+        }
+
+        if (count == best) {
+            return (current + 1) % count;
+        }
+        return best;
+    }
+
+    /**
+     * Thread starts running
+     */
+    void Dispatch(SchedEntity* e, uint64_t now) {
+        RT_ASSERT(e);
+        if (e->irq_) {
+            e->level_ = SchedEntity::kDriverLevel;
+            ++e->irq_wakeups_;
+        }
+
+        if (e->runnable_) {
+            // Thread doesn't wait while it still runs
+            uint64_t ready = e->ready_nanos_ > e->last_stop_nanos_ ?
+                e->ready_nanos_ : e->last_stop_nanos_;
+            uint64_t wait = now > ready ? now - ready : 0;
+            e->wait_nanos_ += wait;
+            if (wait > e->max_wait_nanos_) {
+                e->max_wait_nanos_ = wait;
+            }
+        }
+
+        ++e->dispatches_;
+        e->run_start_nanos_ = now;
+    }
+
+    /**
+     * Thread gave CPU up, level follows time it used
+     */
+    void Stop(SchedEntity* e, uint64_t now) {
+        RT_ASSERT(e);
+        uint64_t used = now > e->run_start_nanos_ ? now - e->run_start_nanos_ : 0;
+        e->run_nanos_ += used;
+        e->last_slice_nanos_ = used;
+        e->last_stop_nanos_ = now;
+
+        uint64_t quantum = Quantum(e->level_);
+        if (SchedEntity::kDriverLevel == e->level_) {
+            // Driver level lasts one dispatch, next IRQ earns it again
+            e->level_ = SchedEntity::kStartLevel;
+        } else if (used >= quantum) {
+            if (e->level_ + 1 < SchedEntity::kLevels) {
+                ++e->level_;
+            }
+        } else if (used < quantum / 4 && e->level_ > SchedEntity::kStartLevel) {
+            --e->level_;
+        }
+    }
+private:
+    uint64_t last_boost_nanos_;
+    DELETE_COPY_AND_ASSIGN(MlfqScheduler);
+};
+
+} // namespace rt
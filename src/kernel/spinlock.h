@@ -56,11 +56,12 @@ public:
         if (cpuid == _l->owner) {
             return true;
         }
-        bool tryresult = __sync_lock_test_and_set(_p, 1);
-        if (tryresult) {
+        // Returns previous value, lock is acquired if it was free
+        bool acquired = !__sync_lock_test_and_set(_p, 1);
+        if (acquired) {
             _l->owner = cpuid;
         }
-        return tryresult;
+        return acquired;
     }
 
     inline void unlock() {
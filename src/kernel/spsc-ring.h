@@ -0,0 +1,216 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <kernel/kernel.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+namespace rt {
+
+/**
+ * Lock-free single producer, single consumer byte ring in
+ * memory shared by two threads (or isolates). Header is part of
+ * the shared memory, so both sides (and scripts which map it as
+ * ArrayBuffer) see indices directly:
+ *
+ *   0    head (uint32, written by producer)
+ *   4    producer is waiting for space
+ *   64   tail (uint32, written by consumer)
+ *   68   consumer is waiting for data
+ *   128  data, size bytes (power of two)
+ *
+ * Indices run freely and wrap at 2^32, offset in data is index
+ * modulo size. A side which found ring empty (full) arms its wait
+ * flag, other side clears the flag and reports that a doorbell
+ * is needed. Doorbell is only sent to a waiting side, streaming
+ * which keeps up does not send any.
+ */
+class SpscRing {
+public:
+    static const size_t kHeaderSize = 128;
+    static const size_t kHeadOffset = 0;
+    static const size_t kProducerWaitingOffset = 4;
+    static const size_t kTailOffset = 64;
+    static const size_t kConsumerWaitingOffset = 68;
+    static const uint32_t kMaxSize = 1U << 30;
+
+    /**
+     * Memory size required for ring of size bytes
+     */
+    static size_t MemorySize(uint32_t size) {
+        return kHeaderSize + size;
+    }
+
+    static bool IsValidSize(uint32_t size) {
+        return size > 0 && size <= kMaxSize && 0 == (size & (size - 1));
+    }
+
+    SpscRing(void* memory, uint32_t size)
+        :	memory_(static_cast<uint8_t*>(memory)),
+            size_(size) {
+        RT_ASSERT(memory_);
+        RT_ASSERT(IsValidSize(size));
+        memset(memory_, 0, kHeaderSize);
+    }
+
+    uint8_t* memory() const { return memory_; }
+    uint8_t* data() const { return memory_ + kHeaderSize; }
+    uint32_t size() const { return size_; }
+
+    uint32_t head() const { return Load(kHeadOffset); }
+    uint32_t tail() const { return Load(kTailOffset); }
+
+    /**
+     * Scripts can write header, indices are checked before
+     * they are used to access data
+     */
+    bool IsValid() const {
+        return head() - tail() <= size_;
+    }
+
+    uint32_t Readable() const {
+        return head() - tail();
+    }
+
+    uint32_t Writable() const {
+        return size_ - (head() - tail());
+    }
+
+    uint32_t ReadOffset() const { return tail() & (size_ - 1); }
+    uint32_t WriteOffset() const { return head() & (size_ - 1); }
+
+    /**
+     * Producer wrote bytes at write offset. Returns true if
+     * consumer waits and needs a doorbell. Caller checks there
+     * was space, script on the other side can move tail anytime
+     */
+    bool Commit(uint32_t bytes) {
+        Store(kHeadOffset, head() + bytes);
+        return Disarm(kConsumerWaitingOffset);
+    }
+
+    /**
+     * Consumer read bytes at read offset. Returns true if
+     * producer waits and needs a doorbell. Caller checks there
+     * was data
+     */
+    bool Consume(uint32_t bytes) {
+        Store(kTailOffset, tail() + bytes);
+        return Disarm(kProducerWaitingOffset);
+    }
+
+    /**
+     * Consumer is going to wait for data. Returns false if
+     * there is data already and nothing was armed
+     */
+    bool WaitReadable() {
+        return Arm(kConsumerWaitingOffset, [this]() { return Readable() > 0; });
+    }
+
+    /**
+     * Producer is going to wait for space. Returns false if
+     * there is space already and nothing was armed
+     */
+    bool WaitWritable() {
+        return Arm(kProducerWaitingOffset, [this]() { return Writable() > 0; });
+    }
+
+    /**
+     * Copy as much as fits, returns number of bytes written.
+     * Sets doorbell if consumer needs one
+     */
+    uint32_t Write(const void* src, uint32_t len, bool* doorbell) {
+        // Single snapshot, consumer moves tail concurrently
+        uint32_t used = head() - tail();
+        if (used > size_) {
+            *doorbell = false;
+            return 0;
+        }
+
+        uint32_t writable = size_ - used;
+        uint32_t n = len < writable ? len : writable;
+        uint32_t offset = WriteOffset();
+        uint32_t first = n < size_ - offset ? n : size_ - offset;
+        const uint8_t* p = static_cast<const uint8_t*>(src);
+        memcpy(data() + offset, p, first);
+        memcpy(data(), p + first, n - first);
+        *doorbell = n > 0 && Commit(n);
+        return n;
+    }
+
+    /**
+     * Copy as much as available, returns number of bytes read.
+     * Sets doorbell if producer needs one
+     */
+    uint32_t Read(void* dst, uint32_t len, bool* doorbell) {
+        uint32_t readable = Readable();
+        if (readable > size_) {
+            *doorbell = false;
+            return 0;
+        }
+
+        uint32_t n = len < readable ? len : readable;
+        uint32_t offset = ReadOffset();
+        uint32_t first = n < size_ - offset ? n : size_ - offset;
+        uint8_t* p = static_cast<uint8_t*>(dst);
+        memcpy(p, data() + offset, first);
+        memcpy(p + first, data(), n - first);
+        *doorbell = n > 0 && Consume(n);
+        return n;
+    }
+private:
+    volatile uint32_t* Word(size_t offset) const {
+        return reinterpret_cast<volatile uint32_t*>(memory_ + offset);
+    }
+
+    uint32_t Load(size_t offset) const {
+        return __atomic_load_n(Word(offset), __ATOMIC_SEQ_CST);
+    }
+
+    void Store(size_t offset, uint32_t value) {
+        __atomic_store_n(Word(offset), value, __ATOMIC_SEQ_CST);
+    }
+
+    bool Disarm(size_t offset) {
+        // Common case, nobody waits
+        if (0 == Load(offset)) {
+            return false;
+        }
+
+        uint32_t expected = 1;
+        return __atomic_compare_exchange_n(Word(offset), &expected, 0,
+            false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    }
+
+    template<typename Ready>
+    bool Arm(size_t offset, Ready ready) {
+        Store(offset, 1);
+
+        // Other side could update index before it saw the flag
+        if (ready() && Disarm(offset)) {
+            return false;
+        }
+
+        return true;
+    }
+
+    uint8_t* memory_;
+    uint32_t size_;
+    DELETE_COPY_AND_ASSIGN(SpscRing);
+};
+
+} // namespace rt
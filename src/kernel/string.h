@@ -17,6 +17,7 @@
 #include <kernel/kernel.h>
 #include <kernel/allocator.h>
 #include <string>
+#include <cstring>
 #include <functional>
 #include <vector>
 
@@ -71,6 +71,19 @@ v8::Local<v8::Context> TemplateCache::NewContext() {
         runtime->Set(iv8_, "args", v8::FunctionTemplate::New(iv8_, NativesObject::Args));
         runtime->Set(iv8_, "log", v8::FunctionTemplate::New(iv8_, NativesObject::KernelLog));
         runtime->Set(iv8_, "version", v8::FunctionTemplate::New(iv8_, NativesObject::Version));
+        runtime->Set(iv8_, "callBatch", v8::FunctionTemplate::New(iv8_, NativesObject::CallBatch));
+        runtime->Set(iv8_, "setExceptionHandler",
+                     v8::FunctionTemplate::New(iv8_, NativesObject::SetExceptionHandler));
+        runtime->Set(iv8_, "recycleBuffer",
+                     v8::FunctionTemplate::New(iv8_, NativesObject::RecycleBuffer));
+        runtime->Set(iv8_, "setMailboxLimits",
+                     v8::FunctionTemplate::New(iv8_, NativesObject::SetMailboxLimits));
+        runtime->Set(iv8_, "mailboxInfo",
+                     v8::FunctionTemplate::New(iv8_, NativesObject::MailboxInfo));
+        runtime->Set(iv8_, "setTimeSlice",
+                     v8::FunctionTemplate::New(iv8_, NativesObject::SetTimeSlice));
+        runtime->Set(iv8_, "schedulerInfo",
+                     v8::FunctionTemplate::New(iv8_, NativesObject::SchedulerInfo));
 
         global->Set(iv8_, "runtime", runtime);
 
@@ -109,6 +122,9 @@ v8::Local<v8::Value> TemplateCache::NewWrappedFunction(ExternalFunction* data) {
 
     obj->SetAlignedPointerInInternalField(0,
         static_cast<NativeObjectWrapper*>(data));
+
+    // Deletes itself when object is collected
+    new ExternalFunctionWrapper(iv8_, obj, data);
     return scope.Escape(obj);
 }
 
@@ -42,6 +42,7 @@ enum class NativeTypeId : uint32_t {
     TYPEID_PROCESS_MANAGER_HANDLE,
     TYPEID_ALLOCATOR,
     TYPEID_FUNCTION,
+    TYPEID_CHANNEL,
 
     LAST // Keep it as the last element
 };
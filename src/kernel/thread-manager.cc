@@ -15,6 +15,7 @@
 #include "thread-manager.h"
 #include <kernel/kernel.h>
 #include <kernel/engines.h>
+#include <kernel/clock.h>
 
 namespace rt {
 
@@ -23,6 +24,7 @@ void ThreadEntryPoint(Thread* t) {
     Cpu::EnableInterrupts();
 
     t->Init();
+    t->thread_manager()->PreemptEnable();
     for (;;) {
         Cpu::EnableInterrupts();
         t->Run();
@@ -36,6 +38,7 @@ ThreadManager::ThreadManager(Engine* engine)
         current_thread_index_(0) {
     RT_ASSERT(engine);
     threads_.reserve(128);
+    entities_.reserve(128);
     ticks_counter_.Set(1);
 }
 
@@ -54,25 +57,86 @@ void ThreadManager::ProcessNewThreads() {
     if (0 == threads.size()) return;
 
     for (auto thread : threads) {
-        thread.get()->thread_ = CreateThread(thread);
+        Thread* t = CreateThread(thread);
+        thread.get()->thread_ = t;
+        t->memory().SetLimits(thread.get()->memory_limits());
+        uint64_t time_slice = thread.get()->time_slice_nanos();
+        if (0 != time_slice) {
+            t->SetTimeSlice(time_slice);
+        }
+
+        // Messages pushed before thread existed
+        t->NotifyMessage(false);
     }
 }
 
 void ThreadManager::TimerInterruptNotify() {
     ticks_counter_.AddFetch(1);
+
+    // Threads are not preempted while being switched
+    if (IsPreemptEnabled() && nullptr != current_thread_) {
+        current_thread_->TimerTick(NowNanos());
+    }
+}
+
+uint64_t ThreadManager::NowNanos() {
+    return nullptr == GLOBAL_clock() ? 0 : GLOBAL_clock()->MonotonicNanos();
+}
+
+Thread* ThreadManager::SwitchToNextThread() {
+    uint64_t ticks_now = ticks_count();
+    uint64_t now = NowNanos();
+    for (size_t i = 0; i < threads_.size(); ++i) {
+        Thread* t = threads_[i].thread();
+
+        // Copy priority from Atomic32 to thread data
+        threads_[i].SetPriority(t->priority());
+        t->UpdateSchedState(ticks_now);
+    }
+
+    current_thread_index_ = scheduler_.Pick(entities_.data(), entities_.size(),
+                                            current_thread_index_, now);
+    current_thread_ = threads_[current_thread_index_].thread();
+    current_thread_->ResetPriority();
+    scheduler_.Dispatch(&current_thread_->sched(), now);
+    return current_thread_;
+}
+
+void ThreadManager::RemoveThread(Thread* t) {
+    RT_ASSERT(t);
+    RT_ASSERT(t != current_thread_);
+    for (size_t i = 0; i < threads_.size(); ++i) {
+        if (threads_[i].thread() != t) {
+            continue;
+        }
+
+        threads_.erase(threads_.begin() + i);
+        entities_.erase(entities_.begin() + i);
+        if (current_thread_index_ > i) {
+            --current_thread_index_;
+        }
+        return;
+    }
+    RT_ASSERT(!"thread not found");
 }
 
 void ThreadManager::Preempt() {
+    PreemptDisable();
     Thread* curr_thread = current_thread();
+    scheduler_.Stop(&curr_thread->sched(), NowNanos());
     Thread* new_thread = SwitchToNextThread();
 
     ProcessNewThreads();
 
-    if (curr_thread == new_thread) {
-        return;
+    if (curr_thread != new_thread) {
+        if (curr_thread->parked()) {
+            RemoveThread(curr_thread);
+        }
+        preemptStart(curr_thread->_fxstate, new_thread->_fxstate);
     }
 
-    preemptStart(curr_thread->_fxstate, new_thread->_fxstate);
+    // Switched back to this thread
+    PreemptEnable();
 }
 
 } // namespace rt
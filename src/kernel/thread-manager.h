@@ -70,6 +70,7 @@ public:
         Thread* t = new Thread(this, ethread);
         ThreadInit(t);
         threads_.push_back(ThreadData(t));
+        entities_.push_back(&t->sched());
         return t;
     }
 
@@ -95,6 +96,7 @@ public:
 
         current_thread_index_ = 0;
         current_thread_ = threads_[current_thread_index_].thread();
+        scheduler_.Dispatch(&current_thread_->sched(), NowNanos());
         enterFirstThread(current_thread_->_fxstate);
     }
 
@@ -102,44 +104,10 @@ public:
     // When thread needs to start without saved state
     void ThreadInit(Thread* t);
 
-    Thread* SwitchToNextThread() {
-        uint32_t max = 0;
-        uint32_t min = std::numeric_limits<uint32_t>::max();
-        size_t max_index = 0;
-        size_t min_index = 0;
-
-        for (size_t i = 0; i < threads_.size(); ++i) {
-
-            uint32_t p = threads_[i].thread()->priority();
-
-            // Copy priority from Atomic32 to thread data
-            threads_[i].SetPriority(p);
-
-            if (p > max) {
-                max = p;
-                max_index = i;
-            }
-
-            if (p < min) {
-                min = p;
-                min_index = i;
-            }
-        }
-
-        if (max != min) {
-            current_thread_index_ = max_index;
-        } else {
-            ++current_thread_index_;
-            if (current_thread_index_ == threads_.size())
-            {
-                current_thread_index_ = 0;
-            }
-        }
-
-        current_thread_ = threads_[current_thread_index_].thread();
-        current_thread_->ResetPriority();
-        return current_thread_;
-    }
+    /**
+     * Pick thread to run next, see MlfqScheduler
+     */
+    Thread* SwitchToNextThread();
 
     bool IsPreemptEnabled() {
         return (1 == is_preempt_enabled_.Get());
@@ -161,11 +129,22 @@ public:
     void TimerInterruptNotify();
     void Preempt();
 private:
+    static uint64_t NowNanos();
+
+    /**
+     * Take parked thread out of the scheduler, it must not be
+     * the current thread. Thread object and its isolate are
+     * leaked, isolate can't be disposed after fatal error
+     */
+    void RemoveThread(Thread* t);
+
     Thread* current_thread_;
     Engine* engine_;
     uint64_t next_thread_id_;
     volatile uint64_t current_thread_index_;
     std::vector<ThreadData> threads_;
+    std::vector<SchedEntity*> entities_;
+    MlfqScheduler scheduler_;
     Atomic<uint32_t> is_preempt_enabled_;
     Atomic<uint64_t> ticks_counter_;
     DELETE_COPY_AND_ASSIGN(ThreadManager);
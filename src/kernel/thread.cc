@@ -18,16 +18,31 @@
 #include <kernel/mem-manager.h>
 #include <kernel/engine.h>
 #include <kernel/engines.h>
+#include <kernel/trace.h>
+#include <kernel/isolate-memory.h>
+#include <kernel/fpu.h>
+#include <kernel/clock.h>
 
 namespace rt {
 
 Thread::Thread(ThreadManager* thread_mgr, ResourceHandle<EngineThread> ethread)
-    :	thread_mgr_(thread_mgr),
+    :	_fxstate(Fpu::AllocState()),
+        thread_mgr_(thread_mgr),
         iv8_(nullptr),
         tpl_cache_(nullptr),
         stack_(GLOBAL_mem_manager()->virtual_allocator().AllocStack()),
         ethread_(ethread),
-        exports_(this) {
+        exports_(this),
+        deferred_calls_(0),
+        max_pending_calls_(kDefaultPendingCalls),
+        rejected_calls_(0),
+        drain_slice_nanos_(kDefaultDrainSliceNanos),
+        microtask_budget_(kDefaultMicrotaskBudget),
+        time_slice_(kDefaultTimeSliceNanos),
+        in_run_(false),
+        parked_(false),
+        preemptions_(0),
+        uncaught_exceptions_(0) {
     priority_.Set(1);
 }
 
@@ -37,18 +52,60 @@ Thread::~Thread() {
 
     iv8_->Dispose(); // This deletes v8 isolate object
     delete tpl_cache_;
+    Fpu::FreeState(_fxstate);
+    for (CallBatch* batch : outgoing_calls_) {
+        delete batch;
+    }
+    for (DeferredCall& call : deferred_) {
+        delete call.message;
+    }
     // TODO: delete stack
 }
 
 ExternalFunction* FunctionExports::Add(v8::Local<v8::Value> v,
                                        ResourceHandle<EngineThread> recv) {
-    uint32_t index = data_.size();
     RT_ASSERT(thread_);
+    RT_ASSERT(v->IsFunction());
     v8::Isolate* iv8 { thread_->IsolateV8() };
     RT_ASSERT(iv8);
+    v8::HandleScope scope(iv8);
+
+    if (key_.IsEmpty()) {
+        key_.Reset(iv8, v8::String::NewFromUtf8(iv8, "runtime::export"));
+    }
+    v8::Local<v8::String> key { v8::Local<v8::String>::New(iv8, key_) };
+    v8::Local<v8::Object> obj { v->ToObject() };
+
+    // Function exported already, slot could be reused by other
+    // function since then
+    v8::Local<v8::Value> slot { obj->GetHiddenValue(key) };
+    if (!slot.IsEmpty() && slot->IsUint32()) {
+        uint32_t index = slot->Uint32Value();
+        if (index < data_.size() && !data_[index].empty() &&
+            data_[index].GetValue(iv8)->StrictEquals(v)) {
+            ExternalFunction* efn { data_[index].efn() };
+            efn->AddRef();
+            return efn;
+        }
+    }
+
+    uint32_t index;
+    if (free_.size() > 0) {
+        index = free_.back();
+        free_.pop_back();
+    } else {
+        index = data_.size();
+        data_.push_back(FunctionExportData());
+    }
+
     size_t export_id = ++export_id_;
-    data_.push_back(std::move(FunctionExportData(iv8, v, export_id)));
-    return new ExternalFunction(index, export_id, thread_, recv);
+    ExternalFunction* efn { new ExternalFunction(index, export_id, thread_, recv) };
+    data_[index].Set(iv8, v, export_id, efn);
+    obj->SetHiddenValue(key, v8::Uint32::NewFromUnsigned(iv8, index));
+    ++count_;
+
+    efn->AddRef();
+    return efn;
 }
 
 v8::Local<v8::Value> FunctionExports::Get(uint32_t index, size_t export_id) {
@@ -64,6 +121,60 @@ v8::Local<v8::Value> FunctionExports::Get(uint32_t index, size_t export_id) {
     return scope.Escape(data_[index].GetValue(iv8));
 }
 
+void FunctionExports::Release(ExternalFunction* efn) {
+    RT_ASSERT(efn);
+    if (!efn->TryFree()) {
+        return;
+    }
+
+    uint32_t index = efn->index();
+    RT_ASSERT(index < data_.size());
+    RT_ASSERT(data_[index].efn() == efn);
+    data_[index].Clear();
+    free_.push_back(index);
+    RT_ASSERT(count_ > 0);
+    --count_;
+    delete efn;
+}
+
+void ExternalFunction::Release() {
+    for (;;) {
+        uint64_t state = state_.Get();
+        RT_ASSERT(state >= kRefOne);
+        uint64_t next = state - kRefOne;
+        bool notify = 0 == next;
+        if (notify) {
+            next = kReleasePending;
+        }
+
+        if (state_.CompareExchange(state, next)) {
+            if (notify) {
+                std::unique_ptr<ThreadMessage> msg(new ThreadMessage(
+                    ThreadMessage::Type::FUNCTION_RELEASE,
+                    ResourceHandle<EngineThread>(), TransportData(), this));
+                recv_.get()->PushMessage(std::move(msg));
+            }
+            return;
+        }
+    }
+}
+
+void Thread::UpdateSchedState(uint64_t ticks_now) {
+    if (parked_) {
+        sched_.SetReady(false, false, 0);
+        return;
+    }
+
+    uint64_t ready_tsc = ready_tsc_.Get();
+    uint64_t ready_nanos = 0;
+    if (0 != ready_tsc && nullptr != GLOBAL_clock()) {
+        ready_nanos = GLOBAL_clock()->NanosFromTsc(ready_tsc);
+    }
+
+    // Thread preempted in the middle of its drain has work too
+    bool runnable = priority_.Get() > 1 || in_run_ || timeouts_.Elapsed(ticks_now);
+    sched_.SetReady(runnable, 0 != irq_tsc_.Get(), ready_nanos);
+}
 
 void Thread::SetTimeout(uint32_t timeout_id, uint64_t timeout_ms) {
     uint64_t ticks_now { thread_mgr_->ticks_count() };
@@ -71,17 +182,350 @@ void Thread::SetTimeout(uint32_t timeout_id, uint64_t timeout_ms) {
     timeouts_.Set(timeout_id, when);
 }
 
+void Thread::QueueCall(ExternalFunction* efn, TransportData data,
+                       uint32_t promise_index, size_t calls) {
+    RT_ASSERT(efn);
+    ResourceHandle<EngineThread> recv { efn->recv() };
+
+    for (size_t i = 0; i < outgoing_calls_.size(); ++i) {
+        CallBatch* batch { outgoing_calls_[i] };
+        if (batch->recv() != recv) {
+            continue;
+        }
+
+        // Calls queued in this turn are not counted by CallsOverLimit
+        // until sent, batch can't grow past the limit unchecked
+        if (batch->calls_count() + calls > max_pending_calls_) {
+            outgoing_calls_.erase(outgoing_calls_.begin() + i);
+            SendBatch(batch);
+            break;
+        }
+
+        batch->Add(efn, std::move(data), promise_index, calls);
+        return;
+    }
+
+    CallBatch* batch = new CallBatch(recv);
+    batch->Add(efn, std::move(data), promise_index, calls);
+    outgoing_calls_.push_back(batch);
+}
+
+void Thread::FlushCalls() {
+    if (0 == outgoing_calls_.size()) {
+        return;
+    }
+
+    for (CallBatch* batch : outgoing_calls_) {
+        SendBatch(batch);
+    }
+
+    outgoing_calls_.clear();
+    RetryDeferredCalls();
+}
+
+void Thread::SendBatch(CallBatch* batch) {
+    RT_ASSERT(batch);
+    RT_TRACE_INSTANT(Trace::kCategoryMessage, "call batch", batch->calls_count());
+    ResourceHandle<EngineThread> recv { batch->recv() };
+    std::unique_ptr<ThreadMessage> msg(new ThreadMessage(
+        ThreadMessage::Type::FUNCTION_CALL_BATCH,
+        ethread_, std::unique_ptr<CallBatch>(batch)));
+    SendCall(recv, std::move(msg));
+}
+
+void Thread::SetMailboxLimits(uint32_t capacity, size_t pending_calls) {
+    ethread_.get()->credits().SetCapacity(capacity);
+    max_pending_calls_ = pending_calls;
+}
+
+void Thread::SendCall(ResourceHandle<EngineThread> recv,
+                      std::unique_ptr<ThreadMessage> message) {
+    RT_ASSERT(message);
+    uint32_t credits = message->call_credits();
+    RT_ASSERT(credits > 0);
+
+    // Nothing may overtake calls which wait already
+    if (0 == deferred_.size() && TakeCredits(recv, credits)) {
+        recv.get()->PushMessage(std::move(message));
+        return;
+    }
+
+    RT_TRACE_INSTANT(Trace::kCategoryMessage, "call deferred", credits);
+    DeferredCall call;
+    call.recv = recv;
+    call.message = message.release();
+    call.credits = credits;
+    deferred_.push_back(call);
+    deferred_calls_ += credits;
+}
+
+bool Thread::TakeCredits(ResourceHandle<EngineThread> recv, uint32_t credits) {
+    CallCredits& recv_credits { recv.get()->credits() };
+    if (recv_credits.Take(credits)) {
+        return true;
+    }
+
+    // Receiver could return credits before it saw the waiter
+    recv.get()->AddCreditWaiter(ethread_);
+    return recv_credits.Take(credits);
+}
+
+void Thread::RetryDeferredCalls() {
+    if (0 == deferred_.size()) {
+        return;
+    }
+
+    // Receivers which refused a call, their later calls wait too
+    SharedSTLVector<ResourceHandle<EngineThread>> blocked;
+    size_t kept = 0;
+    for (size_t i = 0; i < deferred_.size(); ++i) {
+        DeferredCall call { deferred_[i] };
+        bool wait = false;
+        for (const ResourceHandle<EngineThread>& recv : blocked) {
+            if (recv == call.recv) {
+                wait = true;
+                break;
+            }
+        }
+
+        if (!wait && TakeCredits(call.recv, call.credits)) {
+            call.recv.get()->PushMessage(std::unique_ptr<ThreadMessage>(call.message));
+            deferred_calls_ -= call.credits;
+            continue;
+        }
+
+        if (!wait) {
+            blocked.push_back(call.recv);
+        }
+        deferred_[kept++] = call;
+    }
+
+    deferred_.resize(kept);
+}
+
+void Thread::RunCallBatch(v8::Local<v8::Context> context, ThreadMessage* message) {
+    ResourceHandle<EngineThread> sender_handle { message->sender() };
+    Thread* sender { sender_handle.get()->thread() };
+    RT_ASSERT(sender);
+
+    std::unique_ptr<CallBatch> results(new CallBatch(sender_handle));
+
+    for (CallBatch::Entry& entry : message->batch()->entries()) {
+        v8::HandleScope scope(iv8_);
+        RT_ASSERT(entry.efn);
+
+        v8::Local<v8::Value> fnval { exports_.Get(entry.efn->index(),
+                                                  entry.efn->export_id()) };
+        v8::Local<v8::Value> list { entry.data.Unpack(this) };
+        RT_ASSERT(!list.IsEmpty());
+
+        v8::Local<v8::Value> value;
+        bool ok = true;
+        if (fnval.IsEmpty() || !fnval->IsFunction() || !list->IsArray()) {
+            value = v8::Exception::Error(v8::String::NewFromUtf8(iv8_,
+                "Batched function call is invalid"));
+            ok = false;
+        } else {
+            v8::Local<v8::Function> fn { v8::Local<v8::Function>::Cast(fnval) };
+            v8::Local<v8::Array> calls { v8::Local<v8::Array>::Cast(list) };
+            uint32_t count = calls->Length();
+            v8::Local<v8::Array> values { v8::Array::New(iv8_, count) };
+
+            // Functions return plain values, first exception
+            // rejects the whole entry
+            for (uint32_t i = 0; i < count; ++i) {
+                v8::Local<v8::Value> callargs { calls->Get(i) };
+                std::vector<v8::Local<v8::Value>> argv;
+                if (callargs->IsArray()) {
+                    v8::Local<v8::Array> a { v8::Local<v8::Array>::Cast(callargs) };
+                    uint32_t argc = a->Length();
+                    argv.reserve(argc);
+                    for (uint32_t j = 0; j < argc; ++j) {
+                        argv.push_back(a->Get(j));
+                    }
+                } else {
+                    argv.push_back(callargs);
+                }
+
+                v8::TryCatch trycatch;
+                v8::Local<v8::Value> result { fn->Call(context->Global(),
+                    argv.size(), argv.data()) };
+                // Reply is sent in this turn, it can't wait for
+                // promise to settle the way single calls do
+                bool thenable = !result.IsEmpty() && (result->IsPromise() ||
+                    (result->IsObject() && v8::Local<v8::Object>::Cast(result)->Get(
+                        v8::String::NewFromUtf8(iv8_, "then"))->IsFunction()));
+                if (trycatch.HasCaught()) {
+                    value = trycatch.Exception();
+                    ok = false;
+                    break;
+                }
+
+                if (thenable) {
+                    value = v8::Exception::TypeError(v8::String::NewFromUtf8(iv8_,
+                        "Async functions cannot be batched"));
+                    ok = false;
+                    break;
+                }
+
+                values->Set(i, result);
+            }
+
+            if (ok) {
+                value = values;
+            }
+        }
+
+        TransportData data;
+        if (TransportData::SerializeError::NONE != data.MoveValue(this, sender, value)) {
+            const char* err = "Batched function call result is not transferable";
+            data.SetString(reinterpret_cast<const uint8_t*>(err), strlen(err));
+            ok = false;
+        }
+
+        results->AddResult(std::move(data), entry.promise_index, ok);
+    }
+
+    std::unique_ptr<ThreadMessage> msg(new ThreadMessage(
+        ThreadMessage::Type::FUNCTION_RETURN_BATCH,
+        ethread_, std::move(results)));
+    sender_handle.get()->PushMessage(std::move(msg));
+}
+
+size_t Thread::SettleCallBatch(ThreadMessage* message) {
+    size_t settled = 0;
+    for (CallBatch::Entry& entry : message->batch()->entries()) {
+        v8::HandleScope scope(iv8_);
+        v8::Local<v8::Value> unpacked { entry.data.Unpack(this) };
+        RT_ASSERT(!unpacked.IsEmpty());
+
+        v8::Local<v8::Promise::Resolver> resolver {
+            v8::Local<v8::Promise::Resolver>::New(iv8_, TakePromise(entry.promise_index)) };
+        if (resolver.IsEmpty()) {
+            continue;
+        }
+
+        if (entry.ok) {
+            resolver->Resolve(unpacked);
+        } else {
+            resolver->Reject(unpacked);
+        }
+        ++settled;
+    }
+
+    return settled;
+}
+
+void Thread::ReportException(v8::Local<v8::Context> context, v8::TryCatch& trycatch) {
+    RT_ASSERT(trycatch.HasCaught());
+    ++uncaught_exceptions_;
+    RT_TRACE_INSTANT(Trace::kCategoryMessage, "uncaught exception", uncaught_exceptions_);
+
+    if (exception_handler_.IsEmpty()) {
+        return;
+    }
+
+    v8::Isolate* iv8 { iv8_ };
+    v8::HandleScope scope(iv8);
+    LOCAL_V8STRING(s_script, "script");
+    LOCAL_V8STRING(s_line, "line");
+    LOCAL_V8STRING(s_stack, "stack");
+
+    v8::Local<v8::Object> info { v8::Object::New(iv8_) };
+    v8::Local<v8::Message> message { trycatch.Message() };
+    if (!message.IsEmpty()) {
+        info->Set(s_script, message->GetScriptResourceName());
+        info->Set(s_line, v8::Integer::New(iv8_, message->GetLineNumber()));
+    }
+    v8::Local<v8::Value> stack { trycatch.StackTrace() };
+    if (!stack.IsEmpty()) {
+        info->Set(s_stack, stack);
+    }
+
+    v8::Local<v8::Function> handler {
+        v8::Local<v8::Function>::New(iv8_, exception_handler_) };
+    v8::Local<v8::Value> argv[] { trycatch.Exception(), info };
+
+    // Exceptions thrown by handler itself are dropped
+    v8::TryCatch handler_trycatch;
+    handler->Call(context->Global(), 2, argv);
+}
+
+bool Thread::SliceElapsed(uint64_t start_nanos) const {
+    if (nullptr == GLOBAL_clock()) {
+        return false;
+    }
+    return GLOBAL_clock()->MonotonicNanos() - start_nanos >= drain_slice_nanos_;
+}
+
+void Thread::PreemptCallback(v8::Isolate* iv8, void* data) {
+    RT_ASSERT(data);
+    static_cast<Thread*>(data)->YieldTimeSlice();
+}
+
+void Thread::YieldTimeSlice() {
+    RT_ASSERT(nullptr != GLOBAL_clock());
+
+    // Request left over from previous drain
+    uint64_t now = GLOBAL_clock()->MonotonicNanos();
+    if (!in_run_ || !SliceExpired(now)) {
+        return;
+    }
+
+    ++preemptions_;
+    RT_TRACE_INSTANT(Trace::kCategoryMessage, "preempt", preemptions_);
+    thread_mgr_->Preempt();
+    time_slice_.Start(GLOBAL_clock()->MonotonicNanos());
+}
+
+void Thread::Park() {
+    in_run_ = false;
+    parked_ = true;
+    RT_TRACE_INSTANT(Trace::kCategoryMessage, "park", 0);
+
+    // Manager removes parked thread when switching away from it
+    thread_mgr_->Preempt();
+    RT_ASSERT(!"parked thread resumed");
+    Cpu::HangSystem();
+}
+
 void Thread::Init() {
     RT_ASSERT(nullptr == iv8_);
     RT_ASSERT(nullptr == tpl_cache_);
     iv8_ = v8::Isolate::New();
     iv8_->SetData(0, this);
+    // Drain runs the checkpoint, V8 would run it after every call
+    iv8_->SetAutorunMicrotasks(false);
+    memory_.Attach(iv8_);
+    V8Utils::AddTraceGCCallbacks(iv8_);
     v8::Locker lock(iv8_);
     v8::Isolate::Scope ivscope(iv8_);
     v8::HandleScope local_handle_scope(iv8_);
+    memory_.InstallFatalErrorHandler();
     tpl_cache_ = new TemplateCache(iv8_);
 }
 
+void Thread::Idle(uint64_t ticks_now) {
+    // Nothing to collect before the first request
+    if (context_.IsEmpty() || memory_.idle_done() || memory_.terminated()) {
+        return;
+    }
+
+    // Isolate is idle at least until the next timeout
+    uint64_t idle_ms = IsolateMemory::kMaxIdleMs;
+    uint64_t next = timeouts_.NextTime();
+    if (next <= ticks_now) {
+        return;
+    }
+    if (next - ticks_now < idle_ms / GLOBAL_engines()->MsPerTick()) {
+        idle_ms = (next - ticks_now) * GLOBAL_engines()->MsPerTick();
+    }
+
+    v8::Locker lock(iv8_);
+    v8::Isolate::Scope ivscope(iv8_);
+    memory_.NotifyIdle(idle_ms);
+}
+
 void Thread::Run() {
     RT_ASSERT(iv8_);
     RT_ASSERT(tpl_cache_);
@@ -97,8 +541,12 @@ void Thread::Run() {
         }
     }
 
+    // Receivers might have returned credits since last turn
+    RetryDeferredCalls();
+
     EngineThread::ThreadMessagesVector messages = ethread_.get()->TakeMessages();
     if (0 == messages.size()) {
+        Idle(ticks_now);
         return;
     }
 
@@ -106,6 +554,11 @@ void Thread::Run() {
     v8::Isolate::Scope ivscope(iv8_);
     v8::HandleScope local_handle_scope(iv8_);
 
+    if (nullptr != GLOBAL_trace()) {
+        GLOBAL_trace()->SetIsolate(iv8_);
+    }
+    RT_TRACE_BEGIN(Trace::kCategoryMessage, "drain", messages.size());
+
     if (context_.IsEmpty()) {
 
        // printf("++++++++++++++++ CONTEXT (X0)\n");
@@ -117,11 +570,44 @@ void Thread::Run() {
     v8::Local<v8::Context> context = v8::Local<v8::Context>::New(iv8_, context_);
     v8::Context::Scope cs(context);
 
-    v8::TryCatch trycatch;
+    uint64_t start_nanos { nullptr == GLOBAL_clock() ? 0 :
+                           GLOBAL_clock()->MonotonicNanos() };
 
-    for (ThreadMessage* message : messages) {
+    // Timer may preempt JS from now on
+    time_slice_.Start(start_nanos);
+    in_run_ = true;
+
+    // Promises settled since the last microtask checkpoint
+    size_t settled = 0;
+
+    for (size_t i = 0; i < messages.size(); ++i) {
+        ThreadMessage* message { messages[i] };
         RT_ASSERT(message);
 
+        // Drain used up its time slice, other isolates on this
+        // engine run before the rest
+        if (i > 0 && SliceElapsed(start_nanos)) {
+            RT_TRACE_INSTANT(Trace::kCategoryMessage, "drain slice", messages.size() - i);
+            ethread_.get()->RequeueMessages(messages, i);
+            break;
+        }
+
+        // Calls give their credits back when done, dropped or not
+        uint32_t credits = message->call_credits();
+
+        // Isolate ran out of its memory budget, drop everything
+        if (memory_.terminated()) {
+            if (credits > 0) {
+                ethread_.get()->credits().Return(credits);
+            }
+            if (!message->reusable()) {
+                delete message;
+            }
+            continue;
+        }
+
+        v8::HandleScope message_scope(iv8_);
+        v8::TryCatch trycatch;
         ThreadMessage::Type type = message->type();
 
         switch (type) {
@@ -177,8 +663,13 @@ void Thread::Run() {
             v8::Local<v8::Promise::Resolver> resolver {
                 v8::Local<v8::Promise::Resolver>::New(iv8_, TakePromise(message->recv_index())) };
 
+            // Stale index, promise is settled already
+            if (resolver.IsEmpty()) {
+                break;
+            }
+
             resolver->Resolve(unpacked);
-            iv8_->RunMicrotasks();
+            ++settled;
         }
             break;
         case ThreadMessage::Type::FUNCTION_RETURN_REJECT: {
@@ -188,21 +679,61 @@ void Thread::Run() {
             v8::Local<v8::Promise::Resolver> resolver {
                 v8::Local<v8::Promise::Resolver>::New(iv8_, TakePromise(message->recv_index())) };
 
+            // Stale index, promise is settled already
+            if (resolver.IsEmpty()) {
+                break;
+            }
+
             resolver->Reject(unpacked);
-            iv8_->RunMicrotasks();
+            ++settled;
         }
             break;
+        case ThreadMessage::Type::FUNCTION_CALL_BATCH:
+            RunCallBatch(context, message);
+            break;
+        case ThreadMessage::Type::FUNCTION_RETURN_BATCH:
+            settled += SettleCallBatch(message);
+            break;
+        case ThreadMessage::Type::FUNCTION_RELEASE:
+            exports_.Release(message->exported_func());
+            break;
         case ThreadMessage::Type::TIMEOUT_EVENT: {
             v8::Local<v8::Value> fnv { v8::Local<v8::Value>::New(iv8_,
                 TakeTimeoutData(message->recv_index())) };
+            if (fnv.IsEmpty()) {
+                break;
+            }
+            RT_ASSERT(fnv->IsFunction());
+            v8::Local<v8::Function> fn { v8::Local<v8::Function>::Cast(fnv) };
+            fn->Call(context->Global(), 0, nullptr);
+        }
+            break;
+        case ThreadMessage::Type::CHANNEL_DOORBELL: {
+            v8::Local<v8::Value> fnv { v8::Local<v8::Value>::New(iv8_,
+                TakeDoorbellData(message->recv_index())) };
+            if (fnv.IsEmpty()) {
+                break;
+            }
             RT_ASSERT(fnv->IsFunction());
             v8::Local<v8::Function> fn { v8::Local<v8::Function>::Cast(fnv) };
             fn->Call(context->Global(), 0, nullptr);
         }
             break;
         case ThreadMessage::Type::IRQ_RAISE: {
+            // Latency from the oldest IRQ not handled yet
+            uint64_t irq_tsc = irq_tsc_.Get();
+            if (0 != irq_tsc && irq_tsc_.CompareExchange(irq_tsc, 0) &&
+                nullptr != GLOBAL_clock()) {
+                uint64_t raised = GLOBAL_clock()->NanosFromTsc(irq_tsc);
+                uint64_t now = GLOBAL_clock()->MonotonicNanos();
+                sched_.AddIrqLatency(now > raised ? now - raised : 0);
+            }
+
             v8::Local<v8::Value> fnv { v8::Local<v8::Value>::New(iv8_,
                 GetIRQData(message->recv_index())) };
+            if (fnv.IsEmpty()) {
+                break;
+            }
             RT_ASSERT(fnv->IsFunction());
             v8::Local<v8::Function> fn { v8::Local<v8::Function>::Cast(fnv) };
             fn->Call(context->Global(), 0, nullptr);
@@ -215,30 +746,38 @@ void Thread::Run() {
             break;
         }
 
-        if (!message->reusable()) {
-            delete message;
+        if (trycatch.HasCaught()) {
+            ReportException(context, trycatch);
         }
-    }
 
-    v8::Local<v8::Value> ex = trycatch.Exception();
-    if (!ex.IsEmpty()) {
-        v8::String::Utf8Value exception_str(ex);
-        v8::Local<v8::Message> message = trycatch.Message();
-        if (message.IsEmpty()) {
-           // printf("Uncaught exception: %s\n", *exception_str);
-        } else {
-            v8::String::Utf8Value script_name(message->GetScriptResourceName());
-            int linenum = message->GetLineNumber();
-           // printf("Uncaught exception: %s:%i: %s\n", *script_name, linenum, *exception_str);
+        if (credits > 0) {
+            ethread_.get()->credits().Return(credits);
         }
 
-        v8::String::Utf8Value stack(trycatch.StackTrace());
-        if (stack.length() > 0) {
-           // printf("%s\n", *stack);
+        if (!message->reusable()) {
+            delete message;
+        }
+
+        // Continuations run once per drain unless there are
+        // many of them
+        if (settled >= microtask_budget_) {
+            iv8_->RunMicrotasks();
+            settled = 0;
         }
     }
 
-    trycatch.Reset();
+    // Handlers may have queued microtasks without settling
+    // any promise
+    iv8_->RunMicrotasks();
+
+    // Senders blocked on this mailbox can use returned credits
+    ethread_.get()->WakeCreditWaiters();
+
+    FlushCalls();
+    in_run_ = false;
+    memory_.RequestDone();
+    memory_.HandlePressure();
+    RT_TRACE_END(Trace::kCategoryMessage, "drain", messages.size());
 }
 
 } // namespace rt
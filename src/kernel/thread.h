@@ -27,51 +27,100 @@
 #include <kernel/transport.h>
 #include <kernel/v8utils.h>
 #include <kernel/native-fn.h>
+#include <kernel/isolate-memory.h>
+#include <kernel/call-batch.h>
+#include <kernel/scheduler.h>
+#include <kernel/cpu.h>
 
 namespace rt {
 
 class ThreadManager;
 class Interface;
 class EngineThread;
+class ThreadMessage;
 
 class FunctionExportData {
 public:
-    FunctionExportData(v8::Isolate* iv8, v8::Local<v8::Value> fn, size_t export_id)
-        :	fn_(std::move(v8::UniquePersistent<v8::Value>(iv8, fn))),
-            export_id_(export_id) {
-        RT_ASSERT(iv8);
-    }
+    FunctionExportData()
+        :	export_id_(0),
+            efn_(nullptr) {}
 
     FunctionExportData(FunctionExportData&& other)
         :	fn_(std::move(other.fn_)),
-            export_id_(other.export_id_) {}
+            export_id_(other.export_id_),
+            efn_(other.efn_) {}
+
+    void Set(v8::Isolate* iv8, v8::Local<v8::Value> fn,
+             size_t export_id, ExternalFunction* efn) {
+        RT_ASSERT(iv8);
+        RT_ASSERT(empty());
+        fn_.Reset(iv8, fn);
+        export_id_ = export_id;
+        efn_ = efn;
+    }
+
+    void Clear() {
+        fn_.Reset();
+        export_id_ = 0;
+        efn_ = nullptr;
+    }
 
     v8::Local<v8::Value> GetValue(v8::Isolate* iv8) const {
         v8::EscapableHandleScope scope(iv8);
         return scope.Escape(v8::Local<v8::Value>::New(iv8, fn_));
     }
 
+    bool empty() const { return 0 == export_id_; }
     size_t export_id() const { return export_id_; }
+    ExternalFunction* efn() const { return efn_; }
 private:
     v8::UniquePersistent<v8::Value> fn_;
     size_t export_id_;
+    ExternalFunction* efn_;
     DELETE_COPY_AND_ASSIGN(FunctionExportData);
 };
 
+/**
+ * Functions exported by isolate. Function exported again
+ * shares its slot and ExternalFunction (slot index is kept
+ * in a hidden value of the function). Slots are freed when
+ * the last reference is released and reused through free list
+ */
 class FunctionExports {
 public:
     FunctionExports(Thread* thread)
-        :	thread_(thread), export_id_(0) {
+        :	thread_(thread), export_id_(0), count_(0) {
         RT_ASSERT(thread);
     }
 
+    /**
+     * Export function, returned ExternalFunction has one reference
+     * added for the caller
+     */
     ExternalFunction* Add(v8::Local<v8::Value> v, ResourceHandle<EngineThread> recv);
     v8::Local<v8::Value> Get(uint32_t index, size_t export_id);
 
+    /**
+     * Release message for function arrived
+     */
+    void Release(ExternalFunction* efn);
+
+    /**
+     * Number of live exports
+     */
+    size_t count() const { return count_; }
+
+    /**
+     * Number of allocated slots
+     */
+    size_t capacity() const { return data_.size(); }
 private:
     Thread* thread_;
     SharedSTLVector<FunctionExportData> data_;
+    SharedSTLVector<uint32_t> free_;
+    v8::UniquePersistent<v8::String> key_;
     size_t export_id_;
+    size_t count_;
 };
 
 class Thread {
@@ -111,6 +160,18 @@ public:
         return exports_.Add(fn, ethread_);
     }
 
+    FunctionExports& exports() { return exports_; }
+
+    /**
+     * Function exported by this isolate, empty handle if it
+     * is not available anymore
+     */
+    v8::Local<v8::Value> GetExport(ExternalFunction* efn) {
+        RT_ASSERT(efn);
+        v8::EscapableHandleScope scope(iv8_);
+        return scope.Escape(exports_.Get(efn->index(), efn->export_id()));
+    }
+
     uint32_t AddIRQData(v8::UniquePersistent<v8::Value> v) {
         return irq_data_.Push(std::move(v));
     }
@@ -128,6 +189,17 @@ public:
         return timeout_data_.Take(index);
     }
 
+    /**
+     * Callback for a single channel doorbell
+     */
+    uint32_t AddDoorbellData(v8::UniquePersistent<v8::Value> v) {
+        return doorbell_data_.Push(std::move(v));
+    }
+
+    v8::UniquePersistent<v8::Value> TakeDoorbellData(uint32_t index) {
+        return doorbell_data_.Take(index);
+    }
+
     uint32_t AddPromise(v8::UniquePersistent<v8::Promise::Resolver> resolver) {
         return promises_.Push(std::move(resolver));
     }
@@ -146,8 +218,34 @@ public:
 
     void ResetPriority() {
         priority_.Set(1);
+        ready_tsc_.Set(0);
+    }
+
+    /**
+     * Message was pushed into mailbox of this thread. Priority
+     * counts messages since the thread was scheduled last time.
+     * Safe in IRQ context
+     */
+    void NotifyMessage(bool irq) {
+        uint64_t tsc = Cpu::ReadTimestampCounter();
+        ready_tsc_.CompareExchange(0, tsc);
+        if (irq) {
+            irq_tsc_.CompareExchange(0, tsc);
+        }
+        AddPriority(1);
     }
 
+    /**
+     * Refresh scheduler view of pending work before its
+     * decision, thread must not be running
+     */
+    void UpdateSchedState(uint64_t ticks_now);
+
+    /**
+     * Scheduling state and run/wait time of this thread
+     */
+    SchedEntity& sched() { return sched_; }
+
     void SetCallWrapper(v8::Local<v8::Function> fn) {
         RT_ASSERT(call_wrapper_.IsEmpty());
         RT_ASSERT(!fn.IsEmpty());
@@ -157,6 +255,134 @@ public:
 
     void SetTimeout(uint32_t timeout_id, uint64_t timeout_ms);
 
+    /**
+     * Longest time one mailbox drain may take, the rest of
+     * messages waits for the next turn. Microtasks run once per
+     * drain, or after this many promises were settled
+     */
+    static const uint64_t kDefaultDrainSliceNanos = 10 * 1000 * 1000;
+    static const uint32_t kDefaultMicrotaskBudget = 256;
+
+    void SetDrainLimits(uint64_t slice_nanos, uint32_t microtask_budget) {
+        RT_ASSERT(microtask_budget > 0);
+        drain_slice_nanos_ = slice_nanos;
+        microtask_budget_ = microtask_budget;
+    }
+
+    /**
+     * Longest time isolate runs JS before timer interrupt makes
+     * it yield the CPU to other threads, in the middle of a
+     * message handler if necessary. Quantum of the scheduler
+     * level thread runs on is usually shorter and ends the
+     * slice first, see MlfqScheduler::Quantum
+     */
+    static const uint64_t kDefaultTimeSliceNanos = 20 * 1000 * 1000;
+
+    void SetTimeSlice(uint64_t nanos) {
+        time_slice_.SetLength(nanos);
+    }
+
+    uint64_t time_slice_nanos() const { return time_slice_.length_nanos(); }
+
+    /**
+     * Thread used up its time slice or scheduler quantum
+     */
+    bool SliceExpired(uint64_t now_nanos) const {
+        return time_slice_.Expired(now_nanos) ||
+            MlfqScheduler::Expired(&sched_, now_nanos);
+    }
+
+    /**
+     * Timer interrupt on CPU this thread runs on. Requests V8
+     * interrupt if thread used up its time slice, isolate yields
+     * from interrupt callback at the next safe point. Inert for
+     * now, engine thread managers don't run while Engines::Startup
+     * is disabled, boot isolate is not preempted
+     */
+    void TimerTick(uint64_t now_nanos) {
+        if (!in_run_ || !SliceExpired(now_nanos)) {
+            return;
+        }
+        iv8_->RequestInterruptFromIrq(PreemptCallback, this);
+    }
+
+    /**
+     * Thread can't continue on its stack (fatal V8 error), it is
+     * removed from the scheduler and never runs again. Doesn't return
+     */
+    void Park();
+
+    bool parked() const { return parked_; }
+
+    /**
+     * Number of times isolate was preempted by timer
+     */
+    uint64_t preemptions() const { return preemptions_; }
+
+    /**
+     * Function called with every exception not caught by
+     * message handlers
+     */
+    void SetExceptionHandler(v8::Local<v8::Function> fn) {
+        RT_ASSERT(!fn.IsEmpty());
+        exception_handler_.Reset(iv8_, fn);
+    }
+
+    uint64_t uncaught_exceptions() const { return uncaught_exceptions_; }
+
+    /**
+     * Queue batched call to function exported by another isolate.
+     * Calls to the same isolate made during current event loop
+     * turn are sent together as one message when turn ends.
+     * Batch is sent early once it has more calls than this
+     * isolate may keep waiting
+     */
+    void QueueCall(ExternalFunction* efn, TransportData data,
+                   uint32_t promise_index, size_t calls);
+
+    /**
+     * Calls this isolate may keep waiting for receivers which
+     * ran out of credits, calls over the limit are rejected
+     */
+    static const size_t kDefaultPendingCalls = 4096;
+
+    /**
+     * Set credits of this isolate mailbox and limit of
+     * calls it keeps waiting
+     */
+    void SetMailboxLimits(uint32_t capacity, size_t pending_calls);
+
+    /**
+     * Push call message to receiver mailbox if it has credits
+     * for it, keep it otherwise. Calls are sent in order
+     */
+    void SendCall(ResourceHandle<EngineThread> recv,
+                  std::unique_ptr<ThreadMessage> message);
+
+    /**
+     * Too many calls are waiting, new ones should be rejected
+     */
+    bool CallsOverLimit() const {
+        return deferred_calls_ >= max_pending_calls_;
+    }
+
+    void AddRejectedCall() { ++rejected_calls_; }
+
+    size_t deferred_calls() const { return deferred_calls_; }
+    size_t max_pending_calls() const { return max_pending_calls_; }
+    uint64_t rejected_calls() const { return rejected_calls_; }
+
+    /**
+     * Virtual memory reserved and committed by isolate heap
+     */
+    VmAccount& vm_account() { return vm_account_; }
+
+    /**
+     * Isolate memory budget and accounting, limits must be
+     * set before Init
+     */
+    IsolateMemory& memory() { return memory_; }
+
     v8::Local<v8::Value> args() const {
         v8::EscapableHandleScope scope(iv8_);
         if (args_.IsEmpty()) {
@@ -167,10 +393,73 @@ public:
     }
 
     /**
-     * Thread state storage required for stack switch
+     * Thread state storage required for stack switch (general
+     * registers and FPU state, see Fpu::AllocState)
      */
-    uint8_t _fxstate[1024] alignas(16);
+    void* _fxstate;
 private:
+    /**
+     * Mailbox is empty, let V8 use the time for GC
+     */
+    void Idle(uint64_t ticks_now);
+
+    struct DeferredCall {
+        ResourceHandle<EngineThread> recv;
+        ThreadMessage* message;
+        uint32_t credits;
+    };
+
+    /**
+     * Send batches queued during this turn, one message
+     * per receiver
+     */
+    void FlushCalls();
+
+    /**
+     * Send one queued batch, takes over the batch
+     */
+    void SendBatch(CallBatch* batch);
+
+    /**
+     * Take receiver credits for a call, or ask receiver to
+     * notify this thread when it returns some
+     */
+    bool TakeCredits(ResourceHandle<EngineThread> recv, uint32_t credits);
+
+    /**
+     * Send calls which waited for credits. Calls to receiver
+     * which is still over budget keep waiting in order
+     */
+    void RetryDeferredCalls();
+
+    /**
+     * Run batch of calls and reply with their results
+     */
+    void RunCallBatch(v8::Local<v8::Context> context, ThreadMessage* message);
+
+    /**
+     * Settle promises of a batch reply, returns number
+     * of promises settled
+     */
+    size_t SettleCallBatch(ThreadMessage* message);
+
+    /**
+     * Message handler threw exception
+     */
+    void ReportException(v8::Local<v8::Context> context, v8::TryCatch& trycatch);
+
+    /**
+     * Drain started at this time used up its slice
+     */
+    bool SliceElapsed(uint64_t start_nanos) const;
+
+    /**
+     * V8 interrupt requested by TimerTick, switch to another
+     * thread and continue when scheduled again
+     */
+    static void PreemptCallback(v8::Isolate* iv8, void* data);
+    void YieldTimeSlice();
+
     ThreadManager* thread_mgr_;
     v8::Isolate* iv8_;
     TemplateCache* tpl_cache_;
@@ -179,16 +468,35 @@ private:
     v8::UniquePersistent<v8::Context> context_;
     v8::UniquePersistent<v8::Value> args_;
     v8::UniquePersistent<v8::Function> call_wrapper_;
+    v8::UniquePersistent<v8::Function> exception_handler_;
 
     VirtualStack stack_;
     Atomic<uint32_t> priority_;
+    Atomic<uint64_t> ready_tsc_;
+    Atomic<uint64_t> irq_tsc_;
+    SchedEntity sched_;
+    VmAccount vm_account_;
+    IsolateMemory memory_;
 
     ResourceHandle<EngineThread> ethread_;
     FunctionExports exports_;
     Timeouts<uint32_t> timeouts_;
+    SharedSTLVector<CallBatch*> outgoing_calls_;
+    SharedSTLVector<DeferredCall> deferred_;
+    size_t deferred_calls_;
+    size_t max_pending_calls_;
+    uint64_t rejected_calls_;
+    uint64_t drain_slice_nanos_;
+    uint32_t microtask_budget_;
+    TimeSlice time_slice_;
+    volatile bool in_run_;
+    volatile bool parked_;
+    uint64_t preemptions_;
+    uint64_t uncaught_exceptions_;
 
     UniquePersistentIndexedPool<v8::Value> timeout_data_;
     UniquePersistentIndexedPool<v8::Value> irq_data_;
+    UniquePersistentIndexedPool<v8::Value> doorbell_data_;
     UniquePersistentIndexedPool<v8::Promise::Resolver> promises_;
 };
 
@@ -17,6 +17,7 @@
 #include <vector>
 #include <kernel/kernel.h>
 #include <queue>
+#include <limits>
 #include <stdio.h>
 
 namespace rt {
@@ -68,6 +69,16 @@ public:
         return (ticks_now >= top.time());
     }
 
+    /**
+     * Time of the nearest timeout, max value if there are none
+     */
+    uint64_t NextTime() const {
+        if (queue_.empty()) {
+            return std::numeric_limits<uint64_t>::max();
+        }
+        return queue_.top().time();
+    }
+
     T Take() {
         const TimeoutItem<T> top = queue_.top();
         queue_.pop();
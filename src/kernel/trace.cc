@@ -13,11 +13,272 @@
 // limitations under the License.
 
 #include "trace.h"
+#include <kernel/platform.h>
+#include <kernel/clock.h>
+#include <kernel/boot-services.h>
+#include <printf.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 namespace rt {
 
-TraceScope::TraceScope(const char* func, const char* file, int line) {}
-TraceScope::~TraceScope() {}
+namespace {
+
+/**
+ * Collects small pieces of output and passes them to
+ * trace writer in large chunks
+ */
+class ChunkWriter {
+public:
+    ChunkWriter(TraceWriter writer, void* data)
+        :	writer_(writer),
+            data_(data),
+            len_(0) { }
+
+    ~ChunkWriter() {
+        Flush();
+    }
+
+    void Append(const char* data, size_t len) {
+        if (len_ + len > sizeof(buf_)) {
+            Flush();
+        }
+        if (len > sizeof(buf_)) {
+            writer_(data_, data, len);
+            return;
+        }
+        memcpy(buf_ + len_, data, len);
+        len_ += len;
+    }
+
+    void Append(const char* str) {
+        Append(str, strlen(str));
+    }
+
+    /**
+     * Append JSON string contents
+     */
+    void AppendEscaped(const char* str) {
+        if (nullptr == str) {
+            return;
+        }
+        for (const char* p = str; *p; ++p) {
+            char c = *p;
+            if ('"' == c || '\\' == c) {
+                Append("\\", 1);
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                continue;
+            }
+            Append(&c, 1);
+        }
+    }
+
+    void Flush() {
+        if (0 == len_) {
+            return;
+        }
+        writer_(data_, buf_, len_);
+        len_ = 0;
+    }
+private:
+    TraceWriter writer_;
+    void* data_;
+    char buf_[4096];
+    size_t len_;
+};
+
+void WriteSerial(void* data, const char* buf, size_t len) {
+    GLOBAL_boot_services()->logger()->WriteSerial(buf, len);
+}
+
+} // namespace
+
+TraceScope::TraceScope(const char* func, const char* file, int line)
+    :	func_(func),
+        file_(file),
+        line_(line) {
+    Trace* trace = GLOBAL_trace();
+    if (nullptr != trace) {
+        trace->Record(TracePhase::BEGIN, Trace::kCategoryScope,
+                      func_, file_, line_, 0);
+    }
+}
+
+TraceScope::~TraceScope() {
+    Trace* trace = GLOBAL_trace();
+    if (nullptr != trace) {
+        trace->Record(TracePhase::END, Trace::kCategoryScope,
+                      func_, file_, line_, 0);
+    }
+}
+
+Trace::Trace()
+    :	categories_(0),
+        cpus_count_(0) {
+    memset(cpus_, 0, sizeof(cpus_));
+}
+
+Trace::~Trace() {
+    Stop();
+    for (uint32_t i = 0; i < kMaxCpus; ++i) {
+        free(cpus_[i].events);
+    }
+}
+
+bool Trace::Start(uint32_t categories) {
+    Stop();
+
+    uint32_t count = 1;
+    if (nullptr != GLOBAL_platform()) {
+        count = GLOBAL_platform()->cpu_count();
+    }
+    if (count > kMaxCpus) {
+        count = kMaxCpus;
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+        if (nullptr == cpus_[i].events) {
+            cpus_[i].events = static_cast<TraceEvent*>(
+                malloc(sizeof(TraceEvent) * kEventsPerCpu));
+            if (nullptr == cpus_[i].events) {
+                return false;
+            }
+
+            // Touch all pages now, page fault tracepoint must not
+            // fault on the buffer it writes to
+            memset(cpus_[i].events, 0, sizeof(TraceEvent) * kEventsPerCpu);
+        }
+        __atomic_store_n(&cpus_[i].head, 0, __ATOMIC_SEQ_CST);
+    }
+
+    if (count > cpus_count_) {
+        cpus_count_ = count;
+    }
+
+    __atomic_store_n(&categories_, categories, __ATOMIC_SEQ_CST);
+    return true;
+}
+
+void Trace::Stop() {
+    __atomic_store_n(&categories_, 0, __ATOMIC_SEQ_CST);
+}
+
+void Trace::SetIsolate(void* isolate) {
+    uint32_t cpu = Cpu::id();
+    if (cpu < kMaxCpus) {
+        cpus_[cpu].isolate = reinterpret_cast<uintptr_t>(isolate);
+    }
+}
+
+void Trace::RecordEvent(TracePhase phase, uint32_t category, const char* name,
+                        const char* file, uint32_t line, uint64_t arg) {
+    uint32_t cpu = Cpu::id();
+    if (cpu >= cpus_count_) {
+        return;
+    }
+
+    CpuBuffer& buffer = cpus_[cpu];
+
+    // Only this CPU writes into its buffer, but interrupt handler
+    // could record an event in the middle of this one
+    uint64_t index = __atomic_fetch_add(&buffer.head, 1, __ATOMIC_RELAXED);
+    TraceEvent& event = buffer.events[index & (kEventsPerCpu - 1)];
+
+    event.tsc = Cpu::ReadTimestampCounter();
+    event.name = name;
+    event.file = file;
+    event.isolate = buffer.isolate;
+    event.arg = arg;
+    event.line = line;
+    event.cpu = cpu;
+    event.phase = phase;
+    // Event stores category bit index
+    RT_ASSERT(0 != category && 0 == (category & (category - 1)));
+    event.category = __builtin_ctz(category);
+}
+
+size_t Trace::events_count() const {
+    size_t count = 0;
+    for (uint32_t cpu = 0; cpu < cpus_count_; ++cpu) {
+        uint64_t head = __atomic_load_n(&cpus_[cpu].head, __ATOMIC_SEQ_CST);
+        count += head < kEventsPerCpu ? head : kEventsPerCpu;
+    }
+    return count;
+}
+
+uint64_t Trace::overwritten() const {
+    uint64_t count = 0;
+    for (uint32_t cpu = 0; cpu < cpus_count_; ++cpu) {
+        uint64_t head = __atomic_load_n(&cpus_[cpu].head, __ATOMIC_SEQ_CST);
+        if (head > kEventsPerCpu) {
+            count += head - kEventsPerCpu;
+        }
+    }
+    return count;
+}
+
+const char* Trace::CategoryName(uint32_t category) {
+    switch (category) {
+    case kCategoryScope:
+        return "scope";
+    case kCategorySched:
+        return "sched";
+    case kCategoryIrq:
+        return "irq";
+    case kCategoryPageFault:
+        return "pagefault";
+    case kCategoryMessage:
+        return "message";
+    case kCategoryGC:
+        return "gc";
+    default:
+        return "other";
+    }
+}
+
+size_t Trace::ExportChromeJson(TraceWriter writer, void* data) const {
+    RT_ASSERT(writer);
+    ChunkWriter out(writer, data);
+    size_t written = 0;
+
+    out.Append("{\"traceEvents\":[");
+    for (uint32_t cpu = 0; cpu < cpus_count_; ++cpu) {
+        const CpuBuffer& buffer = cpus_[cpu];
+        uint64_t head = __atomic_load_n(&buffer.head, __ATOMIC_SEQ_CST);
+        uint64_t first = head > kEventsPerCpu ? head - kEventsPerCpu : 0;
+
+        for (uint64_t i = first; i < head; ++i) {
+            const TraceEvent& event = buffer.events[i & (kEventsPerCpu - 1)];
+            const char* ph = "i";
+            if (TracePhase::BEGIN == event.phase) ph = "B";
+            if (TracePhase::END == event.phase) ph = "E";
+
+            uint64_t ns = GLOBAL_clock()->NanosFromTsc(event.tsc);
+            char line[256];
+
+            out.Append(0 == written ? "\n{\"name\":\"" : ",\n{\"name\":\"");
+            out.AppendEscaped(event.name);
+            out.Append("\",\"cat\":\"");
+            out.Append(CategoryName(1 << event.category));
+            int len = tfp_snprintf(line, sizeof(line),
+                "\",\"ph\":\"%s\",%s\"ts\":%lu.%03lu,\"pid\":%lu,\"tid\":%u,"
+                "\"args\":{\"line\":%u,\"arg\":%lu,\"file\":\"",
+                ph, TracePhase::INSTANT == event.phase ? "\"s\":\"t\"," : "",
+                ns / 1000, ns % 1000, event.isolate, event.cpu,
+                event.line, event.arg);
+            out.Append(line, len);
+            out.AppendEscaped(event.file);
+            out.Append("\"}}");
+            ++written;
+        }
+    }
+    out.Append("\n],\"displayTimeUnit\":\"ns\"}\n");
+    return written;
+}
+
+size_t Trace::DumpChromeJson() const {
+    return ExportChromeJson(&WriteSerial, nullptr);
+}
 
 } // namespace rt
@@ -15,16 +15,147 @@
 #pragma once
 
 #include <kernel/kernel.h>
+#include <kernel/cpu.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define RT_TRACE_EVENT(PHASE, CATEGORY, NAME, ARG)                            \
+    do {                                                                      \
+        static_assert(0 != (CATEGORY) && 0 == ((CATEGORY) & ((CATEGORY) - 1)), \
+                      "trace event category must be a single bit");           \
+        rt::Trace* rt_trace_ = GLOBAL_trace();                                \
+        if (nullptr != rt_trace_) {                                           \
+            rt_trace_->Record(PHASE, CATEGORY, NAME, __FILE__, __LINE__, ARG); \
+        }                                                                     \
+    } while (0)
+
+#define RT_TRACE_BEGIN(CATEGORY, NAME, ARG)                                   \
+    RT_TRACE_EVENT(rt::TracePhase::BEGIN, CATEGORY, NAME, ARG)
+
+#define RT_TRACE_END(CATEGORY, NAME, ARG)                                     \
+    RT_TRACE_EVENT(rt::TracePhase::END, CATEGORY, NAME, ARG)
+
+#define RT_TRACE_INSTANT(CATEGORY, NAME, ARG)                                 \
+    RT_TRACE_EVENT(rt::TracePhase::INSTANT, CATEGORY, NAME, ARG)
 
 namespace rt {
 
+enum class TracePhase : uint8_t {
+    BEGIN,
+    END,
+    INSTANT
+};
+
+/**
+ * Single trace record, name and file must be static strings
+ */
+struct TraceEvent {
+    uint64_t tsc;
+    const char* name;
+    const char* file;
+    uintptr_t isolate;
+    uint64_t arg;
+    uint32_t line;
+    uint16_t cpu;
+    TracePhase phase;
+    uint8_t category;
+};
+
+/**
+ * Output callback for trace export
+ */
+typedef void (*TraceWriter)(void* data, const char* buf, size_t len);
+
+/**
+ * Kernel tracing. Events are stamped with TSC and appended to
+ * the current CPU ring buffer without locks, old events are
+ * overwritten. Disabled categories cost a single load and branch.
+ */
 class Trace {
 public:
-    Trace() {}
+    static const uint32_t kMaxCpus = 32;
+    static const size_t kEventsPerCpu = 16384;
+
+    static const uint32_t kCategoryScope = 1 << 0;
+    static const uint32_t kCategorySched = 1 << 1;
+    static const uint32_t kCategoryIrq = 1 << 2;
+    static const uint32_t kCategoryPageFault = 1 << 3;
+    static const uint32_t kCategoryMessage = 1 << 4;
+    static const uint32_t kCategoryGC = 1 << 5;
+    static const uint32_t kCategoryAll = (1 << 6) - 1;
+
+    Trace();
+    ~Trace();
+
+    /**
+     * Enable categories and clear buffers. Allocates buffers on
+     * first call (requires malloc)
+     */
+    bool Start(uint32_t categories);
+
+    /**
+     * Disable all categories, recorded events are kept
+     */
+    void Stop();
+
+    bool enabled(uint32_t category) const {
+        return 0 != (categories_ & category);
+    }
+
+    uint32_t categories() const { return categories_; }
+
+    inline void Record(TracePhase phase, uint32_t category, const char* name,
+                       const char* file, uint32_t line, uint64_t arg) {
+        if (enabled(category)) {
+            RecordEvent(phase, category, name, file, line, arg);
+        }
+    }
+
+    /**
+     * Set isolate which runs on current CPU, recorded with
+     * every event on this CPU
+     */
+    void SetIsolate(void* isolate);
+
+    /**
+     * Number of events currently stored in buffers
+     */
+    size_t events_count() const;
+
+    /**
+     * Number of events lost because ring buffer wrapped
+     */
+    uint64_t overwritten() const;
+
+    /**
+     * Write stored events in Chrome trace event JSON format,
+     * returns number of events written
+     */
+    size_t ExportChromeJson(TraceWriter writer, void* data) const;
+
+    /**
+     * Write Chrome trace event JSON to serial port
+     */
+    size_t DumpChromeJson() const;
+
+    /**
+     * Category name used in exported trace
+     */
+    static const char* CategoryName(uint32_t category);
 private:
+    struct CpuBuffer {
+        TraceEvent* events;
+        uint64_t head;
+        uintptr_t isolate;
+    };
+
+    void RecordEvent(TracePhase phase, uint32_t category, const char* name,
+                     const char* file, uint32_t line, uint64_t arg);
+
+    volatile uint32_t categories_;
+    uint32_t cpus_count_;
+    CpuBuffer cpus_[kMaxCpus];
     DELETE_COPY_AND_ASSIGN(Trace);
 };
 
 } // namespace rt
-
-
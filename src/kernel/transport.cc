@@ -17,6 +17,7 @@
 #include <kernel/object-wrapper.h>
 #include <kernel/thread.h>
 #include <kernel/native-object.h>
+#include <kernel/isolate-memory.h>
 
 namespace rt {
 
@@ -70,6 +71,31 @@ v8::Local<v8::Value> TransportData::GetRef(v8::Isolate* iv8, uint32_t index) con
     return scope.Escape(v8::Local<v8::Value>::New(iv8, refs_[index]));
 }
 
+void TransportData::AppendFunction(ExternalFunction* efn) {
+    RT_ASSERT(efn);
+    efn->AddRef();
+    functions_.push_back(efn);
+    AppendType(Type::FUNCTION);
+    stream_.AppendValue<ExternalFunction*>(efn);
+}
+
+void TransportData::ReleaseReferences() {
+    for (ExternalFunction* efn : functions_) {
+        efn->Release();
+    }
+    functions_.clear();
+
+    for (Channel* channel : channels_) {
+        channel->Release();
+    }
+    channels_.clear();
+
+    for (BackingStore* store : buffers_) {
+        store->Release();
+    }
+    buffers_.clear();
+}
+
 uint32_t TransportData::AddRef(v8::Local<v8::Value> value) {
     RT_ASSERT(allow_ref_);
     RT_ASSERT(thread_);
@@ -143,17 +169,38 @@ TransportData::SerializeError TransportData::SerializeValue(Thread* exporter,
     }
 
     if (value->IsArrayBuffer()) {
-        // Neuter this array buffer and take its contents
-        AppendType(Type::ARRAYBUFFER);
+        // Neuter this array buffer and take its store, data is
+        // not copied
         v8::Local<v8::ArrayBuffer> b { v8::Local<v8::ArrayBuffer>::Cast(value) };
+        BackingStore* store { nullptr };
         if (b->IsExternal()) {
-            return SerializeError::EXTERNAL_BUFFER;
+            // Only device memory mappings have a store
+            store = ExternalBufferRef::GetStore(b);
+            if (nullptr == store) {
+                return SerializeError::EXTERNAL_BUFFER;
+            }
+            store->AddRef();
+        } else {
+            v8::ArrayBuffer::Contents c { b->Externalize() };
+
+            // Empty buffers have no store
+            if (nullptr != c.Data()) {
+                // Reference of V8 buffer now belongs to this data
+                store = BackingStore::FromData(c.Data(), c.ByteLength());
+                RT_ASSERT(thread_);
+                IsolateMemory* memory { IsolateMemory::FromIsolate(thread_->IsolateV8()) };
+                if (nullptr != memory) {
+                    memory->ReleaseArrayBuffer(c.ByteLength());
+                }
+            }
         }
-        v8::ArrayBuffer::Contents c { b->Externalize() };
-        stream_.AppendValue<void*>(c.Data());
-        stream_.AppendValue<size_t>(c.ByteLength());
         b->Neuter();
 
+        if (nullptr != store) {
+            buffers_.push_back(store);
+        }
+        AppendType(Type::ARRAYBUFFER);
+        stream_.AppendValue<BackingStore*>(store);
         return SerializeError::NONE;
     }
 
@@ -162,7 +209,9 @@ TransportData::SerializeError TransportData::SerializeValue(Thread* exporter,
     }
 
     if (value->IsFunction()) {
+        // Export holds a reference for this data already
         ExternalFunction* efn { exporter->AddExport(value) };
+        functions_.push_back(efn);
         AppendType(Type::FUNCTION);
         stream_.AppendValue<ExternalFunction*>(efn);
         return SerializeError::NONE;
@@ -198,8 +247,27 @@ TransportData::SerializeError TransportData::SerializeValue(Thread* exporter,
             switch (ptr->type_id()) {
             case NativeTypeId::TYPEID_FUNCTION: {
                 ExternalFunction* efn { static_cast<ExternalFunction*>(ptr) };
-                AppendType(Type::FUNCTION);
-                stream_.AppendValue<ExternalFunction*>(efn);
+                AppendFunction(efn);
+                return SerializeError::NONE;
+            }
+            case NativeTypeId::TYPEID_CHANNEL: {
+                // Passed by reference within isolate
+                if (allow_ref_) {
+                    break;
+                }
+
+                ChannelObject* endpoint { static_cast<ChannelObject*>(ptr) };
+                if (endpoint->detached()) {
+                    return SerializeError::CHANNEL_DETACHED;
+                }
+
+                endpoint->Detach();
+                Channel* channel { endpoint->channel() };
+                channel->AddRef();
+                channels_.push_back(channel);
+                AppendType(Type::CHANNEL);
+                stream_.AppendValue<Channel*>(channel);
+                stream_.AppendValue<uint8_t>(static_cast<uint8_t>(endpoint->side()));
                 return SerializeError::NONE;
             }
             default:
@@ -294,9 +362,24 @@ v8::Local<v8::Value> TransportData::UnpackValue(Thread* thread, ByteStreamReader
     case Type::BOOL_FALSE:
         return scope.Escape<v8::Primitive>(v8::False(iv8));
     case Type::ARRAYBUFFER: {
-        void* buf = reader.ReadValue<void*>();
-        size_t len = reader.ReadValue<size_t>();
-        return scope.Escape(v8::ArrayBuffer::NewNonExternal(iv8, buf, len));
+        BackingStore* store = reader.ReadValue<BackingStore*>();
+        if (nullptr == store) {
+            return scope.Escape(v8::ArrayBuffer::New(iv8, 0));
+        }
+
+        // New buffer takes its own reference
+        store->AddRef();
+        if (BackingStore::Kind::DEVICE == store->kind()) {
+            return scope.Escape(ExternalBufferRef::NewBuffer(iv8, store));
+        }
+
+        // Released by allocator when buffer is collected
+        IsolateMemory* memory { IsolateMemory::FromIsolate(iv8) };
+        if (nullptr != memory) {
+            memory->AdoptArrayBuffer(store->length());
+        }
+        return scope.Escape(v8::ArrayBuffer::NewNonExternal(iv8,
+            store->data(), store->length()));
     }
     case Type::ARRAY: {
         uint32_t len = reader.ReadValue<uint32_t>();
@@ -322,6 +405,13 @@ v8::Local<v8::Value> TransportData::UnpackValue(Thread* thread, ByteStreamReader
         v8::Local<v8::Value> fnobj { thread->template_cache()->NewWrappedFunction(efn) };
         return scope.Escape(fnobj);
     }
+    case Type::CHANNEL: {
+        Channel* channel = reader.ReadValue<Channel*>();
+        Channel::Side side = static_cast<Channel::Side>(reader.ReadValue<uint8_t>());
+        RT_ASSERT(thread->template_cache());
+        return scope.Escape((new ChannelObject(thread->template_cache(),
+            channel, side))->GetInstance());
+    }
     case Type::ERROR_OBJ: {
         v8::Local<v8::Value> v { UnpackValue(thread, reader) };
         return scope.Escape(v8::Exception::Error(v->ToString()));
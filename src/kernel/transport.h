@@ -20,94 +20,14 @@
 #include <common/constants.h>
 #include <kernel/vector.h>
 #include <kernel/resource.h>
+#include <kernel/byte-stream.h>
 
 namespace rt {
 
 class Isolate;
-
-/**
- * Dynamic size contiguous byte array for mixed data
- */
-class ByteStream {
-    friend class ByteStreamReader;
-public:
-    ByteStream() {}
-
-    ByteStream(ByteStream&& other)
-        :	data_(std::move(other.data_)) {}
-
-    /**
-     * Memcpy value into stream
-     */
-    template<typename T>
-    void AppendValue(T value) {
-        size_t size = data_.size();
-        size_t valsize = sizeof(T);
-        data_.resize(size + valsize);
-        T* p = reinterpret_cast<T*>(data_.data() + size);
-        memcpy(p, &value, valsize);
-    }
-
-    /**
-     * Clear stream
-     */
-    void Clear() {
-        data_.clear();
-    }
-
-    /**
-     * Allocate uninitialized space on the stream. Returns pointer
-     * to first element.
-     */
-    void* AppendBuffer(uint32_t len) {
-        size_t size = data_.size();
-        data_.resize(size + len);
-        return data_.data() + size;
-    }
-
-private:
-    SharedSTLVector<uint8_t> data_;
-    DELETE_COPY_AND_ASSIGN(ByteStream);
-};
-
-/**
- * Provides read functionality for ByteStream object
- */
-class ByteStreamReader {
-public:
-    ByteStreamReader(const ByteStream& stream)
-        :	stream_(stream), pos_(0) {}
-
-    /**
-     * Copy value from stream. Moves read position sizeof(T)
-     * elements forward.
-     */
-    template<typename T>
-    T ReadValue() {
-        size_t valsize = sizeof(T);
-        RT_ASSERT(pos_ + valsize <= stream_.data_.size());
-        const void* p = stream_.data_.data() + pos_;
-        T ret;
-        memcpy(&ret, p, valsize);
-        pos_ += valsize;
-        return ret;
-    }
-
-    /**
-     * Returns pointer to current stream position. Moves
-     * read position "len" elements forward.
-     */
-    const void* ReadBuffer(uint32_t len) {
-        RT_ASSERT(pos_ + len <= stream_.data_.size());
-        const void* p = stream_.data_.data() + pos_;
-        pos_ += len;
-        return p;
-    }
-
-private:
-    const ByteStream& stream_;
-    size_t pos_;
-};
+class ExternalFunction;
+class Channel;
+class BackingStore;
 
 /**
  * Serialized data to be transferred between contexts or isolates
@@ -120,6 +40,7 @@ public:
         INVALID_TYPE,
         EXTERNAL_BUFFER,
         TYPEDARRAY_VIEW,
+        CHANNEL_DETACHED,
     };
 
     /**
@@ -206,7 +127,14 @@ public:
             allow_ref_(other.allow_ref_),
             err_(other.err_),
             stream_(std::move(other.stream_)),
-            refs_(std::move(other.refs_)) {}
+            refs_(std::move(other.refs_)),
+            functions_(std::move(other.functions_)),
+            channels_(std::move(other.channels_)),
+            buffers_(std::move(other.buffers_)) {}
+
+    ~TransportData() {
+        ReleaseReferences();
+    }
 
     /**
      * Deserialize data to V8 value
@@ -238,7 +166,7 @@ public:
             iv8->ThrowException(
                 v8::Exception::Error(
                 v8::String::NewFromUtf8(iv8,
-                "ArrayBuffer have already transferred")));
+                "ArrayBuffer have already transferred or can't be transferred")));
             return true;
         case SerializeError::TYPEDARRAY_VIEW:
             iv8->ThrowException(
@@ -246,6 +174,12 @@ public:
                 v8::String::NewFromUtf8(iv8,
                 "ArrayBufferView can't be transferred, use .buffer to get referenced buffer")));
             return true;
+        case SerializeError::CHANNEL_DETACHED:
+            iv8->ThrowException(
+                v8::Exception::Error(
+                v8::String::NewFromUtf8(iv8,
+                "Channel endpoint have already transferred")));
+            return true;
         default:
             RT_ASSERT(!"unknown serializer error");
             return true;
@@ -272,6 +206,7 @@ private:
         FUNCTION,
         ERROR_OBJ,
         RESOURCES_FN,
+        CHANNEL,
     };
 
     void Clear() {
@@ -279,8 +214,17 @@ private:
         err_ = SerializeError::NONE;
         allow_ref_ = false;
         stream_.Clear();
+        ReleaseReferences();
     }
 
+    /**
+     * Serialized functions, channels and buffer stores are referenced
+     * until data is destroyed, receiver objects take their own
+     * references
+     */
+    void AppendFunction(ExternalFunction* efn);
+    void ReleaseReferences();
+
     SerializeError SerializeValue(Thread* exporter, v8::Local<v8::Value> value, uint32_t stack_level);
     v8::Local<v8::Value> UnpackValue(Thread* thread, ByteStreamReader& reader) const;
 
@@ -302,6 +246,9 @@ private:
     SerializeError err_;
     ByteStream stream_;
     SharedSTLVector<v8::UniquePersistent<v8::Value>> refs_;
+    SharedSTLVector<ExternalFunction*> functions_;
+    SharedSTLVector<Channel*> channels_;
+    SharedSTLVector<BackingStore*> buffers_;
 
     DELETE_COPY_AND_ASSIGN(TransportData);
 };
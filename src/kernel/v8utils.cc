@@ -13,10 +13,62 @@
 // limitations under the License.
 
 #include "v8utils.h"
+#include <kernel/trace.h>
 #include <EASTL/string.h>
 
 namespace rt {
 
+/**
+ * External string resource for read-only memory that is never freed
+ */
+class StaticStringResource : public v8::String::ExternalOneByteStringResource {
+public:
+    StaticStringResource(const char* data, size_t len)
+        :	data_(data),
+            len_(len) { }
+    const char* data() const { return data_; }
+    size_t length() const { return len_; }
+private:
+    const char* data_;
+    size_t len_;
+    DELETE_COPY_AND_ASSIGN(StaticStringResource);
+};
+
+v8::Local<v8::String> V8Utils::StaticString(v8::Isolate* iv8,
+        const char* data, size_t len) {
+    RT_ASSERT(iv8);
+    RT_ASSERT(data);
+
+    for (size_t i = 0; i < len; ++i) {
+        if (static_cast<uint8_t>(data[i]) >= 0x80) {
+            return v8::String::NewFromUtf8(iv8, data,
+                v8::String::kNormalString, len);
+        }
+    }
+
+    return v8::String::NewExternal(iv8, new StaticStringResource(data, len));
+}
+
+static const char* GCTraceName(v8::GCType type) {
+    return v8::kGCTypeScavenge == type ? "scavenge" : "mark-sweep";
+}
+
+static void TraceGCPrologue(v8::Isolate* iv8, v8::GCType type,
+                            v8::GCCallbackFlags flags) {
+    RT_TRACE_BEGIN(Trace::kCategoryGC, GCTraceName(type), flags);
+}
+
+static void TraceGCEpilogue(v8::Isolate* iv8, v8::GCType type,
+                            v8::GCCallbackFlags flags) {
+    RT_TRACE_END(Trace::kCategoryGC, GCTraceName(type), flags);
+}
+
+void V8Utils::AddTraceGCCallbacks(v8::Isolate* iv8) {
+    RT_ASSERT(iv8);
+    iv8->AddGCPrologueCallback(TraceGCPrologue);
+    iv8->AddGCEpilogueCallback(TraceGCEpilogue);
+}
+
 SharedString V8Utils::ToSharedString(const v8::Local<v8::String> str) {
     RT_ASSERT(!str.IsEmpty());
     RT_ASSERT(str->IsString());
@@ -17,6 +17,7 @@
 #include <kernel/kernel.h>
 #include <kernel/string.h>
 #include <kernel/vector.h>
+#include <kernel/indexed-pool.h>
 #include <v8.h>
 
 #define NATIVE_FUNCTION(TypeName, FuncName) 									\
@@ -98,12 +99,26 @@ public:
 
     static SharedString ToSharedString(const v8::Local<v8::String> str);
 
+    /**
+     * Create string which points directly to the provided memory
+     * without copying, memory must stay alive while system is running
+     * (e.g. initrd contents). Non-ASCII data is copied into V8 heap
+     * as UTF-8 instead.
+     */
+    static v8::Local<v8::String> StaticString(v8::Isolate* iv8,
+            const char* data, size_t len);
+
     inline static v8::Local<v8::String> FromString(v8::Isolate* iv8, String str) {
         v8::EscapableHandleScope scope(iv8);
         return scope.Escape(v8::String::NewFromUtf8(iv8, str.Data(),
                 v8::String::kNormalString, str.Length()));
     }
 
+    /**
+     * Record isolate garbage collections as GC trace events
+     */
+    static void AddTraceGCCallbacks(v8::Isolate* iv8);
+
     inline static Thread* GetThread(const v8::FunctionCallbackInfo<v8::Value>& args) {
         return reinterpret_cast<Thread*>(args.GetIsolate()->GetData(0));
     }
@@ -179,38 +194,33 @@ public:
 
 /**
  * Random access array for unique persistent handles
- * O(n) insert, O(1) remove, O(1) lookup
+ * O(1) insert, O(1) remove, O(1) lookup. Stale indexes
+ * find empty handles (see IndexedPool)
  */
 template<typename T>
 class UniquePersistentIndexedPool {
 public:
     uint32_t Push(v8::UniquePersistent<T> value) {
-        for (uint32_t i = 0; i < data_.size(); ++i) {
-            if (data_[i].IsEmpty()) {
-                data_[i] = std::move(value);
-                return i;
-            }
-        }
-
-        uint32_t index = data_.size();
-        data_.push_back(std::move(value));
-        return index;
+        return pool_.Push(std::move(value));
     }
 
     v8::UniquePersistent<T> Take(uint32_t index) {
-        RT_ASSERT(index < data_.size());
-        return std::move(data_[index]);
+        return pool_.Take(index);
     }
 
     v8::Local<T> GetLocal(v8::Isolate* iv8, uint32_t index) const {
-        RT_ASSERT(index < data_.size());
         RT_ASSERT(iv8);
         v8::EscapableHandleScope scope(iv8);
-        return scope.Escape<T>(v8::Local<T>::New(iv8, data_[index]));
+        const v8::UniquePersistent<T>* value { pool_.Get(index) };
+        if (nullptr == value) {
+            return scope.Escape(v8::Local<T>());
+        }
+        return scope.Escape<T>(v8::Local<T>::New(iv8, *value));
     }
 
+    uint32_t count() const { return pool_.count(); }
 private:
-    SharedSTLVector<v8::UniquePersistent<T>> data_;
+    IndexedPool<v8::UniquePersistent<T>> pool_;
 };
 
 } // namespace rt
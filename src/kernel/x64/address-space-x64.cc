@@ -53,6 +53,7 @@ void AddressSpaceX64::Configure() {
 }
 
 void AddressSpaceX64::Install() {
+    cpus_installed_.AddFetch(1);
     asm volatile("mov %0, %%cr3":: "b"(cr3_.Encode()));
 }
 
@@ -156,4 +157,41 @@ void AddressSpaceX64::MapPage(void* virtaddr, void* physaddr, bool invalidate, b
     }
 }
 
+void* AddressSpaceX64::UnmapPage(void* virtaddr) {
+    uintptr_t vaddr = reinterpret_cast<uintptr_t>(virtaddr);
+    uint32_t pd_offset = (vaddr >> 21) & 0x1FF;
+    uint32_t pdp_offset = (vaddr >> 30) & 0x1FF;
+    uint32_t pml4_offset = (vaddr >> 39) & 0x1FF;
+
+    RT_ASSERT(cr3_.PageDirectory);
+    PageTable<PML4Entry>* pml4_table =
+        reinterpret_cast<PageTable<PML4Entry>*>(cr3_.PageDirectory);
+
+    PML4Entry pml4 = pml4_table->GetEntry(pml4_offset);
+    if (!pml4.IsPresent) {
+        return nullptr;
+    }
+
+    PageTable<PDPEntry>* pdp_table =
+        reinterpret_cast<PageTable<PDPEntry>*>(pml4.PageDirectory);
+    PDPEntry pdp = pdp_table->GetEntry(pdp_offset);
+    if (!pdp.IsPresent) {
+        return nullptr;
+    }
+
+    PageTable<PDEntry>* pd_table =
+        reinterpret_cast<PageTable<PDEntry>*>(pdp.PageDirectory);
+    PDEntry pd = pd_table->GetEntry(pd_offset);
+    if (!pd.IsPresent) {
+        return nullptr;
+    }
+
+    // Other CPUs could keep using stale translation of the freed
+    // page, this needs IPI shootdown once SMP is enabled
+    RT_ASSERT(cpus_installed_.Get() <= 1);
+    pd_table->SetEntry(pd_offset, PDEntry());
+    asm volatile("invlpg (%0)" ::"r" (virtaddr) : "memory");
+    return pd.PageAddress;
+}
+
 } // namespace rt
@@ -17,6 +17,7 @@
 #include <kernel/kernel.h>
 #include <common/constants.h>
 #include <kernel/spinlock.h>
+#include <kernel/atomic.h>
 
 namespace rt {
 
@@ -197,6 +198,19 @@ public:
     void Configure();
     void MapPage(void* virtaddr, void* physaddr, bool invalidate, bool writethrough);
 
+    /**
+     * Remove page mapping, returns physical address of the
+     * page or nullptr if page was not mapped. TLB entry is only
+     * invalidated on current CPU, there is no shootdown yet,
+     * address space must not be installed on other CPUs
+     */
+    void* UnmapPage(void* virtaddr);
+
+    /**
+     * Number of CPUs this address space is installed on
+     */
+    uint32_t cpus_installed() const { return cpus_installed_.Get(); }
+
     inline static CR3Entry current() {
         uint64_t cr3value;
         asm volatile("mov %%cr3, %0" : "=r"(cr3value));
@@ -208,6 +222,7 @@ private:
     CR3Entry cr3_;
     PageTable<PML4Entry>* pml4_table_;
     Locker map_page_locker_;
+    Atomic<uint32_t> cpus_installed_;
 };
 
 } // namespace rt
@@ -74,6 +74,24 @@ public:
     inline static void EnableInterrupts() {
         asm volatile("sti");
     }
+
+    /**
+     * Read time stamp counter
+     */
+    inline static uint64_t ReadTimestampCounter() {
+        uint32_t lo, hi;
+        asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+        return (static_cast<uint64_t>(hi) << 32) | lo;
+    }
+
+    /**
+     * Check IF flag
+     */
+    inline static bool InterruptsEnabled() {
+        uint64_t flags;
+        asm volatile("pushfq; popq %0" : "=r"(flags));
+        return 0 != (flags & (1 << 9));
+    }
 };
 
 } // namespace rt
@@ -0,0 +1,210 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fpu-x64.h"
+#include <kernel/cpu.h>
+#include <common/cpu-features.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Switch and #NM paths run while registers still hold state of
+// another thread. They only do integer work, no memcpy, floating
+// point or structure copies the compiler could vectorize.
+
+namespace rt {
+
+bool FpuX64::xsave_ = false;
+bool FpuX64::xsaveopt_ = false;
+size_t FpuX64::area_size_ = 512;
+uint64_t FpuX64::features_ = FpuX64::kFeatureX87 | FpuX64::kFeatureSSE;
+void* FpuX64::initial_ = nullptr;
+FpuX64::CpuData FpuX64::cpus_[FpuX64::kMaxCpus];
+
+} // namespace rt
+
+// IRQ and exception gates save FPU/SIMD registers of interrupted
+// code on the stack (irq-vectors-x64.asm), FXSAVE until XSAVE
+// is enabled
+extern "C" {
+volatile uint8_t fpu_irq_xsave = 0;
+volatile uint64_t fpu_irq_area_size = 512;
+}
+
+namespace rt {
+
+namespace {
+
+const uint64_t kCr0TaskSwitched = 1 << 3;
+const uint64_t kCr4OsXsave = 1 << 18;
+
+inline uint64_t ReadCr0() {
+    uint64_t value;
+    asm volatile("mov %%cr0, %0" : "=r"(value));
+    return value;
+}
+
+inline void SetTaskSwitched() {
+    uint64_t value = ReadCr0() | kCr0TaskSwitched;
+    asm volatile("mov %0, %%cr0" : : "r"(value) : "memory");
+}
+
+inline void ClearTaskSwitched() {
+    asm volatile("clts" : : : "memory");
+}
+
+} // namespace
+
+void FpuX64::InitCpu() {
+    uint32_t cpu = Cpu::id();
+    RT_ASSERT(cpu < kMaxCpus);
+    cpus_[cpu].current = nullptr;
+    cpus_[cpu].owner = nullptr;
+    cpus_[cpu].ts = false;
+    ClearTaskSwitched();
+
+    if (common::CpuFeatures::HasXsave()) {
+        uint64_t cr4;
+        asm volatile("mov %%cr4, %0" : "=r"(cr4));
+        cr4 |= kCr4OsXsave;
+        asm volatile("mov %0, %%cr4" : : "r"(cr4));
+
+        uint64_t features = kFeatureX87 | kFeatureSSE;
+        if (common::CpuFeatures::HasAvx()) {
+            features |= kFeatureAVX;
+        }
+        asm volatile("xsetbv" : : "c"(0), "a"(static_cast<uint32_t>(features)),
+                     "d"(static_cast<uint32_t>(features >> 32)));
+
+        // Size of the area for components enabled in XCR0
+        xsave_ = true;
+        xsaveopt_ = common::CpuFeatures::HasXsaveopt();
+        features_ = features;
+        area_size_ = common::CpuFeatures::Cpuid(0xd, 0).ebx;
+
+        // Size first, interrupt can come in between
+        fpu_irq_area_size = area_size_;
+        fpu_irq_xsave = 1;
+    }
+
+    // Boot CPU state (control words set by startup code) is
+    // the initial state of every thread
+    if (nullptr == initial_) {
+        initial_ = memalign(kAlignment, area_size_);
+        RT_ASSERT(initial_);
+        memset(initial_, 0, area_size_);
+        Save(initial_);
+    }
+}
+
+void* FpuX64::AllocState() {
+    RT_ASSERT(initial_);
+    void* state = memalign(kAlignment, state_size());
+    RT_ASSERT(state);
+    memset(state, 0, kRegistersSize);
+    memcpy(Area(state), initial_, area_size_);
+    return state;
+}
+
+void FpuX64::FreeState(void* state) {
+    for (uint32_t i = 0; i < kMaxCpus; ++i) {
+        __sync_bool_compare_and_swap(&cpus_[i].owner, state, nullptr);
+    }
+    free(state);
+}
+
+void FpuX64::Adopt(void* state) {
+    CpuData& cpu = cpus_[Cpu::id()];
+    cpu.current = state;
+    cpu.owner = state;
+}
+
+void FpuX64::SwitchTo(void* state) {
+    CpuData& cpu = cpus_[Cpu::id()];
+    cpu.current = state;
+    ++cpu.switches;
+
+    // Registers still hold state of this thread if nobody else
+    // used FPU since it ran last time
+    bool ts = cpu.owner != state;
+    if (ts == cpu.ts) {
+        return;
+    }
+
+    cpu.ts = ts;
+    if (ts) {
+        SetTaskSwitched();
+    } else {
+        ClearTaskSwitched();
+    }
+}
+
+void FpuX64::LazyRestore() {
+    CpuData& cpu = cpus_[Cpu::id()];
+    cpu.ts = false;
+    if (cpu.owner == cpu.current) {
+        return;
+    }
+
+    RT_ASSERT(cpu.current);
+    if (nullptr != cpu.owner) {
+        Save(Area(cpu.owner));
+    }
+    Restore(Area(cpu.current));
+    cpu.owner = cpu.current;
+    ++cpu.restores;
+}
+
+uint64_t FpuX64::switches() {
+    uint64_t count = 0;
+    for (uint32_t i = 0; i < kMaxCpus; ++i) {
+        count += cpus_[i].switches;
+    }
+    return count;
+}
+
+uint64_t FpuX64::restores() {
+    uint64_t count = 0;
+    for (uint32_t i = 0; i < kMaxCpus; ++i) {
+        count += cpus_[i].restores;
+    }
+    return count;
+}
+
+void FpuX64::Save(void* area) {
+    if (xsaveopt_) {
+        asm volatile("xsaveopt (%0)" : : "r"(area), "a"(0xffffffff),
+                     "d"(0xffffffff) : "memory");
+    } else if (xsave_) {
+        asm volatile("xsave (%0)" : : "r"(area), "a"(0xffffffff),
+                     "d"(0xffffffff) : "memory");
+    } else {
+        asm volatile("fxsave (%0)" : : "r"(area) : "memory");
+    }
+}
+
+void FpuX64::Restore(void* area) {
+    if (xsave_) {
+        asm volatile("xrstor (%0)" : : "r"(area), "a"(0xffffffff),
+                     "d"(0xffffffff) : "memory");
+    } else {
+        asm volatile("fxrstor (%0)" : : "r"(area) : "memory");
+    }
+}
+
+} // namespace rt
+
+// Called by context switch code with interrupts disabled
+extern "C" void fpu_switch_event(void* state) {
+    rt::FpuX64::SwitchTo(state);
+}
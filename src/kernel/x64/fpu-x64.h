@@ -0,0 +1,109 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <kernel/kernel.h>
+#include <stdint.h>
+#include <stddef.h>
+
+namespace rt {
+
+/**
+ * FPU/SIMD register state of threads. Thread state structure
+ * (see irq-vectors-x64.asm) holds general registers followed by
+ * XSAVE area sized from CPUID (x87, SSE and AVX state), or FXSAVE
+ * area on CPUs without XSAVE. Switching is lazy: context switch
+ * only sets CR0.TS and the state is swapped on the first FPU/SIMD
+ * instruction of the new thread (#NM). Threads which don't touch
+ * these registers don't pay for save and restore. IRQ and page
+ * fault gates save registers of the interrupted code on the stack
+ * instead, handlers are free to use SSE/AVX.
+ */
+class FpuX64 {
+public:
+    static const uint32_t kMaxCpus = 32;
+    static const size_t kAlignment = 64;
+    static const size_t kRegistersSize = 128;
+
+    static const uint64_t kFeatureX87 = 1 << 0;
+    static const uint64_t kFeatureSSE = 1 << 1;
+    static const uint64_t kFeatureAVX = 1 << 2;
+
+    /**
+     * Enable XSAVE and supported state components on current CPU,
+     * must run before it allocates thread states (requires malloc)
+     */
+    static void InitCpu();
+
+    /**
+     * Allocate thread state structure, FPU state is a copy of
+     * the boot CPU state
+     */
+    static void* AllocState();
+    static void FreeState(void* state);
+
+    /**
+     * Current execution context owns FPU registers, used for
+     * contexts adopted by native threads
+     */
+    static void Adopt(void* state);
+
+    /**
+     * Thread is about to run on current CPU, interrupts must
+     * be disabled
+     */
+    static void SwitchTo(void* state);
+
+    /**
+     * First FPU/SIMD instruction since switch (#NM handler),
+     * CR0.TS is cleared already
+     */
+    static void LazyRestore();
+
+    static bool uses_xsave() { return xsave_; }
+    static size_t area_size() { return area_size_; }
+    static size_t state_size() { return kRegistersSize + area_size_; }
+    static uint64_t features() { return features_; }
+
+    /**
+     * Context switches and lazy restores (#NM) on all CPUs
+     */
+    static uint64_t switches();
+    static uint64_t restores();
+private:
+    struct CpuData {
+        void* current;
+        void* owner;
+        bool ts;
+        uint64_t switches;
+        uint64_t restores;
+    };
+
+    static void* Area(void* state) {
+        return static_cast<uint8_t*>(state) + kRegistersSize;
+    }
+
+    static void Save(void* area);
+    static void Restore(void* area);
+
+    static bool xsave_;
+    static bool xsaveopt_;
+    static size_t area_size_;
+    static uint64_t features_;
+    static void* initial_;
+    static CpuData cpus_[kMaxCpus];
+};
+
+} // namespace rt
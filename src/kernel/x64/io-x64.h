@@ -26,6 +26,10 @@ public:
         asm volatile("outb %b0,%w1":: "a"(value), "d"(port));
     }
 
+    inline static void OutSB(uint16_t port, const void* data, size_t count) {
+        asm volatile("rep outsb" : "+S"(data), "+c"(count) : "d"(port) : "memory");
+    }
+
     inline static void OutW(uint16_t port, uint16_t value) {
         asm volatile("outw %w0,%w1":: "a"(value), "d"(port));
     }
@@ -126,7 +130,22 @@ public:
        while (is_transmit_empty() == 0);
        IoPortsX64::OutB(port_, a);
     }
+
+    /**
+     * Write buffer in FIFO sized bursts, waits for empty transmitter
+     * once per burst instead of once per byte
+     */
+    inline static void WriteBuffer(const char* data, size_t len) {
+        while (len > 0) {
+            size_t count = len < kFifoSize ? len : kFifoSize;
+            while (is_transmit_empty() == 0);
+            IoPortsX64::OutSB(port_, data, count);
+            data += count;
+            len -= count;
+        }
+    }
 private:
+    static const size_t kFifoSize = 16;
     static int port_;
 };
 
@@ -298,6 +298,9 @@ extrn    irq_timer_event
 extrn    irq_keyboard_event
 extrn    irq_other_event
 extrn    irq_handler_any
+extrn    fpu_switch_event
+extrn    fpu_irq_xsave
+extrn    fpu_irq_area_size
 
 macro SaveState
 {
@@ -318,10 +321,13 @@ macro SaveState
     mov qword [rsp+104], rax
     mov qword [rsp+112], rbp
     mov qword [rsp+120], rsp
+    mov rbp, rsp        ; saved state, callee-saved register
+    and rsp, -16        ; handlers expect ABI stack alignment
 }
 
 macro RestoreState
 {
+    mov rsp, rbp
     mov r15, qword [rsp+0]
     mov r14, qword [rsp+8]
     mov r13, qword [rsp+16]
@@ -341,11 +347,68 @@ macro RestoreState
     add rsp, 256
 }
 
+; Handlers are compiled C++ which may use SSE/AVX registers
+; (memcpy, vectorized loops) of the interrupted code. Save them
+; below general registers, must follow SaveState (RBP points to
+; saved state). CR0.TS is cleared for the handler, so it doesn't
+; trigger lazy FPU switch (#NM), and restored afterwards
+macro SaveVectorState
+{
+    local use_fxsave, saved
+    mov rax, cr0
+    mov qword [rbp+128], rax    ; CR0 of interrupted code
+    clts
+    mov rax, fpu_irq_area_size
+    sub rsp, qword [rax]
+    and rsp, -64                ; XSAVE area alignment
+    mov rax, fpu_irq_xsave
+    cmp byte [rax], 0
+    je use_fxsave
+    xor eax, eax                ; XRSTOR requires clean header
+    mov qword [rsp+512], rax
+    mov qword [rsp+520], rax
+    mov qword [rsp+528], rax
+    mov qword [rsp+536], rax
+    mov qword [rsp+544], rax
+    mov qword [rsp+552], rax
+    mov qword [rsp+560], rax
+    mov qword [rsp+568], rax
+    mov eax, -1                 ; all components enabled in XCR0
+    mov edx, -1
+    xsave [rsp]
+    jmp saved
+use_fxsave:
+    fxsave [rsp]
+saved:
+}
+
+macro RestoreVectorState
+{
+    local use_fxrstor, restored, ts_clear
+    mov rax, fpu_irq_xsave
+    cmp byte [rax], 0
+    je use_fxrstor
+    mov eax, -1
+    mov edx, -1
+    xrstor [rsp]
+    jmp restored
+use_fxrstor:
+    fxrstor [rsp]
+restored:
+    mov rax, qword [rbp+128]
+    test rax, 8                 ; CR0.TS
+    jz ts_clear
+    mov cr0, rax
+ts_clear:
+}
+
 macro IrqHandler num
 {
     SaveState
+    SaveVectorState
     mov rdi, num
     call irq_handler_any
+    RestoreVectorState
     RestoreState
     iretq
 }
@@ -370,85 +433,93 @@ _switch_to_stack:
 ;  ---------------------------------------------------
 ;  begin preempt logic
 
-;  Param: RDI - load thread structure location, 16 bytes aligned
-;               structure size - 1024 bytes
-;                 0 - 512  fx state
-;               512 - 1024 general registers etc
+;  Thread structure, 64 bytes aligned, allocated by FpuX64::AllocState
+;                 0 - 128  general registers etc
+;                   0 r15, 8 r14, 16 r13, 24 r12, 32 rbp, 40 rbx,
+;                   48 rsp, 56 rip, 64 thread pointer
+;               128 - ...  FPU/SIMD state (XSAVE or FXSAVE area),
+;                          saved and restored lazily by #NM handler
+
+;  Param: RDI - load thread structure location
 
 _enterFirstThread:
+    push rdi                    ; also aligns stack for the call
+    call fpu_switch_event       ; RDI - new thread structure
+    pop rdi
 
     xor rax, rax
     push rax                    ; target ss
-    push qword [rdi+560]        ; target rsp
+    push qword [rdi+48]         ; target rsp
     pushfq                      ; target flags
     push 0x08                   ; target cs
-    push qword [rdi+568]        ; target rip
-    mov rdi, qword [rdi+576]    ; pass thread pointer as 1st parameter
+    push qword [rdi+56]         ; target rip
+    mov rdi, qword [rdi+64]     ; pass thread pointer as 1st parameter
     iretq
 
 ;
-;  Param: RDI - save thread structure location, 16 bytes aligned
-;               structure size - 1024 bytes
-;                 0 - 512  fx state
-;               512 - 1024 general registers etc
-;  Param: RSI - load thread structure location, 16 bytes aligned
-;               structure size - 1024 bytes
-;                 0 - 512  fx state
-;               512 - 1024 general registers etc
+;  Param: RDI - save thread structure location
+;  Param: RSI - load thread structure location
 ;
 
 _preemptStart:
     cli
     push rdi
-    fxsave [rdi]
-    mov qword [rdi+512], r15
-    mov qword [rdi+520], r14
-    mov qword [rdi+528], r13
-    mov qword [rdi+536], r12
-    mov qword [rdi+544], rbp
-    mov qword [rdi+552], rbx
-    mov qword [rdi+560], rsp
-    mov qword [rdi+568], _preemptCallback
+    push rsi
+    sub rsp, 8                  ; align stack for the call
+    mov rdi, rsi
+    call fpu_switch_event       ; sets CR0.TS unless new thread owns FPU
+    add rsp, 8
+    pop rsi
+    pop rdi
+
+    push rdi
+    mov qword [rdi+0], r15
+    mov qword [rdi+8], r14
+    mov qword [rdi+16], r13
+    mov qword [rdi+24], r12
+    mov qword [rdi+32], rbp
+    mov qword [rdi+40], rbx
+    mov qword [rdi+48], rsp
+    mov qword [rdi+56], _preemptCallback
 
     xor rax, rax
     push rax                    ; target ss
-    push qword [rsi+560]        ; target rsp
+    push qword [rsi+48]         ; target rsp
     pushfq                      ; target flags
     push 0x08                   ; target cs
-    push qword [rsi+568]        ; target rip
-    mov rdi, qword [rsi+576]    ; pass thread pointer as 1st parameter
+    push qword [rsi+56]         ; target rip
+    mov rdi, qword [rsi+64]     ; pass thread pointer as 1st parameter
     iretq
 
 _preemptCallback:
     pop rdi
-    fxrstor [rdi]
-    mov r15, qword [rdi+512]
-    mov r14, qword [rdi+520]
-    mov r13, qword [rdi+528]
-    mov r12, qword [rdi+536]
-    mov rbp, qword [rdi+544]
-    mov rbx, qword [rdi+552]
-    mov rax, qword [rdi+576]   ; return thread pointer
+    mov r15, qword [rdi+0]
+    mov r14, qword [rdi+8]
+    mov r13, qword [rdi+16]
+    mov r12, qword [rdi+24]
+    mov rbp, qword [rdi+32]
+    mov rbx, qword [rdi+40]
+    mov rax, qword [rdi+64]    ; return thread pointer
     sti
     ret
 
-;  Param: RDI - clean 1024 byte space for thread structure location
+;  Param: RDI - thread structure location, FPU state is initialized
 ;  Param: RSI - function pointer to thread entry point
-;  Param: RDX - thread stack location
+;  Param: RDX - thread stack location, 16 bytes aligned
 ;  Param: RCX - thread object pointer
 
 _threadStructInit:
-    fxsave [rdi]        ; save current state, it could be any valid fxstate
     xor rax, rax
-    mov qword [rdi+512], rax
-    mov qword [rdi+520], rax
-    mov qword [rdi+528], rax
-    mov qword [rdi+536], rax
-    mov qword [rdi+544], rax
-    mov qword [rdi+552], rax
-    mov qword [rdi+560], rdx
-    mov qword [rdi+568], rsi
-    mov qword [rdi+576], rcx
+    mov qword [rdi+0], rax
+    mov qword [rdi+8], rax
+    mov qword [rdi+16], rax
+    mov qword [rdi+24], rax
+    mov qword [rdi+32], rax
+    mov qword [rdi+40], rax
+    sub rdx, 8                  ; entry point is entered like a call,
+    mov qword [rdi+48], rdx     ; RSP+8 is 16 bytes aligned
+    mov qword [rdi+56], rsi
+    mov qword [rdi+64], rcx
     ret
 
 ;  end preempt logic
@@ -508,9 +579,10 @@ _int_gate_exception_UD:
 _int_gate_exception_NM:
 
     SaveState
+    clts                ; before handler touches FPU
     call	exception_NM_event
     RestoreState
-    Hang
+    iretq
 
 _int_gate_exception_DF:
 
@@ -562,7 +634,9 @@ _int_gate_exception_PF:
     SaveState
     mov rsi, 0
     mov     rdi, cr2    ; CR2 contians the address that the program tried to access
+    SaveVectorState     ; before it can fault again and change CR2
     call    exception_PF_event
+    RestoreVectorState
     RestoreState
     add	rsp, 8	    ; fix rsp after state restore
     iretq
@@ -614,11 +688,14 @@ align 16
 _int_gate_irq_timer:
 
     SaveState
+    SaveVectorState
     mov ax, 1
     mov fs, ax
+    mov rdi, rbp    ; saved state, 1 arg
     call    irq_timer_event
     mov ax, 0
     mov fs, ax
+    RestoreVectorState
     RestoreState
     iretq
 
@@ -630,7 +707,9 @@ _int_gate_irq_keyboard:
     ; push rdi ; put it back
 
     SaveState
+    SaveVectorState
     call    irq_keyboard_event
+    RestoreVectorState
     RestoreState
     iretq
 
@@ -18,6 +18,7 @@
 #include <kernel/mem-manager.h>
 #include <kernel/system-context.h>
 #include <kernel/x64/io-x64.h>
+#include <kernel/clock.h>
 
 namespace rt {
 
@@ -77,9 +78,11 @@ void LocalApicX64::InitCpu() {
 
         // Reset APIC timer (set counter to -1)
         registers_.Write(LocalApicRegister::TIMER_INITIAL_COUNT, 0xFFFFFFFF);
+        uint64_t tsc_start = Cpu::ReadTimestampCounter();
 
         // Wait until PIT counter reaches zero
         while(!(IoPortsX64::InB(0x61) & 0x20));
+        uint64_t tsc_end = Cpu::ReadTimestampCounter();
 
         // Stop Apic timer
         registers_.Write(LocalApicRegister::TIMER, 1 << 16);
@@ -88,11 +91,18 @@ void LocalApicX64::InitCpu() {
         uint32_t curr_count = registers_.Read(LocalApicRegister::TIMER_CURRENT_COUNT);
         uint32_t cpubusfreq = ((0xFFFFFFFF - curr_count) + 1) * 16 * 100;
         bus_freq_ = cpubusfreq;
+
+        // TSC is calibrated using the same 1/100 sec interval
+        GLOBAL_clock()->CalibrateTsc((tsc_end - tsc_start) * 100);
     }
 
+    SetTimerFrequency(kTimerFrequency);
+}
+
+void LocalApicX64::SetTimerFrequency(uint32_t hz) {
     RT_ASSERT(bus_freq_);
-    uint32_t quantum = 100;
-    uint32_t init_count = bus_freq_ / quantum / 16;
+    RT_ASSERT(hz);
+    uint32_t init_count = bus_freq_ / hz / 16;
 
     // Set minimum initial count value to avoid QEMU
     // "I/O thread has spun for 1000 iterations" warning
@@ -134,6 +134,11 @@ private:
 
 class LocalApicX64 {
 public:
+    /**
+     * Default timer interrupt rate (scheduler tick)
+     */
+    static const uint32_t kTimerFrequency = 100;
+
     LocalApicX64(void* local_apic_address);
 
     /**
@@ -185,6 +190,11 @@ public:
 
     void InitCpu();
 
+    /**
+     * Reprogram periodic timer on current CPU
+     */
+    void SetTimerFrequency(uint32_t hz);
+
 private:
     void* local_apic_address_;
     LocalApicRegisterAccessor registers_;
@@ -35,6 +35,15 @@ public:
         RT_ASSERT(acpi_.local_apic());
         return acpi_.local_apic()->bus_frequency();
     }
+
+    uint32_t timer_frequency() const {
+        return LocalApicX64::kTimerFrequency;
+    }
+
+    void SetTimerFrequency(uint32_t hz) {
+        RT_ASSERT(acpi_.local_apic());
+        acpi_.local_apic()->SetTimerFrequency(hz);
+    }
 private:
     AcpiX64 acpi_;
     DELETE_COPY_AND_ASSIGN(PlatformArch);
@@ -0,0 +1,124 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <kernel/kernel.h>
+#include <kernel/x64/io-x64.h>
+
+namespace rt {
+
+/**
+ * CMOS real-time clock, read once at boot to get wall clock epoch
+ */
+class RtcX64 {
+public:
+    /**
+     * Read current time, returns seconds since Unix epoch
+     */
+    static uint64_t ReadUnixTime() {
+        // Registers might change in the middle of reading,
+        // repeat until two consecutive reads match
+        DateTime a;
+        DateTime b = Read();
+        do {
+            a = b;
+            b = Read();
+        } while (!a.Equals(b));
+
+        uint8_t status_b = ReadRegister(0x0B);
+        bool bcd = 0 == (status_b & 0x04);
+        bool hour12 = 0 == (status_b & 0x02);
+
+        bool pm = 0 != (a.hour & 0x80);
+        a.hour &= 0x7F;
+
+        if (bcd) {
+            a.second = FromBcd(a.second);
+            a.minute = FromBcd(a.minute);
+            a.hour = FromBcd(a.hour);
+            a.day = FromBcd(a.day);
+            a.month = FromBcd(a.month);
+            a.year = FromBcd(a.year);
+            a.century = FromBcd(a.century);
+        }
+
+        if (hour12) {
+            a.hour %= 12;
+            if (pm) {
+                a.hour += 12;
+            }
+        }
+
+        // Century register is optional
+        uint64_t century = (a.century >= 19 && a.century <= 99) ? a.century : 20;
+        uint64_t year = century * 100 + a.year;
+
+        return DaysFromCivil(year, a.month, a.day) * 86400 +
+               a.hour * 3600 + a.minute * 60 + a.second;
+    }
+private:
+    struct DateTime {
+        uint8_t second;
+        uint8_t minute;
+        uint8_t hour;
+        uint8_t day;
+        uint8_t month;
+        uint8_t year;
+        uint8_t century;
+
+        bool Equals(const DateTime& other) const {
+            return second == other.second && minute == other.minute &&
+                   hour == other.hour && day == other.day &&
+                   month == other.month && year == other.year &&
+                   century == other.century;
+        }
+    };
+
+    static uint8_t ReadRegister(uint8_t reg) {
+        IoPortsX64::OutB(0x70, reg);
+        return IoPortsX64::InB(0x71);
+    }
+
+    static DateTime Read() {
+        while (ReadRegister(0x0A) & 0x80);     // Update in progress
+        DateTime dt;
+        dt.second = ReadRegister(0x00);
+        dt.minute = ReadRegister(0x02);
+        dt.hour = ReadRegister(0x04);
+        dt.day = ReadRegister(0x07);
+        dt.month = ReadRegister(0x08);
+        dt.year = ReadRegister(0x09);
+        dt.century = ReadRegister(0x32);
+        return dt;
+    }
+
+    static uint8_t FromBcd(uint8_t value) {
+        return (value & 0x0F) + (value >> 4) * 10;
+    }
+
+    // Days since 1970-01-01 for proleptic Gregorian date
+    static uint64_t DaysFromCivil(uint64_t y, uint64_t m, uint64_t d) {
+        if (m <= 2) {
+            --y;
+        }
+        uint64_t era = y / 400;
+        uint64_t yoe = y - era * 400;
+        uint64_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+        uint64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097 + doe - 719468;
+    }
+};
+
+} // namespace rt
@@ -16,6 +16,7 @@
 #include <kernel/boot-services.h>
 #include <kernel/logger.h>
 #include <kernel/platform.h>
+#include <common/mem-ops.h>
 #include <stdio.h>
 
 extern "C" {
@@ -67,6 +68,19 @@ int __stdio_close(FILE *f) { return 0; }
 long __stdio_seek(FILE *f, long off, int whence) { return -1; }
 void __stdio_exit(void) { }
 
+// Replace musl generic C versions, see common/mem-ops.h
+void* memcpy(void* dst, const void* src, size_t n) {
+    return common::MemOps::Copy(dst, src, n);
+}
+
+void* memmove(void* dst, const void* src, size_t n) {
+    return common::MemOps::Move(dst, src, n);
+}
+
+void* memset(void* dst, int c, size_t n) {
+    return common::MemOps::Fill(dst, c, n);
+}
+
 int *__errno_location(void) {
     static int e;
     return &e;
@@ -19,6 +19,7 @@
 #include <sys/types.h>
 #include <dirent.h>
 
+#include <strings.h>
 #include <cstring>
 #include <vector>
 #include <string>
@@ -126,13 +127,55 @@ void ListDir(const char* root, const char *name,
     closedir(dir);
 }
 
+// Text files compress well, media and archives are usually
+// compressed already
+const char* kCompressedExtensions[] = {
+    ".js", ".json", ".txt", ".html", ".htm", ".css", ".svg", ".map",
+    ".md", ".xml", ".csv", nullptr
+};
+
+PackageFileType FileTypeFor(const std::string& path, const char* codec) {
+    if (0 == strcmp("raw", codec)) {
+        return PackageFileType::DEFAULT;
+    }
+
+    if (0 == strcmp("lz4", codec)) {
+        return PackageFileType::LZ4;
+    }
+
+    size_t dot = path.rfind('.');
+    if (std::string::npos == dot) {
+        return PackageFileType::DEFAULT;
+    }
+
+    const char* ext = &path.c_str()[dot];
+    for (const char** e = kCompressedExtensions; *e; ++e) {
+        if (0 == strcasecmp(ext, *e)) {
+            return PackageFileType::LZ4;
+        }
+    }
+
+    return PackageFileType::DEFAULT;
+}
+
+bool IsCodec(const char* arg) {
+    return 0 == strcmp("auto", arg) || 0 == strcmp("lz4", arg) ||
+           0 == strcmp("raw", arg);
+}
+
 int PrintUsage() {
-    fprintf(stderr, "Usage: mkinitrd [-c|-l] <output> <directory>\n");
+    fprintf(stderr, "Usage: mkinitrd [-c|-l] <output> <directory>... [auto|lz4|raw]\n");
     fprintf(stderr, "runtime.js initrd tool\n");
     fprintf(stderr, "\n");
     fprintf(stderr, "Commands:\n");
-    fprintf(stderr, "  -c\tcreate initrd file <output> from <directory>\n");
+    fprintf(stderr, "  -c\tcreate initrd file <output> from <directory>, files of\n");
+    fprintf(stderr, "    \tother directories (build output) are added to the same root\n");
     fprintf(stderr, "  -l\tlist files in <directory>\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Compression:\n");
+    fprintf(stderr, "  auto\tcompress text files only (default)\n");
+    fprintf(stderr, "  lz4\tcompress all files\n");
+    fprintf(stderr, "  raw\tstore all files uncompressed\n");
     return -1;
 }
 
@@ -144,11 +187,21 @@ int main(int argc, const char* argv[]) {
 
     const char* cmd = argv[1];
     const char* filename = argv[2];
-    const char* directory = argv[3];
+    int dirs_end = argc;
+    const char* codec = "auto";
+    if (argc > 4 && IsCodec(argv[argc - 1])) {
+        codec = argv[argc - 1];
+        dirs_end = argc - 1;
+    }
 
+    // Files and lengths of their directory prefix
     std::vector<std::string> files;
-    ListDir(directory, directory, 0, &files);
-    size_t root_len = strlen(directory);
+    std::vector<size_t> root_lens;
+    for (int i = 3; i < dirs_end; ++i) {
+        const char* directory = argv[i];
+        ListDir(directory, directory, 0, &files);
+        root_lens.resize(files.size(), strlen(directory));
+    }
 
     if (0 == strcmp("-l", cmd)) {
         for (const std::string& file : files) {
@@ -159,7 +212,9 @@ int main(int argc, const char* argv[]) {
 
     if (0 == strcmp("-c", cmd)) {
         PackageFileWriter writer(filename);
-        for (const std::string& file : files) {
+        for (size_t i = 0; i < files.size(); ++i) {
+            const std::string& file = files[i];
+            size_t root_len = root_lens[i];
             FILE* f = fopen(file.c_str(), "rb");
             if (nullptr == f) {
                 fprintf(stderr, "mkinitrd: unable to open file '%s'.\n", file.c_str());
@@ -182,7 +237,8 @@ int main(int argc, const char* argv[]) {
             fclose(f);
 
             writer.AddFileData(PackageFileData(
-                std::string(&file.c_str()[root_len]), std::move(data)));
+                std::string(&file.c_str()[root_len]), std::move(data),
+                FileTypeFor(file, codec)));
         }
 
         if (writer.IsError()) {
@@ -0,0 +1,118 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cc/test.h>
+#include <kernel/buffer-pool.h>
+#include <vector>
+
+namespace test {
+
+using namespace rt;
+
+namespace {
+
+void* TestAllocPages(size_t size) {
+    void* base = memalign(4096, size);
+    memset(base, 0, size);
+    return base;
+}
+
+void TestFreePages(void* base, size_t size) {
+    free(base);
+}
+
+} // namespace
+
+TEST(BufferPool) {
+
+    describe("BufferPool") {
+        it("should round up to size classes", function {
+            assert_eq(BufferPool::ClassIndex(0), 0);
+            assert_eq(BufferPool::ClassIndex(64), 0);
+            assert_eq(BufferPool::ClassIndex(65), 1);
+            assert_eq(BufferPool::ClassSize(BufferPool::ClassIndex(1500)), 2048);
+        });
+
+        it("should recycle released stores", function {
+            BufferPool pool(TestAllocPages, TestFreePages, 4096);
+            BackingStore* first = pool.Alloc(1500, true);
+            void* data = first->data();
+            memset(data, 0xff, 1500);
+            first->Release();
+            assert_eq(pool.allocated(), 0);
+            assert_eq(pool.cached_bytes(), 2048);
+
+            BackingStore* second = pool.Alloc(1024 + 1, true);
+            assert_eq(second->data(), data);
+            assert_eq(pool.reused(), 1);
+            assert_eq(static_cast<uint8_t*>(second->data())[1024], 0);
+            assert_eq(BackingStore::FromData(second->data(), second->length()), second);
+            second->Release();
+        });
+
+        it("should keep store until last reference", function {
+            BufferPool pool(TestAllocPages, TestFreePages, 4096);
+            BackingStore* store = pool.Alloc(100, false);
+            store->AddRef();
+            store->Release();
+            assert_eq(pool.allocated(), 1);
+            store->Release();
+            assert_eq(pool.allocated(), 0);
+        });
+
+        it("should place large buffers on pages", function {
+            BufferPool pool(TestAllocPages, TestFreePages, 4096);
+            size_t length = BufferPool::kMaxPooledSize + 10;
+            BackingStore* store = pool.Alloc(length, true);
+            assert_eq((store->kind() == BackingStore::Kind::PAGES), true);
+            assert_eq((reinterpret_cast<uintptr_t>(store->data()) & 4095), 0);
+            assert_eq(BackingStore::FromData(store->data(), length), store);
+            store->Release();
+            assert_eq(pool.allocated(), 0);
+            assert_eq(pool.cached_bytes(), 0);
+        });
+
+        it("should delete device stores", function {
+            uint8_t memory[256];
+            BackingStore* store = BackingStore::NewDevice(memory, sizeof(memory));
+            assert_eq((store->kind() == BackingStore::Kind::DEVICE), true);
+            assert_eq(store->refs(), 1);
+            store->Release();
+        });
+
+        it("should free cached stores on trim", function {
+            BufferPool pool(TestAllocPages, TestFreePages, 4096);
+            uint32_t count = BufferPool::CpuCacheLimit(0) * 2;
+            std::vector<BackingStore*> stores;
+            for (uint32_t i = 0; i < count; ++i) {
+                stores.push_back(pool.Alloc(64, false));
+            }
+            for (BackingStore* store : stores) {
+                store->Release();
+            }
+            assert_eq(pool.cached_bytes(), count * 64);
+
+            assert_eq(pool.Trim(), count * 64);
+            assert_eq(pool.cached_bytes(), 0);
+
+            BackingStore* store = pool.Alloc(64, true);
+            assert_eq(pool.reused(), 0);
+            store->Release();
+        });
+    }
+}
+
+} // namespace test
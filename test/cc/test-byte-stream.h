@@ -0,0 +1,67 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cc/test.h>
+#include <kernel/byte-stream.h>
+#include <string.h>
+
+namespace test {
+
+using namespace rt;
+
+TEST(ByteStream) {
+
+    describe("ByteStream") {
+        it("should read values in order they were appended", function {
+            ByteStream s;
+            s.AppendValue<uint8_t>(7);
+            s.AppendValue<uint32_t>(0xdeadbeef);
+            s.AppendValue<double>(1.5);
+            s.AppendValue<uint64_t>(0x123456789abcdef0ULL);
+
+            ByteStreamReader r(s);
+            assert_eq(r.ReadValue<uint8_t>(), 7);
+            assert_eq(r.ReadValue<uint32_t>(), 0xdeadbeef);
+            assert_eq(r.ReadValue<double>(), 1.5);
+            assert_eq(r.ReadValue<uint64_t>(), 0x123456789abcdef0ULL);
+        });
+
+        it("should keep appended buffers", function {
+            ByteStream s;
+            const char* text = "transport data";
+            uint32_t len = strlen(text);
+            s.AppendValue<uint32_t>(len);
+            memcpy(s.AppendBuffer(len), text, len);
+            s.AppendValue<uint32_t>(42);
+
+            ByteStreamReader r(s);
+            assert_eq(r.ReadValue<uint32_t>(), len);
+            assert_eq(memcmp(r.ReadBuffer(len), text, len), 0);
+            assert_eq(r.ReadValue<uint32_t>(), 42);
+        });
+
+        it("should be empty after clear", function {
+            ByteStream s;
+            s.AppendValue<uint32_t>(1);
+            s.Clear();
+            s.AppendValue<uint32_t>(2);
+            ByteStreamReader r(s);
+            assert_eq(r.ReadValue<uint32_t>(), 2);
+        });
+    }
+}
+
+} // namespace test
@@ -0,0 +1,68 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <cc/test.h>
+#include <kernel/call-credits.h>
+
+namespace test {
+
+using namespace rt;
+
+TEST(CallCredits) {
+
+    describe("CallCredits") {
+        it("should deny calls over capacity", function {
+            CallCredits credits;
+            credits.SetCapacity(4);
+            assert_eq(credits.Take(3), true);
+            assert_eq(credits.Take(1), true);
+            assert_eq(credits.Take(1), false);
+            assert_eq(credits.used(), 4);
+            assert_eq(credits.denied(), 1);
+
+            credits.Return(2);
+            assert_eq(credits.Take(2), true);
+            assert_eq(credits.Take(1), false);
+            assert_eq(credits.peak(), 4);
+        });
+
+        it("should admit large batch into empty mailbox only", function {
+            CallCredits credits;
+            credits.SetCapacity(8);
+            assert_eq(credits.Take(1), true);
+            assert_eq(credits.Take(100), false);
+            credits.Return(1);
+            assert_eq(credits.Take(100), true);
+            assert_eq(credits.used(), 100);
+            assert_eq(credits.Take(1), false);
+            credits.Return(100);
+            assert_eq(credits.used(), 0);
+        });
+
+        it("should use new capacity for next calls", function {
+            CallCredits credits;
+            assert_eq(credits.capacity(), CallCredits::kDefaultCapacity);
+            credits.SetCapacity(2);
+            assert_eq(credits.Take(2), true);
+            credits.SetCapacity(3);
+            assert_eq(credits.Take(1), true);
+            assert_eq(credits.Take(1), false);
+        });
+    }
+}
+
+} // namespace test
@@ -0,0 +1,78 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cc/test.h>
+#include <kernel/kernel.h>
+#include <kernel/clock.h>
+#include <kernel/x64/io-x64.h>
+
+namespace test {
+
+using namespace rt;
+
+// Busy wait 1/100 sec using PIT channel 2 one-shot mode
+static void PitWait10ms() {
+    IoPortsX64::OutB(0x61, (IoPortsX64::InB(0x61) & 0xFD) | 1);
+    IoPortsX64::OutB(0x43, 0xB2);
+    IoPortsX64::OutB(0x42, 0x9B);
+    IoPortsX64::InB(0x60);
+    IoPortsX64::OutB(0x42, 0x2E);
+    uint8_t tmp = IoPortsX64::InB(0x61) & 0xFE;
+    IoPortsX64::OutB(0x61, tmp);
+    IoPortsX64::OutB(0x61, tmp | 1);
+    while (!(IoPortsX64::InB(0x61) & 0x20));
+}
+
+TEST(Clock) {
+
+    describe("MonotonicNanos") {
+        it("should never go backwards", function {
+            uint64_t prev = GLOBAL_clock()->MonotonicNanos();
+            bool monotonic = true;
+            for (uint32_t i = 0; i < 100000; ++i) {
+                uint64_t now = GLOBAL_clock()->MonotonicNanos();
+                if (now < prev) {
+                    monotonic = false;
+                }
+                prev = now;
+            }
+            assert_eq(monotonic, true);
+        });
+
+        it("should not drift from PIT by more than 2%", function {
+            for (uint32_t i = 0; i < 10; ++i) {
+                uint64_t start = GLOBAL_clock()->MonotonicNanos();
+                PitWait10ms();
+                uint64_t elapsed = GLOBAL_clock()->MonotonicNanos() - start;
+                assert_eq(elapsed > 9800000 && elapsed < 10200000, true);
+            }
+        });
+    }
+
+    describe("WallClockMicros") {
+        it("should be after 2014-01-01 and follow monotonic clock", function {
+            uint64_t wall = GLOBAL_clock()->WallClockMicros();
+            assert_eq(wall > UINT64_C(1388534400) * 1000000, true);
+            uint64_t start = GLOBAL_clock()->MonotonicNanos();
+            PitWait10ms();
+            uint64_t wall_elapsed = GLOBAL_clock()->WallClockMicros() - wall;
+            uint64_t mono_elapsed = (GLOBAL_clock()->MonotonicNanos() - start) / 1000;
+            assert_eq(wall_elapsed + 2 >= mono_elapsed && wall_elapsed <= mono_elapsed + 2, true);
+        });
+    }
+}
+
+} // namespace test
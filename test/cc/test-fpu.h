@@ -0,0 +1,94 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cc/test.h>
+#include <kernel/kernel.h>
+#include <kernel/fpu.h>
+
+// EASTL headers use "function" identifier
+#pragma push_macro("function")
+#undef function
+#include <kernel/native-thread.h>
+#pragma pop_macro("function")
+
+namespace test {
+
+using namespace rt;
+
+// xmm15 is not used by generated kernel code in practice
+static inline void FpuSetRegister(uint64_t value) {
+    asm volatile("movq %0, %%xmm15" : : "r"(value) : "xmm15");
+}
+
+static inline uint64_t FpuGetRegister() {
+    uint64_t value;
+    asm volatile("movq %%xmm15, %0" : "=r"(value));
+    return value;
+}
+
+/**
+ * Counts switches after which register value of this thread
+ * was lost
+ */
+static uint32_t FpuYieldLoop(uint64_t value, uint32_t rounds) {
+    uint32_t lost = 0;
+    FpuSetRegister(value);
+    for (uint32_t i = 0; i < rounds; ++i) {
+        GLOBAL_native_threads()->Yield();
+        if (FpuGetRegister() != value) {
+            ++lost;
+            FpuSetRegister(value);
+        }
+    }
+    return lost;
+}
+
+struct FpuWorker {
+    FpuWorker() : lost(0) {}
+    uint32_t lost;
+};
+
+static void FpuWorkerEntry(void* arg) {
+    FpuWorker* w = reinterpret_cast<FpuWorker*>(arg);
+    w->lost = FpuYieldLoop(0x5555aaaa5555aaaaULL, 1000);
+}
+
+TEST(Fpu) {
+
+    describe("Fpu") {
+        it("should size state area for enabled components", function {
+            assert_eq(Fpu::area_size() >= 512, true);
+            assert_eq(0 != (Fpu::features() & Fpu::kFeatureSSE), true);
+            if (0 != (Fpu::features() & Fpu::kFeatureAVX)) {
+                assert_eq(Fpu::area_size() >= 832, true);
+            }
+        });
+
+        it("should keep SIMD registers of every thread", function {
+            FpuWorker w;
+            uint64_t restores = Fpu::restores();
+            NativeThreadHandle t = GLOBAL_native_threads()->Create("fpu",
+                0, FpuWorkerEntry, &w);
+            uint32_t lost = FpuYieldLoop(0x123456789abcdef0ULL, 1000);
+            GLOBAL_native_threads()->Join(t);
+            assert_eq(lost, 0);
+            assert_eq(w.lost, 0);
+            assert_eq(Fpu::restores() > restores, true);
+        });
+    }
+}
+
+} // namespace test
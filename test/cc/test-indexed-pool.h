@@ -0,0 +1,81 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cc/test.h>
+#include <kernel/indexed-pool.h>
+#include <memory>
+
+namespace test {
+
+using namespace rt;
+
+TEST(IndexedPool) {
+
+    describe("IndexedPool") {
+        it("should take pushed values", function {
+            IndexedPool<uint64_t> pool;
+            uint32_t a = pool.Push(10);
+            uint32_t b = pool.Push(20);
+            assert_eq(pool.count(), 2);
+            assert_eq(*pool.Get(a), 10);
+            assert_eq(pool.Take(b), 20);
+            assert_eq(pool.Take(a), 10);
+            assert_eq(pool.count(), 0);
+        });
+
+        it("should reuse free slots", function {
+            IndexedPool<uint64_t> pool;
+            for (uint64_t i = 0; i < 100; ++i) {
+                pool.Push(i);
+            }
+            uint32_t index = pool.Push(100);
+            pool.Take(index);
+            pool.Push(101);
+            assert_eq(pool.capacity(), 101);
+        });
+
+        it("should not find stale indexes", function {
+            IndexedPool<std::unique_ptr<int>> pool;
+            uint32_t first = pool.Push(std::unique_ptr<int>(new int(1)));
+            assert_eq(*pool.Take(first), 1);
+            uint32_t second = pool.Push(std::unique_ptr<int>(new int(2)));
+            uint32_t mask = IndexedPool<int>::kSlotMask;
+            assert_eq((first & mask), (second & mask));
+            assert_eq((first != second), true);
+            assert_eq(pool.Get(first), nullptr);
+            assert_eq(pool.Take(first), nullptr);
+            assert_eq(*pool.Take(second), 2);
+            assert_eq(pool.Get(12345), nullptr);
+        });
+
+        it("should find index again after generation wraps", function {
+            IndexedPool<int> pool;
+            uint32_t first = pool.Push(1);
+            pool.Take(first);
+            uint32_t index = 0;
+            for (uint32_t i = 0; i < IndexedPool<int>::kGenerationMask; ++i) {
+                index = pool.Push(2);
+                assert_eq((index != first), true);
+                pool.Take(index);
+            }
+            index = pool.Push(3);
+            assert_eq(index, first);
+            assert_eq(*pool.Get(first), 3);
+        });
+    }
+}
+
+} // namespace test
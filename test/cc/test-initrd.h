@@ -0,0 +1,133 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cc/test.h>
+
+// kernel/string.h includes <functional>
+#pragma push_macro("function")
+#undef function
+#include <kernel/initrd.h>
+#pragma pop_macro("function")
+
+#include <common/package.h>
+#include <common/crc64.h>
+#include <string.h>
+#include <vector>
+
+namespace test {
+
+using namespace rt;
+using namespace package;
+
+class TestPackageWriter : public PackageWriter {
+public:
+    void WriteData(const void* buf, size_t len) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(buf);
+        data_.insert(data_.end(), p, p + len);
+    }
+    std::vector<uint8_t>& data() { return data_; }
+private:
+    std::vector<uint8_t> data_;
+};
+
+static std::vector<uint8_t> TestFileContents(const char* text, size_t repeat) {
+    std::vector<uint8_t> data;
+    for (size_t i = 0; i < repeat; ++i) {
+        data.insert(data.end(), text, text + strlen(text));
+    }
+    return data;
+}
+
+TEST(Initrd) {
+
+    describe("CRC64") {
+        it("should match check value for all implementations", function {
+            const unsigned char* s = reinterpret_cast<const unsigned char*>("123456789");
+            const uint64_t kCheck = 0xe9c6d914c4b8d9caULL;
+            assert_eq(CRC64::ComputeTable(0, s, 9), kCheck);
+            assert_eq(CRC64::ComputeSlicing8(0, s, 9), kCheck);
+            assert_eq(CRC64::ComputeSlicing16(0, s, 9), kCheck);
+            assert_eq(CRC64::Compute(0, s, 9), kCheck);
+        });
+    }
+
+    describe("Initrd") {
+        it("should find stored and compressed files", function {
+            TestPackageWriter w;
+            w.AddFileData(PackageFileData("/a.js", TestFileContents("var a = 1;\n", 3)));
+            w.AddFileData(PackageFileData("/b.js", TestFileContents("module.exports = b;\n", 500),
+                                          PackageFileType::LZ4));
+            w.Write();
+
+            Initrd initrd;
+            initrd.Init(&w.data()[0], w.data().size());
+            assert_eq(initrd.files_count(), 2);
+
+            InitrdFile a = initrd.Get("/a.js");
+            assert_eq(a.IsEmpty(), false);
+            assert_eq(a.Size(), 33);
+            assert_eq(memcmp(a.Data(), "var a = 1;\nvar a = 1;\n", 22), 0);
+
+            InitrdFile b = initrd.Get("/b.js");
+            std::vector<uint8_t> expected = TestFileContents("module.exports = b;\n", 500);
+            assert_eq(b.Size(), expected.size());
+            assert_eq(memcmp(b.Data(), &expected[0], expected.size()), 0);
+            assert_eq((initrd.cache_size() >= expected.size()), true);
+
+            assert_eq(initrd.Get("/c.js").IsEmpty(), true);
+        });
+
+        it("should reject files with invalid CRC64", function {
+            TestPackageWriter w;
+            w.AddFileData(PackageFileData("/a.js", TestFileContents("var a = 1;\n", 3)));
+            w.Write();
+
+            // Corrupt the last byte of file contents
+            std::vector<uint8_t>& data = w.data();
+            PackageFile file = PackageReader(&data[0], data.size()).Find("/a.js");
+            size_t offset = file.buf() - &data[0] + file.len() - 1;
+            data[offset] ^= 0xff;
+
+            Initrd initrd;
+            initrd.Init(&data[0], data.size());
+            assert_eq(initrd.Get("/a.js").IsEmpty(), true);
+        });
+
+        it("should not loop on hash table without empty buckets", function {
+            TestPackageWriter w;
+            w.AddFileData(PackageFileData("/a.js", TestFileContents("var a = 1;\n", 3)));
+            w.Write();
+
+            // Point every bucket to the only file
+            std::vector<uint8_t>& data = w.data();
+            const size_t header = 2 * sizeof(uint32_t) + 2 * sizeof(uint64_t);
+            uint64_t buckets_count;
+            memcpy(&buckets_count, &data[header - sizeof(uint64_t)], sizeof(uint64_t));
+            size_t buckets = header + sizeof(PackageIndexEntry);
+            for (size_t i = 0; i < buckets_count; ++i) {
+                uint32_t value = 1;
+                memcpy(&data[buckets + i * sizeof(uint32_t)], &value, sizeof(uint32_t));
+            }
+
+            PackageReader reader(&data[0], data.size());
+            assert_eq(reader.files_count(), 1);
+            assert_eq(reader.IndexOf("/a.js"), 0);
+            assert_eq(reader.IndexOf("/missing.js"), PackageReader::kNotFound);
+        });
+    }
+}
+
+} // namespace test
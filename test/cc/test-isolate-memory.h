@@ -0,0 +1,81 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cc/test.h>
+#include <kernel/kernel.h>
+#include <kernel/isolate-memory.h>
+
+namespace test {
+
+using namespace rt;
+
+TEST(IsolateMemory) {
+
+    describe("ChargeArrayBuffer") {
+        it("should charge and release backing stores", function {
+            IsolateMemory memory;
+            assert_eq(memory.ChargeArrayBuffer(4096), true);
+            assert_eq(memory.ChargeArrayBuffer(1024), true);
+            assert_eq(memory.array_buffer_bytes(), 5120);
+
+            memory.ReleaseArrayBuffer(4096);
+            assert_eq(memory.array_buffer_bytes(), 1024);
+            assert_eq(memory.array_buffer_peak(), 5120);
+        });
+
+        it("should fail when budget is exhausted", function {
+            MemoryLimits limits;
+            limits.max_array_buffer_bytes = 8192;
+            IsolateMemory memory(limits);
+
+            assert_eq(memory.ChargeArrayBuffer(8192), true);
+            assert_eq(memory.ChargeArrayBuffer(1), false);
+            assert_eq(memory.array_buffer_bytes(), 8192);
+            assert_eq(memory.array_buffer_failures(), 1);
+
+            memory.ReleaseArrayBuffer(4096);
+            assert_eq(memory.ChargeArrayBuffer(4096), true);
+            assert_eq(memory.terminated(), false);
+        });
+
+        it("should use limits set by process creator", function {
+            MemoryLimits limits;
+            limits.max_old_space_mb = MemoryLimits::MegabytesFromBytes(3 * 1024 * 1024 + 1);
+            limits.max_array_buffer_bytes = 4096;
+            assert_eq(limits.max_old_space_mb, 4);
+            assert_eq(MemoryLimits::MegabytesFromBytes(1), 1);
+
+            IsolateMemory memory;
+            memory.SetLimits(limits);
+            assert_eq(memory.limits().max_old_space_mb, 4);
+            assert_eq(memory.ChargeArrayBuffer(4096), true);
+            assert_eq(memory.ChargeArrayBuffer(1), false);
+        });
+    }
+
+    describe("AccountingArrayBufferAllocator") {
+        it("should allocate zeroed memory without current isolate", function {
+            AccountingArrayBufferAllocator allocator;
+            uint8_t* data = static_cast<uint8_t*>(allocator.Allocate(64));
+            assert_eq(data != nullptr, true);
+            assert_eq(data[0], 0);
+            assert_eq(data[63], 0);
+            allocator.Free(data, 64);
+        });
+    }
+}
+
+} // namespace test
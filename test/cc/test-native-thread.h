@@ -0,0 +1,112 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cc/test.h>
+#include <kernel/kernel.h>
+#include <kernel/clock.h>
+
+// EASTL headers use "function" identifier
+#pragma push_macro("function")
+#undef function
+#include <kernel/native-thread.h>
+#pragma pop_macro("function")
+
+namespace test {
+
+using namespace rt;
+
+struct PingPong {
+    PingPong() : ping(0), pong(0), rounds(0) {}
+    NativeSemaphore ping;
+    NativeSemaphore pong;
+    uint32_t rounds;
+};
+
+static void PingPongEntry(void* arg) {
+    PingPong* p = reinterpret_cast<PingPong*>(arg);
+    for (uint32_t i = 0; i < 100; ++i) {
+        p->ping.Wait();
+        ++p->rounds;
+        p->pong.Signal();
+    }
+}
+
+struct Counter {
+    Counter() : value(0) {}
+    NativeMutex mutex;
+    uint32_t value;
+};
+
+static void CounterEntry(void* arg) {
+    Counter* c = reinterpret_cast<Counter*>(arg);
+    for (uint32_t i = 0; i < 1000; ++i) {
+        c->mutex.Lock();
+        uint32_t v = c->value;
+        GLOBAL_native_threads()->Yield();
+        c->value = v + 1;
+        c->mutex.Unlock();
+    }
+}
+
+TEST(NativeThread) {
+
+    describe("NativeSemaphore") {
+        it("should hand off between threads", function {
+            PingPong p;
+            NativeThreadHandle t = GLOBAL_native_threads()->Create("pingpong",
+                0, PingPongEntry, &p);
+            for (uint32_t i = 0; i < 100; ++i) {
+                p.ping.Signal();
+                p.pong.Wait();
+            }
+            GLOBAL_native_threads()->Join(t);
+            assert_eq(p.rounds, 100);
+        });
+
+        it("should time out", function {
+            NativeSemaphore s(0);
+            uint64_t deadline = GLOBAL_clock()->MonotonicNanos() + 1000000;
+            assert_eq(s.WaitUntil(deadline), false);
+            assert_eq(GLOBAL_clock()->MonotonicNanos() >= deadline, true);
+        });
+    }
+
+    describe("NativeMutex") {
+        it("should serialize threads yielding inside critical section", function {
+            Counter c;
+            NativeThreadHandle t1 = GLOBAL_native_threads()->Create("counter1",
+                0, CounterEntry, &c);
+            NativeThreadHandle t2 = GLOBAL_native_threads()->Create("counter2",
+                0, CounterEntry, &c);
+            GLOBAL_native_threads()->Join(t1);
+            GLOBAL_native_threads()->Join(t2);
+            assert_eq(c.value, 2000);
+        });
+
+        it("should allow recursive locking when configured", function {
+            NativeMutex m;
+            m.SetRecursive();
+            m.Lock();
+            assert_eq(m.TryLock(), true);
+            m.Unlock();
+            m.Unlock();
+            assert_eq(m.TryLock(), true);
+            m.Unlock();
+        });
+    }
+}
+
+} // namespace test
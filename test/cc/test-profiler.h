@@ -0,0 +1,158 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cc/test.h>
+#include <kernel/kernel.h>
+#include <kernel/profiler.h>
+
+// EASTL headers use "function" identifier
+#pragma push_macro("function")
+#undef function
+#include <kernel/platform.h>
+#pragma pop_macro("function")
+
+namespace test {
+
+using namespace rt;
+
+// Interrupt gate saved state, see irq-vectors-x64.asm
+static void ProfilerFakeState(uint64_t* state, uintptr_t rip,
+                              uintptr_t rsp, uintptr_t rbp) {
+    for (uint32_t i = 0; i < 37; ++i) {
+        state[i] = 0;
+    }
+    state[14] = rbp;
+    state[32] = rip;
+    state[35] = rsp;
+}
+
+static uint32_t profiler_hook_calls = 0;
+static uintptr_t profiler_hook_rip = 0;
+
+static void ProfilerTestHook(void* data, const ProfilerRegisters& regs) {
+    ++profiler_hook_calls;
+    profiler_hook_rip = regs.rip;
+}
+
+TEST(Profiler) {
+
+    describe("Tick") {
+        it("should not sample when profiler is stopped", function {
+            Profiler profiler;
+            uint64_t state[37];
+            ProfilerFakeState(state, 0x1000, 0, 0);
+            assert_eq(profiler.Tick(state), true);
+            assert_eq(profiler.samples(), 0);
+        });
+
+        it("should record sample and follow frame pointers", function {
+            // Local profiler at scheduler rate, timer is not reprogrammed
+            // and real interrupts are not routed here
+            Profiler profiler;
+            uint32_t hz = GLOBAL_platform()->timer_frequency();
+            assert_eq(profiler.Start(hz), true);
+            assert_eq(profiler.frequency(), hz);
+
+            uintptr_t stack[8] = { 0 };
+            stack[2] = reinterpret_cast<uintptr_t>(&stack[4]);
+            stack[3] = 0x2000;
+            stack[4] = 0;
+            stack[5] = 0x3000;
+
+            uint64_t state[37];
+            ProfilerFakeState(state, 0x1000, reinterpret_cast<uintptr_t>(&stack[0]),
+                reinterpret_cast<uintptr_t>(&stack[2]));
+            assert_eq(profiler.Tick(state), true);
+            assert_eq(profiler.samples(), 1);
+
+            profiler.Stop();
+            assert_eq(profiler.running(), false);
+            assert_eq(profiler.Tick(state), true);
+            assert_eq(profiler.samples(), 1);
+        });
+
+        it("should not follow frame pointers outside of thread stack", function {
+            Profiler profiler;
+            assert_eq(profiler.Start(GLOBAL_platform()->timer_frequency()), true);
+
+            // Frame chain in heap memory, not on any stack
+            uintptr_t* heap_frames = new uintptr_t[4]();
+            heap_frames[1] = 0x2000;
+            uintptr_t stack[4] = { 0 };
+            stack[1] = 0x3000;
+
+            uint64_t state[37];
+            ProfilerFakeState(state, 0x1000, reinterpret_cast<uintptr_t>(&stack[0]),
+                reinterpret_cast<uintptr_t>(heap_frames));
+            profiler.Tick(state);
+
+            // Misaligned frame pointer
+            ProfilerFakeState(state, 0x1000, reinterpret_cast<uintptr_t>(&stack[0]),
+                reinterpret_cast<uintptr_t>(&stack[0]) + 4);
+            profiler.Tick(state);
+
+            assert_eq(profiler.samples(), 2);
+            assert_eq(profiler.sample_depth(0), 1);
+            assert_eq(profiler.sample_depth(1), 1);
+            profiler.Stop();
+            delete[] heap_frames;
+        });
+
+        it("should count dropped samples when buffer is full", function {
+            Profiler profiler;
+            assert_eq(profiler.Start(GLOBAL_platform()->timer_frequency()), true);
+
+            uint64_t state[37];
+            ProfilerFakeState(state, 0x1000, 0, 0);
+            for (size_t i = 0; i < Profiler::kMaxSamples + 3; ++i) {
+                profiler.Tick(state);
+            }
+            assert_eq(profiler.samples(), Profiler::kMaxSamples);
+            assert_eq(profiler.dropped(), 3);
+
+            profiler.Reset();
+            assert_eq(profiler.samples(), 0);
+            profiler.Stop();
+        });
+    }
+
+    describe("AddHook") {
+        it("should call hook with interrupted registers", function {
+            Profiler profiler;
+            profiler_hook_calls = 0;
+            int data = 0;
+            uint32_t hz = GLOBAL_platform()->timer_frequency();
+            assert_eq(profiler.AddHook(&ProfilerTestHook, &data, hz), true);
+            assert_eq(profiler.running(), true);
+
+            uint64_t state[37];
+            ProfilerFakeState(state, 0x4000, 0, 0);
+            profiler.Tick(state);
+            assert_eq(profiler_hook_calls, 1);
+            assert_eq(profiler_hook_rip, 0x4000);
+
+            // Hook only, kernel samples are not recorded
+            assert_eq(profiler.samples(), 0);
+
+            profiler.RemoveHook(&ProfilerTestHook, &data);
+            assert_eq(profiler.running(), false);
+            profiler.Tick(state);
+            assert_eq(profiler_hook_calls, 1);
+        });
+    }
+}
+
+} // namespace test
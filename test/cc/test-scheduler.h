@@ -0,0 +1,223 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <cc/test.h>
+#include <kernel/scheduler.h>
+
+namespace test {
+
+using namespace rt;
+
+TEST(Scheduler) {
+
+    describe("MlfqScheduler") {
+        const uint64_t ms = 1000 * 1000;
+
+        it("should run IRQ-woken thread before CPU-bound ones", function {
+            MlfqScheduler sched;
+            SchedEntity busy1, busy2, driver;
+            SchedEntity* entities[] = { &busy1, &busy2, &driver };
+            busy1.SetReady(true, false, 0);
+            busy2.SetReady(true, false, 0);
+            driver.SetReady(false, true, 5 * ms);
+            assert_eq(sched.Pick(entities, 3, 0, 6 * ms), 2);
+
+            sched.Dispatch(&driver, 6 * ms);
+            assert_eq(driver.level(), SchedEntity::kDriverLevel);
+            assert_eq(driver.irq_wakeups(), 1);
+            assert_eq(driver.wait_nanos(), 1 * ms);
+        });
+
+        it("should move CPU-bound thread down the levels", function {
+            MlfqScheduler sched;
+            SchedEntity busy;
+            uint64_t now = 1 * ms;
+            for (uint32_t i = 0; i < SchedEntity::kLevels + 2; ++i) {
+                sched.Dispatch(&busy, now);
+                now += 40 * ms;
+                sched.Stop(&busy, now);
+            }
+            assert_eq(busy.level(), SchedEntity::kLevels - 1);
+            assert_eq(busy.run_nanos(), (SchedEntity::kLevels + 2) * 40 * ms);
+
+            // Short runs bring it back up
+            for (uint32_t i = 0; i < SchedEntity::kLevels; ++i) {
+                sched.Dispatch(&busy, now);
+                now += 100;
+                sched.Stop(&busy, now);
+            }
+            assert_eq(busy.level(), SchedEntity::kStartLevel);
+        });
+
+        it("should round-robin between threads on one level", function {
+            MlfqScheduler sched;
+            SchedEntity a, b, c;
+            SchedEntity* entities[] = { &a, &b, &c };
+            a.SetReady(true, false, 0);
+            b.SetReady(false, false, 0);
+            c.SetReady(true, false, 0);
+            assert_eq(sched.Pick(entities, 3, 0, 1 * ms), 2);
+            assert_eq(sched.Pick(entities, 3, 2, 1 * ms), 0);
+
+            // Nobody has work
+            a.SetReady(false, false, 0);
+            c.SetReady(false, false, 0);
+            assert_eq(sched.Pick(entities, 3, 0, 1 * ms), 1);
+        });
+
+        it("should not starve idle and low level threads", function {
+            MlfqScheduler sched;
+            SchedEntity busy, idle;
+            SchedEntity* entities[] = { &busy, &idle };
+            sched.Dispatch(&idle, 0);
+            sched.Stop(&idle, 0);
+            busy.SetReady(true, false, 0);
+            idle.SetReady(false, false, 0);
+            assert_eq(sched.Pick(entities, 2, 0, 1 * ms), 0);
+            assert_eq(sched.Pick(entities, 2, 0,
+                      MlfqScheduler::kStarvationNanos), 1);
+
+            // Periodic boost lifts demoted thread
+            for (uint32_t i = 0; i < SchedEntity::kLevels; ++i) {
+                sched.Dispatch(&busy, 0);
+                sched.Stop(&busy, 40 * ms);
+            }
+            assert_eq(busy.level(), SchedEntity::kLevels - 1);
+            sched.Pick(entities, 2, 0, MlfqScheduler::kBoostPeriodNanos);
+            assert_eq(busy.level(), SchedEntity::kStartLevel);
+        });
+
+        it("should share CPU between preempted threads", function {
+            MlfqScheduler sched;
+            SchedEntity a, b;
+            SchedEntity* entities[] = { &a, &b };
+            a.SetReady(true, false, 0);
+            b.SetReady(true, false, 0);
+
+            // Both never yield, timer preempts them after a full slice
+            const uint64_t slice = 20 * ms;
+            uint64_t now = 0;
+            uint32_t current = 0;
+            for (uint32_t i = 0; i < 100; ++i) {
+                current = sched.Pick(entities, 2, current, now);
+                sched.Dispatch(entities[current], now);
+                now += slice;
+                sched.Stop(entities[current], now);
+            }
+
+            assert_eq(a.run_nanos() + b.run_nanos(), 100 * slice);
+            assert_eq((a.run_nanos() <= b.run_nanos() + slice), true);
+            assert_eq((b.run_nanos() <= a.run_nanos() + slice), true);
+            assert_eq((a.max_wait_nanos() <= 2 * slice), true);
+            assert_eq((b.max_wait_nanos() <= 2 * slice), true);
+        });
+
+        it("should preempt threads which never yield on timer ticks", function {
+            MlfqScheduler sched;
+            SchedEntity a, b;
+            SchedEntity* entities[] = { &a, &b };
+            TimeSlice slice_a(10 * ms), slice_b(10 * ms);
+            TimeSlice* slices[] = { &slice_a, &slice_b };
+            a.SetReady(true, false, 0);
+            b.SetReady(true, false, 0);
+
+            // Tick is 1 ms, expired slice switches on the same tick
+            uint64_t now = 0;
+            uint32_t current = sched.Pick(entities, 2, 0, now);
+            sched.Dispatch(entities[current], now);
+            slices[current]->Start(now);
+            uint32_t preemptions = 0;
+            for (uint32_t tick = 0; tick < 2000; ++tick) {
+                now += ms;
+                if (!slices[current]->Expired(now)) {
+                    continue;
+                }
+
+                ++preemptions;
+                sched.Stop(entities[current], now);
+                current = sched.Pick(entities, 2, current, now);
+                sched.Dispatch(entities[current], now);
+                slices[current]->Start(now);
+            }
+            sched.Stop(entities[current], now);
+
+            assert_eq(preemptions, 200);
+            assert_eq(a.run_nanos() + b.run_nanos(), 2000 * ms);
+            assert_eq((a.run_nanos() <= b.run_nanos() + 10 * ms), true);
+            assert_eq((b.run_nanos() <= a.run_nanos() + 10 * ms), true);
+        });
+
+        it("should demote driver level thread when it gives CPU up", function {
+            MlfqScheduler sched;
+            SchedEntity driver, other;
+            SchedEntity* entities[] = { &driver, &other };
+            driver.SetReady(false, true, 0);
+            sched.Dispatch(&driver, 1 * ms);
+            assert_eq(driver.level(), SchedEntity::kDriverLevel);
+            sched.Stop(&driver, 1 * ms + 100);
+            assert_eq(driver.level(), SchedEntity::kStartLevel);
+
+            // Work without IRQ competes on start level
+            driver.SetReady(true, false, 0);
+            other.SetReady(true, false, 0);
+            assert_eq(sched.Pick(entities, 2, 0, 2 * ms), 1);
+            assert_eq(sched.Pick(entities, 2, 1, 2 * ms), 0);
+        });
+
+        it("should preempt on quantum of thread level", function {
+            MlfqScheduler sched;
+            SchedEntity a, b;
+            SchedEntity* entities[] = { &a, &b };
+            a.SetReady(true, false, 0);
+            b.SetReady(true, false, 0);
+
+            // Tick is 1 ms, threads never yield
+            uint64_t now = 0;
+            uint32_t current = sched.Pick(entities, 2, 0, now);
+            sched.Dispatch(entities[current], now);
+            uint64_t start = now;
+            for (uint32_t tick = 0; tick < 100; ++tick) {
+                now += ms;
+                if (!MlfqScheduler::Expired(entities[current], now)) {
+                    continue;
+                }
+
+                uint32_t level = entities[current]->level();
+                assert_eq(now - start, MlfqScheduler::Quantum(level));
+                sched.Stop(entities[current], now);
+                current = sched.Pick(entities, 2, current, now);
+                sched.Dispatch(entities[current], now);
+                start = now;
+            }
+
+            assert_eq(a.level(), SchedEntity::kLevels - 1);
+            assert_eq(b.level(), SchedEntity::kLevels - 1);
+            assert_eq(a.last_slice_nanos(), MlfqScheduler::Quantum(SchedEntity::kLevels - 1));
+        });
+
+        it("should record IRQ latency", function {
+            SchedEntity driver;
+            driver.AddIrqLatency(100);
+            driver.AddIrqLatency(300);
+            assert_eq(driver.irq_count(), 2);
+            assert_eq(driver.irq_latency_nanos(), 400);
+            assert_eq(driver.irq_latency_max_nanos(), 300);
+        });
+    }
+}
+
+} // namespace test
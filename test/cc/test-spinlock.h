@@ -0,0 +1,60 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cc/test.h>
+#include <kernel/spinlock.h>
+
+namespace test {
+
+using namespace rt;
+
+TEST(Spinlock) {
+
+    describe("Spinlock") {
+        it("should acquire free lock only once per CPU", function {
+            Locker l;
+            Spinlock s(l);
+            assert_eq(s.tryLock(), true);
+            s.unlock();
+            s.lock();
+            s.unlock();
+            assert_eq(s.tryLock(), true);
+            s.unlock();
+        });
+
+        it("should allow lock owner to lock again", function {
+            Locker l;
+            Spinlock s(l);
+            s.lock();
+            s.lock();
+            assert_eq(s.tryLock(), true);
+            s.unlock();
+            assert_eq(s.tryLock(), true);
+            s.unlock();
+        });
+
+        it("should release lock at the end of scope", function {
+            Locker l;
+            {   ScopedLock lock(l);
+            }
+            Spinlock s(l);
+            assert_eq(s.tryLock(), true);
+            s.unlock();
+        });
+    }
+}
+
+} // namespace test
@@ -0,0 +1,98 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cc/test.h>
+#include <kernel/spsc-ring.h>
+
+namespace test {
+
+using namespace rt;
+
+TEST(SpscRing) {
+
+    describe("SpscRing") {
+        it("should accept power of two sizes only", function {
+            assert_eq(SpscRing::IsValidSize(4096), true);
+            assert_eq(SpscRing::IsValidSize(0), false);
+            assert_eq(SpscRing::IsValidSize(1000), false);
+        });
+
+        it("should read bytes written across the end", function {
+            uint8_t memory[SpscRing::kHeaderSize + 16];
+            SpscRing ring(memory, 16);
+            uint8_t out[16];
+            bool doorbell;
+            assert_eq(ring.Write("0123456789", 10, &doorbell), 10);
+            assert_eq(ring.Read(out, 8, &doorbell), 8);
+            assert_eq(ring.Writable(), 14);
+            assert_eq(ring.Write("abcdefghijklmnop", 16, &doorbell), 14);
+            assert_eq(ring.Readable(), 16);
+            assert_eq(ring.Read(out, 16, &doorbell), 16);
+            assert_eq(memcmp(out, "89abcdefghijklmn", 16), 0);
+            assert_eq(ring.Readable(), 0);
+        });
+
+        it("should ring doorbell only for waiting side", function {
+            uint8_t memory[SpscRing::kHeaderSize + 64];
+            SpscRing ring(memory, 64);
+            uint8_t out[64];
+            bool doorbell;
+            ring.Write("x", 1, &doorbell);
+            assert_eq(doorbell, false);
+
+            // Data is there, consumer does not wait
+            assert_eq(ring.WaitReadable(), false);
+            ring.Read(out, 1, &doorbell);
+            assert_eq(doorbell, false);
+
+            assert_eq(ring.WaitReadable(), true);
+            ring.Write("y", 1, &doorbell);
+            assert_eq(doorbell, true);
+            ring.Write("z", 1, &doorbell);
+            assert_eq(doorbell, false);
+        });
+
+        it("should wake producer waiting for space", function {
+            uint8_t memory[SpscRing::kHeaderSize + 8];
+            SpscRing ring(memory, 8);
+            uint8_t out[8];
+            bool doorbell;
+            ring.Write("12345678", 8, &doorbell);
+            assert_eq(ring.WaitWritable(), true);
+            ring.Read(out, 2, &doorbell);
+            assert_eq(doorbell, true);
+            assert_eq(ring.WaitWritable(), false);
+        });
+
+        it("should not use indices corrupted by script", function {
+            uint8_t memory[SpscRing::kHeaderSize + 8];
+            SpscRing ring(memory, 8);
+            uint8_t out[8];
+            bool doorbell;
+            ring.Write("1234", 4, &doorbell);
+
+            // Head is 100 bytes ahead of tail in 8 byte ring
+            uint32_t head = 100;
+            memcpy(memory + SpscRing::kHeadOffset, &head, sizeof(head));
+            assert_eq(ring.IsValid(), false);
+            assert_eq(ring.Write("x", 1, &doorbell), 0);
+            assert_eq(ring.Read(out, 8, &doorbell), 0);
+            assert_eq(doorbell, false);
+        });
+    }
+}
+
+} // namespace test
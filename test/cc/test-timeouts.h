@@ -0,0 +1,53 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cc/test.h>
+#include <kernel/timeouts.h>
+#include <limits>
+
+namespace test {
+
+using namespace rt;
+
+TEST(Timeouts) {
+
+    describe("Timeouts") {
+        it("should be empty initially", function {
+            Timeouts<uint32_t> t;
+            assert_eq(t.Elapsed(std::numeric_limits<uint64_t>::max()), false);
+            assert_eq(t.NextTime(), std::numeric_limits<uint64_t>::max());
+        });
+
+        it("should take items in time order", function {
+            Timeouts<uint32_t> t;
+            t.Set(3, 300);
+            t.Set(1, 100);
+            t.Set(2, 200);
+            assert_eq(t.NextTime(), 100);
+            assert_eq(t.Elapsed(99), false);
+            assert_eq(t.Elapsed(100), true);
+            assert_eq(t.Take(), 1);
+            assert_eq(t.Elapsed(250), true);
+            assert_eq(t.Take(), 2);
+            assert_eq(t.Elapsed(250), false);
+            assert_eq(t.NextTime(), 300);
+            assert_eq(t.Take(), 3);
+            assert_eq(t.Elapsed(1000), false);
+        });
+    }
+}
+
+} // namespace test
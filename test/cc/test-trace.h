@@ -0,0 +1,105 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cc/test.h>
+#include <kernel/kernel.h>
+#include <kernel/trace.h>
+#include <string.h>
+
+namespace test {
+
+using namespace rt;
+
+struct TraceOutput {
+    TraceOutput() : len(0) {}
+    char buf[4096];
+    size_t len;
+};
+
+static void TraceCollect(void* data, const char* buf, size_t len) {
+    TraceOutput* out = reinterpret_cast<TraceOutput*>(data);
+    if (out->len + len >= sizeof(out->buf)) {
+        len = sizeof(out->buf) - out->len - 1;
+    }
+    memcpy(out->buf + out->len, buf, len);
+    out->len += len;
+    out->buf[out->len] = '\0';
+}
+
+TEST(Trace) {
+
+    describe("Record") {
+        it("should skip disabled categories", function {
+            Trace trace;
+            assert_eq(trace.Start(Trace::kCategoryIrq), true);
+            trace.Record(TracePhase::INSTANT, Trace::kCategoryGC, "gc", __FILE__, __LINE__, 0);
+            assert_eq(trace.events_count(), 0);
+            trace.Record(TracePhase::INSTANT, Trace::kCategoryIrq, "irq", __FILE__, __LINE__, 0);
+            assert_eq(trace.events_count(), 1);
+            trace.Stop();
+            trace.Record(TracePhase::INSTANT, Trace::kCategoryIrq, "irq", __FILE__, __LINE__, 0);
+            assert_eq(trace.events_count(), 1);
+        });
+
+        it("should keep latest events when buffer wraps", function {
+            Trace trace;
+            assert_eq(trace.Start(Trace::kCategoryAll), true);
+            for (size_t i = 0; i < Trace::kEventsPerCpu + 5; ++i) {
+                trace.Record(TracePhase::INSTANT, Trace::kCategorySched, "switch",
+                             __FILE__, __LINE__, i);
+            }
+            trace.Stop();
+            assert_eq(trace.events_count(), Trace::kEventsPerCpu);
+            assert_eq(trace.overwritten(), 5);
+
+            // Restart clears buffers
+            assert_eq(trace.Start(Trace::kCategoryAll), true);
+            assert_eq(trace.events_count(), 0);
+            trace.Stop();
+        });
+    }
+
+    describe("ExportChromeJson") {
+        it("should write begin and end events", function {
+            Trace trace;
+            assert_eq(trace.Start(Trace::kCategoryAll), true);
+            trace.Record(TracePhase::BEGIN, Trace::kCategoryMessage, "drain", "a.cc", 10, 3);
+            trace.Record(TracePhase::END, Trace::kCategoryMessage, "drain", "a.cc", 20, 3);
+            trace.Stop();
+
+            TraceOutput out;
+            assert_eq(trace.ExportChromeJson(TraceCollect, &out), 2);
+            assert_eq(0 == strncmp(out.buf, "{\"traceEvents\":[", 16), true);
+            assert_eq(nullptr != strstr(out.buf, "\"name\":\"drain\",\"cat\":\"message\",\"ph\":\"B\""), true);
+            assert_eq(nullptr != strstr(out.buf, "\"ph\":\"E\""), true);
+            assert_eq(nullptr != strstr(out.buf, "\"line\":20,\"arg\":3,\"file\":\"a.cc\""), true);
+        });
+
+        it("should escape names", function {
+            Trace trace;
+            assert_eq(trace.Start(Trace::kCategoryAll), true);
+            trace.Record(TracePhase::INSTANT, Trace::kCategoryScope, "say \"hi\"", "b.cc", 1, 0);
+            trace.Stop();
+
+            TraceOutput out;
+            assert_eq(trace.ExportChromeJson(TraceCollect, &out), 1);
+            assert_eq(nullptr != strstr(out.buf, "\"name\":\"say \\\"hi\\\"\""), true);
+            assert_eq(nullptr != strstr(out.buf, "\"s\":\"t\""), true);
+        });
+    }
+}
+
+} // namespace test
@@ -0,0 +1,130 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cc/test.h>
+#include <kernel/kernel.h>
+#include <kernel/mem-manager.h>
+
+namespace test {
+
+using namespace rt;
+
+TEST(VirtualMemory) {
+
+    describe("ReserveRegion") {
+        it("should return aligned range and charge account", function {
+            MemManager* mem = GLOBAL_mem_manager();
+            VmAccount account;
+            size_t alignment = 8 * common::Constants::MiB;
+            void* p = mem->ReserveRegion(3 * common::Constants::MiB, alignment, &account);
+            assert_eq(nullptr != p, true);
+            assert_eq(reinterpret_cast<uintptr_t>(p) % alignment, 0);
+            assert_eq(account.reserved(), 4 * common::Constants::MiB);
+            assert_eq(mem->ReleaseRegion(p, 3 * common::Constants::MiB), true);
+            assert_eq(account.reserved(), 0);
+        });
+
+        it("should reuse released address space", function {
+            MemManager* mem = GLOBAL_mem_manager();
+            void* p1 = mem->ReserveRegion(16 * common::Constants::MiB, 0, nullptr);
+            assert_eq(mem->ReleaseRegion(p1, 16 * common::Constants::MiB), true);
+            void* p2 = mem->ReserveRegion(16 * common::Constants::MiB, 0, nullptr);
+            assert_eq(p1 == p2, true);
+            assert_eq(mem->ReleaseRegion(p2, 16 * common::Constants::MiB), true);
+        });
+    }
+
+    describe("CommitRegion") {
+        it("should map zeroed pages lazily and free them on uncommit", function {
+            MemManager* mem = GLOBAL_mem_manager();
+            VmAccount account;
+            size_t page = mem->page_size();
+            uint8_t* p = reinterpret_cast<uint8_t*>(
+                mem->ReserveRegion(4 * page, 0, &account));
+            assert_eq(mem->CommitRegion(p, 4 * page), true);
+            assert_eq(account.committed(), 4 * page);
+
+            uint64_t resident = mem->vm_resident_total();
+            p[0] = 1;
+            p[page] = 1;
+            assert_eq(p[1] == 0 && p[page + 1] == 0, true);
+            assert_eq(mem->vm_resident_total(), resident + 2 * page);
+
+            // Partially covered page stays mapped
+            assert_eq(mem->UncommitRegion(p + page / 2, 2 * page), true);
+            assert_eq(mem->vm_resident_total(), resident + page);
+            assert_eq(account.committed(), 2 * page);
+            assert_eq(p[0], 1);
+
+            assert_eq(mem->ReleaseRegion(p, 4 * page), true);
+            assert_eq(mem->vm_resident_total(), resident);
+            assert_eq(account.committed(), 0);
+        });
+
+        it("should find regions after releasing one in the middle", function {
+            MemManager* mem = GLOBAL_mem_manager();
+            size_t page = mem->page_size();
+            uint8_t* a = reinterpret_cast<uint8_t*>(mem->ReserveRegion(page, 0, nullptr));
+            uint8_t* b = reinterpret_cast<uint8_t*>(mem->ReserveRegion(page, 0, nullptr));
+            uint8_t* c = reinterpret_cast<uint8_t*>(mem->ReserveRegion(page, 0, nullptr));
+            assert_eq(mem->ReleaseRegion(b, page), true);
+
+            assert_eq(mem->CommitRegion(a + page - 1, 1), true);
+            assert_eq(mem->CommitRegion(b, 1), false);
+            assert_eq(mem->CommitRegion(c, 1), true);
+            assert_eq(mem->IsCommitted(c), true);
+
+            assert_eq(mem->ReleaseRegion(a, page), true);
+            assert_eq(mem->ReleaseRegion(c, page), true);
+        });
+
+        it("should track committed blocks", function {
+            MemManager* mem = GLOBAL_mem_manager();
+            VmAccount account;
+            size_t block = MemManager::kCommitBlockSize;
+            size_t page = mem->page_size();
+            uint8_t* p = reinterpret_cast<uint8_t*>(
+                mem->ReserveRegion(2 * page, 0, &account));
+            assert_eq(mem->IsCommitted(p), false);
+
+            // Commit is idempotent and rounds out to blocks
+            assert_eq(mem->CommitRegion(p + block + 1, 2 * block), true);
+            assert_eq(mem->CommitRegion(p + block, 3 * block), true);
+            assert_eq(account.committed(), 3 * block);
+            assert_eq(mem->IsCommitted(p), false);
+            assert_eq(mem->IsCommitted(p + block), true);
+            assert_eq(mem->IsCommitted(p + 3 * block + 1), true);
+            assert_eq(mem->IsCommitted(p + 4 * block), false);
+
+            uint64_t resident = mem->vm_resident_total();
+            p[block] = 1;
+            assert_eq(mem->vm_resident_total(), resident + page);
+
+            // Page stays mapped until its last block is uncommitted
+            assert_eq(mem->UncommitRegion(p + block, block), true);
+            assert_eq(mem->IsCommitted(p + block), false);
+            assert_eq(mem->vm_resident_total(), resident + page);
+            assert_eq(mem->UncommitRegion(p + 2 * block, 2 * block), true);
+            assert_eq(mem->vm_resident_total(), resident);
+            assert_eq(account.committed(), 0);
+
+            assert_eq(mem->ReleaseRegion(p, 2 * page), true);
+            assert_eq(mem->IsCommitted(p + block), false);
+        });
+    }
+}
+
+} // namespace test
@@ -16,6 +16,22 @@
 
 // Include tests here
 #include <cc/test-utils.h>
+#include <cc/test-clock.h>
+#include <cc/test-vm.h>
+#include <cc/test-native-thread.h>
+#include <cc/test-profiler.h>
+#include <cc/test-trace.h>
+#include <cc/test-isolate-memory.h>
+#include <cc/test-fpu.h>
+#include <cc/test-timeouts.h>
+#include <cc/test-byte-stream.h>
+#include <cc/test-spinlock.h>
+#include <cc/test-initrd.h>
+#include <cc/test-indexed-pool.h>
+#include <cc/test-spsc-ring.h>
+#include <cc/test-buffer-pool.h>
+#include <cc/test-call-credits.h>
+#include <cc/test-scheduler.h>
 
 namespace test {
 
@@ -29,6 +45,22 @@ void TestFramework::RunTests() {
     TestSpec spec;
 
     GET_SPEC(Utils);
+    GET_SPEC(Clock);
+    GET_SPEC(VirtualMemory);
+    GET_SPEC(NativeThread);
+    GET_SPEC(Profiler);
+    GET_SPEC(Trace);
+    GET_SPEC(IsolateMemory);
+    GET_SPEC(Fpu);
+    GET_SPEC(Timeouts);
+    GET_SPEC(ByteStream);
+    GET_SPEC(Spinlock);
+    GET_SPEC(Initrd);
+    GET_SPEC(IndexedPool);
+    GET_SPEC(SpscRing);
+    GET_SPEC(BufferPool);
+    GET_SPEC(CallCredits);
+    GET_SPEC(Scheduler);
 
     spec.RunTests();
 }
@@ -19,6 +19,7 @@
 
 #include <vector>
 #include <stdio.h>
+#include <string.h>
 
 #define TEST(NAME) class Test##NAME : public Test { void GetSpec(TestSpec& it); }; \
     void Test##NAME::GetSpec(TestSpec& it)
@@ -102,6 +103,9 @@ public:
        // printf("Done. Completed: %u, failed: %u.\n", _total_completed, _total_failed);
     }
 
+    uint32_t total_completed() const { return _total_completed; }
+    uint32_t total_failed() const { return _total_failed; }
+
     void PrintTestHeader() {
         if (_current_header_print) {
             return;
@@ -0,0 +1,102 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <chrono>
+#include <vector>
+#include <common/crc64.h>
+#include <common/cpu-features.h>
+
+typedef uint64_t (*CRC64Function)(uint64_t crc, const unsigned char* s, uint64_t l);
+
+static double Seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+static void Bench(const char* label, CRC64Function fn,
+                  const std::vector<unsigned char>& data, uint64_t expected) {
+    const size_t kMinBytes = 1024 * 1024 * 1024;
+    size_t rounds = kMinBytes / data.size() + 1;
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t crc = 0;
+    for (size_t i = 0; i < rounds; ++i) {
+        crc = fn(0, &data[0], data.size());
+    }
+    double sec = Seconds(start);
+
+    assert(expected == crc);
+    printf("  %-10s %8.2f GB/s\n", label,
+           static_cast<double>(data.size()) * rounds / sec / 1e9);
+}
+
+int main() {
+    const unsigned char* check = reinterpret_cast<const unsigned char*>("123456789");
+    const uint64_t kCheck = UINT64_C(0xe9c6d914c4b8d9ca);
+    assert(kCheck == CRC64::ComputeTable(0, check, 9));
+    assert(kCheck == CRC64::ComputeSlicing8(0, check, 9));
+    assert(kCheck == CRC64::ComputeSlicing16(0, check, 9));
+    assert(kCheck == CRC64::Compute(0, check, 9));
+
+    bool pclmul = common::CpuFeatures::HasPclmul();
+
+    // Bit-identical results for all lengths and alignments
+    std::vector<unsigned char> data(64 * 1024);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<unsigned char>(rand());
+    }
+    for (size_t len = 0; len < 2048; ++len) {
+        for (size_t offset = 0; offset < 8; ++offset) {
+            uint64_t init = static_cast<uint64_t>(rand()) * 0x9e3779b97f4a7c15ULL;
+            uint64_t crc = CRC64::ComputeTable(init, &data[offset], len);
+            assert(crc == CRC64::ComputeSlicing8(init, &data[offset], len));
+            assert(crc == CRC64::ComputeSlicing16(init, &data[offset], len));
+            assert(crc == CRC64::Compute(init, &data[offset], len));
+            if (pclmul) {
+                assert(crc == CRC64::ComputePclmul(init, &data[offset], len));
+            }
+        }
+    }
+
+    uint64_t expected = CRC64::ComputeTable(0, &data[0], data.size());
+    printf("crc64: %zu KiB buffer, pclmul %s\n", data.size() / 1024,
+           pclmul ? "supported" : "not supported");
+    Bench("table", CRC64::ComputeTable, data, expected);
+    Bench("slicing8", CRC64::ComputeSlicing8, data, expected);
+    Bench("slicing16", CRC64::ComputeSlicing16, data, expected);
+    if (pclmul) {
+        Bench("pclmul", CRC64::ComputePclmul, data, expected);
+    }
+
+    // Boot-time verification of the largest initrd kernel accepts
+    std::vector<unsigned char> initrd(128 * 1024 * 1024);
+    for (size_t i = 0; i < initrd.size(); ++i) {
+        initrd[i] = static_cast<unsigned char>(i * 2654435761U >> 13);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t slow = CRC64::ComputeTable(0, &initrd[0], initrd.size());
+    double table_ms = Seconds(start) * 1000;
+
+    start = std::chrono::steady_clock::now();
+    uint64_t fast = CRC64::Compute(0, &initrd[0], initrd.size());
+    double fast_ms = Seconds(start) * 1000;
+
+    assert(slow == fast);
+    printf("128 MiB initrd: table %.1f ms, dispatched %.1f ms\n", table_ms, fast_ms);
+    return 0;
+}
@@ -0,0 +1,178 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <common/package.h>
+#include <common/crc64.h>
+#include <common/lz4.h>
+
+using namespace package;
+
+class PackageBufferWriter : public PackageWriter {
+public:
+    void WriteData(const void* buf, size_t len) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(buf);
+        data_.insert(data_.end(), p, p + len);
+    }
+    const std::vector<uint8_t>& data() const { return data_; }
+private:
+    std::vector<uint8_t> data_;
+};
+
+static double ElapsedUs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+static const size_t kFiles = 10000;
+static const size_t kFileSize = 4096;
+static const size_t kBootFiles = 16;
+
+// Script-like contents so compression ratio is close to real bundles
+static std::vector<uint8_t> MakeFile(size_t index) {
+    static const char* words[] = {
+        "var ", "function ", "return ", "this.", "require('", "');\n",
+        "module.exports", " = ", "{\n", "}\n", "if (", ") ", "null",
+        "length", "buffer", "callback", "  ", "0x", "prototype.", ";\n"
+    };
+    std::vector<uint8_t> data;
+    uint32_t seed = static_cast<uint32_t>(index) * 2654435761U + 1;
+    while (data.size() < kFileSize) {
+        seed = seed * 1103515245U + 12345U;
+        const char* word = words[(seed >> 16) % (sizeof(words) / sizeof(words[0]))];
+        data.insert(data.end(), word, word + strlen(word));
+        if (0 == (seed & 0x700)) {
+            char num[16];
+            int len = snprintf(num, sizeof(num), "%u", seed >> 20);
+            data.insert(data.end(), num, num + len);
+        }
+    }
+    data.resize(kFileSize);
+    return data;
+}
+
+// Simulates Initrd::Get on boot: lookup, unpack into page aligned
+// cache and verify CRC64 for a few files
+static void BenchBoot(const char* label, const std::vector<uint8_t>& image,
+                      const std::vector<std::string>& names) {
+    auto start = std::chrono::steady_clock::now();
+    PackageReader reader(&image[0], image.size());
+    double open_us = ElapsedUs(start);
+    assert(kFiles == reader.files_count());
+
+    std::vector<void*> cache;
+    size_t cache_size = 0;
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kBootFiles; ++i) {
+        PackageFile file = reader.Find(names[i * (kFiles / kBootFiles)].c_str());
+        assert(!file.empty());
+        const uint8_t* data = file.buf();
+        if (file.compressed()) {
+            size_t size = (file.raw_len() + 4095) & ~static_cast<size_t>(4095);
+            void* buf = nullptr;
+            assert(0 == posix_memalign(&buf, 4096, size));
+            bool ok = LZ4::Decompress(file.buf(), file.len(),
+                                      reinterpret_cast<uint8_t*>(buf), file.raw_len());
+            assert(ok);
+            cache.push_back(buf);
+            cache_size += size;
+            data = reinterpret_cast<const uint8_t*>(buf);
+        }
+        assert(file.crc64() == CRC64::Compute(0, data, file.raw_len()));
+    }
+    double boot_us = ElapsedUs(start);
+
+    start = std::chrono::steady_clock::now();
+    for (const std::string& name : names) {
+        size_t index = reader.IndexOf(name.c_str());
+        assert(PackageReader::kNotFound != index);
+        assert(0 == strcmp(name.c_str(), reader.Get(index).name()));
+    }
+    double lookup_us = ElapsedUs(start);
+    assert(PackageReader::kNotFound == reader.IndexOf("/missing.js"));
+
+    printf("  %s: image %zu KiB, open %.1f us, boot (%zu files) %.1f us, "
+           "cache %zu KiB, lookup %.3f us/file\n",
+           label, image.size() / 1024, open_us, kBootFiles, boot_us,
+           cache_size / 1024, lookup_us / kFiles);
+
+    for (void* buf : cache) {
+        free(buf);
+    }
+}
+
+// Builds 10k file initrd and compares boot work done by the
+// old sequential format (CRC64 every file, linear lookups)
+// with the indexed one (map directory, lazy CRC64 on access),
+// stored raw and LZ4 compressed.
+int main() {
+    PackageBufferWriter raw_writer;
+    PackageBufferWriter lz4_writer;
+    std::vector<std::string> names;
+    for (size_t i = 0; i < kFiles; ++i) {
+        char name[64];
+        snprintf(name, sizeof(name), "/lib/module%05zu/index.js", i);
+        names.push_back(name);
+        std::vector<uint8_t> data = MakeFile(i);
+        raw_writer.AddFileData(PackageFileData(name, data, PackageFileType::DEFAULT));
+        lz4_writer.AddFileData(PackageFileData(name, data, PackageFileType::LZ4));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    raw_writer.Write();
+    lz4_writer.Write();
+    double write_us = ElapsedUs(start);
+
+    printf("initrd: %zu files, %zu bytes each, written in %.1f ms\n",
+           kFiles, kFileSize, write_us / 1000);
+    BenchBoot("indexed raw", raw_writer.data(), names);
+    BenchBoot("indexed lz4", lz4_writer.data(), names);
+
+    // Sequential: verify every file, lookups scan the list
+    const std::vector<uint8_t>& image = raw_writer.data();
+    PackageReader reader(&image[0], image.size());
+    start = std::chrono::steady_clock::now();
+    std::vector<PackageFile> files;
+    for (size_t i = 0; i < reader.files_count(); ++i) {
+        PackageFile file = reader.Get(i);
+        assert(file.crc64() == CRC64::Compute(0, file.buf(), file.len()));
+        files.push_back(file);
+    }
+    double eager_us = ElapsedUs(start);
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kFiles; i += kFiles / 100) {
+        const char* name = names[i].c_str();
+        bool found = false;
+        for (const PackageFile& file : files) {
+            if (0 == strcmp(name, file.name())) {
+                found = true;
+                break;
+            }
+        }
+        assert(found);
+    }
+    double linear_us = ElapsedUs(start) * (kFiles / 100);
+
+    printf("  sequential: crc all %.1f us, lookup %.3f us/file\n",
+           eager_us, linear_us / kFiles);
+    return 0;
+}
@@ -0,0 +1,401 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Microbenchmarks of kernel subsystems built for the host
+// (RUNTIMEJS_PLATFORM_HOST). Optional argument is a name filter:
+//
+//   ./bench-kernel Timeouts
+
+#include <stdlib.h>
+#include <thread>
+#include <bench.h>
+#include <kernel/timeouts.h>
+#include <kernel/byte-stream.h>
+#include <kernel/spinlock.h>
+#include <kernel/initrd.h>
+#include <kernel/indexed-pool.h>
+#include <kernel/spsc-ring.h>
+#include <kernel/buffer-pool.h>
+#include <kernel/scheduler.h>
+#include <common/package.h>
+#include <common/crc64.h>
+#include <common/mem-ops.h>
+#include <common/log-ring.h>
+
+using namespace rt;
+
+static void BM_TimeoutsSetTake(bench::State& state) {
+    size_t count = state.range();
+    std::vector<uint64_t> times(count);
+    for (size_t i = 0; i < count; ++i) {
+        times[i] = static_cast<uint64_t>(rand());
+    }
+
+    Timeouts<uint32_t> timeouts;
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < count; ++i) {
+            timeouts.Set(i, times[i]);
+        }
+        while (timeouts.Elapsed(RAND_MAX)) {
+            bench::DoNotOptimize(timeouts.Take());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_TimeoutsSetTake)->Range(8, 32768);
+
+static void BM_TimeoutsElapsed(bench::State& state) {
+    Timeouts<uint32_t> timeouts;
+    for (uint32_t i = 0; i < 1024; ++i) {
+        timeouts.Set(i, 1000000 + i);
+    }
+    uint64_t now = 0;
+    while (state.KeepRunning()) {
+        bench::DoNotOptimize(timeouts.Elapsed(++now));
+    }
+}
+BENCHMARK(BM_TimeoutsElapsed);
+
+static void BM_ByteStreamAppendValue(bench::State& state) {
+    size_t count = state.range();
+    ByteStream stream;
+    while (state.KeepRunning()) {
+        stream.Clear();
+        for (size_t i = 0; i < count; ++i) {
+            stream.AppendValue<uint32_t>(i);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_ByteStreamAppendValue)->Range(8, 4096);
+
+static void BM_ByteStreamAppendBuffer(bench::State& state) {
+    size_t len = state.range();
+    std::vector<uint8_t> data(len, 0x5a);
+    ByteStream stream;
+    while (state.KeepRunning()) {
+        stream.Clear();
+        stream.AppendValue<uint32_t>(len);
+        memcpy(stream.AppendBuffer(len), &data[0], len);
+    }
+    state.SetBytesProcessed(state.iterations() * len);
+}
+BENCHMARK(BM_ByteStreamAppendBuffer)->Range(8, 1 << 20);
+
+static void BM_ByteStreamRead(bench::State& state) {
+    size_t count = state.range();
+    ByteStream stream;
+    for (size_t i = 0; i < count; ++i) {
+        stream.AppendValue<uint64_t>(i);
+    }
+    while (state.KeepRunning()) {
+        ByteStreamReader reader(stream);
+        uint64_t sum = 0;
+        for (size_t i = 0; i < count; ++i) {
+            sum += reader.ReadValue<uint64_t>();
+        }
+        bench::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_ByteStreamRead)->Range(8, 4096);
+
+static void BM_SpinlockUncontended(bench::State& state) {
+    Locker locker;
+    while (state.KeepRunning()) {
+        ScopedLock lock(locker);
+    }
+}
+BENCHMARK(BM_SpinlockUncontended);
+
+static void BM_SpinlockContended(bench::State& state) {
+    Locker locker;
+    volatile bool stop = false;
+    std::thread other([&locker, &stop]() {
+        while (!stop) {
+            ScopedLock lock(locker);
+        }
+    });
+    while (state.KeepRunning()) {
+        ScopedLock lock(locker);
+    }
+    stop = true;
+    other.join();
+}
+BENCHMARK(BM_SpinlockContended);
+
+class BenchPackageWriter : public package::PackageWriter {
+public:
+    void WriteData(const void* buf, size_t len) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(buf);
+        data_.insert(data_.end(), p, p + len);
+    }
+    std::vector<uint8_t>& data() { return data_; }
+private:
+    std::vector<uint8_t> data_;
+};
+
+static std::vector<uint8_t> BenchPackage(size_t files) {
+    BenchPackageWriter writer;
+    for (size_t i = 0; i < files; ++i) {
+        std::vector<uint8_t> contents(256, static_cast<uint8_t>(i));
+        writer.AddFileData(package::PackageFileData(
+            "/node_modules/module" + std::to_string(i) + "/index.js", contents));
+    }
+    writer.Write();
+    return writer.data();
+}
+
+static void BM_PackageIndexOf(bench::State& state) {
+    size_t files = state.range();
+    std::vector<uint8_t> data = BenchPackage(files);
+    package::PackageReader reader(&data[0], data.size());
+    std::vector<std::string> names;
+    for (size_t i = 0; i < files; ++i) {
+        names.push_back("/node_modules/module" + std::to_string(i) + "/index.js");
+    }
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        bench::DoNotOptimize(reader.IndexOf(names[i++ % files].c_str()));
+    }
+}
+BENCHMARK(BM_PackageIndexOf)->Range(8, 32768);
+
+static void BM_InitrdGet(bench::State& state) {
+    std::vector<uint8_t> data = BenchPackage(1024);
+    Initrd initrd;
+    initrd.Init(&data[0], data.size());
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        std::string name = "/node_modules/module" + std::to_string(i++ % 1024) + "/index.js";
+        bench::DoNotOptimize(initrd.Get(name.c_str()).Data());
+    }
+}
+BENCHMARK(BM_InitrdGet);
+
+static void BM_CRC64(bench::State& state) {
+    size_t len = state.range();
+    std::vector<unsigned char> data(len, 0x5a);
+    while (state.KeepRunning()) {
+        bench::DoNotOptimize(CRC64::Compute(0, &data[0], len));
+    }
+    state.SetBytesProcessed(state.iterations() * len);
+}
+BENCHMARK(BM_CRC64)->Range(64, 1 << 20);
+
+static void BM_MemOpsCopy(bench::State& state) {
+    size_t len = state.range();
+    std::vector<uint8_t> src(len, 0x5a);
+    std::vector<uint8_t> dst(len);
+    while (state.KeepRunning()) {
+        common::MemOps::Copy(&dst[0], &src[0], len);
+        bench::DoNotOptimize(dst[0]);
+    }
+    state.SetBytesProcessed(state.iterations() * len);
+}
+BENCHMARK(BM_MemOpsCopy)->Range(8, 2 << 20);
+
+static void BM_LogRingPushPop(bench::State& state) {
+    static common::LogRing<65536> ring;
+    char line[80];
+    memset(line, 'x', sizeof(line));
+    char out[128];
+    while (state.KeepRunning()) {
+        uint8_t tag;
+        size_t len;
+        ring.Push(1, line, sizeof(line));
+        ring.Pop(&tag, out, sizeof(out), &len);
+    }
+    state.SetBytesProcessed(state.iterations() * sizeof(line));
+}
+BENCHMARK(BM_LogRingPushPop);
+
+// Outstanding promises: pool holds range() values, every
+// iteration takes the oldest one and pushes a new one
+static void BM_IndexedPoolPushTake(bench::State& state) {
+    size_t count = state.range();
+    IndexedPool<uint64_t> pool;
+    std::vector<uint32_t> indexes(count);
+    for (size_t i = 0; i < count; ++i) {
+        indexes[i] = pool.Push(i);
+    }
+    size_t next = 0;
+    while (state.KeepRunning()) {
+        bench::DoNotOptimize(pool.Take(indexes[next]));
+        indexes[next] = pool.Push(next);
+        next = next + 1 == count ? 0 : next + 1;
+    }
+}
+BENCHMARK(BM_IndexedPoolPushTake)->Range(8, 32768)->Arg(100000);
+
+// Previous pool, linear scan for an empty slot
+class LinearPool {
+public:
+    uint32_t Push(uint64_t value) {
+        for (uint32_t i = 0; i < data_.size(); ++i) {
+            if (0 == data_[i]) {
+                data_[i] = value + 1;
+                return i;
+            }
+        }
+        data_.push_back(value + 1);
+        return data_.size() - 1;
+    }
+
+    uint64_t Take(uint32_t index) {
+        uint64_t value = data_[index] - 1;
+        data_[index] = 0;
+        return value;
+    }
+private:
+    std::vector<uint64_t> data_;
+};
+
+static void BM_LinearPoolPushTake(bench::State& state) {
+    size_t count = state.range();
+    LinearPool pool;
+    std::vector<uint32_t> indexes(count);
+    for (size_t i = 0; i < count; ++i) {
+        indexes[i] = pool.Push(i);
+    }
+    size_t next = 0;
+    while (state.KeepRunning()) {
+        bench::DoNotOptimize(pool.Take(indexes[next]));
+        indexes[next] = pool.Push(next);
+        next = next + 1 == count ? 0 : next + 1;
+    }
+}
+BENCHMARK(BM_LinearPoolPushTake)->Range(8, 32768)->Arg(100000);
+
+// Producer and consumer threads stream through 1 MiB ring in
+// range() byte chunks, waiting sides yield instead of doorbells
+static void BM_SpscRingStream(bench::State& state) {
+    const uint32_t kRingSize = 1 << 20;
+    uint32_t chunk = state.range();
+    std::vector<uint8_t> memory(SpscRing::MemorySize(kRingSize) + 64);
+    void* aligned = reinterpret_cast<void*>(
+        (reinterpret_cast<uintptr_t>(&memory[0]) + 63) & ~uintptr_t(63));
+    SpscRing ring(aligned, kRingSize);
+    volatile bool stop = false;
+
+    std::thread consumer([&ring, &stop, chunk]() {
+        std::vector<uint8_t> out(chunk);
+        bool doorbell;
+        while (!stop || ring.Readable() > 0) {
+            if (0 == ring.Read(&out[0], chunk, &doorbell)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::vector<uint8_t> in(chunk, 0x5a);
+    uint64_t bytes = 0;
+    bool doorbell;
+    while (state.KeepRunning()) {
+        uint32_t left = chunk;
+        while (left > 0) {
+            uint32_t written = ring.Write(&in[chunk - left], left, &doorbell);
+            if (0 == written) {
+                std::this_thread::yield();
+            }
+            left -= written;
+        }
+        bytes += chunk;
+    }
+    stop = true;
+    consumer.join();
+    state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_SpscRingStream)->Range(64, 65536);
+
+static void* BenchAllocPages(size_t size) {
+    void* base = memalign(4096, size);
+    memset(base, 0, size);
+    return base;
+}
+
+static void BenchFreePages(void* base, size_t size) {
+    free(base);
+}
+
+// Packet-sized ArrayBuffer stores, bursts of 32 zeroed buffers
+// are allocated and released (what V8 does through allocator)
+static void BM_BufferPoolAlloc(bench::State& state) {
+    const size_t kBurst = 32;
+    size_t len = state.range();
+    BufferPool pool(BenchAllocPages, BenchFreePages, 4096);
+    BackingStore* stores[kBurst];
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < kBurst; ++i) {
+            stores[i] = pool.Alloc(len, true);
+        }
+        bench::DoNotOptimize(stores[0]->data());
+        for (size_t i = 0; i < kBurst; ++i) {
+            stores[i]->Release();
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * kBurst * len);
+}
+BENCHMARK(BM_BufferPoolAlloc)->Arg(64)->Arg(256)->Arg(1500)->Arg(9000);
+
+// Same with calloc, previous allocator
+static void BM_CallocFree(bench::State& state) {
+    const size_t kBurst = 32;
+    size_t len = state.range();
+    void* buffers[kBurst];
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < kBurst; ++i) {
+            buffers[i] = calloc(1, len);
+        }
+        bench::DoNotOptimize(buffers[0]);
+        for (size_t i = 0; i < kBurst; ++i) {
+            free(buffers[i]);
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * kBurst * len);
+}
+BENCHMARK(BM_CallocFree)->Arg(64)->Arg(256)->Arg(1500)->Arg(9000);
+
+// One scheduling decision on an engine with given number of
+// threads, half of them have messages and one is woken by IRQ
+static void BM_MlfqSwitch(bench::State& state) {
+    size_t count = state.range();
+    std::vector<SchedEntity> entities(count);
+    std::vector<SchedEntity*> pointers;
+    for (SchedEntity& e : entities) {
+        pointers.push_back(&e);
+    }
+
+    MlfqScheduler sched;
+    uint64_t now = 0;
+    size_t current = 0;
+    sched.Dispatch(pointers[current], now);
+    while (state.KeepRunning()) {
+        now += 50 * 1000;
+        sched.Stop(pointers[current], now);
+        for (size_t i = 0; i < count; ++i) {
+            pointers[i]->SetReady(0 == (i & 1), i == (now >> 20) % count, now);
+        }
+        current = sched.Pick(pointers.data(), count, current, now);
+        sched.Dispatch(pointers[current], now);
+    }
+    bench::DoNotOptimize(current);
+}
+BENCHMARK(BM_MlfqSwitch)->Range(2, 128);
+
+int main(int argc, char** argv) {
+    common::MemOps::Init();
+    bench::RunAll(argc > 1 ? argv[1] : nullptr);
+    return 0;
+}
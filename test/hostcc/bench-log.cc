@@ -0,0 +1,118 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <stdarg.h>
+#include <atomic>
+#include <chrono>
+#include <printf.h>
+#include <common/log-ring.h>
+
+// Stands in for a device write so the compiler keeps the output
+static volatile char sink;
+static std::atomic_flag lock = ATOMIC_FLAG_INIT;
+
+static void Device(char c) {
+    sink = c;
+}
+
+// Character at a time formatting, writer lock per character
+static void PutCharLocked(void* p, char c, size_t offset) {
+    while (lock.test_and_set(std::memory_order_acquire)) { }
+    Device(c);
+    lock.clear(std::memory_order_release);
+}
+
+static int PrintPerChar(const char* fmt, ...) {
+    va_list va;
+    va_start(va, fmt);
+    int count = tfp_format(nullptr, PutCharLocked, fmt, va);
+    va_end(va);
+    return count;
+}
+
+// One pass into a line buffer, ring push, whole-line drain
+static common::LogRing<4096> ring;
+
+static void Drain() {
+    if (lock.test_and_set(std::memory_order_acquire)) {
+        return;
+    }
+    char line[256];
+    uint8_t tag;
+    size_t len;
+    while (ring.Pop(&tag, line, sizeof(line), &len)) {
+        for (size_t i = 0; i < len; ++i) {
+            Device(line[i]);
+        }
+    }
+    lock.clear(std::memory_order_release);
+}
+
+static int PrintRing(const char* fmt, ...) {
+    char line[256];
+    va_list va;
+    va_start(va, fmt);
+    int count = tfp_vsnprintf(line, sizeof(line), fmt, va);
+    va_end(va);
+    size_t len = static_cast<size_t>(count) < sizeof(line) ? count : sizeof(line) - 1;
+    if (!ring.Push(0, line, len)) {
+        Drain();
+        ring.Push(0, line, len);
+    }
+    Drain();
+    return count;
+}
+
+template<typename F>
+static double LinesPerSecond(F print, size_t lines) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < lines; ++i) {
+        print("[%d] thread %s: value 0x%x, count %u\n",
+              static_cast<int>(i & 7), "engine", static_cast<unsigned>(i * 31), static_cast<unsigned>(i));
+    }
+    double sec = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    return lines / sec;
+}
+
+int main() {
+    const size_t kLines = 2000000;
+
+    // Records survive wrap around intact and in order
+    common::LogRing<64> small;
+    char buf[64];
+    uint8_t tag;
+    size_t len;
+    for (int i = 0; i < 1000; ++i) {
+        int n = snprintf(buf, sizeof(buf), "line %d", i);
+        assert(small.Push(static_cast<uint8_t>(i), buf, n));
+        char out[64];
+        assert(small.Pop(&tag, out, sizeof(out), &len));
+        assert(static_cast<uint8_t>(i) == tag);
+        assert(static_cast<size_t>(n) == len && 0 == memcmp(buf, out, len));
+    }
+    assert(small.empty());
+    assert(!small.Push(0, buf, 61));
+
+    double per_char = LinesPerSecond(PrintPerChar, kLines);
+    double ring_lines = LinesPerSecond(PrintRing, kLines);
+    assert(ring.empty());
+
+    printf("logger: per-char %.2f M lines/s, ring %.2f M lines/s\n",
+           per_char / 1e6, ring_lines / 1e6);
+    return 0;
+}
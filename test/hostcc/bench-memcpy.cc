@@ -0,0 +1,98 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <chrono>
+#include <vector>
+
+// Kernel used to be built with -fno-tree-vectorize because interrupt
+// handlers were entered with misaligned stack. Same copy loop with and
+// without vectorization, plus libc memcpy for reference
+
+typedef void (*CopyFunction)(uint8_t* dst, const uint8_t* src, size_t len);
+
+__attribute__((noinline, optimize("O3", "no-tree-vectorize")))
+static void CopyScalar(uint8_t* dst, const uint8_t* src, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        dst[i] = src[i];
+    }
+}
+
+__attribute__((noinline, optimize("O3", "tree-vectorize")))
+static void CopyVectorized(uint8_t* dst, const uint8_t* src, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        dst[i] = src[i];
+    }
+}
+
+__attribute__((noinline))
+static void CopyLibc(uint8_t* dst, const uint8_t* src, size_t len) {
+    memcpy(dst, src, len);
+}
+
+static double Seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+static double Bench(CopyFunction fn, size_t len, size_t offset) {
+    const size_t kMinBytes = 2ULL * 1024 * 1024 * 1024;
+    std::vector<uint8_t> src(len + 64);
+    std::vector<uint8_t> dst(len + 64);
+    for (size_t i = 0; i < src.size(); ++i) {
+        src[i] = static_cast<uint8_t>(i * 31);
+    }
+
+    size_t rounds = kMinBytes / len + 1;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < rounds; ++i) {
+        fn(&dst[offset], &src[offset], len);
+    }
+    double sec = Seconds(start);
+
+    assert(0 == memcmp(&dst[offset], &src[offset], len));
+    return static_cast<double>(len) * rounds / sec / 1e9;
+}
+
+int main() {
+    // Same results for all lengths and alignments
+    std::vector<uint8_t> src(1024);
+    for (size_t i = 0; i < src.size(); ++i) {
+        src[i] = static_cast<uint8_t>(rand());
+    }
+    for (size_t len = 0; len < 512; ++len) {
+        for (size_t offset = 0; offset < 16; ++offset) {
+            std::vector<uint8_t> a(src.size()), b(src.size());
+            CopyScalar(&a[offset], &src[offset], len);
+            CopyVectorized(&b[offset], &src[offset], len);
+            assert(a == b);
+        }
+    }
+
+    const size_t sizes[] = { 64, 512, 4096, 65536, 1024 * 1024 };
+    printf("memcpy GB/s      %10s %10s %10s\n", "scalar", "vectorized", "libc");
+    for (size_t len : sizes) {
+        for (size_t offset : { 0, 3 }) {
+            printf("  %7zu +%zu     %10.2f %10.2f %10.2f\n", len, offset,
+                   Bench(CopyScalar, len, offset),
+                   Bench(CopyVectorized, len, offset),
+                   Bench(CopyLibc, len, offset));
+        }
+    }
+    return 0;
+}
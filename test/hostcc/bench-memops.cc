@@ -0,0 +1,163 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <chrono>
+#include <vector>
+#include <common/mem-ops.h>
+#include <common/cpu-features.h>
+
+using common::MemOps;
+using common::CpuFeatures;
+
+typedef void* (*CopyFunction)(void* dst, const void* src, size_t n);
+typedef void* (*FillFunction)(void* dst, int c, size_t n);
+
+static void* CopyLibc(void* dst, const void* src, size_t n) {
+    return memcpy(dst, src, n);
+}
+
+static void* FillLibc(void* dst, int c, size_t n) {
+    return memset(dst, c, n);
+}
+
+static double Seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+static size_t Rounds(size_t len) {
+    const size_t kMinBytes = 1024ULL * 1024 * 1024;
+    return kMinBytes / len + 1;
+}
+
+static double BenchCopy(CopyFunction fn, size_t len) {
+    std::vector<uint8_t> src(len + 64, 0x5a);
+    std::vector<uint8_t> dst(len + 64);
+    size_t rounds = Rounds(len);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < rounds; ++i) {
+        fn(&dst[1], &src[0], len);
+        asm volatile("" : : "r"(&dst[0]) : "memory");
+    }
+    return static_cast<double>(len) * rounds / Seconds(start) / 1e9;
+}
+
+static double BenchFill(FillFunction fn, size_t len) {
+    // 64 byte aligned destination, as pages are
+    std::vector<uint8_t> buf(len + 64);
+    uint8_t* dst = reinterpret_cast<uint8_t*>(
+        (reinterpret_cast<uintptr_t>(&buf[0]) + 63) & ~uintptr_t(63));
+    size_t rounds = Rounds(len);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < rounds; ++i) {
+        fn(dst, 0, len);
+        asm volatile("" : : "r"(dst) : "memory");
+    }
+    return static_cast<double>(len) * rounds / Seconds(start) / 1e9;
+}
+
+static void Verify(bool avx2, bool erms) {
+    std::vector<uint8_t> src(1024);
+    for (size_t i = 0; i < src.size(); ++i) {
+        src[i] = static_cast<uint8_t>(rand());
+    }
+
+    std::vector<CopyFunction> copies = { MemOps::Copy, MemOps::CopyScalar,
+        MemOps::CopySse2 };
+    std::vector<FillFunction> fills = { MemOps::Fill, MemOps::FillScalar,
+        MemOps::FillSse2 };
+    if (avx2) {
+        copies.push_back(MemOps::CopyAvx2);
+        fills.push_back(MemOps::FillAvx2);
+    }
+    if (erms) {
+        copies.push_back(MemOps::CopyErms);
+        fills.push_back(MemOps::FillErms);
+    }
+
+    // Bytes around the destination must stay intact
+    for (size_t len = 0; len < 600; ++len) {
+        for (size_t offset = 0; offset < 32; ++offset) {
+            std::vector<uint8_t> expected(src.size(), 0xee);
+            memcpy(&expected[offset], &src[offset ^ 5], len);
+            for (CopyFunction fn : copies) {
+                std::vector<uint8_t> dst(src.size(), 0xee);
+                fn(&dst[offset], &src[offset ^ 5], len);
+                assert(dst == expected);
+            }
+
+            memset(&expected[offset], 0x3c, len);
+            for (FillFunction fn : fills) {
+                std::vector<uint8_t> dst(src.size(), 0xee);
+                memcpy(&dst[offset], &src[offset ^ 5], len);
+                fn(&dst[offset], 0x3c, len);
+                assert(dst == expected);
+            }
+        }
+    }
+
+    // Overlapping moves in both directions
+    for (size_t len = 0; len < 300; ++len) {
+        for (size_t from = 0; from < 40; ++from) {
+            for (size_t to = 0; to < 40; ++to) {
+                std::vector<uint8_t> expected(src.begin(), src.begin() + 400);
+                std::vector<uint8_t> dst(expected);
+                memmove(&expected[to], &expected[from], len);
+                MemOps::Move(&dst[to], &dst[from], len);
+                assert(dst == expected);
+            }
+        }
+    }
+}
+
+int main() {
+    bool avx2 = CpuFeatures::HasAvx2();
+    bool erms = CpuFeatures::HasErms();
+    MemOps::Init();
+    Verify(avx2, erms);
+
+    printf("mem ops: avx2 %s, erms %s\n", avx2 ? "yes" : "no", erms ? "yes" : "no");
+
+    const size_t sizes[] = { 8, 32, 64, 256, 1024, 4096, 16384,
+        65536, 256 * 1024, 2 * 1024 * 1024 };
+
+    printf("copy GB/s  %9s %9s %9s %9s %9s %9s\n",
+           "scalar", "sse2", "avx2", "erms", "dispatch", "libc");
+    for (size_t len : sizes) {
+        printf("  %8zu %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f\n", len,
+               BenchCopy(MemOps::CopyScalar, len),
+               BenchCopy(MemOps::CopySse2, len),
+               avx2 ? BenchCopy(MemOps::CopyAvx2, len) : 0.0,
+               erms ? BenchCopy(MemOps::CopyErms, len) : 0.0,
+               BenchCopy(MemOps::Copy, len),
+               BenchCopy(CopyLibc, len));
+    }
+
+    printf("fill GB/s  %9s %9s %9s %9s %9s %9s\n",
+           "scalar", "sse2", "avx2", "erms", "dispatch", "libc");
+    for (size_t len : sizes) {
+        printf("  %8zu %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f\n", len,
+               BenchFill(MemOps::FillScalar, len),
+               BenchFill(MemOps::FillSse2, len),
+               avx2 ? BenchFill(MemOps::FillAvx2, len) : 0.0,
+               erms ? BenchFill(MemOps::FillErms, len) : 0.0,
+               BenchFill(MemOps::Fill, len),
+               BenchFill(FillLibc, len));
+    }
+    return 0;
+}
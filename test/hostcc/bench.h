@@ -0,0 +1,190 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Minimal microbenchmark runner with Google Benchmark style API:
+//
+//   static void BM_Foo(bench::State& state) {
+//       while (state.KeepRunning()) { ... }
+//   }
+//   BENCHMARK(BM_Foo)->Range(8, 4096);
+//
+// Iteration count grows until a run takes at least kMinSeconds.
+
+namespace bench {
+
+class State {
+public:
+    State(uint64_t iterations, int64_t arg)
+        :	iterations_(iterations),
+            done_(0),
+            arg_(arg),
+            bytes_(0),
+            items_(0),
+            seconds_(0) {}
+
+    bool KeepRunning() {
+        if (0 == done_) {
+            start_ = std::chrono::steady_clock::now();
+        }
+        if (done_ < iterations_) {
+            ++done_;
+            return true;
+        }
+        seconds_ = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start_).count();
+        return false;
+    }
+
+    int64_t range() const { return arg_; }
+    uint64_t iterations() const { return iterations_; }
+    double seconds() const { return seconds_; }
+    uint64_t bytes_processed() const { return bytes_; }
+    uint64_t items_processed() const { return items_; }
+
+    void SetBytesProcessed(uint64_t bytes) { bytes_ = bytes; }
+    void SetItemsProcessed(uint64_t items) { items_ = items; }
+private:
+    uint64_t iterations_;
+    uint64_t done_;
+    int64_t arg_;
+    uint64_t bytes_;
+    uint64_t items_;
+    double seconds_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+typedef void (*Function)(State& state);
+
+class Benchmark {
+public:
+    Benchmark(const char* name, Function fn)
+        :	name_(name),
+            fn_(fn) {}
+
+    Benchmark* Arg(int64_t arg) {
+        args_.push_back(arg);
+        return this;
+    }
+
+    /**
+     * Powers of 8 from lo to hi, both included
+     */
+    Benchmark* Range(int64_t lo, int64_t hi) {
+        for (int64_t arg = lo; arg < hi; arg *= 8) {
+            args_.push_back(arg);
+        }
+        args_.push_back(hi);
+        return this;
+    }
+
+    const char* name() const { return name_; }
+    Function function() const { return fn_; }
+    const std::vector<int64_t>& args() const { return args_; }
+private:
+    const char* name_;
+    Function fn_;
+    std::vector<int64_t> args_;
+};
+
+inline std::vector<Benchmark*>& Registry() {
+    static std::vector<Benchmark*> benchmarks;
+    return benchmarks;
+}
+
+inline Benchmark* Register(const char* name, Function fn) {
+    Benchmark* b = new Benchmark(name, fn);
+    Registry().push_back(b);
+    return b;
+}
+
+/**
+ * Compiler must not optimize value away
+ */
+template<typename T>
+inline void DoNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void Run(Benchmark* b, int64_t arg, bool has_arg) {
+    static const double kMinSeconds = 0.2;
+    static const uint64_t kMaxIterations = 1000000000;
+
+    uint64_t iterations = 1;
+    for (;;) {
+        State state(iterations, arg);
+        b->function()(state);
+
+        if (state.seconds() >= kMinSeconds || iterations >= kMaxIterations) {
+            std::string name = b->name();
+            if (has_arg) {
+                name += "/" + std::to_string(arg);
+            }
+            printf("%-40s %12.1f ns %12lu", name.c_str(),
+                   state.seconds() * 1e9 / iterations,
+                   static_cast<unsigned long>(iterations));
+            if (state.bytes_processed() > 0) {
+                printf(" %10.2f GB/s", state.bytes_processed() / state.seconds() / 1e9);
+            }
+            if (state.items_processed() > 0) {
+                printf(" %10.2f M items/s", state.items_processed() / state.seconds() / 1e6);
+            }
+            printf("\n");
+            return;
+        }
+
+        // Aim a bit past the minimum time
+        double scale = state.seconds() > 0 ? kMinSeconds * 1.4 / state.seconds() : 100;
+        if (scale > 100) {
+            scale = 100;
+        }
+        uint64_t next = static_cast<uint64_t>(iterations * scale);
+        iterations = next > iterations ? next : iterations + 1;
+    }
+}
+
+/**
+ * Run all benchmarks, or only these with filter in the name
+ */
+inline void RunAll(const char* filter) {
+    printf("%-40s %15s %12s\n", "benchmark", "time", "iterations");
+    for (Benchmark* b : Registry()) {
+        if (nullptr != filter && nullptr == strstr(b->name(), filter)) {
+            continue;
+        }
+        if (b->args().empty()) {
+            Run(b, 0, false);
+            continue;
+        }
+        for (int64_t arg : b->args()) {
+            Run(b, arg, true);
+        }
+    }
+}
+
+} // namespace bench
+
+#define BENCHMARK_CONCAT2(A, B) A##B
+#define BENCHMARK_CONCAT(A, B) BENCHMARK_CONCAT2(A, B)
+#define BENCHMARK(NAME) \
+    static bench::Benchmark* BENCHMARK_CONCAT(benchmark_, __LINE__) \
+    __attribute__((unused)) = bench::Register(#NAME, NAME)
@@ -0,0 +1,70 @@
+// Copyright 2014 Runtime.JS project authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Kernel subsystems built for the host (RUNTIMEJS_PLATFORM_HOST),
+// same specs as in-kernel test/cc runner
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <cc/test.h>
+#include <cc/test-utils.h>
+#include <cc/test-timeouts.h>
+#include <cc/test-byte-stream.h>
+#include <cc/test-spinlock.h>
+#include <cc/test-initrd.h>
+#include <cc/test-indexed-pool.h>
+#include <cc/test-spsc-ring.h>
+#include <cc/test-buffer-pool.h>
+#include <cc/test-call-credits.h>
+#include <cc/test-scheduler.h>
+
+namespace test {
+
+TestFramework::TestFramework() {
+
+}
+
+#define GET_SPEC(NAME) static_cast<Test*>(new Test##NAME)->GetSpec(spec);
+
+void TestFramework::RunTests() {
+    TestSpec spec;
+
+    GET_SPEC(Utils);
+    GET_SPEC(Timeouts);
+    GET_SPEC(ByteStream);
+    GET_SPEC(Spinlock);
+    GET_SPEC(Initrd);
+    GET_SPEC(IndexedPool);
+    GET_SPEC(SpscRing);
+    GET_SPEC(BufferPool);
+    GET_SPEC(CallCredits);
+    GET_SPEC(Scheduler);
+
+    spec.RunTests();
+    printf("host tests: %u completed, %u failed\n",
+           spec.total_completed(), spec.total_failed());
+    if (spec.total_failed() > 0) {
+        exit(1);
+    }
+}
+
+#undef GET_SPEC
+
+} // namespace test
+
+int main() {
+    test::TestFramework framework;
+    framework.RunTests();
+    return 0;
+}
@@ -0,0 +1,52 @@
+// Packet-sized ArrayBuffer allocation benchmark
+//
+// Allocates buffers of typical packet sizes and reports buffers
+// per second. Buffers are either left to GC or handed back to
+// the pool with runtime.recycleBuffer, which makes the next
+// allocation of the same size class reuse the same memory
+// (memoryInfo().bufferStoresReused counts these).
+//
+//   require('./bench-buffers.js')(resources.natives,
+//     function(line) { runtime.log(line) })
+
+var BUFFERS = 200000
+var SIZES = [64, 576, 1500, 9000]
+
+function measure(size, recycle) {
+  var start = Date.now()
+  var sum = 0
+  for (var i = 0; i < BUFFERS; i++) {
+    var buffer = new ArrayBuffer(size)
+    var bytes = new Uint8Array(buffer)
+    bytes[0] = i & 0xff
+    sum += bytes[size - 1]
+    if (recycle) {
+      runtime.recycleBuffer(buffer)
+    }
+  }
+
+  if (0 !== sum) {
+    throw new Error('bench-buffers: buffer was not zeroed')
+  }
+
+  var elapsed = Math.max(1, Date.now() - start)
+  return Math.round(BUFFERS * 1000 / elapsed)
+}
+
+function run(natives, log) {
+  var results = []
+  SIZES.forEach(function(size) {
+    var before = natives.memoryInfo().bufferStoresReused || 0
+    var gc = measure(size, false)
+    var recycled = measure(size, true)
+    var reused = (natives.memoryInfo().bufferStoresReused || 0) - before
+    results.push({ size: size, gc: gc, recycled: recycled, reused: reused })
+    if (log) {
+      log('buffers: ' + size + ' bytes, gc ' + gc + '/s, recycled ' +
+          recycled + '/s, reused ' + reused)
+    }
+  })
+  return results
+}
+
+module.exports = run
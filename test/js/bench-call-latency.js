@@ -0,0 +1,63 @@
+// Function call latency benchmark
+//
+// Calls an echo function through external function wrappers one
+// call at a time and reports average round trip. Same-isolate
+// wrapper (function exported by this isolate and passed back to
+// it) runs from a microtask with original arguments. Cross-isolate
+// wrapper goes through serialization and the receiver mailbox.
+// Runs on the isolate engine (process manager).
+//
+//   require('./bench-call-latency.js')(resources.processManager,
+//     function(line) { runtime.log(line) })
+
+var CALLS = 20000
+
+function child() {
+  var args = runtime.args()
+  function echo(value) {
+    return value
+  }
+  runtime.callBatch(args.ready, [[echo, args.echo]])
+}
+
+function measure(fn, done) {
+  var left = CALLS
+  var start = Date.now()
+
+  function next(value) {
+    if (--left === 0) {
+      var elapsed = Date.now() - start
+      return done(elapsed * 1000 / CALLS)
+    }
+    fn(value + 1).then(next)
+  }
+
+  fn(0).then(next)
+}
+
+function run(processManager, log) {
+  var result = {}
+
+  function echo(value) {
+    return value
+  }
+
+  function ready(remoteEcho, localEcho) {
+    measure(localEcho, function(local) {
+      result.local = local
+      measure(remoteEcho, function(remote) {
+        result.remote = remote
+        if (log) {
+          log('call latency: same isolate ' + local.toFixed(2) + ' us' +
+              ', cross isolate ' + remote.toFixed(2) + ' us')
+        }
+      })
+    })
+  }
+
+  processManager.create('(' + child.toString() + ')()',
+                        { ready: ready, echo: echo })
+  return result
+}
+
+module.exports = run
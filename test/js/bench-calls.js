@@ -0,0 +1,118 @@
+// Cross-isolate call benchmark
+//
+// Starts a process which exports an echo function and calls it
+// with runtime.callBatch, 1, 16 and 256 calls per batch. Batch
+// travels as one message and its results as one reply, so the
+// per-message cost (serialization buffer, promise, mailbox lock
+// and wakeup) is shared by all calls in it. Coalesced mode makes
+// separate single-call batches in one turn, these share a
+// message too. Functions which return a promise can't be batched,
+// this is checked first. Runs on the isolate engine (process
+// manager).
+//
+//   require('./bench-calls.js')(resources.processManager,
+//     function(line) { runtime.log(line) })
+
+var TOTAL_CALLS = 65536
+var BATCH_SIZES = [1, 16, 256]
+
+function child() {
+  var args = runtime.args()
+  function echo(value) {
+    return value
+  }
+  function later(value) {
+    return Promise.resolve(value)
+  }
+  runtime.callBatch(args.ready, [[echo, later]])
+}
+
+function checkAsync(later, done) {
+  runtime.callBatch(later, [[1]]).then(function() {
+    throw new Error('bench-calls: async function was batched')
+  }, function(err) {
+    if (!/cannot be batched/.test(String(err))) {
+      throw new Error('bench-calls: unexpected error ' + err)
+    }
+    done()
+  })
+}
+
+function measure(echo, size, coalesced, done) {
+  var list = []
+  for (var i = 0; i < size; i++) {
+    list.push([i])
+  }
+
+  var left = TOTAL_CALLS / size
+  var start = Date.now()
+
+  function batch() {
+    if (!coalesced) {
+      return runtime.callBatch(echo, list)
+    }
+
+    var calls = []
+    for (var i = 0; i < size; i++) {
+      calls.push(runtime.callBatch(echo, [list[i]]))
+    }
+    return Promise.all(calls)
+  }
+
+  function next() {
+    batch().then(function(results) {
+      if (results.length !== size) {
+        throw new Error('bench-calls: wrong number of results')
+      }
+
+      if (--left > 0) {
+        return next()
+      }
+
+      var elapsed = Math.max(1, Date.now() - start)
+      done(Math.round(TOTAL_CALLS * 1000 / elapsed))
+    })
+  }
+
+  next()
+}
+
+function run(processManager, log) {
+  var results = []
+  var cases = []
+  BATCH_SIZES.forEach(function(size) {
+    cases.push({ size: size, coalesced: false })
+    if (size > 1) {
+      cases.push({ size: size, coalesced: true })
+    }
+  })
+
+  function ready(echo, later) {
+    var index = 0
+
+    function step() {
+      if (index >= cases.length) {
+        return
+      }
+
+      var c = cases[index++]
+      measure(echo, c.size, c.coalesced, function(callsPerSecond) {
+        results.push({ size: c.size, coalesced: c.coalesced,
+                       callsPerSecond: callsPerSecond })
+        if (log) {
+          log('calls: batch ' + c.size +
+              (c.coalesced ? ' coalesced' : '') + ' ' +
+              callsPerSecond + ' calls/s')
+        }
+        step()
+      })
+    }
+
+    checkAsync(later, step)
+  }
+
+  processManager.create('(' + child.toString() + ')()', { ready: ready })
+  return results
+}
+
+module.exports = run
@@ -0,0 +1,122 @@
+// Shared memory channel throughput benchmark
+//
+// Streams bytes to another process through ring channel
+// (natives.createChannel) and reports GB/s for a few chunk
+// sizes. Both sides map ring as ArrayBuffer, data is written and
+// read in place, only commit/consume update ring indices. Doorbell
+// message is sent only when one side waits for the other. Runs on
+// the isolate engine (process manager).
+//
+//   require('./bench-channel.js')(resources.processManager,
+//     resources.natives, function(line) { runtime.log(line) })
+
+var RING_SIZE = 1 << 20
+var TOTAL_BYTES = 256 * 1024 * 1024
+var CHUNKS = [256, 4096, 65536]
+
+// Ring header layout, see SpscRing
+var HEAD = 0
+var TAIL = 16
+var DATA = 128
+
+function child() {
+  var args = runtime.args()
+  var channel = args.channel
+  var size = channel.size()
+  var words = new Uint32Array(channel.buffer(), 0, 32)
+  var data = new Uint8Array(channel.buffer(), 128, size)
+  var received = 0
+  var checksum = 0
+
+  function pump() {
+    for (;;) {
+      var readable = (words[0] - words[16]) >>> 0
+      if (0 === readable) {
+        if (channel.wait(pump)) {
+          return
+        }
+        continue
+      }
+
+      var offset = words[16] & (size - 1)
+      var n = Math.min(readable, size - offset)
+      checksum = (checksum + data[offset]) | 0
+      channel.consume(n)
+      received += n
+      if (received >= args.bytes) {
+        runtime.callBatch(args.done, [[received, checksum]])
+        return
+      }
+    }
+  }
+
+  pump()
+}
+
+function measure(processManager, natives, chunk, done) {
+  var endpoints = natives.createChannel(RING_SIZE)
+  var producer = endpoints[0]
+  var words = new Uint32Array(producer.buffer(), 0, 32)
+  var data = new Uint8Array(producer.buffer(), DATA, RING_SIZE)
+  var payload = new Uint8Array(chunk)
+  var sent = 0
+  var start = Date.now()
+
+  for (var i = 0; i < chunk; i++) {
+    payload[i] = i & 0xff
+  }
+
+  function finished(received) {
+    var elapsed = Math.max(1, Date.now() - start)
+    done(received / elapsed / 1e6)
+  }
+
+  function pump() {
+    while (sent < TOTAL_BYTES) {
+      var writable = RING_SIZE - ((words[HEAD] - words[TAIL]) >>> 0)
+      if (writable < chunk) {
+        if (producer.wait(pump)) {
+          return
+        }
+        continue
+      }
+
+      // Chunk sizes divide ring size, chunk never wraps
+      data.set(payload, words[HEAD] & (RING_SIZE - 1))
+      producer.commit(chunk)
+      sent += chunk
+    }
+  }
+
+  processManager.create('(' + child.toString() + ')()', {
+    channel: endpoints[1],
+    bytes: TOTAL_BYTES,
+    done: finished
+  })
+  pump()
+}
+
+function run(processManager, natives, log) {
+  var results = []
+  var index = 0
+
+  function step() {
+    if (index >= CHUNKS.length) {
+      return
+    }
+
+    var chunk = CHUNKS[index++]
+    measure(processManager, natives, chunk, function(gbps) {
+      results.push({ chunk: chunk, gbps: gbps })
+      if (log) {
+        log('channel: chunk ' + chunk + ' ' + gbps.toFixed(2) + ' GB/s')
+      }
+      step()
+    })
+  }
+
+  step()
+  return results
+}
+
+module.exports = run
@@ -0,0 +1,111 @@
+// IRQ-to-handler latency benchmark
+//
+// This isolate is a driver: it programs the RTC periodic
+// interrupt (IRQ 8) at 1024 Hz and handles it. Latency from the
+// interrupt to the start of the JS handler is measured by the
+// kernel (schedulerInfo). It is measured first on an idle engine,
+// then with a CPU-bound background isolate which never yields
+// for less than its full slice. The scheduler runs driver
+// isolates woken by IRQs first, latency should stay close to the
+// idle one instead of growing to a whole background turn.
+//
+//   require('./bench-irq-latency.js')(resources,
+//     function(line) { runtime.log(line) })
+
+var IRQ = 8
+var RATE = 6  // 32768 >> (RATE - 1) Hz
+var SAMPLES = 2048
+var BUSY_MS = 20
+var BACKGROUND_MS = 10000
+
+function background() {
+  var args = runtime.args()
+  var end = Date.now() + args.duration
+  var x = 0
+
+  // Long turns with no messages in between
+  function spin() {
+    var until = Date.now() + args.busy
+    while (Date.now() < until) {
+      x = (x * 31 + 7) | 0
+    }
+    if (Date.now() < end) {
+      setTimeout(spin, 0)
+    }
+  }
+  runtime.callBatch(args.ready, [[]])
+  spin()
+}
+
+function run(resources, log) {
+  var index = resources.ioRange.port(0x70)
+  var data = resources.ioRange.port(0x71)
+  var natives = resources.natives
+  var phases = []
+  var phase = null
+  var prev = null
+
+  function cmos(reg) {
+    index.write8(0x80 | reg)
+    return data.read8()
+  }
+
+  function setCmos(reg, value) {
+    index.write8(0x80 | reg)
+    data.write8(value)
+  }
+
+  function start(name, done) {
+    prev = natives.schedulerInfo()
+    phase = { name: name, count: 0, done: done }
+  }
+
+  function finish() {
+    var info = natives.schedulerInfo()
+    var count = info.irqCount - prev.irqCount
+    var total = info.irqLatency * info.irqCount - prev.irqLatency * prev.irqCount
+    var result = { name: phase.name, irqs: count,
+                   latency: count ? total / count : 0,
+                   maxLatency: info.irqLatencyMax, level: info.level }
+    phases.push(result)
+    if (log) {
+      log('irq latency, ' + result.name + ': ' + result.latency.toFixed(3) +
+          ' ms average, ' + result.maxLatency.toFixed(3) + ' ms max so far' +
+          ' (' + result.irqs + ' irqs, level ' + result.level + ')')
+    }
+
+    var done = phase.done
+    phase = null
+    done()
+  }
+
+  resources.irqRange.irq(IRQ).on(function() {
+    // Reading register C acknowledges the interrupt
+    cmos(0x0c)
+    if (phase && ++phase.count === SAMPLES) {
+      finish()
+    }
+  })
+
+  setCmos(0x0a, (cmos(0x0a) & 0xf0) | RATE)
+  setCmos(0x0b, cmos(0x0b) | 0x40)
+  cmos(0x0c)
+
+  function stop() {
+    setCmos(0x0b, cmos(0x0b) & ~0x40)
+  }
+
+  start('idle engine', function() {
+    resources.processManager.create('(' + background.toString() + ')()', {
+      busy: BUSY_MS,
+      duration: BACKGROUND_MS,
+      ready: function() {
+        start('CPU-bound background isolate', stop)
+      }
+    })
+  })
+
+  return phases
+}
+
+module.exports = run
@@ -0,0 +1,73 @@
+// Promise reply throughput benchmark
+//
+// Keeps a window of calls to a function in another process in
+// flight and counts replies per second. Every reply is its own
+// message. Replies which arrive together are settled in one
+// mailbox drain, and their continuations run at one microtask
+// checkpoint. Runs on the isolate engine (process manager).
+//
+//   require('./bench-replies.js')(resources.processManager,
+//     function(line) { runtime.log(line) })
+
+var REPLIES = 100000
+var WINDOWS = [1, 16, 256]
+
+function child() {
+  var args = runtime.args()
+  function echo(value) {
+    return value
+  }
+  runtime.callBatch(args.ready, [[echo]])
+}
+
+function measure(echo, window, done) {
+  var sent = 0
+  var received = 0
+  var start = Date.now()
+
+  function send() {
+    echo(sent++).then(function() {
+      if (++received === REPLIES) {
+        var elapsed = Math.max(1, Date.now() - start)
+        return done(Math.round(REPLIES * 1000 / elapsed))
+      }
+      if (sent < REPLIES) {
+        send()
+      }
+    })
+  }
+
+  for (var i = 0; i < window; i++) {
+    send()
+  }
+}
+
+function run(processManager, log) {
+  var results = []
+
+  function ready(echo) {
+    var index = 0
+
+    function step() {
+      if (index >= WINDOWS.length) {
+        return
+      }
+
+      var window = WINDOWS[index++]
+      measure(echo, window, function(repliesPerSecond) {
+        results.push({ window: window, repliesPerSecond: repliesPerSecond })
+        if (log) {
+          log('replies: window ' + window + ' ' + repliesPerSecond + ' replies/s')
+        }
+        step()
+      })
+    }
+
+    step()
+  }
+
+  processManager.create('(' + child.toString() + ')()', { ready: ready })
+  return results
+}
+
+module.exports = run
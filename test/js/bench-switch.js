@@ -0,0 +1,44 @@
+// Context switch benchmark
+//
+// Kernel thread and a native thread yield to each other. Without
+// SIMD neither thread touches FPU registers and lazy switching
+// skips save and restore. With SIMD both threads do, and every
+// switch pays for #NM, XSAVE and XRSTOR (same as eager switching).
+// Needs background CPUs offline, worker runs on this CPU.
+//
+//   require('./bench-switch.js')(function(line) { screen.write(line) })
+
+var ITERATIONS = 100000
+
+function run(log) {
+  var info = fpu.info()
+  var lazy = fpu.benchSwitch(ITERATIONS, false)
+  var simd = fpu.benchSwitch(ITERATIONS, true)
+  if (!lazy || !simd) {
+    if (log) {
+      log('switch bench: background CPUs are online, skipped')
+    }
+    return null
+  }
+
+  var result = {
+    xsave: info.xsave,
+    avx: info.avx,
+    stateSize: info.stateSize,
+    lazy: lazy.cycles,
+    simd: simd.cycles,
+    restores: simd.restores
+  }
+
+  if (log) {
+    log('context switch: ' + result.lazy.toFixed(0) + ' cycles,' +
+        ' with SIMD state ' + result.simd.toFixed(0) + ' cycles' +
+        ' (' + result.restores + ' restores, ' +
+        (result.xsave ? 'xsave ' : 'fxsave ') + result.stateSize + ' bytes' +
+        (result.avx ? ', avx' : '') + ')')
+  }
+
+  return result
+}
+
+module.exports = run
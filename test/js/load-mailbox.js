@@ -0,0 +1,107 @@
+// Mailbox backpressure load test
+//
+// Producer calls a slow consumer function as fast as it can.
+// Consumer mailbox admits CAPACITY calls, the rest waits in the
+// producer until consumer returns credits, calls over PENDING
+// are rejected. Consumer replies with its mailbox high watermark,
+// which stays bounded however far producer runs ahead. Producer
+// heap stays flat as well.
+//
+//   require('./load-mailbox.js')(resources.processManager, natives,
+//     function(line) { runtime.log(line) })
+
+var CAPACITY = 256
+var PENDING = 1024
+var BURST = 4096
+var ROUNDS = 200
+var SAMPLE_EVERY = 20
+
+function child() {
+  var args = runtime.args()
+  runtime.setMailboxLimits(args.capacity, args.pending)
+
+  function consume(value) {
+    // Slower than producer, a few microseconds per call
+    var x = value
+    for (var i = 0; i < 2000; i++) {
+      x = (x * 31 + i) | 0
+    }
+    return runtime.mailboxInfo().highWatermark
+  }
+  runtime.callBatch(args.ready, [[consume]])
+}
+
+function run(processManager, natives, log) {
+  var samples = []
+  var sent = 0
+  var resolved = 0
+  var rejected = 0
+  var watermark = 0
+
+  function sample(round) {
+    var mailbox = natives.mailboxInfo()
+    var memory = natives.memoryInfo()
+    samples.push({ round: round, deferred: mailbox.deferred,
+                   heapUsed: memory.heapUsed, watermark: watermark })
+    if (log) {
+      log('mailbox load: round ' + round + ', ' + sent + ' sent, ' +
+          resolved + ' done, ' + rejected + ' rejected, ' +
+          mailbox.deferred + ' waiting, consumer watermark ' + watermark +
+          ', heap ' + Math.round(memory.heapUsed / 1024) + ' KiB')
+    }
+  }
+
+  function finish() {
+    var first = samples[1] || samples[0]
+    var last = samples[samples.length - 1]
+    var bounded = watermark <= CAPACITY + 16 &&
+                  last.deferred <= PENDING
+    var flat = last.heapUsed <= 2 * Math.max(first.heapUsed, 4 * 1024 * 1024)
+    if (log) {
+      log('mailbox load: ' + (bounded && flat ? 'OK' :
+          'FAILED, mailbox or heap keeps growing'))
+    }
+  }
+
+  function ready(consume) {
+    var round = 0
+
+    function onResult(value) {
+      ++resolved
+      if (value > watermark) {
+        watermark = value
+      }
+    }
+
+    function onReject() {
+      ++rejected
+    }
+
+    function burst() {
+      for (var i = 0; i < BURST; i++) {
+        ++sent
+        consume(i).then(onResult, onReject)
+      }
+
+      if (++round % SAMPLE_EVERY === 0) {
+        sample(round)
+      }
+      if (round < ROUNDS) {
+        setTimeout(burst, 0)
+      } else {
+        finish()
+      }
+    }
+
+    natives.setMailboxLimits(natives.mailboxInfo().capacity, PENDING)
+    sample(0)
+    burst()
+  }
+
+  processManager.create('(' + child.toString() + ')()',
+                        { ready: ready, capacity: CAPACITY,
+                          pending: PENDING })
+  return samples
+}
+
+module.exports = run
@@ -0,0 +1,79 @@
+// Function export soak test
+//
+// Sends requests to a service process, every request carries a
+// new callback closure. Exports are released when the service
+// drops its callback wrappers, so export table size and heap
+// stay flat however many requests are made.
+//
+//   require('./soak-exports.js')(resources.processManager, natives,
+//     function(line) { runtime.log(line) })
+
+var REQUESTS = 200000
+var WINDOW = 64
+var SAMPLE_EVERY = 20000
+
+function child() {
+  var args = runtime.args()
+  function handle(value, callback) {
+    runtime.callBatch(callback, [[value * 2]])
+    return value
+  }
+  runtime.callBatch(args.ready, [[handle]])
+}
+
+function run(processManager, natives, log) {
+  var samples = []
+
+  function sample(done) {
+    var info = natives.memoryInfo()
+    samples.push({ requests: done, exports: info.exports,
+                   slots: info.exportSlots, heapUsed: info.heapUsed })
+    if (log) {
+      log('exports soak: ' + done + ' requests, ' + info.exports +
+          ' exports, ' + info.exportSlots + ' slots, heap ' +
+          Math.round(info.heapUsed / 1024) + ' KiB')
+    }
+  }
+
+  function finish() {
+    var first = samples[1] || samples[0]
+    var last = samples[samples.length - 1]
+    var flat = last.slots <= 2 * Math.max(first.slots, WINDOW)
+    if (log) {
+      log('exports soak: ' + (flat ? 'OK' : 'FAILED, table keeps growing'))
+    }
+  }
+
+  function ready(handle) {
+    var sent = 0
+    var done = 0
+
+    function send() {
+      var id = sent++
+      // New closure per request, exported with the request
+      runtime.callBatch(handle, [[id, function(result) {
+        if (result !== id * 2) {
+          throw new Error('exports soak: wrong result')
+        }
+        if (++done % SAMPLE_EVERY === 0) {
+          sample(done)
+        }
+        if (sent < REQUESTS) {
+          send()
+        } else if (done === REQUESTS) {
+          finish()
+        }
+      }]])
+    }
+
+    sample(0)
+    for (var i = 0; i < WINDOW; i++) {
+      send()
+    }
+  }
+
+  processManager.create('(' + child.toString() + ')()', { ready: ready })
+  return samples
+}
+
+module.exports = run